@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/framework/attr_map.h"
 #include "oneflow/core/framework/nd_sbp.h"
 #include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
 #include "oneflow/core/framework/tensor.h"
@@ -123,6 +124,16 @@ ONEFLOW_API_PYBIND11_MODULE("one", m) {
   auto py_user_op_class = PybindExportOpExpr<one::UserOpExpr, cfg::UserOpConf>(m, "UserOpExpr");
   py_user_op_class.def_property_readonly(
       "op_type_name", [](const one::UserOpExpr& op) { return op.proto().op_type_name(); });
+  py_user_op_class.def_property_readonly("local_tensor_infer_cache_hit_count",
+                                         [](const one::UserOpExpr& op) {
+                                           return op.mut_local_tensor_infer_cache()->hit_count();
+                                         });
+  py_user_op_class.def_property_readonly("local_tensor_infer_cache_miss_count",
+                                         [](const one::UserOpExpr& op) {
+                                           return op.mut_local_tensor_infer_cache()->miss_count();
+                                         });
+  m.def("GetLocalTensorInferCacheHitCount", &one::LocalTensorInferCache::TotalHitCount);
+  m.def("GetLocalTensorInferCacheMissCount", &one::LocalTensorInferCache::TotalMissCount);
   PybindExportOpExpr<one::VariableOpExpr, cfg::VariableOpConf>(m, "VariableOpExpr");
   // NOTE(chengcheng): export for Lazy nn.Graph Feed/Fetch EagerTensor to/from LazyTensor.
   PybindExportOpExpr<one::FeedInputOpExpr, cfg::FeedInputOpConf>(m, "FeedInputOpExpr");
@@ -17,6 +17,8 @@ limitations under the License.
 #include "oneflow/api/python/of_api_registry.h"
 
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/host_tracer.h"
+#include "oneflow/core/profiler/op_stats.h"
 
 namespace py = pybind11;
 
@@ -30,6 +32,34 @@ ONEFLOW_API_PYBIND11_MODULE("profiler", m) {
   m.def("ProfilerStart", []() { profiler::ProfilerStart(); });
 
   m.def("ProfilerStop", []() { profiler::ProfilerStop(); });
+
+  m.def("StartHostTrace", []() { profiler::StartHostTrace(); });
+
+  m.def("StopHostTrace", []() { profiler::StopHostTrace(); });
+
+  m.def("DumpHostTrace",
+        [](const std::string& path) { return profiler::DumpHostTrace(path).GetOrThrow(); });
+
+  m.def("EnableOpStats", [](bool enabled) { profiler::EnableOpStats(enabled); });
+
+  m.def("ResetOpStats", []() { profiler::ResetOpStats(); });
+
+  m.def("GetOpStats", [](bool group_by_op_type) {
+    py::list stats;
+    for (const auto& summary : profiler::GetOpStats(group_by_op_type)) {
+      py::dict stat;
+      stat["name"] = summary.name;
+      stat["op_type"] = summary.op_type;
+      stat["count"] = summary.count;
+      stat["total_ns"] = summary.total_ns;
+      stat["p50_ns"] = summary.p50_ns;
+      stat["p99_ns"] = summary.p99_ns;
+      stat["input_bytes"] = summary.input_bytes;
+      stat["output_bytes"] = summary.output_bytes;
+      stats.append(stat);
+    }
+    return stats;
+  });
 }
 
 }  // namespace oneflow
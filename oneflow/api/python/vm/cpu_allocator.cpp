@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/vm/cpu_allocator.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+namespace vm {
+
+ONEFLOW_API_PYBIND11_MODULE("vm", m) {
+  m.def("CpuAllocatorEmptyCache", []() { Global<CpuAllocator>::Get()->EmptyCache(); });
+  m.def("CpuAllocatorResetPeakInUseBytes",
+        []() { Global<CpuAllocator>::Get()->ResetPeakInUseBytes(); });
+  m.def("CpuAllocatorMemoryStats", []() {
+    const CpuAllocator* allocator = Global<CpuAllocator>::Get();
+    py::dict stats;
+    stats["reserved_bytes"] = allocator->reserved_bytes();
+    stats["in_use_bytes"] = allocator->in_use_bytes();
+    stats["peak_in_use_bytes"] = allocator->peak_in_use_bytes();
+    return stats;
+  });
+}
+
+}  // namespace vm
+}  // namespace oneflow
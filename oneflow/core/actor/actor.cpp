@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/runtime_job_descs.h"
 #include "oneflow/core/stream/stream_context.h"
+#include "oneflow/core/profiler/host_tracer.h"
 
 namespace oneflow {
 
@@ -429,7 +430,13 @@ int Actor::HandlerZombie(const ActorMsg& msg) {
 
 void Actor::ActUntilFail() {
   while (IsReadReady() && IsWriteReady()) {
-    Act();
+    {
+      profiler::HostTraceRange trace_range("actor", [&]() -> std::string {
+        if (exec_kernel_vec_.empty()) { return "actor " + std::to_string(actor_id()); }
+        return exec_kernel_vec_.front().kernel->op_conf().name();
+      });
+      Act();
+    }
 
     AsyncSendCustomizedProducedRegstMsgToConsumer();
     AsyncSendNaiveProducedRegstMsgToConsumer();
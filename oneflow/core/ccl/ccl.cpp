@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/ccl/ccl.h"
+#include "oneflow/core/ccl/shm_comm_ctx.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/framework/transport_util.h"
 #include "oneflow/core/job/parallel_desc.h"
@@ -21,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/common/data_type_seq.h"
 #include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/spin_counter.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
@@ -51,11 +53,10 @@ int64_t RingIncrease(int64_t n, int64_t size) { return (n + 1 + size) % size; }
 
 template<typename T>
 void VecAdd(size_t size, T* out, const T* in0, const T* in1) {
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  BalancedSplitter bs(size, thread_num);
-  MultiThreadLoop(thread_num, [&](size_t thread_idx) {
-    size_t end = bs.At(thread_idx).end();
-    for (size_t i = bs.At(thread_idx).begin(); i < end; ++i) { out[i] = in0[i] + in1[i]; }
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  const int64_t grain = RoundUp(size, thread_pool->thread_num()) / thread_pool->thread_num();
+  thread_pool->ParallelFor(0, size, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) { out[i] = in0[i] + in1[i]; }
   });
 }
 
@@ -64,89 +65,347 @@ void VecAdd(size_t size, T* out, const T* in0, const T* in1) {
 template<typename T, ReduceType reduce_type>
 struct DtypeAllReduce;
 
+namespace {
+
+// Every part of a ring all-reduce is cut into chunks of about this size, so that the reduction of
+// one chunk overlaps with the transfer of the next ones.
+const int64_t kDefaultRingChunkSize = 512 * 1024;
+const int64_t kMaxRingChunkNumPerPart = 64;
+// Messages smaller than this use recursive halving/doubling, which takes log(n) steps instead of
+// the 2 * (n - 1) latency-bound steps of the ring.
+const int64_t kDefaultRingAllReduceThreshold = 1024 * 1024;
+
+int64_t RingChunkNum(size_t part_byte_size) {
+  static const int64_t chunk_size = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_CCL_CPU_RING_CHUNK_SIZE", kDefaultRingChunkSize), 1);
+  const int64_t chunk_num = (static_cast<int64_t>(part_byte_size) + chunk_size - 1) / chunk_size;
+  return std::min(std::max<int64_t>(chunk_num, 1), kMaxRingChunkNumPerPart);
+}
+
+bool UseRingAllReduce(size_t byte_size, int64_t parallel_num) {
+  static const int64_t threshold = ParseIntegerFromEnv("ONEFLOW_CCL_CPU_ALL_REDUCE_RING_THRESHOLD",
+                                                       kDefaultRingAllReduceThreshold);
+  return parallel_num <= 2 || static_cast<int64_t>(byte_size) >= threshold;
+}
+
+Maybe<void> AsyncSendToRank(int64_t rank, const TransportToken& transport_token, const void* ptr,
+                            size_t size, const std::function<void()>& Done) {
+  NaiveAsyncTransportCtx ctx(
+      transport_token,
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = const_cast<void*>(ptr);
+        *buffer_size = size;
+        *Cb = Done;
+        return Maybe<void>::Ok();
+      },
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        UNIMPLEMENTED_THEN_RETURN();
+      });
+  return TransportUtil::SendDataToRank(rank, transport_token, &ctx);
+}
+
+Maybe<void> AsyncReceiveFromRank(int64_t rank, const TransportToken& transport_token, void* ptr,
+                                 size_t size, const std::function<void()>& Done) {
+  NaiveAsyncTransportCtx ctx(
+      transport_token,
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        UNIMPLEMENTED_THEN_RETURN();
+      },
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = ptr;
+        *buffer_size = size;
+        *Cb = Done;
+        return Maybe<void>::Ok();
+      });
+  return TransportUtil::ReceiveDataFromRank(rank, transport_token, &ctx);
+}
+
+// Sends to and receives from the same peer, and waits for both.
+Maybe<void> SendRecvWithRank(int64_t rank, const TransportToken& transport_token,
+                             const void* send_ptr, size_t send_size, void* recv_ptr,
+                             size_t recv_size) {
+  NaiveAsyncTransportCtx ctx(
+      transport_token,
+      [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = const_cast<void*>(send_ptr);
+        *size = send_size;
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      },
+      [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = recv_ptr;
+        *size = recv_size;
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      });
+  if (send_size > 0) { JUST(TransportUtil::SendDataToRank(rank, transport_token, &ctx)); }
+  if (recv_size > 0) { JUST(TransportUtil::ReceiveDataFromRank(rank, transport_token, &ctx)); }
+  JUST(TransportUtil::WaitUntilDoneOrTimeout(ctx, TransportUtil::TimeoutSeconds()));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> WaitUntilDone(const std::atomic<bool>& done) {
+  return SpinWaitUntilTimeout([&]() { return !done.load(std::memory_order_acquire); },
+                              TransportUtil::TimeoutSeconds());
+}
+
+Maybe<void> WaitUntilZero(const std::atomic<int64_t>& cnt) {
+  return SpinWaitUntilTimeout([&]() { return cnt.load(std::memory_order_acquire) > 0; },
+                              TransportUtil::TimeoutSeconds());
+}
+
+// Ring reduce-scatter followed by ring all-gather. Each part is cut into chunks, and a chunk is
+// reduced and forwarded to the next rank as soon as it arrives, instead of waiting for the whole
+// part of the step.
+template<typename T>
+Maybe<void> RingAllReduce(const T* in, T* out, size_t elem_cnt,
+                          Symbol<ParallelDesc> parallel_desc) {
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  Optional<int64_t> opt_parallel_id;
+  JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &opt_parallel_id));
+  const int64_t parallel_id = JUST(opt_parallel_id);
+  const auto& rank_group = JUST(RankGroup::New(parallel_desc));
+  const int64_t next_rank = JUST(rank_group->GetNextRankInRing());
+  const int64_t prev_rank = JUST(rank_group->GetPrevRankInRing());
+  TransportToken transport_token =
+      JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  BalancedSplitter bs(elem_cnt, parallel_num);
+  const int64_t chunk_num = RingChunkNum(bs.At(0).size() * sizeof(T));
+  const auto& ChunkRange = [&](int64_t part_id, int64_t chunk_id) -> Range {
+    const Range& part = bs.At(part_id);
+    const Range chunk = BalancedSplitter(part.size(), chunk_num).At(chunk_id);
+    return Range(part.begin() + chunk.begin(), part.begin() + chunk.end());
+  };
+  // Shared with the transport callbacks, which may outlive this function on errors.
+  auto pending_send_cnt = std::make_shared<std::atomic<int64_t>>(0);
+  const auto& SendChunk = [&](const T* base, int64_t part_id, int64_t chunk_id) -> Maybe<void> {
+    const Range range = ChunkRange(part_id, chunk_id);
+    if (range.size() == 0) { return Maybe<void>::Ok(); }
+    ++*pending_send_cnt;
+    return AsyncSendToRank(next_rank, transport_token, base + range.begin(),
+                           range.size() * sizeof(T), [pending_send_cnt]() { --*pending_send_cnt; });
+  };
+  const auto& ReceiveChunk = [&](T* ptr, size_t size,
+                                 const std::shared_ptr<std::vector<std::atomic<bool>>>& done,
+                                 int64_t idx) -> Maybe<void> {
+    done->at(idx).store(size == 0, std::memory_order_relaxed);
+    if (size == 0) { return Maybe<void>::Ok(); }
+    return AsyncReceiveFromRank(
+        prev_rank, transport_token, ptr, size * sizeof(T),
+        [done, idx]() { done->at(idx).store(true, std::memory_order_release); });
+  };
+  // Step i of the reduce-scatter sends part SendPartId(i) and receives part SendPartId(i + 1).
+  const auto& SendPartId = [&](int64_t step) -> int64_t {
+    return (parallel_id - step % parallel_num + parallel_num) % parallel_num;
+  };
+
+  // reduce-scatter
+  std::vector<T> recv_buffers[2];
+  recv_buffers[0].resize(bs.At(0).size());
+  recv_buffers[1].resize(bs.At(0).size());
+  auto rs_done = std::make_shared<std::vector<std::atomic<bool>>>(2 * chunk_num);
+  const auto& PostReduceScatterReceives = [&](int64_t step) -> Maybe<void> {
+    const int64_t part_id = SendPartId(step + 1);
+    T* recv_buffer = recv_buffers[step % 2].data();
+    FOR_RANGE(int64_t, chunk_id, 0, chunk_num) {
+      const Range range = ChunkRange(part_id, chunk_id);
+      JUST(ReceiveChunk(recv_buffer + (range.begin() - bs.At(part_id).begin()), range.size(),
+                        rs_done, (step % 2) * chunk_num + chunk_id));
+    }
+    return Maybe<void>::Ok();
+  };
+  FOR_RANGE(int64_t, chunk_id, 0, chunk_num) { JUST(SendChunk(in, SendPartId(0), chunk_id)); }
+  JUST(PostReduceScatterReceives(0));
+  FOR_RANGE(int64_t, step, 0, parallel_num - 1) {
+    const bool has_next_step = step + 1 < parallel_num - 1;
+    // The other buffer was consumed by the previous step.
+    if (has_next_step) { JUST(PostReduceScatterReceives(step + 1)); }
+    const int64_t part_id = SendPartId(step + 1);
+    const T* recv_buffer = recv_buffers[step % 2].data();
+    FOR_RANGE(int64_t, chunk_id, 0, chunk_num) {
+      const Range range = ChunkRange(part_id, chunk_id);
+      if (range.size() == 0) { continue; }
+      JUST(WaitUntilDone(rs_done->at((step % 2) * chunk_num + chunk_id)));
+      VecAdd(range.size(), out + range.begin(), in + range.begin(),
+             recv_buffer + (range.begin() - bs.At(part_id).begin()));
+      if (has_next_step) { JUST(SendChunk(out, part_id, chunk_id)); }
+    }
+  }
+  // Parts sent from out are received again during the all-gather.
+  JUST(WaitUntilZero(*pending_send_cnt));
+
+  // all-gather, this rank now owns the fully reduced part SendPartId(parallel_num - 1).
+  auto ag_done = std::make_shared<std::vector<std::atomic<bool>>>((parallel_num - 1) * chunk_num);
+  FOR_RANGE(int64_t, step, 0, parallel_num - 1) {
+    const int64_t part_id = SendPartId(step);
+    FOR_RANGE(int64_t, chunk_id, 0, chunk_num) {
+      const Range range = ChunkRange(part_id, chunk_id);
+      JUST(ReceiveChunk(out + range.begin(), range.size(), ag_done, step * chunk_num + chunk_id));
+    }
+  }
+  FOR_RANGE(int64_t, chunk_id, 0, chunk_num) {
+    JUST(SendChunk(out, SendPartId(parallel_num - 1), chunk_id));
+  }
+  FOR_RANGE(int64_t, step, 0, parallel_num - 1) {
+    FOR_RANGE(int64_t, chunk_id, 0, chunk_num) {
+      JUST(WaitUntilDone(ag_done->at(step * chunk_num + chunk_id)));
+      if (step + 1 < parallel_num - 1) { JUST(SendChunk(out, SendPartId(step), chunk_id)); }
+    }
+  }
+  JUST(WaitUntilZero(*pending_send_cnt));
+  return Maybe<void>::Ok();
+}
+
+// Rabenseifner's all-reduce: reduce-scatter by recursive halving, then all-gather by recursive
+// doubling among a power-of-two number of ranks. With n = 2^k + r ranks, the first 2 * r ranks are
+// paired up beforehand so that only one rank of each pair takes part.
+template<typename T>
+Maybe<void> HalvingDoublingAllReduce(const T* in, T* out, size_t elem_cnt,
+                                     Symbol<ParallelDesc> parallel_desc) {
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  Optional<int64_t> opt_parallel_id;
+  JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &opt_parallel_id));
+  const int64_t parallel_id = JUST(opt_parallel_id);
+  TransportToken transport_token =
+      JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  const auto& SendRecv = [&](int64_t peer_parallel_id, const T* send_ptr, size_t send_cnt,
+                             T* recv_ptr, size_t recv_cnt) -> Maybe<void> {
+    const int64_t peer_rank = JUST(parallel_desc->MachineId4ParallelId(peer_parallel_id));
+    return SendRecvWithRank(peer_rank, transport_token, send_ptr, send_cnt * sizeof(T), recv_ptr,
+                            recv_cnt * sizeof(T));
+  };
+  if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+  int64_t pow2_num = 1;
+  while (pow2_num * 2 <= parallel_num) { pow2_num *= 2; }
+  const int64_t remain_num = parallel_num - pow2_num;
+  std::vector<T> recv_buffer(remain_num > 0 ? elem_cnt : (elem_cnt + 1) / 2);
+
+  // id among the pow2_num participating ranks, -1 if this rank sits out.
+  int64_t vid = parallel_id - remain_num;
+  if (parallel_id < 2 * remain_num) {
+    if (parallel_id % 2 == 0) {
+      JUST(SendRecv(parallel_id + 1, out, elem_cnt, nullptr, 0));
+      vid = -1;
+    } else {
+      JUST(SendRecv(parallel_id - 1, nullptr, 0, recv_buffer.data(), elem_cnt));
+      if (elem_cnt > 0) { VecAdd(elem_cnt, out, out, recv_buffer.data()); }
+      vid = parallel_id / 2;
+    }
+  }
+  if (vid != -1) {
+    const auto& ParallelId4Vid = [&](int64_t id) -> int64_t {
+      return id < remain_num ? id * 2 + 1 : id + remain_num;
+    };
+    std::vector<std::pair<size_t, size_t>> parent_ranges;
+    size_t lo = 0;
+    size_t hi = elem_cnt;
+    for (int64_t mask = pow2_num / 2; mask >= 1; mask /= 2) {
+      const size_t mid = lo + (hi - lo) / 2;
+      parent_ranges.emplace_back(lo, hi);
+      const bool keep_lower = (vid & mask) == 0;
+      const size_t keep_lo = keep_lower ? lo : mid;
+      const size_t keep_hi = keep_lower ? mid : hi;
+      const size_t send_lo = keep_lower ? mid : lo;
+      const size_t send_hi = keep_lower ? hi : mid;
+      JUST(SendRecv(ParallelId4Vid(vid ^ mask), out + send_lo, send_hi - send_lo,
+                    recv_buffer.data(), keep_hi - keep_lo));
+      if (keep_hi > keep_lo) {
+        VecAdd(keep_hi - keep_lo, out + keep_lo, out + keep_lo, recv_buffer.data());
+      }
+      lo = keep_lo;
+      hi = keep_hi;
+    }
+    for (int64_t mask = 1; mask < pow2_num; mask *= 2) {
+      const std::pair<size_t, size_t> parent = parent_ranges.back();
+      parent_ranges.pop_back();
+      const size_t other_lo = lo == parent.first ? hi : parent.first;
+      const size_t other_hi = lo == parent.first ? parent.second : lo;
+      JUST(SendRecv(ParallelId4Vid(vid ^ mask), out + lo, hi - lo, out + other_lo,
+                    other_hi - other_lo));
+      lo = parent.first;
+      hi = parent.second;
+    }
+  }
+  if (parallel_id < 2 * remain_num) {
+    if (parallel_id % 2 == 0) {
+      JUST(SendRecv(parallel_id + 1, nullptr, 0, out, elem_cnt));
+    } else {
+      JUST(SendRecv(parallel_id - 1, out, elem_cnt, nullptr, 0));
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+template<typename T>
+Maybe<void> FlatAllReduce(const T* in, T* out, size_t elem_cnt,
+                          Symbol<ParallelDesc> parallel_desc) {
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  if (parallel_num == 1) {
+    if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+    return Maybe<void>::Ok();
+  }
+  if (UseRingAllReduce(elem_cnt * sizeof(T), parallel_num)) {
+    return RingAllReduce<T>(in, out, elem_cnt, parallel_desc);
+  } else {
+    return HalvingDoublingAllReduce<T>(in, out, elem_cnt, parallel_desc);
+  }
+}
+
+// The ranks of a node reduce through shared memory, then only one leader per node takes part in
+// the flat all-reduce over the network, and the result is shared back through the same memory.
+// The data goes through the shared slots piece by piece.
+template<typename T>
+Maybe<void> HierarchicalAllReduce(const T* in, T* out, size_t elem_cnt,
+                                  Symbol<ParallelDesc> parallel_desc) {
+  const auto& ctx = JUST(ShmCommCtx::Get(parallel_desc));
+  const Symbol<ParallelDesc> leader_parallel_desc = ctx->leader_parallel_desc();
+  const int64_t local_num = ctx->local_num();
+  const size_t piece_elem_cnt = ctx->slot_size() / sizeof(T);
+  T* result = local_num > 1 ? reinterpret_cast<T*>(ctx->result_slot()) : nullptr;
+  for (size_t offset = 0; offset < elem_cnt; offset += piece_elem_cnt) {
+    const size_t piece_size = std::min(piece_elem_cnt, elem_cnt - offset);
+    // Alone on its node, so this rank is the leader of it and has no shared memory. It still goes
+    // piece by piece, so that all the leaders make the same flat all-reduce calls.
+    if (local_num == 1) {
+      JUST(FlatAllReduce<T>(in + offset, out + offset, piece_size, leader_parallel_desc));
+      continue;
+    }
+    std::memcpy(ctx->slot(ctx->local_id()), in + offset, piece_size * sizeof(T));
+    JUST(ctx->Barrier());
+    // Every local rank reduces its own share of the piece over all the slots.
+    const Range range = BalancedSplitter(piece_size, local_num).At(ctx->local_id());
+    const T* slot0 = reinterpret_cast<const T*>(ctx->slot(0));
+    std::copy(slot0 + range.begin(), slot0 + range.end(), result + range.begin());
+    for (int64_t local_id = 1; local_id < local_num; ++local_id) {
+      const T* slot = reinterpret_cast<const T*>(ctx->slot(local_id));
+      for (int64_t i = range.begin(); i < range.end(); ++i) { result[i] += slot[i]; }
+    }
+    JUST(ctx->Barrier());
+    if (leader_parallel_desc) {
+      if (ctx->is_leader()) {
+        JUST(FlatAllReduce<T>(result, result, piece_size, leader_parallel_desc));
+      }
+      JUST(ctx->Barrier());
+    }
+    // The next piece overwrites the result slot only after every local rank has passed its first
+    // barrier, that is after this copy.
+    std::memcpy(out + offset, result, piece_size * sizeof(T));
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
 template<typename T>
 struct DtypeAllReduce<T, kSum> {
   static Maybe<void> Call(const void* void_in, void* void_out, size_t elem_cnt,
                           Symbol<ParallelDesc> parallel_desc) {
     const T* in = reinterpret_cast<const T*>(void_in);
     T* out = reinterpret_cast<T*>(void_out);
-    int64_t parallel_num = parallel_desc->parallel_num();
-    BalancedSplitter bs(elem_cnt, parallel_num);
-    std::vector<T> recv_buffer(bs.At(0).size());
-    Optional<int64_t> parallel_id;
-    JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &parallel_id));
-    const auto& rank_group = JUST(RankGroup::New(parallel_desc));
-    TransportToken transport_token =
-        JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = JUST(parallel_id); i < parallel_num - 1;
-         ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = &out[bs.At(send_part_id).begin()];
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.data();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(TransportUtil::WaitUntilDoneOrTimeout(ctx, TransportUtil::TimeoutSeconds()));
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      T* cur_out = &out[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) { VecAdd(recv_size, cur_out, cur_in, recv_ptr); }
-    }
-    for (int64_t i = 0, part_id = RingIncrease(JUST(parallel_id), parallel_num);
-         i < parallel_num - 1; ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = &out[bs.At(send_part_id).begin()];
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = &out[bs.At(recv_part_id).begin()];
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(TransportUtil::WaitUntilDoneOrTimeout(ctx, TransportUtil::TimeoutSeconds()));
+    if (parallel_desc->parallel_num() > 1 && ShmCommCtx::IsEnabled(parallel_desc)) {
+      return HierarchicalAllReduce<T>(in, out, elem_cnt, parallel_desc);
     }
-    return Maybe<void>::Ok();
+    return FlatAllReduce<T>(in, out, elem_cnt, parallel_desc);
   }
 };
 
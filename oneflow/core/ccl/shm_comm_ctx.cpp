@@ -0,0 +1,213 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ccl/shm_comm_ctx.h"
+#include "oneflow/core/framework/transport_util.h"
+#include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/job/rank_group.h"
+#include "oneflow/core/common/spin_counter.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace ccl {
+
+namespace {
+
+const int64_t kDefaultShmSlotSize = 4 * 1024 * 1024;
+const size_t kShmHeaderSize = 4096;
+const size_t kShmSlotAlignment = 64;
+const size_t kShmNameSize = 64;
+// A barrier waiter stops burning its core after this many polls.
+const int64_t kBarrierSpinCount = 4096;
+
+size_t ShmSlotSize() {
+  static const size_t slot_size = RoundUp(
+      std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_CCL_CPU_SHM_SLOT_SIZE", kDefaultShmSlotSize),
+                        kShmSlotAlignment),
+      kShmSlotAlignment);
+  return slot_size;
+}
+
+std::string NewShmName() {
+  static std::atomic<int64_t> counter(0);
+  return "/oneflow_ccl_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+}
+
+// Ranks of parallel_desc grouped by node, each group sorted.
+std::map<int64_t, std::vector<int64_t>> GroupRanksByNode(const ParallelDesc& parallel_desc) {
+  std::map<int64_t, std::vector<int64_t>> node_id2ranks;
+  for (int64_t rank : parallel_desc.sorted_machine_ids()) {
+    node_id2ranks[GlobalProcessCtx::NodeId(rank)].push_back(rank);
+  }
+  return node_id2ranks;
+}
+
+}  // namespace
+
+// Lives at the beginning of the segment and is shared by the processes of the node.
+struct ShmCommCtx::Header {
+  std::atomic<int64_t> arrived_cnt;
+  std::atomic<int64_t> generation;
+};
+
+ShmCommCtx::~ShmCommCtx() {
+  if (segment_ != nullptr) { PCHECK(munmap(segment_, segment_size_) == 0); }
+}
+
+/*static*/ bool ShmCommCtx::IsEnabled(Symbol<ParallelDesc> parallel_desc) {
+  // Not cached, so that a process can switch between the two paths, as the tests do.
+  if (!ParseBooleanFromEnv("ONEFLOW_CCL_CPU_ENABLE_SHM", true)) { return false; }
+  for (const auto& pair : GroupRanksByNode(*parallel_desc)) {
+    if (pair.second.size() > 1) { return true; }
+  }
+  return false;
+}
+
+/*static*/ Maybe<ShmCommCtx> ShmCommCtx::Get(Symbol<ParallelDesc> parallel_desc) {
+  static std::mutex mutex;
+  static HashMap<Symbol<ParallelDesc>, std::shared_ptr<ShmCommCtx>> parallel_desc2ctx;
+  std::unique_lock<std::mutex> lock(mutex);
+  auto iter = parallel_desc2ctx.find(parallel_desc);
+  if (iter == parallel_desc2ctx.end()) {
+    std::shared_ptr<ShmCommCtx> ctx(new ShmCommCtx());
+    JUST(ctx->Init(parallel_desc));
+    iter = parallel_desc2ctx.emplace(parallel_desc, ctx).first;
+  }
+  return iter->second;
+}
+
+Maybe<void> ShmCommCtx::Init(Symbol<ParallelDesc> parallel_desc) {
+  segment_ = nullptr;
+  header_ = nullptr;
+  segment_size_ = 0;
+  slot_size_ = ShmSlotSize();
+  const auto& node_id2ranks = GroupRanksByNode(*parallel_desc);
+  const auto& local_ranks_iter = node_id2ranks.find(GlobalProcessCtx::ThisNodeId());
+  CHECK_OR_RETURN(local_ranks_iter != node_id2ranks.end());
+  const std::vector<int64_t>& local_ranks = local_ranks_iter->second;
+  const auto& rank_iter =
+      std::find(local_ranks.begin(), local_ranks.end(), GlobalProcessCtx::Rank());
+  CHECK_OR_RETURN(rank_iter != local_ranks.end());
+  local_num_ = local_ranks.size();
+  local_id_ = rank_iter - local_ranks.begin();
+  if (node_id2ranks.size() > 1) {
+    std::set<int64_t> leader_ranks;
+    for (const auto& pair : node_id2ranks) { leader_ranks.insert(pair.second.front()); }
+    leader_parallel_desc_ = JUST(
+        RankGroup::GetDefaultParallelDesc(DeviceType::kCPU, JUST(RankGroup::New(leader_ranks))));
+  }
+  if (local_num_ == 1) { return Maybe<void>::Ok(); }
+
+  // The leader creates the segment and tells the other local ranks its name.
+  char name[kShmNameSize];
+  std::memset(name, 0, sizeof(name));
+  if (is_leader()) {
+    const std::string& new_name = NewShmName();
+    CHECK_LT_OR_RETURN(new_name.size(), kShmNameSize);
+    std::memcpy(name, new_name.data(), new_name.size());
+    JUST(MapSegment(name, true));
+  }
+  TransportToken transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  NaiveAsyncTransportCtx ctx(
+      transport_token,
+      [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = name;
+        *size = sizeof(name);
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      },
+      [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = name;
+        *size = sizeof(name);
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      });
+  if (is_leader()) {
+    for (int64_t i = 1; i < local_num_; ++i) {
+      JUST(TransportUtil::SendDataToRank(local_ranks.at(i), transport_token, &ctx));
+    }
+  } else {
+    JUST(TransportUtil::ReceiveDataFromRank(local_ranks.front(), transport_token, &ctx));
+  }
+  JUST(TransportUtil::WaitUntilDoneOrTimeout(ctx, TransportUtil::TimeoutSeconds()));
+  if (!is_leader()) { JUST(MapSegment(name, false)); }
+  // Everyone has mapped the segment, so its name is no longer needed and the memory is released
+  // once the last process unmaps it, even if some process crashes.
+  JUST(Barrier());
+  if (is_leader()) { CHECK_OR_RETURN(shm_unlink(name) == 0) << name << ": " << strerror(errno); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> ShmCommCtx::MapSegment(const std::string& name, bool create) {
+  static_assert(sizeof(Header) <= kShmHeaderSize, "");
+  segment_size_ = kShmHeaderSize + (local_num_ + 1) * slot_size_;
+  int fd = shm_open(name.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+  CHECK_OR_RETURN(fd != -1) << name << ": " << strerror(errno);
+  if (create) {
+    CHECK_OR_RETURN(ftruncate(fd, segment_size_) == 0) << name << ": " << strerror(errno);
+  }
+  void* ptr = mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  CHECK_OR_RETURN(ptr != MAP_FAILED) << name << ": " << strerror(errno);
+  CHECK_OR_RETURN(close(fd) == 0) << strerror(errno);
+  segment_ = reinterpret_cast<char*>(ptr);
+  if (create) {
+    header_ = new (segment_) Header();
+    header_->arrived_cnt.store(0, std::memory_order_relaxed);
+    header_->generation.store(0, std::memory_order_release);
+  } else {
+    header_ = reinterpret_cast<Header*>(segment_);
+  }
+  return Maybe<void>::Ok();
+}
+
+char* ShmCommCtx::slot(int64_t local_id) const {
+  CHECK_NOTNULL(segment_);
+  CHECK_GE(local_id, 0);
+  CHECK_LT(local_id, local_num_);
+  return segment_ + kShmHeaderSize + local_id * slot_size_;
+}
+
+char* ShmCommCtx::result_slot() const {
+  CHECK_NOTNULL(segment_);
+  return segment_ + kShmHeaderSize + local_num_ * slot_size_;
+}
+
+// Sense-reversing barrier: the last arriving rank resets the counter and moves the generation on,
+// which releases the others.
+Maybe<void> ShmCommCtx::Barrier() {
+  if (local_num_ == 1) { return Maybe<void>::Ok(); }
+  const int64_t generation = header_->generation.load(std::memory_order_acquire);
+  if (header_->arrived_cnt.fetch_add(1, std::memory_order_acq_rel) + 1 == local_num_) {
+    header_->arrived_cnt.store(0, std::memory_order_relaxed);
+    header_->generation.fetch_add(1, std::memory_order_acq_rel);
+    return Maybe<void>::Ok();
+  }
+  int64_t spin_cnt = 0;
+  return SpinWaitUntilTimeout(
+      [&]() {
+        if (++spin_cnt > kBarrierSpinCount) { std::this_thread::yield(); }
+        return header_->generation.load(std::memory_order_acquire) == generation;
+      },
+      TransportUtil::TimeoutSeconds());
+}
+
+}  // namespace ccl
+
+}  // namespace oneflow
@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_CCL_SHM_COMM_CTX_H_
+#define ONEFLOW_CORE_CCL_SHM_COMM_CTX_H_
+
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/symbol.h"
+
+namespace oneflow {
+
+class ParallelDesc;
+
+namespace ccl {
+
+// Shared memory used by the ranks of a placement that live on the same node. The segment holds one
+// slot per local rank and one result slot, which the local ranks fill and reduce between Barrier()
+// calls, so that only one leader per node has to go through the transport.
+class ShmCommCtx final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShmCommCtx);
+  ~ShmCommCtx();
+
+  // Whether some node hosts more than one rank of parallel_desc. All the ranks of parallel_desc
+  // get the same answer, so they all take the same collective algorithm.
+  static bool IsEnabled(Symbol<ParallelDesc> parallel_desc);
+  // Must be called by all the ranks of parallel_desc at the same point. The context is created on
+  // first use and cached.
+  static Maybe<ShmCommCtx> Get(Symbol<ParallelDesc> parallel_desc);
+
+  int64_t local_num() const { return local_num_; }
+  int64_t local_id() const { return local_id_; }
+  bool is_leader() const { return local_id_ == 0; }
+  // One leader per node, empty if there is only one node.
+  Symbol<ParallelDesc> leader_parallel_desc() const { return leader_parallel_desc_; }
+
+  size_t slot_size() const { return slot_size_; }
+  char* slot(int64_t local_id) const;
+  char* result_slot() const;
+
+  // Blocks until all the local ranks have called Barrier().
+  Maybe<void> Barrier();
+
+ private:
+  struct Header;
+
+  ShmCommCtx() = default;
+  Maybe<void> Init(Symbol<ParallelDesc> parallel_desc);
+  Maybe<void> MapSegment(const std::string& name, bool create);
+
+  int64_t local_num_;
+  int64_t local_id_;
+  Symbol<ParallelDesc> leader_parallel_desc_;
+  size_t slot_size_;
+  size_t segment_size_;
+  char* segment_;
+  Header* header_;
+};
+
+}  // namespace ccl
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_CCL_SHM_COMM_CTX_H_
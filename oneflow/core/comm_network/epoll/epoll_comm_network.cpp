@@ -29,6 +29,8 @@ namespace oneflow {
 namespace {
 
 static const int32_t kInvlidPort = 0;
+// Every stripe of a read striped over the data lanes is at least this large.
+static const int64_t kDefaultStripeSize = 4 * 1024 * 1024;
 
 sockaddr_in GetSockAddr(const std::string& addr, uint16_t port) {
   sockaddr_in sa;
@@ -88,6 +90,12 @@ EpollCommNet::~EpollCommNet() {
     pollers_[i]->Stop();
   }
   OF_ENV_BARRIER();
+  for (int64_t peer_id : peer_machine_id()) {
+    FOR_RANGE(int32_t, lane_id, 0, lane_num_) {
+      LOG(INFO) << "CommNet:Epoll write stat to machine " << peer_id << " lane " << lane_id
+                << ": " << GetSocketHelper(peer_id, lane_id)->GetWriteStat().ToString();
+    }
+  }
   for (IOEventPoller* poller : pollers_) { delete poller; }
   for (auto& pair : sockfd2helper_) { delete pair.second; }
 }
@@ -99,7 +107,7 @@ void EpollCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& actor_ms
   if (actor_msg.IsDataRegstMsgToConsumer()) {
     msg.actor_msg.set_comm_net_token(actor_msg.regst()->comm_net_token());
   }
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  GetSocketHelper(dst_machine_id, 0)->AsyncWrite(msg);
 }
 
 void EpollCommNet::SendTransportMsg(int64_t dst_machine_id, const TransportMsg& transport_msg) {
@@ -110,7 +118,32 @@ void EpollCommNet::SendTransportMsg(int64_t dst_machine_id, const TransportMsg&
 }
 
 void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  const int32_t lane_id =
+      msg.msg_type == SocketMsgType::kRequestRead ? msg.request_read_msg.lane_id : 0;
+  GetSocketHelper(dst_machine_id, lane_id)->AsyncWrite(msg);
+}
+
+SocketWriteStat EpollCommNet::GetSocketWriteStat(int64_t dst_machine_id) {
+  SocketWriteStat sum;
+  std::memset(&sum, 0, sizeof(sum));
+  FOR_RANGE(int32_t, lane_id, 0, lane_num_) {
+    const SocketWriteStat stat = GetSocketHelper(dst_machine_id, lane_id)->GetWriteStat();
+    sum.msg_cnt += stat.msg_cnt;
+    sum.byte_cnt += stat.byte_cnt;
+    sum.syscall_cnt += stat.syscall_cnt;
+    sum.zerocopy_byte_cnt += stat.zerocopy_byte_cnt;
+    sum.zerocopy_syscall_cnt += stat.zerocopy_syscall_cnt;
+    sum.zerocopy_copied_cnt += stat.zerocopy_copied_cnt;
+  }
+  return sum;
+}
+
+void EpollCommNet::StripeReadDone(void* stripe_read_id) {
+  auto striped_read = static_cast<StripedRead*>(stripe_read_id);
+  if (striped_read->remaining_stripe_cnt.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    ReadDone(striped_read->read_id);
+    delete striped_read;
+  }
 }
 
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
@@ -121,6 +154,14 @@ SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
 }
 
 EpollCommNet::EpollCommNet() : CommNetIf() {
+  lane_num_ = ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_SOCKETS_PER_PEER", 1);
+  lane_selector_.reset(new SocketLaneSelector(
+      lane_num_, ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_STRIPE_SIZE", kDefaultStripeSize)));
+  // A zero-copy body is only safe to reuse once its acknowledgement has come back, which the
+  // return of the register on the control lane does not imply for the other lanes.
+  CHECK(!(lane_num_ > 1 && ParseBooleanFromEnv("ONEFLOW_COMM_NET_EPOLL_ENABLE_ZEROCOPY", false)))
+      << "ONEFLOW_COMM_NET_EPOLL_ENABLE_ZEROCOPY requires "
+      << "ONEFLOW_COMM_NET_EPOLL_SOCKETS_PER_PEER=1";
   pollers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
   for (size_t i = 0; i < pollers_.size(); ++i) { pollers_[i] = new IOEventPoller; }
   InitSockets();
@@ -131,7 +172,7 @@ void EpollCommNet::InitSockets() {
   int64_t this_machine_id = GlobalProcessCtx::Rank();
   auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
   int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->process_ranks().size();
-  machine_id2sockfd_.assign(total_machine_num, -1);
+  machine_id2sockfds_.assign(total_machine_num, std::vector<int>(lane_num_, -1));
   sockfd2helper_.clear();
   size_t poller_idx = 0;
   auto NewSocketHelper = [&](int sockfd) {
@@ -150,7 +191,7 @@ void EpollCommNet::InitSockets() {
       this_listen_port = Global<EnvDesc>::Get()->data_port();
     }
   }
-  CHECK_EQ(SockListen(listen_sockfd, &this_listen_port, total_machine_num), 0);
+  CHECK_EQ(SockListen(listen_sockfd, &this_listen_port, total_machine_num * lane_num_), 0);
   CHECK_NE(this_listen_port, 0);
   PushPort(this_machine_id, this_listen_port);
   int32_t src_machine_count = 0;
@@ -164,53 +205,77 @@ void EpollCommNet::InitSockets() {
     uint16_t peer_port = PullPort(peer_id);
     auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
     sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    ssize_t n = write(sockfd, &this_machine_id, sizeof(int64_t));
-    PCHECK(n == sizeof(int64_t));
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
+    FOR_RANGE(int32_t, lane_id, 0, lane_num_) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      const int64_t handshake[2] = {this_machine_id, lane_id};
+      ssize_t n = write(sockfd, handshake, sizeof(handshake));
+      PCHECK(n == sizeof(handshake));
+      CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
+      machine_id2sockfds_[peer_id][lane_id] = sockfd;
+    }
   }
 
   // accept
-  HashSet<int64_t> processed_ranks;
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
+  FOR_RANGE(int32_t, idx, 0, src_machine_count * lane_num_) {
     sockaddr_in peer_sockaddr;
     socklen_t len = sizeof(peer_sockaddr);
     int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
     PCHECK(sockfd != -1);
-    int64_t peer_rank;
-    ssize_t n = read(sockfd, &peer_rank, sizeof(int64_t));
-    PCHECK(n == sizeof(int64_t));
+    int64_t handshake[2];
+    ssize_t n = read(sockfd, handshake, sizeof(handshake));
+    PCHECK(n == sizeof(handshake));
+    const int64_t peer_rank = handshake[0];
+    const int64_t lane_id = handshake[1];
+    CHECK_GE(lane_id, 0);
+    CHECK_LT(lane_id, lane_num_);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    CHECK(processed_ranks.emplace(peer_rank).second);
-    machine_id2sockfd_[peer_rank] = sockfd;
+    CHECK_EQ(machine_id2sockfds_.at(peer_rank).at(lane_id), -1);
+    machine_id2sockfds_[peer_rank][lane_id] = sockfd;
   }
   PCHECK(close(listen_sockfd) == 0);
   ClearPort(this_machine_id);
 
   // useful log
   FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
+    FOR_RANGE(int32_t, lane_id, 0, lane_num_) {
+      LOG(INFO) << "machine " << machine_id << " lane " << lane_id << " sockfd "
+                << machine_id2sockfds_[machine_id][lane_id];
+    }
   }
 }
 
-SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id, int32_t lane_id) {
+  int sockfd = machine_id2sockfds_.at(machine_id).at(lane_id);
   return sockfd2helper_.at(sockfd);
 }
 
 void EpollCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
+  const int64_t byte_size = static_cast<const SocketMemDesc*>(dst_token)->byte_size;
+  const std::vector<SocketReadStripe> stripes = lane_selector_->SplitRead(byte_size);
+  const bool is_stripe = stripes.size() > 1;
+  if (is_stripe) {
+    StripedRead* striped_read = new StripedRead;
+    striped_read->read_id = read_id;
+    striped_read->remaining_stripe_cnt.store(stripes.size(), std::memory_order_relaxed);
+    read_id = striped_read;
+  }
   SocketMsg msg;
   msg.msg_type = SocketMsgType::kRequestWrite;
   msg.request_write_msg.src_token = src_token;
   msg.request_write_msg.dst_machine_id = GlobalProcessCtx::Rank();
   msg.request_write_msg.dst_token = dst_token;
   msg.request_write_msg.read_id = read_id;
-  GetSocketHelper(src_machine_id)->AsyncWrite(msg);
+  msg.request_write_msg.is_stripe = is_stripe;
+  for (const SocketReadStripe& stripe : stripes) {
+    msg.request_write_msg.offset = stripe.offset;
+    msg.request_write_msg.byte_size = stripe.byte_size;
+    msg.request_write_msg.lane_id = stripe.lane_id;
+    GetSocketHelper(src_machine_id, 0)->AsyncWrite(msg);
+  }
 }
 
 }  // namespace oneflow
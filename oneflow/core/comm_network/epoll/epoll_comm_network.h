@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "oneflow/core/comm_network/comm_network.h"
 #include "oneflow/core/comm_network/epoll/socket_helper.h"
+#include "oneflow/core/comm_network/epoll/socket_lane_selector.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 
 namespace oneflow {
@@ -32,18 +33,30 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
   void SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg);
   void SendTransportMsg(int64_t dst_machine_id, const TransportMsg& msg);
+  // Sum of the write stats of all the lanes to dst_machine_id.
+  SocketWriteStat GetSocketWriteStat(int64_t dst_machine_id);
+  // Called when one stripe of a striped read has arrived.
+  void StripeReadDone(void* stripe_read_id);
 
  private:
+  struct StripedRead {
+    void* read_id;
+    std::atomic<int64_t> remaining_stripe_cnt;
+  };
+
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
 
   friend class Global<EpollCommNet>;
   EpollCommNet();
   void InitSockets();
-  SocketHelper* GetSocketHelper(int64_t machine_id);
+  SocketHelper* GetSocketHelper(int64_t machine_id, int32_t lane_id);
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  // Sockets per peer, see SocketLaneSelector.
+  int32_t lane_num_;
+  std::unique_ptr<SocketLaneSelector> lane_selector_;
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
 };
 
@@ -24,7 +24,8 @@ SocketHelper::SocketHelper(int sockfd, IOEventPoller* poller) {
   write_helper_ = new SocketWriteHelper(sockfd, poller);
   poller->AddFd(
       sockfd, [this]() { read_helper_->NotifyMeSocketReadable(); },
-      [this]() { write_helper_->NotifyMeSocketWriteable(); });
+      [this]() { write_helper_->NotifyMeSocketWriteable(); },
+      [this]() { write_helper_->NotifyMeSocketErrQueueReadable(); });
 }
 
 SocketHelper::~SocketHelper() {
@@ -34,6 +35,8 @@ SocketHelper::~SocketHelper() {
 
 void SocketHelper::AsyncWrite(const SocketMsg& msg) { write_helper_->AsyncWrite(msg); }
 
+SocketWriteStat SocketHelper::GetWriteStat() const { return write_helper_->GetStat(); }
+
 }  // namespace oneflow
 
 #endif  // __linux__
@@ -33,6 +33,7 @@ class SocketHelper final {
   SocketHelper(int sockfd, IOEventPoller* poller);
 
   void AsyncWrite(const SocketMsg& msg);
+  SocketWriteStat GetWriteStat() const;
 
  private:
   SocketReadHelper* read_helper_;
@@ -0,0 +1,52 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/socket_lane_selector.h"
+
+namespace oneflow {
+
+SocketLaneSelector::SocketLaneSelector(int32_t lane_num, int64_t stripe_size)
+    : lane_num_(lane_num),
+      data_lane_begin_(lane_num > 1 ? 1 : 0),
+      stripe_size_(stripe_size),
+      next_data_lane_cnt_(0) {
+  CHECK_GE(lane_num_, 1);
+  CHECK_GT(stripe_size_, 0);
+}
+
+std::vector<SocketReadStripe> SocketLaneSelector::SplitRead(int64_t byte_size) {
+  const int64_t data_lane_num = lane_num_ - data_lane_begin_;
+  const int64_t stripe_num =
+      std::min<int64_t>(data_lane_num, std::max<int64_t>(1, byte_size / stripe_size_));
+  std::vector<SocketReadStripe> stripes(stripe_num);
+  const int32_t first_lane_id = NextDataLaneId();
+  FOR_RANGE(int64_t, i, 0, stripe_num) {
+    const int64_t begin = byte_size * i / stripe_num;
+    const int64_t end = byte_size * (i + 1) / stripe_num;
+    stripes.at(i).offset = begin;
+    stripes.at(i).byte_size = end - begin;
+    stripes.at(i).lane_id =
+        data_lane_begin_ + (first_lane_id - data_lane_begin_ + i) % data_lane_num;
+  }
+  return stripes;
+}
+
+int32_t SocketLaneSelector::NextDataLaneId() {
+  const uint32_t data_lane_num = lane_num_ - data_lane_begin_;
+  return data_lane_begin_
+         + next_data_lane_cnt_.fetch_add(1, std::memory_order_relaxed) % data_lane_num;
+}
+
+}  // namespace oneflow
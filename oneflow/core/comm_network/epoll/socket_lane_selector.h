@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_LANE_SELECTOR_H_
+#define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_LANE_SELECTOR_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// [offset, offset + byte_size) of a register, read over the lane lane_id.
+struct SocketReadStripe {
+  int64_t offset;
+  int64_t byte_size;
+  int32_t lane_id;
+};
+
+// Every peer is connected by lane_num sockets. Lane 0 carries the control messages, the others
+// carry register bodies. With a single lane everything goes through lane 0.
+class SocketLaneSelector final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SocketLaneSelector);
+  SocketLaneSelector(int32_t lane_num, int64_t stripe_size);
+  ~SocketLaneSelector() = default;
+
+  int32_t lane_num() const { return lane_num_; }
+
+  // A read of less than twice stripe_size goes to the next data lane round-robin. A larger one is
+  // split into stripes of at least stripe_size, at most one per data lane.
+  std::vector<SocketReadStripe> SplitRead(int64_t byte_size);
+
+ private:
+  int32_t NextDataLaneId();
+
+  const int32_t lane_num_;
+  const int32_t data_lane_begin_;
+  const int64_t stripe_size_;
+  std::atomic<uint32_t> next_data_lane_cnt_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_LANE_SELECTOR_H_
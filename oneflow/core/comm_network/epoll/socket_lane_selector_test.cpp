@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/socket_lane_selector.h"
+
+namespace oneflow {
+
+namespace {
+
+void CheckStripes(const std::vector<SocketReadStripe>& stripes, int64_t byte_size,
+                  int64_t stripe_size, int32_t lane_num) {
+  ASSERT_FALSE(stripes.empty());
+  HashSet<int32_t> lane_ids;
+  int64_t offset = 0;
+  for (const SocketReadStripe& stripe : stripes) {
+    ASSERT_EQ(stripe.offset, offset);
+    if (stripes.size() > 1) { ASSERT_GE(stripe.byte_size, stripe_size); }
+    offset += stripe.byte_size;
+    ASSERT_GE(stripe.lane_id, lane_num > 1 ? 1 : 0);
+    ASSERT_LT(stripe.lane_id, lane_num);
+    ASSERT_TRUE(lane_ids.insert(stripe.lane_id).second);
+  }
+  ASSERT_EQ(offset, byte_size);
+}
+
+}  // namespace
+
+TEST(SocketLaneSelector, single_lane) {
+  SocketLaneSelector selector(1, 100);
+  for (int64_t byte_size : {0, 1, 199, 200, 100000}) {
+    const std::vector<SocketReadStripe> stripes = selector.SplitRead(byte_size);
+    ASSERT_EQ(stripes.size(), 1);
+    ASSERT_EQ(stripes.at(0).lane_id, 0);
+    CheckStripes(stripes, byte_size, 100, 1);
+  }
+}
+
+TEST(SocketLaneSelector, round_robin) {
+  SocketLaneSelector selector(4, 100);
+  FOR_RANGE(int32_t, i, 0, 7) {
+    const std::vector<SocketReadStripe> stripes = selector.SplitRead(199);
+    ASSERT_EQ(stripes.size(), 1);
+    // Lane 0 only carries control messages.
+    ASSERT_EQ(stripes.at(0).lane_id, 1 + i % 3);
+  }
+}
+
+TEST(SocketLaneSelector, stripe) {
+  SocketLaneSelector selector(4, 100);
+  ASSERT_EQ(selector.SplitRead(200).size(), 2);
+  ASSERT_EQ(selector.SplitRead(299).size(), 2);
+  ASSERT_EQ(selector.SplitRead(300).size(), 3);
+  ASSERT_EQ(selector.SplitRead(100000).size(), 3);
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int64_t> dis(0, 1000);
+  FOR_RANGE(int32_t, i, 0, 1000) {
+    const int64_t byte_size = dis(gen);
+    CheckStripes(selector.SplitRead(byte_size), byte_size, 100, 4);
+  }
+}
+
+}  // namespace oneflow
@@ -47,17 +47,27 @@ enum class SocketMsgType {
 #undef MAKE_ENTRY
 };
 
+// A read of [offset, offset + byte_size) of a register. A large register is striped into several
+// such reads over the data lanes of a peer, in which case read_id points to the stripe context.
 struct RequestWriteMsg {
   void* src_token;
   int64_t dst_machine_id;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int32_t lane_id;
+  bool is_stripe;
 };
 
 struct RequestReadMsg {
   void* src_token;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int32_t lane_id;
+  bool is_stripe;
 };
 
 struct SocketMsg {
@@ -18,10 +18,37 @@ limitations under the License.
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 
+#include <linux/errqueue.h>
 #include <sys/eventfd.h>
 
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+#endif
+
 namespace oneflow {
 
+namespace {
+
+// Each message needs at most two iovecs: the header and, for kRequestRead, the register body.
+const int64_t kDefaultMaxIovCnt = 64;
+// Below this size copying the body into the socket buffer is cheaper than pinning its pages.
+const int64_t kDefaultZerocopyThreshold = 64 * 1024;
+
+}  // namespace
+
+double SocketWriteStat::BatchingFactor() const {
+  return syscall_cnt == 0 ? 0.0 : static_cast<double>(msg_cnt) / syscall_cnt;
+}
+
+std::string SocketWriteStat::ToString() const {
+  std::stringstream ss;
+  ss << "msg_cnt: " << msg_cnt << ", byte_cnt: " << byte_cnt << ", syscall_cnt: " << syscall_cnt
+     << ", batching_factor: " << BatchingFactor() << ", zerocopy_byte_cnt: " << zerocopy_byte_cnt
+     << ", zerocopy_syscall_cnt: " << zerocopy_syscall_cnt
+     << ", zerocopy_copied_cnt: " << zerocopy_copied_cnt;
+  return ss.str();
+}
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -32,7 +59,13 @@ SocketWriteHelper::~SocketWriteHelper() {
   }
 }
 
-SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
+SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller)
+    : msg_cnt_(0),
+      byte_cnt_(0),
+      syscall_cnt_(0),
+      zerocopy_byte_cnt_(0),
+      zerocopy_syscall_cnt_(0),
+      zerocopy_copied_cnt_(0) {
   sockfd_ = sockfd;
   queue_not_empty_fd_ = eventfd(0, 0);
   PCHECK(queue_not_empty_fd_ != -1);
@@ -40,9 +73,25 @@ SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  max_iov_cnt_ = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_MAX_IOV_PER_WRITE", kDefaultMaxIovCnt), 2);
+  max_iov_cnt_ = std::min<size_t>(max_iov_cnt_, IOV_MAX);
+  iovecs_.resize(max_iov_cnt_);
+  zerocopy_threshold_ =
+      ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_ZEROCOPY_THRESHOLD", kDefaultZerocopyThreshold);
+  zerocopy_enabled_ = false;
+  if (ParseBooleanFromEnv("ONEFLOW_COMM_NET_EPOLL_ENABLE_ZEROCOPY", false)) {
+#ifdef OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+    const int val = 1;
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == 0) {
+      zerocopy_enabled_ = true;
+    } else {
+      PLOG(WARNING) << "SO_ZEROCOPY is not supported on sockfd " << sockfd_;
+    }
+#else
+    LOG(WARNING) << "MSG_ZEROCOPY is not available in this build";
+#endif  // OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+  }
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -55,6 +104,19 @@ void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
 
 void SocketWriteHelper::NotifyMeSocketWriteable() { WriteUntilMsgQueueEmptyOrSocketNotWriteable(); }
 
+void SocketWriteHelper::NotifyMeSocketErrQueueReadable() { DrainErrQueue(); }
+
+SocketWriteStat SocketWriteHelper::GetStat() const {
+  SocketWriteStat stat;
+  stat.msg_cnt = msg_cnt_.load(std::memory_order_relaxed);
+  stat.byte_cnt = byte_cnt_.load(std::memory_order_relaxed);
+  stat.syscall_cnt = syscall_cnt_.load(std::memory_order_relaxed);
+  stat.zerocopy_byte_cnt = zerocopy_byte_cnt_.load(std::memory_order_relaxed);
+  stat.zerocopy_syscall_cnt = zerocopy_syscall_cnt_.load(std::memory_order_relaxed);
+  stat.zerocopy_copied_cnt = zerocopy_copied_cnt_.load(std::memory_order_relaxed);
+  return stat;
+}
+
 void SocketWriteHelper::SendQueueNotEmptyEvent() {
   uint64_t event_num = 1;
   PCHECK(write(queue_not_empty_fd_, &event_num, 8) == 8);
@@ -67,81 +129,146 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
+  while (true) {
+    FillInflightChunks();
+    if (inflight_chunks_.empty()) { return; }
+    if (!WriteInflightChunks()) { return; }
+  }
 }
 
-bool SocketWriteHelper::InitMsgWriteHandle() {
-  if (cur_msg_queue_->empty()) {
-    {
-      std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
-      std::swap(cur_msg_queue_, pending_msg_queue_);
+void SocketWriteHelper::FillInflightChunks() {
+  while (inflight_chunks_.size() + 2 <= max_iov_cnt_) {
+    if (cur_msg_queue_->empty()) {
+      {
+        std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
+        std::swap(cur_msg_queue_, pending_msg_queue_);
+      }
+      if (cur_msg_queue_->empty()) { return; }
     }
-    if (cur_msg_queue_->empty()) { return false; }
+    PushInflightMsg(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
-  return true;
-}
-
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
 }
 
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
+void SocketWriteHelper::PushInflightMsg(const SocketMsg& msg) {
+  inflight_msgs_.push_back(msg);
+  WriteChunk head;
+  head.ptr = reinterpret_cast<const char*>(&inflight_msgs_.back());
+  head.size = sizeof(SocketMsg);
+  head.is_msg_end = true;
+  head.zerocopy = false;
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    const RequestReadMsg& request_read_msg = msg.request_read_msg;
+    auto src_mem_desc = static_cast<const SocketMemDesc*>(request_read_msg.src_token);
+    CHECK_LE(request_read_msg.offset + request_read_msg.byte_size, src_mem_desc->byte_size);
+    if (request_read_msg.byte_size > 0) {
+      head.is_msg_end = false;
+      inflight_chunks_.push_back(head);
+      WriteChunk body;
+      body.ptr = reinterpret_cast<const char*>(src_mem_desc->mem_ptr) + request_read_msg.offset;
+      body.size = request_read_msg.byte_size;
+      body.is_msg_end = true;
+      body.zerocopy = zerocopy_enabled_ && body.size >= zerocopy_threshold_;
+      inflight_chunks_.push_back(body);
+      return;
+    }
+  }
+  inflight_chunks_.push_back(head);
 }
 
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
+bool SocketWriteHelper::WriteInflightChunks() {
+  // A zero-copy body goes alone, since MSG_ZEROCOPY applies to every iovec of the call.
+  const bool zerocopy = inflight_chunks_.front().zerocopy;
+  size_t iov_cnt = 0;
+  for (const WriteChunk& chunk : inflight_chunks_) {
+    if (iov_cnt == max_iov_cnt_ || (iov_cnt > 0 && (zerocopy || chunk.zerocopy))) { break; }
+    iovecs_[iov_cnt].iov_base = const_cast<char*>(chunk.ptr);
+    iovecs_[iov_cnt].iov_len = chunk.size;
+    ++iov_cnt;
+  }
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iovecs_.data();
+  msg.msg_iovlen = iov_cnt;
+  int flags = MSG_NOSIGNAL;
+#ifdef OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+  if (zerocopy) { flags |= MSG_ZEROCOPY; }
+#endif  // OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+  ssize_t n = sendmsg(sockfd_, &msg, flags);
+  if (n >= 0) {
+    syscall_cnt_.fetch_add(1, std::memory_order_relaxed);
+    byte_cnt_.fetch_add(n, std::memory_order_relaxed);
+    if (zerocopy) {
+      zerocopy_syscall_cnt_.fetch_add(1, std::memory_order_relaxed);
+      zerocopy_byte_cnt_.fetch_add(n, std::memory_order_relaxed);
+    }
+    ConsumeInflightChunks(n);
     return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
+  }
+  CHECK_EQ(n, -1);
+  if (zerocopy && errno == ENOBUFS) {
+    // The socket ran out of optmem for pinned pages, fall back to copying this body.
+    inflight_chunks_.front().zerocopy = false;
     return true;
-  } else {
-    CHECK_EQ(n, -1);
-    PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
-    return false;
   }
+  PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+  return false;
 }
 
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+void SocketWriteHelper::ConsumeInflightChunks(size_t byte_size) {
+  while (byte_size > 0) {
+    WriteChunk* chunk = &inflight_chunks_.front();
+    if (byte_size < chunk->size) {
+      chunk->ptr += byte_size;
+      chunk->size -= byte_size;
+      return;
+    }
+    byte_size -= chunk->size;
+    if (chunk->is_msg_end) {
+      inflight_msgs_.pop_front();
+      msg_cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+    inflight_chunks_.pop_front();
   }
 }
 
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenTransportMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::DrainErrQueue() {
+#ifdef OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+  // The register of a zero-copy body is handed back to its producer by an actor message that
+  // travels on this connection behind the acknowledgement of the body, so the kernel has released
+  // the pages before they can be overwritten. This is why EpollCommNet refuses zero-copy when the
+  // bodies go on data lanes other than the control lane. Completions are only read here to keep
+  // the error queue short and to count the sends that the kernel had to copy anyway (e.g. over
+  // loopback).
+  while (true) {
+    char control[128];
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(sockfd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+    if (n == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+            || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+        continue;
+      }
+      auto err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+      CHECK_EQ(err->ee_errno, 0) << "sockfd " << sockfd_;
+      CHECK_EQ(err->ee_origin, SO_EE_ORIGIN_ZEROCOPY) << "sockfd " << sockfd_;
+      if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        zerocopy_copied_cnt_.fetch_add(err->ee_data - err->ee_info + 1, std::memory_order_relaxed);
+      }
+    }
+  }
+#endif  // OF_EPOLL_COMM_NET_WITH_ZEROCOPY
+  int sock_err = 0;
+  socklen_t len = sizeof(sock_err);
+  PCHECK(getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &sock_err, &len) == 0);
+  CHECK_EQ(sock_err, 0) << "sockfd " << sockfd_ << ": " << strerror(sock_err);
 }
 
 }  // namespace oneflow
@@ -21,8 +21,26 @@ limitations under the License.
 
 #ifdef OF_PLATFORM_POSIX
 
+#include <sys/uio.h>
+
 namespace oneflow {
 
+// Counters of what a SocketWriteHelper has put on its connection so far.
+struct SocketWriteStat {
+  int64_t msg_cnt;
+  int64_t byte_cnt;
+  int64_t syscall_cnt;
+  int64_t zerocopy_byte_cnt;
+  int64_t zerocopy_syscall_cnt;
+  int64_t zerocopy_copied_cnt;
+
+  // Average number of messages sent per syscall.
+  double BatchingFactor() const;
+  std::string ToString() const;
+};
+
+// Writes the queued SocketMsgs to a socket. Headers and register bodies of consecutive messages
+// are gathered into one sendmsg call, and large bodies may be sent with MSG_ZEROCOPY.
 class SocketWriteHelper final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SocketWriteHelper);
@@ -34,23 +52,27 @@ class SocketWriteHelper final {
   void AsyncWrite(const SocketMsg& msg);
 
   void NotifyMeSocketWriteable();
+  void NotifyMeSocketErrQueueReadable();
+
+  SocketWriteStat GetStat() const;
 
  private:
+  struct WriteChunk {
+    const char* ptr;
+    size_t size;
+    bool is_msg_end;
+    bool zerocopy;
+  };
+
   void SendQueueNotEmptyEvent();
   void ProcessQueueNotEmptyEvent();
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  void FillInflightChunks();
+  void PushInflightMsg(const SocketMsg& msg);
+  bool WriteInflightChunks();
+  void ConsumeInflightChunks(size_t byte_size);
+  void DrainErrQueue();
 
   int sockfd_;
   int queue_not_empty_fd_;
@@ -60,10 +82,21 @@ class SocketWriteHelper final {
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  // Messages taken from cur_msg_queue_ whose bytes are not fully written yet. std::deque keeps the
+  // headers in place on push_back / pop_front, so the chunks can point into it.
+  std::deque<SocketMsg> inflight_msgs_;
+  std::deque<WriteChunk> inflight_chunks_;
+  std::vector<iovec> iovecs_;
+  size_t max_iov_cnt_;
+  bool zerocopy_enabled_;
+  size_t zerocopy_threshold_;
+
+  std::atomic<int64_t> msg_cnt_;
+  std::atomic<int64_t> byte_cnt_;
+  std::atomic<int64_t> syscall_cnt_;
+  std::atomic<int64_t> zerocopy_byte_cnt_;
+  std::atomic<int64_t> zerocopy_syscall_cnt_;
+  std::atomic<int64_t> zerocopy_copied_cnt_;
 };
 
 }  // namespace oneflow
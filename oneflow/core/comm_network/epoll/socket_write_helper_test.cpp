@@ -0,0 +1,321 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/epoll/socket_write_helper.h"
+#include "oneflow/core/comm_network/epoll/socket_lane_selector.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+
+#include <sys/wait.h>
+
+namespace oneflow {
+
+namespace {
+
+const int kMsgNum = 1000;
+const size_t kBodyOffset = 16;
+
+// Every third message carries a register body, whose size is stashed in read_id for the reader.
+size_t BodySize4MsgIdx(int msg_idx) {
+  if (msg_idx % 3 != 0) { return 0; }
+  return (msg_idx % 2 == 0) ? 100 * 1024 + msg_idx : 7 * msg_idx + 1;
+}
+
+char BodyByte(int msg_idx, size_t offset) {
+  return static_cast<char>((msg_idx * 31 + offset) & 0xff);
+}
+
+bool ReadFully(int fd, char* ptr, size_t size) {
+  while (size > 0) {
+    ssize_t n = read(fd, ptr, size);
+    if (n <= 0) { return false; }
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Returns -1 on failure.
+int ConnectToLoopback(uint16_t port) {
+  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd == -1) { return -1; }
+  sockaddr_in sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0) {
+    close(sockfd);
+    return -1;
+  }
+  return sockfd;
+}
+
+void ListenOnLoopback(int backlog, int* listen_sockfd, uint16_t* port) {
+  *listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(*listen_sockfd, -1);
+  sockaddr_in sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = 0;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(*listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)), 0);
+  ASSERT_EQ(listen(*listen_sockfd, backlog), 0);
+  socklen_t sa_len = sizeof(sa);
+  ASSERT_EQ(getsockname(*listen_sockfd, reinterpret_cast<sockaddr*>(&sa), &sa_len), 0);
+  *port = ntohs(sa.sin_port);
+}
+
+// Runs in the child process, returns the exit code.
+int ReadAndCheckMsgs(uint16_t port) {
+  int sockfd = ConnectToLoopback(port);
+  if (sockfd == -1) { return 2; }
+  std::vector<char> body;
+  FOR_RANGE(int, msg_idx, 0, kMsgNum) {
+    SocketMsg msg;
+    if (!ReadFully(sockfd, reinterpret_cast<char*>(&msg), sizeof(msg))) { return 3; }
+    const size_t body_size = BodySize4MsgIdx(msg_idx);
+    if (body_size == 0) {
+      if (msg.msg_type != SocketMsgType::kRequestWrite) { return 4; }
+      if (msg.request_write_msg.dst_machine_id != msg_idx) { return 5; }
+    } else {
+      if (msg.msg_type != SocketMsgType::kRequestRead) { return 6; }
+      if (reinterpret_cast<size_t>(msg.request_read_msg.read_id) != body_size) { return 7; }
+      body.resize(body_size);
+      if (!ReadFully(sockfd, body.data(), body_size)) { return 8; }
+      FOR_RANGE(size_t, i, 0, body_size) {
+        if (body.at(i) != BodyByte(msg_idx, i)) { return 9; }
+      }
+    }
+  }
+  close(sockfd);
+  return 0;
+}
+
+const int32_t kLaneNum = 4;
+const int64_t kStripeSize = 64 * 1024;
+const int kRegstNum = 30;
+
+// Every other register is large enough to be striped over all the data lanes.
+size_t RegstSize4Idx(int regst_idx) {
+  return (regst_idx % 2 == 0) ? 3 * kStripeSize + 7 * regst_idx : 1000 + regst_idx;
+}
+
+// The stripes of each register in the order the writer queues them, replayed with the same
+// selector on both sides.
+std::vector<std::vector<SocketReadStripe>> SplitRegsts() {
+  SocketLaneSelector selector(kLaneNum, kStripeSize);
+  std::vector<std::vector<SocketReadStripe>> regst_stripes;
+  FOR_RANGE(int, regst_idx, 0, kRegstNum) {
+    regst_stripes.push_back(selector.SplitRead(RegstSize4Idx(regst_idx)));
+  }
+  return regst_stripes;
+}
+
+// Runs in the child process, returns the exit code. Connects one socket per lane, then reads the
+// lanes one after another and puts the stripes back together.
+int ReadAndCheckStripedRegsts(uint16_t port) {
+  std::vector<int> lane_sockfds;
+  FOR_RANGE(int32_t, lane_id, 0, kLaneNum) {
+    int sockfd = ConnectToLoopback(port);
+    if (sockfd == -1) { return 2; }
+    if (write(sockfd, &lane_id, sizeof(lane_id)) != sizeof(lane_id)) { return 3; }
+    lane_sockfds.push_back(sockfd);
+  }
+  const std::vector<std::vector<SocketReadStripe>> regst_stripes = SplitRegsts();
+  std::vector<std::vector<char>> regsts(kRegstNum);
+  FOR_RANGE(int, regst_idx, 0, kRegstNum) { regsts.at(regst_idx).resize(RegstSize4Idx(regst_idx)); }
+  FOR_RANGE(int32_t, lane_id, 0, kLaneNum) {
+    FOR_RANGE(int, regst_idx, 0, kRegstNum) {
+      const std::vector<SocketReadStripe>& stripes = regst_stripes.at(regst_idx);
+      for (const SocketReadStripe& stripe : stripes) {
+        if (stripe.lane_id != lane_id) { continue; }
+        SocketMsg msg;
+        if (!ReadFully(lane_sockfds.at(lane_id), reinterpret_cast<char*>(&msg), sizeof(msg))) {
+          return 4;
+        }
+        const RequestReadMsg& request_read_msg = msg.request_read_msg;
+        if (msg.msg_type != SocketMsgType::kRequestRead) { return 5; }
+        if (reinterpret_cast<size_t>(request_read_msg.read_id) != static_cast<size_t>(regst_idx)) {
+          return 6;
+        }
+        if (request_read_msg.offset != stripe.offset) { return 7; }
+        if (request_read_msg.byte_size != stripe.byte_size) { return 8; }
+        if (request_read_msg.lane_id != lane_id) { return 9; }
+        if (request_read_msg.is_stripe != (stripes.size() > 1)) { return 10; }
+        if (!ReadFully(lane_sockfds.at(lane_id), regsts.at(regst_idx).data() + stripe.offset,
+                       stripe.byte_size)) {
+          return 11;
+        }
+      }
+    }
+  }
+  FOR_RANGE(int, regst_idx, 0, kRegstNum) {
+    FOR_RANGE(size_t, i, 0, regsts.at(regst_idx).size()) {
+      if (regsts.at(regst_idx).at(i) != BodyByte(regst_idx, i)) { return 12; }
+    }
+  }
+  for (int sockfd : lane_sockfds) { close(sockfd); }
+  return 0;
+}
+
+void TestWriteToAnotherProcess(bool enable_zerocopy) {
+  setenv("ONEFLOW_COMM_NET_EPOLL_ENABLE_ZEROCOPY", enable_zerocopy ? "1" : "0", 1);
+  int listen_sockfd = -1;
+  uint16_t port = 0;
+  ASSERT_NO_FATAL_FAILURE(ListenOnLoopback(1, &listen_sockfd, &port));
+
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) { _exit(ReadAndCheckMsgs(port)); }
+
+  int sockfd = accept(listen_sockfd, nullptr, nullptr);
+  ASSERT_NE(sockfd, -1);
+  close(listen_sockfd);
+
+  std::vector<std::vector<char>> bodies(kMsgNum);
+  std::vector<SocketMemDesc> mem_descs(kMsgNum);
+  IOEventPoller poller;
+  SocketWriteHelper write_helper(sockfd, &poller);
+  poller.AddFd(
+      sockfd, []() {}, [&]() { write_helper.NotifyMeSocketWriteable(); },
+      [&]() { write_helper.NotifyMeSocketErrQueueReadable(); });
+  // Everything is queued before the poller starts, so consecutive messages get batched.
+  FOR_RANGE(int, msg_idx, 0, kMsgNum) {
+    SocketMsg msg;
+    const size_t body_size = BodySize4MsgIdx(msg_idx);
+    if (body_size == 0) {
+      msg.msg_type = SocketMsgType::kRequestWrite;
+      msg.request_write_msg.dst_machine_id = msg_idx;
+    } else {
+      // Only a part of the register is sent, starting at kBodyOffset.
+      bodies.at(msg_idx).resize(kBodyOffset + body_size + kBodyOffset);
+      FOR_RANGE(size_t, i, 0, body_size) {
+        bodies.at(msg_idx).at(kBodyOffset + i) = BodyByte(msg_idx, i);
+      }
+      mem_descs.at(msg_idx).mem_ptr = bodies.at(msg_idx).data();
+      mem_descs.at(msg_idx).byte_size = bodies.at(msg_idx).size();
+      msg.msg_type = SocketMsgType::kRequestRead;
+      msg.request_read_msg.src_token = &mem_descs.at(msg_idx);
+      msg.request_read_msg.read_id = reinterpret_cast<void*>(body_size);
+      msg.request_read_msg.offset = kBodyOffset;
+      msg.request_read_msg.byte_size = body_size;
+    }
+    write_helper.AsyncWrite(msg);
+  }
+  poller.Start();
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  poller.Stop();
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  const SocketWriteStat stat = write_helper.GetStat();
+  ASSERT_EQ(stat.msg_cnt, kMsgNum);
+  int64_t total_byte_size = kMsgNum * sizeof(SocketMsg);
+  FOR_RANGE(int, msg_idx, 0, kMsgNum) { total_byte_size += BodySize4MsgIdx(msg_idx); }
+  ASSERT_EQ(stat.byte_cnt, total_byte_size);
+  ASSERT_GT(stat.BatchingFactor(), 1.0);
+  if (!enable_zerocopy) { ASSERT_EQ(stat.zerocopy_syscall_cnt, 0); }
+  unsetenv("ONEFLOW_COMM_NET_EPOLL_ENABLE_ZEROCOPY");
+}
+
+}  // namespace
+
+TEST(SocketWriteHelper, batched_write_over_loopback) { TestWriteToAnotherProcess(false); }
+
+TEST(SocketWriteHelper, zerocopy_write_over_loopback) { TestWriteToAnotherProcess(true); }
+
+TEST(SocketWriteHelper, striped_write_over_loopback_lanes) {
+  int listen_sockfd = -1;
+  uint16_t port = 0;
+  ASSERT_NO_FATAL_FAILURE(ListenOnLoopback(kLaneNum, &listen_sockfd, &port));
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) { _exit(ReadAndCheckStripedRegsts(port)); }
+
+  std::vector<int> lane_sockfds(kLaneNum, -1);
+  FOR_RANGE(int32_t, i, 0, kLaneNum) {
+    int sockfd = accept(listen_sockfd, nullptr, nullptr);
+    ASSERT_NE(sockfd, -1);
+    int32_t lane_id = -1;
+    ASSERT_TRUE(ReadFully(sockfd, reinterpret_cast<char*>(&lane_id), sizeof(lane_id)));
+    ASSERT_GE(lane_id, 0);
+    ASSERT_LT(lane_id, kLaneNum);
+    lane_sockfds.at(lane_id) = sockfd;
+  }
+  close(listen_sockfd);
+
+  std::vector<std::vector<char>> regsts(kRegstNum);
+  std::vector<SocketMemDesc> mem_descs(kRegstNum);
+  FOR_RANGE(int, regst_idx, 0, kRegstNum) {
+    regsts.at(regst_idx).resize(RegstSize4Idx(regst_idx));
+    FOR_RANGE(size_t, i, 0, regsts.at(regst_idx).size()) {
+      regsts.at(regst_idx).at(i) = BodyByte(regst_idx, i);
+    }
+    mem_descs.at(regst_idx).mem_ptr = regsts.at(regst_idx).data();
+    mem_descs.at(regst_idx).byte_size = regsts.at(regst_idx).size();
+  }
+  IOEventPoller poller;
+  std::vector<std::unique_ptr<SocketWriteHelper>> write_helpers;
+  for (int sockfd : lane_sockfds) {
+    write_helpers.emplace_back(new SocketWriteHelper(sockfd, &poller));
+    SocketWriteHelper* write_helper = write_helpers.back().get();
+    poller.AddFd(
+        sockfd, []() {}, [write_helper]() { write_helper->NotifyMeSocketWriteable(); },
+        [write_helper]() { write_helper->NotifyMeSocketErrQueueReadable(); });
+  }
+  const std::vector<std::vector<SocketReadStripe>> regst_stripes = SplitRegsts();
+  int64_t striped_regst_cnt = 0;
+  FOR_RANGE(int, regst_idx, 0, kRegstNum) {
+    const std::vector<SocketReadStripe>& stripes = regst_stripes.at(regst_idx);
+    if (stripes.size() > 1) {
+      ++striped_regst_cnt;
+      ASSERT_EQ(stripes.size(), kLaneNum - 1);
+    }
+    for (const SocketReadStripe& stripe : stripes) {
+      SocketMsg msg;
+      msg.msg_type = SocketMsgType::kRequestRead;
+      msg.request_read_msg.src_token = &mem_descs.at(regst_idx);
+      msg.request_read_msg.read_id = reinterpret_cast<void*>(static_cast<size_t>(regst_idx));
+      msg.request_read_msg.offset = stripe.offset;
+      msg.request_read_msg.byte_size = stripe.byte_size;
+      msg.request_read_msg.lane_id = stripe.lane_id;
+      msg.request_read_msg.is_stripe = stripes.size() > 1;
+      write_helpers.at(stripe.lane_id)->AsyncWrite(msg);
+    }
+  }
+  ASSERT_EQ(striped_regst_cnt, kRegstNum / 2);
+  poller.Start();
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  poller.Stop();
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  // Lane 0 is left to the control messages, every data lane has carried bodies.
+  ASSERT_EQ(write_helpers.at(0)->GetStat().msg_cnt, 0);
+  int64_t msg_cnt = 0;
+  FOR_RANGE(int32_t, lane_id, 1, kLaneNum) {
+    ASSERT_GT(write_helpers.at(lane_id)->GetStat().msg_cnt, 0);
+    msg_cnt += write_helpers.at(lane_id)->GetStat().msg_cnt;
+  }
+  ASSERT_EQ(msg_cnt, kRegstNum / 2 * (kLaneNum - 1) + kRegstNum / 2);
+}
+
+}  // namespace oneflow
+
+#endif  // __linux__
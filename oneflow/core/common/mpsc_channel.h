@@ -0,0 +1,307 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // __linux__
+
+namespace oneflow {
+
+namespace mpsc_channel_detail {
+
+constexpr size_t kCacheLineSize = 64;
+
+inline size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t ret = 1;
+  while (ret < n) { ret <<= 1; }
+  return ret;
+}
+
+// Keeps a hot member away from its neighbours so that producers and the consumer do not share a
+// cache line.
+template<typename T>
+struct CacheLinePadded {
+  char padding_before[kCacheLineSize];
+  T value;
+  char padding_after[kCacheLineSize];
+};
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Blocks the single consumer until the epoch moves away from `expected`.
+class Parker final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Parker);
+  Parker() : epoch_(0) {}
+  ~Parker() = default;
+
+  uint32_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+  void Park(uint32_t expected) {
+#ifdef __linux__
+    while (epoch_.load(std::memory_order_acquire) == expected) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, expected,
+              nullptr, nullptr, 0);
+    }
+#else
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return epoch_.load(std::memory_order_acquire) != expected; });
+#endif  // __linux__
+  }
+
+  void Unpark() {
+#ifdef __linux__
+    epoch_.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, 1, nullptr,
+            nullptr, 0);
+#else
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      epoch_.fetch_add(1, std::memory_order_release);
+    }
+    cond_.notify_one();
+#endif  // __linux__
+  }
+
+ private:
+  std::atomic<uint32_t> epoch_;
+#ifndef __linux__
+  std::mutex mutex_;
+  std::condition_variable cond_;
+#endif  // __linux__
+};
+
+}  // namespace mpsc_channel_detail
+
+// Multi-producer single-consumer counterpart of Channel.
+//
+// Messages go through a bounded lock-free ring (one CAS per Send, no lock on Receive). When the
+// ring is full, Send spills to a mutex protected overflow queue instead of blocking, since the
+// producers of an actor thread may themselves be waiting on this consumer. Once spilling starts,
+// every Send goes to the overflow queue until the consumer has drained it, which keeps the FIFO
+// order of each producer. An idle consumer spins, then yields, then sleeps on a futex.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  explicit MpscChannel(size_t capacity);
+  ~MpscChannel() = default;
+
+  template<typename U>
+  ChannelStatus Send(U&& item);
+  // Must be called from the single consumer thread.
+  ChannelStatus Receive(T* item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+  static constexpr int kSpinCount = 1024;
+  static constexpr int kYieldCount = 64;
+
+  template<typename U>
+  bool TryPushToRing(U&& item);
+  bool TryPopFromRing(T* item);
+  bool TryPopOne(T* item);
+  bool TryPopAll(std::queue<T>* items);
+  void NotifyConsumer();
+  template<typename TryPopT>
+  ChannelStatus WaitAndPop(const TryPopT& TryPop);
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  mpsc_channel_detail::CacheLinePadded<std::atomic<size_t>> enqueue_pos_;
+  mpsc_channel_detail::CacheLinePadded<size_t> dequeue_pos_;
+  std::atomic<bool> consumer_waiting_;
+  std::atomic<bool> is_closed_;
+  std::atomic<bool> overflow_active_;
+  std::mutex overflow_mutex_;
+  std::queue<T> overflow_queue_;
+  mpsc_channel_detail::Parker parker_;
+};
+
+template<typename T>
+MpscChannel<T>::MpscChannel(size_t capacity)
+    : mask_(mpsc_channel_detail::RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1),
+      cells_(new Cell[mask_ + 1]),
+      consumer_waiting_(false),
+      is_closed_(false),
+      overflow_active_(false) {
+  FOR_RANGE(size_t, i, 0, mask_ + 1) { cells_[i].sequence.store(i, std::memory_order_relaxed); }
+  enqueue_pos_.value.store(0, std::memory_order_relaxed);
+  dequeue_pos_.value = 0;
+}
+
+template<typename T>
+template<typename U>
+bool MpscChannel<T>::TryPushToRing(U&& item) {
+  size_t pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  while (true) {
+    cell = &cells_[pos & mask_];
+    const size_t seq = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+    }
+  }
+  cell->item = std::forward<U>(item);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPopFromRing(T* item) {
+  Cell* cell = &cells_[dequeue_pos_.value & mask_];
+  if (cell->sequence.load(std::memory_order_acquire) != dequeue_pos_.value + 1) { return false; }
+  *item = std::move(cell->item);
+  cell->sequence.store(dequeue_pos_.value + mask_ + 1, std::memory_order_release);
+  ++dequeue_pos_.value;
+  return true;
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPopOne(T* item) {
+  if (TryPopFromRing(item)) { return true; }
+  if (!overflow_active_.load(std::memory_order_acquire)) { return false; }
+  std::unique_lock<std::mutex> lock(overflow_mutex_);
+  // A producer may have published into the ring right before spilling started.
+  if (TryPopFromRing(item)) { return true; }
+  if (overflow_queue_.empty()) { return false; }
+  *item = std::move(overflow_queue_.front());
+  overflow_queue_.pop();
+  if (overflow_queue_.empty()) { overflow_active_.store(false, std::memory_order_release); }
+  return true;
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPopAll(std::queue<T>* items) {
+  const size_t size_before = items->size();
+  T item;
+  while (TryPopFromRing(&item)) { items->push(std::move(item)); }
+  if (overflow_active_.load(std::memory_order_acquire)) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    while (TryPopFromRing(&item)) { items->push(std::move(item)); }
+    while (!overflow_queue_.empty()) {
+      items->push(std::move(overflow_queue_.front()));
+      overflow_queue_.pop();
+    }
+    overflow_active_.store(false, std::memory_order_release);
+  }
+  return items->size() > size_before;
+}
+
+template<typename T>
+void MpscChannel<T>::NotifyConsumer() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (consumer_waiting_.load(std::memory_order_relaxed)
+      && consumer_waiting_.exchange(false, std::memory_order_acq_rel)) {
+    parker_.Unpark();
+  }
+}
+
+template<typename T>
+template<typename U>
+ChannelStatus MpscChannel<T>::Send(U&& item) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  if (!overflow_active_.load(std::memory_order_acquire)
+      && TryPushToRing(std::forward<U>(item))) {
+    NotifyConsumer();
+    return kChannelStatusSuccess;
+  }
+  {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    if (overflow_active_.load(std::memory_order_relaxed)
+        || !TryPushToRing(std::forward<U>(item))) {
+      overflow_active_.store(true, std::memory_order_release);
+      overflow_queue_.push(std::forward<U>(item));
+    }
+  }
+  NotifyConsumer();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+template<typename TryPopT>
+ChannelStatus MpscChannel<T>::WaitAndPop(const TryPopT& TryPop) {
+  int spin_cnt = 0;
+  while (true) {
+    if (TryPop()) { return kChannelStatusSuccess; }
+    if (is_closed_.load(std::memory_order_acquire)) {
+      return TryPop() ? kChannelStatusSuccess : kChannelStatusErrorClosed;
+    }
+    if (spin_cnt < kSpinCount) {
+      ++spin_cnt;
+      mpsc_channel_detail::CpuRelax();
+    } else if (spin_cnt < kSpinCount + kYieldCount) {
+      ++spin_cnt;
+      std::this_thread::yield();
+    } else {
+      const uint32_t epoch = parker_.epoch();
+      consumer_waiting_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (TryPop()) {
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+        return kChannelStatusSuccess;
+      }
+      if (!is_closed_.load(std::memory_order_acquire)) { parker_.Park(epoch); }
+      consumer_waiting_.store(false, std::memory_order_relaxed);
+      spin_cnt = 0;
+    }
+  }
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Receive(T* item) {
+  return WaitAndPop([&]() { return TryPopOne(item); });
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  return WaitAndPop([&]() { return TryPopAll(items); });
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  is_closed_.store(true, std::memory_order_release);
+  parker_.Unpark();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
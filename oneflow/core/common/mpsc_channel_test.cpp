@@ -0,0 +1,122 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/mpsc_channel.h"
+
+namespace oneflow {
+
+namespace {
+
+void SendFromSenderThread(MpscChannel<std::pair<int, int>>* channel, int sender_id,
+                          int range_num) {
+  for (int i = 0; i < range_num; ++i) {
+    if (channel->Send(std::make_pair(sender_id, i)) != kChannelStatusSuccess) { break; }
+  }
+}
+
+void TestManySenders(size_t capacity, bool receive_many) {
+  MpscChannel<std::pair<int, int>> channel(capacity);
+  const int sender_num = 30;
+  const int range_num = 2000;
+  std::vector<int> next_expected(sender_num, 0);
+  std::thread receiver([&]() {
+    std::queue<std::pair<int, int>> items;
+    std::pair<int, int> item;
+    while (true) {
+      if (receive_many) {
+        if (channel.ReceiveMany(&items) != kChannelStatusSuccess) { break; }
+      } else {
+        if (channel.Receive(&item) != kChannelStatusSuccess) { break; }
+        items.push(item);
+      }
+      while (!items.empty()) {
+        // every sender must be observed in its own sending order.
+        ASSERT_EQ(items.front().second, next_expected.at(items.front().first));
+        ++next_expected.at(items.front().first);
+        items.pop();
+      }
+    }
+  });
+  std::vector<std::thread> senders;
+  for (int i = 0; i < sender_num; ++i) {
+    senders.push_back(std::thread(SendFromSenderThread, &channel, i, range_num));
+  }
+  for (std::thread& this_thread : senders) { this_thread.join(); }
+  channel.Close();
+  receiver.join();
+  for (int i = 0; i < sender_num; ++i) { ASSERT_EQ(next_expected.at(i), range_num); }
+}
+
+template<typename ChannelT>
+double MessagesPerSecond(ChannelT* channel, int sender_num, int msg_num_per_sender) {
+  const auto start = std::chrono::steady_clock::now();
+  std::thread receiver([&]() {
+    std::queue<std::pair<int, int>> items;
+    int64_t received = 0;
+    while (channel->ReceiveMany(&items) == kChannelStatusSuccess) {
+      received += items.size();
+      std::queue<std::pair<int, int>>().swap(items);
+    }
+    ASSERT_EQ(received, static_cast<int64_t>(sender_num) * msg_num_per_sender);
+  });
+  std::vector<std::thread> senders;
+  for (int i = 0; i < sender_num; ++i) {
+    senders.push_back(std::thread([channel, i, msg_num_per_sender]() {
+      for (int j = 0; j < msg_num_per_sender; ++j) { channel->Send(std::make_pair(i, j)); }
+    }));
+  }
+  for (std::thread& this_thread : senders) { this_thread.join(); }
+  channel->Close();
+  receiver.join();
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return static_cast<double>(sender_num) * msg_num_per_sender / seconds;
+}
+
+}  // namespace
+
+TEST(MpscChannel, 30sender1receiver) { TestManySenders(1024, false); }
+
+TEST(MpscChannel, 30sender1receiver_receive_many) { TestManySenders(1024, true); }
+
+TEST(MpscChannel, 30sender1receiver_overflow) { TestManySenders(4, false); }
+
+TEST(MpscChannel, 30sender1receiver_receive_many_overflow) { TestManySenders(4, true); }
+
+TEST(MpscChannel, close) {
+  MpscChannel<int> channel(8);
+  ASSERT_EQ(channel.Send(1), kChannelStatusSuccess);
+  channel.Close();
+  ASSERT_EQ(channel.Send(2), kChannelStatusErrorClosed);
+  int item = 0;
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusSuccess);
+  ASSERT_EQ(item, 1);
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusErrorClosed);
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(MpscChannel, DISABLED_benchmark) {
+  const int msg_num = 1 << 22;
+  for (int sender_num : {1, 4, 16}) {
+    Channel<std::pair<int, int>> channel;
+    const double channel_rate = MessagesPerSecond(&channel, sender_num, msg_num / sender_num);
+    MpscChannel<std::pair<int, int>> mpsc_channel(4096);
+    const double mpsc_rate = MessagesPerSecond(&mpsc_channel, sender_num, msg_num / sender_num);
+    std::cout << sender_num << " senders: " << channel_rate / 1e6 << " M msgs/s Channel, "
+              << mpsc_rate / 1e6 << " M msgs/s MpscChannel" << std::endl;
+  }
+}
+
+}  // namespace oneflow
@@ -20,7 +20,11 @@ limitations under the License.
 
 namespace oneflow {
 
-enum NotifierStatus { kNotifierStatusSuccess = 0, kNotifierStatusErrorClosed };
+enum NotifierStatus {
+  kNotifierStatusSuccess = 0,
+  kNotifierStatusErrorClosed,
+  kNotifierStatusTimeout
+};
 
 class Notifier final {
  public:
@@ -30,6 +34,8 @@ class Notifier final {
 
   NotifierStatus Notify();
   NotifierStatus WaitAndClearNotifiedCnt();
+  // Returns kNotifierStatusTimeout if not notified within timeout_us.
+  NotifierStatus TimedWaitAndClearNotifiedCnt(int64_t timeout_us);
   void Close();
 
  private:
@@ -27,6 +27,7 @@ namespace one {
 
 class StatefulLocalOpKernel;
 class ConsistentTensorInferResult;
+class LocalTensorInferResult;
 
 using EagerBlobObjectList = std::vector<std::shared_ptr<vm::EagerBlobObject>>;
 using EagerBlobObjectListPtr =
@@ -52,12 +53,14 @@ class LocalCallOpKernelPhyInstrOperand final : public vm::PhyInstrOperand {
       const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
       const one::EagerBlobObjectListPtr& inputs, const one::EagerBlobObjectListPtr& outputs,
       const std::shared_ptr<const one::ConsistentTensorInferResult>& consistent_tensor_infer_result,
+      const std::shared_ptr<const one::LocalTensorInferResult>& local_tensor_infer_result,
       const one::OpExprInterpContext& op_interp_ctx_,
       const one::DevVmDepObjectConsumeMode dev_vm_dep_object_consume_mode)
       : opkernel_(opkernel),
         inputs_(inputs),
         outputs_(outputs),
         consistent_tensor_infer_result_(consistent_tensor_infer_result),
+        local_tensor_infer_result_(local_tensor_infer_result),
         op_interp_ctx_(op_interp_ctx_),
         dev_vm_dep_object_consume_mode_(dev_vm_dep_object_consume_mode) {}
 
@@ -99,11 +102,16 @@ class LocalCallOpKernelPhyInstrOperand final : public vm::PhyInstrOperand {
     return consistent_tensor_infer_result_;
   }
 
+  const std::shared_ptr<const one::LocalTensorInferResult>& local_tensor_infer_result() const {
+    return local_tensor_infer_result_;
+  }
+
  private:
   std::shared_ptr<one::StatefulLocalOpKernel> opkernel_;
   one::EagerBlobObjectListPtr inputs_;
   one::EagerBlobObjectListPtr outputs_;
   std::shared_ptr<const one::ConsistentTensorInferResult> consistent_tensor_infer_result_;
+  std::shared_ptr<const one::LocalTensorInferResult> local_tensor_infer_result_;
   const one::OpExprInterpContext op_interp_ctx_;
   const user_op::OpKernel* user_opkernel_;
   const one::DevVmDepObjectConsumeMode dev_vm_dep_object_consume_mode_;
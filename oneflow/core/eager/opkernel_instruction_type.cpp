@@ -40,6 +40,9 @@ limitations under the License.
 #include "oneflow/core/operator/op_node_signature_desc.h"
 #include "oneflow/core/operator/op_conf_symbol.h"
 #include "oneflow/user/kernels/stateful_local_opkernel.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
+#include "oneflow/core/profiler/host_tracer.h"
+#include "oneflow/core/profiler/op_stats.h"
 
 namespace oneflow {
 namespace vm {
@@ -445,8 +448,17 @@ struct LocalCallOpKernelUtil final {
   static inline Maybe<void> Infer(vm::Instruction* instruction) {
     auto* operand = JUST(GetLocalCallOpKernelPhyInstrOperand(instruction));
     operand->mut_opkernel()->composed_attrs_for_scheduler_thread()->ResetPrior(operand->attrs());
-    operand->set_user_opkernel(JUST(operand->mut_opkernel()->ChooseOpKernel(
-        operand->inputs(), operand->outputs(), operand->consistent_tensor_infer_result())));
+    const auto& local_tensor_infer_result = operand->local_tensor_infer_result();
+    const user_op::OpKernel* user_opkernel =
+        local_tensor_infer_result ? local_tensor_infer_result->user_opkernel() : nullptr;
+    if (user_opkernel == nullptr) {
+      user_opkernel = JUST(operand->mut_opkernel()->ChooseOpKernel(
+          operand->inputs(), operand->outputs(), operand->consistent_tensor_infer_result()));
+      if (local_tensor_infer_result) {
+        local_tensor_infer_result->set_user_opkernel(user_opkernel);
+      }
+    }
+    operand->set_user_opkernel(user_opkernel);
     JUST(CheckOutputBlobObjectsMemCase(operand, instruction->stream()));
     JUST(InitOutputBlobs(operand));
     JUST(InferTempStorageBlobDesc(operand));
@@ -579,14 +591,57 @@ struct LocalCallOpKernelUtil final {
 
   static inline Maybe<void> OpKernelCompute(LocalCallOpKernelPhyInstrOperand* operand,
                                             DeviceCtx* device_ctx, user_op::OpKernelState* state) {
+    const int64_t begin_ns = profiler::IsHostTraceEnabled() || profiler::IsOpStatsEnabled()
+                                 ? profiler::HostTraceNowNs()
+                                 : -1;
     JUST(WithComputeContext(operand, device_ctx,
                             [&](user_op::KernelComputeContext* compute_ctx) -> Maybe<void> {
                               operand->user_opkernel()->Compute(compute_ctx, state);
                               return Maybe<void>::Ok();
                             }));
+    if (begin_ns >= 0) { HostProfileOpKernelCompute(operand, begin_ns); }
     return Maybe<void>::Ok();
   }
 
+  static inline void HostProfileOpKernelCompute(LocalCallOpKernelPhyInstrOperand* operand,
+                                                int64_t begin_ns) {
+    const int64_t end_ns = profiler::HostTraceNowNs();
+    const bool trace = profiler::IsHostTraceEnabled();
+    const auto& user_op_conf = *operand->opkernel().user_op_conf_;
+    std::string shapes;
+    const auto BlobObjectsBytes = [&](const one::EagerBlobObjectListPtr& blob_objects) {
+      int64_t bytes = 0;
+      if (!blob_objects) { return bytes; }
+      for (const auto& blob_object : *blob_objects) {
+        const BlobDesc& blob_desc = blob_object->blob_desc();
+        bytes += blob_desc.ByteSizeOfBlobBody();
+        if (trace) {
+          if (!shapes.empty() && shapes.back() != ' ') { shapes += ","; }
+          shapes += blob_desc.shape().ToString();
+        }
+      }
+      return bytes;
+    };
+    const int64_t input_bytes = BlobObjectsBytes(operand->inputs());
+    if (trace) { shapes += " -> "; }
+    const int64_t output_bytes = BlobObjectsBytes(operand->outputs());
+    if (profiler::IsOpStatsEnabled()) {
+      profiler::RecordOpStats(user_op_conf.op_name(), user_op_conf.op_type_name(), input_bytes,
+                              output_bytes, end_ns - begin_ns);
+    }
+    if (trace) {
+      profiler::HostTraceEvent event;
+      event.category = "kernel";
+      event.name = user_op_conf.op_name();
+      event.op_type = user_op_conf.op_type_name();
+      event.shapes = std::move(shapes);
+      event.bytes = input_bytes + output_bytes;
+      event.begin_ns = begin_ns;
+      event.end_ns = end_ns;
+      profiler::RecordHostTraceEvent(std::move(event));
+    }
+  }
+
   static inline Maybe<void> DeallocateTempStorageBlobMemory(
       LocalCallOpKernelPhyInstrOperand* operand, DeviceCtx* device_ctx) {
     JUST(operand->mut_opkernel()->mut_temp_blob_object()->DeallocateBlobDataPtr());
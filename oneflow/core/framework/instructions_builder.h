@@ -48,6 +48,7 @@ class StatefulLocalOpKernel;
 class TensorTuple;
 class MirroredTensor;
 class ConsistentTensorInferResult;
+class LocalTensorInferResult;
 }  // namespace one
 
 class NNGraphIf;
@@ -263,10 +264,12 @@ class InstructionsBuilder : public std::enable_shared_from_this<InstructionsBuil
     return id_cache->FindOrCreate(conf, [&] { return CreateSymbolId<T>(conf); });
   }
 
-  Maybe<void> LocalCallOpKernel(const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
-                                const one::EagerBlobObjectListPtr& input_eager_blob_objects,
-                                const one::EagerBlobObjectListPtr& output_eager_blob_objects,
-                                const one::OpExprInterpContext& ctx, Symbol<Device> op_device);
+  Maybe<void> LocalCallOpKernel(
+      const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
+      const one::EagerBlobObjectListPtr& input_eager_blob_objects,
+      const one::EagerBlobObjectListPtr& output_eager_blob_objects,
+      const std::shared_ptr<const one::LocalTensorInferResult>& local_tensor_infer_result,
+      const one::OpExprInterpContext& ctx, Symbol<Device> op_device);
 
   Maybe<void> LocalCallOpKernel(
       const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
@@ -276,6 +279,14 @@ class InstructionsBuilder : public std::enable_shared_from_this<InstructionsBuil
       const one::OpExprInterpContext& ctx, Symbol<Device> op_device);
 
  private:
+  Maybe<void> LocalCallOpKernel(
+      const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
+      const one::EagerBlobObjectListPtr& input_eager_blob_objects,
+      const one::EagerBlobObjectListPtr& output_eager_blob_objects,
+      const std::shared_ptr<const one::ConsistentTensorInferResult>& consistent_tensor_infer_result,
+      const std::shared_ptr<const one::LocalTensorInferResult>& local_tensor_infer_result,
+      const one::OpExprInterpContext& ctx, Symbol<Device> op_device);
+
   Maybe<void> RankFrontSeqCallback(const std::string& instruction_name,
                                    const std::function<void()>& callback);
 
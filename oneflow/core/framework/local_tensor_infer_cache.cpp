@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/framework/tensor_impl.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+// Ops called with ever changing shapes or attrs would grow the cache without bound, it starts over
+// once it has this many entries.
+constexpr size_t kLocalTensorInferCacheMaxSize = 256;
+
+std::atomic<int64_t> total_hit_count(0);
+std::atomic<int64_t> total_miss_count(0);
+
+}  // namespace
+
+bool LocalTensorMetaInferArgs::operator==(const LocalTensorMetaInferArgs& other) const {
+  return this->hash_value_ == other.hash_value_ && this->default_device_ == other.default_device_
+         && this->input_tensor_metas_ == other.input_tensor_metas_ && this->attrs_ == other.attrs_;
+}
+
+Maybe<void> LocalTensorMetaInferArgs::Init(const AttrMap& attrs, Symbol<Device> default_device,
+                                           const TensorTuple& input_tensors) {
+  attrs_ = attrs;
+  default_device_ = default_device;
+  input_tensor_metas_.resize(input_tensors.size());
+  hash_value_ = std::hash<AttrMap>()(attrs);
+  HashCombine(&hash_value_, std::hash<Symbol<Device>>()(default_device));
+  for (int i = 0; i < input_tensors.size(); ++i) {
+    // The metas the infer functions read, tensor->shape() would wait for dynamic shapes.
+    const auto* tensor_impl = JUST(input_tensors.at(i)->mut_eager_mirrored_tensor_impl());
+    const MirroredTensorMeta& tensor_meta = *tensor_impl->tensor_meta();
+    InputLocalTensorMeta* meta = &input_tensor_metas_.at(i);
+    meta->shape = tensor_meta.shape();
+    meta->dtype = tensor_meta.dtype();
+    meta->device = tensor_meta.device();
+    meta->is_dynamic = tensor_meta.is_dynamic();
+    HashCombine(&hash_value_, std::hash<Shape>()(meta->shape));
+    HashCombine(&hash_value_, static_cast<size_t>(meta->dtype));
+    HashCombine(&hash_value_, std::hash<Symbol<Device>>()(meta->device));
+    HashCombine(&hash_value_, static_cast<size_t>(meta->is_dynamic));
+  }
+  return Maybe<void>::Ok();
+}
+
+std::shared_ptr<const LocalTensorInferResult> LocalTensorInferCache::Find(
+    const LocalTensorMetaInferArgs& infer_args) {
+  const auto iter = cache_.find(infer_args);
+  if (iter == cache_.end()) {
+    miss_count_ += 1;
+    total_miss_count.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  hit_count_ += 1;
+  total_hit_count.fetch_add(1, std::memory_order_relaxed);
+  return iter->second;
+}
+
+void LocalTensorInferCache::Insert(
+    const LocalTensorMetaInferArgs& infer_args,
+    const std::shared_ptr<const LocalTensorInferResult>& infer_result) {
+  if (cache_.size() >= kLocalTensorInferCacheMaxSize) { cache_.clear(); }
+  cache_.emplace(infer_args, infer_result);
+}
+
+/* static */ bool LocalTensorInferCache::Enabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_EAGER_LOCAL_TENSOR_INFER_CACHE", true);
+  return enabled;
+}
+
+/* static */ int64_t LocalTensorInferCache::TotalHitCount() {
+  return total_hit_count.load(std::memory_order_relaxed);
+}
+
+/* static */ int64_t LocalTensorInferCache::TotalMissCount() {
+  return total_miss_count.load(std::memory_order_relaxed);
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,157 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_LOCAL_TENSOR_INFER_CACHE_H_
+#define ONEFLOW_CORE_FRAMEWORK_LOCAL_TENSOR_INFER_CACHE_H_
+
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/framework/attr_map.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/tensor_meta.h"
+
+namespace oneflow {
+
+namespace user_op {
+class OpKernel;
+}
+
+namespace one {
+
+class TensorTuple;
+
+struct InputLocalTensorMeta {
+  Shape shape;
+  DataType dtype;
+  Symbol<Device> device;
+  // Infer functions pass it on to the outputs.
+  bool is_dynamic;
+
+  bool operator==(const InputLocalTensorMeta& other) const {
+    return this->shape == other.shape && this->dtype == other.dtype
+           && this->device == other.device && this->is_dynamic == other.is_dynamic;
+  }
+};
+
+class LocalTensorMetaInferArgs final {
+ public:
+  LocalTensorMetaInferArgs() = default;
+  LocalTensorMetaInferArgs(const LocalTensorMetaInferArgs&) = default;
+  LocalTensorMetaInferArgs(LocalTensorMetaInferArgs&&) = default;
+  ~LocalTensorMetaInferArgs() = default;
+
+  const AttrMap& attrs() const { return attrs_; }
+  Symbol<Device> default_device() const { return default_device_; }
+  const std::vector<InputLocalTensorMeta>& input_tensor_metas() const {
+    return input_tensor_metas_;
+  }
+
+  size_t hash_value() const { return hash_value_; }
+
+  bool operator==(const LocalTensorMetaInferArgs& other) const;
+
+  Maybe<void> Init(const AttrMap& attrs, Symbol<Device> default_device,
+                   const TensorTuple& input_tensors);
+
+ private:
+  AttrMap attrs_;
+  Symbol<Device> default_device_;
+  std::vector<InputLocalTensorMeta> input_tensor_metas_;
+  size_t hash_value_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+namespace std {
+
+template<>
+struct hash<oneflow::one::LocalTensorMetaInferArgs> final {
+  size_t operator()(const oneflow::one::LocalTensorMetaInferArgs& val) const {
+    return val.hash_value();
+  }
+};
+
+}  // namespace std
+
+namespace oneflow {
+namespace one {
+
+// What the eager mirrored interpreter inferred for an op call: the op device, and the device,
+// shape and dtype of each output.
+class LocalTensorInferResult final {
+ public:
+  LocalTensorInferResult(Symbol<Device> op_device, std::vector<Symbol<Device>>&& output_devices,
+                         std::vector<TensorMeta>&& output_tensor_metas)
+      : op_device_(op_device),
+        output_devices_(std::move(output_devices)),
+        output_tensor_metas_(std::move(output_tensor_metas)),
+        user_opkernel_(nullptr) {}
+  LocalTensorInferResult(const LocalTensorInferResult&) = delete;
+  LocalTensorInferResult(LocalTensorInferResult&&) = delete;
+  ~LocalTensorInferResult() = default;
+
+  Symbol<Device> op_device() const { return op_device_; }
+  const std::vector<Symbol<Device>>& output_devices() const { return output_devices_; }
+  const std::vector<TensorMeta>& output_tensor_metas() const { return output_tensor_metas_; }
+
+  // The kernel chosen by the first call is the choice of every call with the same infer args. It
+  // is set by the vm scheduler thread.
+  const user_op::OpKernel* user_opkernel() const {
+    return user_opkernel_.load(std::memory_order_acquire);
+  }
+  void set_user_opkernel(const user_op::OpKernel* user_opkernel) const {
+    user_opkernel_.store(user_opkernel, std::memory_order_release);
+  }
+
+ private:
+  Symbol<Device> op_device_;
+  std::vector<Symbol<Device>> output_devices_;
+  std::vector<TensorMeta> output_tensor_metas_;
+  mutable std::atomic<const user_op::OpKernel*> user_opkernel_;
+};
+
+// Skips device and shape inference of eager mirrored op calls seen before. Enabled unless
+// ONEFLOW_EAGER_LOCAL_TENSOR_INFER_CACHE=0.
+class LocalTensorInferCache final {
+ public:
+  LocalTensorInferCache() : hit_count_(0), miss_count_(0) {}
+  ~LocalTensorInferCache() = default;
+
+  // nullptr on misses.
+  std::shared_ptr<const LocalTensorInferResult> Find(const LocalTensorMetaInferArgs& infer_args);
+
+  void Insert(const LocalTensorMetaInferArgs& infer_args,
+              const std::shared_ptr<const LocalTensorInferResult>& infer_result);
+
+  int64_t hit_count() const { return hit_count_; }
+  int64_t miss_count() const { return miss_count_; }
+
+  static bool Enabled();
+  // Hits and misses of all the caches.
+  static int64_t TotalHitCount();
+  static int64_t TotalMissCount();
+
+ private:
+  HashMap<LocalTensorMetaInferArgs, std::shared_ptr<const LocalTensorInferResult>> cache_;
+  int64_t hit_count_;
+  int64_t miss_count_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_LOCAL_TENSOR_INFER_CACHE_H_
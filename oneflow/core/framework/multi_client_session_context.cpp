@@ -30,6 +30,7 @@ limitations under the License.
 #include "oneflow/core/common/buffer_manager.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/core/memory/chunk_manager.h"
+#include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/job/collective_boxing_executor.h"
 #include "oneflow/core/job/collective_boxing_device_ctx_poller.h"
@@ -108,6 +109,7 @@ Maybe<void> MultiClientSessionContext::TryInit(const ConfigProto& config_proto)
       Global<summary::EventsWriter>::New();
       Global<boxing::collective::CollectiveBoxingExecutor>::New();
       Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::New();
+      Global<BackgroundSnapshotSaver>::New();
     }
 
     is_inited_ = true;
@@ -132,6 +134,8 @@ Maybe<void> MultiClientSessionContext::TryClose() {
     }
     {
       // NOTE(chengcheng): delete runtime global objects
+      // Finishes the pending snapshot save while the file systems and the env are still alive.
+      Global<BackgroundSnapshotSaver>::Delete();
       Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::Delete();
       Global<boxing::collective::CollectiveBoxingExecutor>::Delete();
       Global<summary::EventsWriter>::Delete();
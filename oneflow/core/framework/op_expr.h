@@ -119,6 +119,7 @@ class BuiltinOpExprImpl : public BuiltinOpExpr {
 
 class StatefulLocalOpKernel;
 class ConsistentTensorInferCache;
+class LocalTensorInferCache;
 
 class UserOpExpr final : public BuiltinOpExprImpl<UserOpConf> {
  public:
@@ -150,6 +151,9 @@ class UserOpExpr final : public BuiltinOpExprImpl<UserOpConf> {
   ConsistentTensorInferCache* mut_consistent_tensor_infer_cache() const {
     return consistent_tensor_infer_cache_.get();
   }
+  LocalTensorInferCache* mut_local_tensor_infer_cache() const {
+    return local_tensor_infer_cache_.get();
+  }
 
  private:
   UserOpExpr(const std::string& op_name, UserOpConf&& proto, const AttrMap& base_attrs,
@@ -162,6 +166,7 @@ class UserOpExpr final : public BuiltinOpExprImpl<UserOpConf> {
   user_op::DeviceInferFn device_infer_fn_;
   mutable HashMap<Symbol<Device>, std::shared_ptr<StatefulLocalOpKernel>> device2kernel_;
   std::shared_ptr<ConsistentTensorInferCache> consistent_tensor_infer_cache_;
+  std::shared_ptr<LocalTensorInferCache> local_tensor_infer_cache_;
 };
 
 class ConsistentToConsistentOpExpr : public OpExpr {
@@ -0,0 +1,288 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_interpreter/eager_elementwise_fusion.h"
+#include "oneflow/core/framework/op_interpreter/eager_mirrored_op_interpreter.h"
+#include "oneflow/core/framework/op_interpreter.h"
+#include "oneflow/core/framework/op_builder.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/attr_map.h"
+#include "oneflow/core/framework/stride.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/eager/local_dep_object.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+int64_t FusionWindowSize() {
+  static const int64_t window_size = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_EAGER_ELEMENTWISE_FUSION_WINDOW_SIZE", 16), 1);
+  return window_size;
+}
+
+// Inside the window, the result of op i has value id -(i + 1) because the input num is not known
+// until the window is flushed.
+int32_t ValueId4OpIndex(int64_t op_index) { return -static_cast<int32_t>(op_index) - 1; }
+
+struct FusionOp {
+  int32_t opcode;
+  int32_t lhs;
+  int32_t rhs;
+  int32_t scalar_index;
+  // Empty for the partial sums of add_n.
+  std::weak_ptr<EagerMirroredTensorImpl> output;
+};
+
+class ElementwiseFusionWindow final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ElementwiseFusionWindow);
+  ElementwiseFusionWindow() = default;
+  ~ElementwiseFusionWindow() = default;
+
+  Maybe<bool> TryBuffer(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
+                        TensorTuple* outputs, const AttrMap& attrs);
+  Maybe<void> Flush();
+
+  bool has_pending_ops() const { return has_pending_ops_.load(std::memory_order_acquire); }
+
+ private:
+  Maybe<bool> IsFusible(const TensorTuple& inputs) const;
+  Maybe<int32_t> ValueId4Input(const std::shared_ptr<Tensor>& input);
+  int32_t AddOp(int32_t opcode, int32_t lhs, int32_t rhs, float scalar);
+  Maybe<UserOpExpr> FusedOpExpr(int64_t input_num, int64_t output_num);
+
+  std::recursive_mutex mutex_;
+  std::atomic<bool> has_pending_ops_{false};
+  TensorTuple inputs_;
+  HashMap<const EagerMirroredTensorImpl*, int32_t> input_impl2value_id_;
+  HashMap<const EagerMirroredTensorImpl*, int32_t> pending_impl2value_id_;
+  std::vector<FusionOp> ops_;
+  std::vector<float> scalars_;
+  std::shared_ptr<const Shape> shape_;
+  Symbol<Device> device_;
+  std::map<std::pair<int64_t, int64_t>, std::shared_ptr<UserOpExpr>> input_output_num2op_expr_;
+};
+
+ElementwiseFusionWindow* GlobalFusionWindow() {
+  // Never destructed, the tensors it may still hold cannot be released after the VM is gone.
+  static ElementwiseFusionWindow* window = new ElementwiseFusionWindow();
+  return window;
+}
+
+Maybe<bool> ElementwiseFusionWindow::IsFusible(const TensorTuple& inputs) const {
+  for (const auto& input : inputs) {
+    if (!input->is_local() || input->is_lazy()) { return false; }
+    if (input->dtype()->data_type() != DataType::kFloat) { return false; }
+    if (JUST(input->device())->type() != "cpu") { return false; }
+    if (*input->shape() != *inputs.at(0)->shape()) { return false; }
+  }
+  return true;
+}
+
+Maybe<int32_t> ElementwiseFusionWindow::ValueId4Input(const std::shared_ptr<Tensor>& input) {
+  const EagerMirroredTensorImpl* impl = JUST(input->mut_eager_mirrored_tensor_impl());
+  if (impl->is_pending_fusion()) {
+    const auto& iter = pending_impl2value_id_.find(impl);
+    CHECK_OR_RETURN(iter != pending_impl2value_id_.end());
+    return iter->second;
+  }
+  const auto& iter = input_impl2value_id_.find(impl);
+  if (iter != input_impl2value_id_.end()) { return iter->second; }
+  // Holding the input keeps its memory until the fused op has read it.
+  const int32_t value_id = inputs_.size();
+  inputs_.push_back(input);
+  input_impl2value_id_.emplace(impl, value_id);
+  return value_id;
+}
+
+int32_t ElementwiseFusionWindow::AddOp(int32_t opcode, int32_t lhs, int32_t rhs, float scalar) {
+  FusionOp op;
+  op.opcode = opcode;
+  op.lhs = lhs;
+  op.rhs = rhs;
+  op.scalar_index = -1;
+  if (opcode == kFusedElementwiseAddScalar || opcode == kFusedElementwiseMulScalar) {
+    op.scalar_index = scalars_.size();
+    scalars_.push_back(scalar);
+  }
+  ops_.push_back(op);
+  return ValueId4OpIndex(ops_.size() - 1);
+}
+
+Maybe<bool> ElementwiseFusionWindow::TryBuffer(const UserOpExpr& user_op_expr,
+                                               const TensorTuple& inputs, TensorTuple* outputs,
+                                               const AttrMap& attrs) {
+  const std::string& op_type_name = user_op_expr.op_type_name();
+  int32_t opcode = -1;
+  if (op_type_name == "add_n" || op_type_name == "broadcast_add") {
+    opcode = kFusedElementwiseAdd;
+  } else if (op_type_name == "broadcast_sub") {
+    opcode = kFusedElementwiseSub;
+  } else if (op_type_name == "multiply" || op_type_name == "broadcast_mul") {
+    opcode = kFusedElementwiseMul;
+  } else if (op_type_name == "broadcast_div") {
+    opcode = kFusedElementwiseDiv;
+  } else if (op_type_name == "scalar_add") {
+    opcode = kFusedElementwiseAddScalar;
+  } else if (op_type_name == "scalar_mul") {
+    opcode = kFusedElementwiseMulScalar;
+  } else if (op_type_name == "relu") {
+    opcode = kFusedElementwiseRelu;
+  } else {
+    return false;
+  }
+  if (inputs.empty() || outputs->size() != 1 || outputs->at(0)) { return false; }
+  if (!JUST(IsFusible(inputs))) { return false; }
+  float scalar = 0;
+  if (opcode == kFusedElementwiseAddScalar || opcode == kFusedElementwiseMulScalar) {
+    ComposedAttrMap composed_attrs(attrs, user_op_expr.base_attrs());
+    if (JUST(composed_attrs.GetAttr<bool>("has_float_operand"))) {
+      scalar = JUST(composed_attrs.GetAttr<double>("float_operand"));
+    } else if (JUST(composed_attrs.GetAttr<bool>("has_int_operand"))) {
+      scalar = JUST(composed_attrs.GetAttr<int64_t>("int_operand"));
+    } else {
+      return false;
+    }
+  }
+
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  const auto& device = JUST(inputs.at(0)->device());
+  if (!ops_.empty() && (*shape_ != *inputs.at(0)->shape() || device_ != device)) { JUST(Flush()); }
+  if (ops_.empty()) {
+    shape_ = inputs.at(0)->shape();
+    device_ = device;
+  }
+  std::vector<int32_t> value_ids;
+  for (const auto& input : inputs) { value_ids.push_back(JUST(ValueId4Input(input))); }
+  int32_t result = 0;
+  if (op_type_name == "add_n") {
+    CHECK_GE_OR_RETURN(value_ids.size(), 2);
+    result = value_ids.at(0);
+    for (int64_t i = 1; i < value_ids.size(); ++i) {
+      result = AddOp(opcode, result, value_ids.at(i), 0);
+    }
+  } else if (opcode == kFusedElementwiseAddScalar || opcode == kFusedElementwiseMulScalar
+             || opcode == kFusedElementwiseRelu) {
+    CHECK_EQ_OR_RETURN(value_ids.size(), 1);
+    result = AddOp(opcode, value_ids.at(0), value_ids.at(0), scalar);
+  } else {
+    CHECK_EQ_OR_RETURN(value_ids.size(), 2);
+    result = AddOp(opcode, value_ids.at(0), value_ids.at(1), 0);
+  }
+
+  const auto& impl = std::make_shared<EagerMirroredTensorImpl>();
+  *JUST(impl->mut_device()) = device;
+  JUST(user_op_expr.InferPhysicalShapeAndDType(
+      attrs, JUST(device->of_type()),
+      [&](int32_t i) -> const TensorMeta* {
+        return CHECK_JUST(inputs.at(i)->mut_eager_mirrored_tensor_impl())->mut_tensor_meta();
+      },
+      [&](int32_t i) -> TensorMeta* { return impl->mut_tensor_meta(); }));
+  CHECK_OR_RETURN(*impl->shape() == *shape_);
+  CHECK_EQ_OR_RETURN(impl->dtype(), DataType::kFloat);
+  impl->mut_tensor_meta()->set_stride(std::make_shared<Stride>(*impl->shape()));
+  impl->set_is_pending_fusion(true);
+  ops_.back().output = impl;
+  pending_impl2value_id_[impl.get()] = result;
+  outputs->at(0) = std::make_shared<MirroredTensor>(impl);
+  has_pending_ops_.store(true, std::memory_order_release);
+  if (ops_.size() >= FusionWindowSize()) { JUST(Flush()); }
+  return true;
+}
+
+Maybe<UserOpExpr> ElementwiseFusionWindow::FusedOpExpr(int64_t input_num, int64_t output_num) {
+  const auto& key = std::make_pair(input_num, output_num);
+  auto iter = input_output_num2op_expr_.find(key);
+  if (iter == input_output_num2op_expr_.end()) {
+    const auto& op_expr = JUST(OpBuilder("eager_fused_elementwise")
+                                   .Input("in", input_num)
+                                   .Output("out", output_num)
+                                   .Build());
+    iter = input_output_num2op_expr_.emplace(key, op_expr).first;
+  }
+  return iter->second;
+}
+
+Maybe<void> ElementwiseFusionWindow::Flush() {
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
+  TensorTuple inputs;
+  std::vector<FusionOp> ops;
+  std::vector<float> scalars;
+  inputs.swap(inputs_);
+  ops.swap(ops_);
+  scalars.swap(scalars_);
+  input_impl2value_id_.clear();
+  pending_impl2value_id_.clear();
+  const int32_t input_num = inputs.size();
+  const auto& GlobalValueId = [&](int32_t value_id) {
+    return value_id >= 0 ? value_id : input_num - value_id - 1;
+  };
+  std::vector<int32_t> program;
+  std::vector<int32_t> output_value_ids;
+  TensorTuple outputs;
+  for (int64_t i = 0; i < ops.size(); ++i) {
+    const FusionOp& op = ops.at(i);
+    program.push_back(op.opcode);
+    program.push_back(GlobalValueId(op.lhs));
+    program.push_back(GlobalValueId(op.rhs));
+    program.push_back(op.scalar_index);
+    // Results nobody refers to any more are only kept in the blocks of the fused kernel.
+    const auto& impl = op.output.lock();
+    if (!impl) { continue; }
+    const auto& dep_object = JUST(GetLocalDepObjectFromDevicePool(device_));
+    JUST(impl->InitEagerBlobObject(dep_object));
+    impl->set_is_pending_fusion(false);
+    output_value_ids.push_back(input_num + i);
+    outputs.push_back(std::make_shared<MirroredTensor>(impl));
+  }
+  // Cleared once all outputs have their blob objects, so that a concurrent flush of one of them
+  // waits for this one, and before the fused op runs, so that its own PhysicalRun has nothing left
+  // to flush.
+  has_pending_ops_.store(false, std::memory_order_release);
+  if (!outputs.empty()) {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::vector<int32_t>>("program", program));
+    JUST(attrs.SetAttr<std::vector<float>>("scalars", scalars));
+    JUST(attrs.SetAttr<std::vector<int32_t>>("output_value_ids", output_value_ids));
+    const auto& op_expr = JUST(FusedOpExpr(input_num, outputs.size()));
+    JUST(NaiveInterpret(*op_expr, inputs, device_, &outputs, OpExprInterpContext(attrs)));
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+bool IsEagerElementwiseFusionEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_EAGER_ELEMENTWISE_FUSION", false);
+  return enabled;
+}
+
+Maybe<bool> TryBufferElementwiseOp(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
+                                   TensorTuple* outputs, const AttrMap& attrs) {
+  return GlobalFusionWindow()->TryBuffer(user_op_expr, inputs, outputs, attrs);
+}
+
+Maybe<void> FlushEagerElementwiseFusion() {
+  if (!IsEagerElementwiseFusionEnabled()) { return Maybe<void>::Ok(); }
+  ElementwiseFusionWindow* window = GlobalFusionWindow();
+  if (!window->has_pending_ops()) { return Maybe<void>::Ok(); }
+  return window->Flush();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_OP_INTERPRETER_EAGER_ELEMENTWISE_FUSION_H_
+#define ONEFLOW_CORE_FRAMEWORK_OP_INTERPRETER_EAGER_ELEMENTWISE_FUSION_H_
+
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+class AttrMap;
+
+namespace one {
+
+class UserOpExpr;
+class TensorTuple;
+
+// With ONEFLOW_EAGER_ELEMENTWISE_FUSION=1, eager elementwise ops on float cpu tensors of the same
+// shape are not dispatched one by one. They are buffered into a window of up to
+// ONEFLOW_EAGER_ELEMENTWISE_FUSION_WINDOW_SIZE ops and run as one eager_fused_elementwise op, which
+// evaluates the whole window block by block so that intermediate results stay in cache. Only the
+// outputs still referenced when the window is flushed are written to memory.
+//
+// The outputs of buffered ops have no eager blob object until then. Accessing it flushes the
+// window, and so does every PhysicalRun, which keeps the instruction order of the VM.
+bool IsEagerElementwiseFusionEnabled();
+
+// Returns false if the op is not fusible, outputs are then left untouched.
+Maybe<bool> TryBufferElementwiseOp(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
+                                   TensorTuple* outputs, const AttrMap& attrs);
+
+Maybe<void> FlushEagerElementwiseFusion();
+
+// Each op of the program of eager_fused_elementwise takes kFusedElementwiseOpSize int32s: the
+// opcode, the lhs and rhs value ids, and the index of its scalar. Value ids [0, input num) are the
+// inputs, the result of op i is value input num + i.
+enum FusedElementwiseOpcode {
+  kFusedElementwiseAdd = 0,
+  kFusedElementwiseSub,
+  kFusedElementwiseMul,
+  kFusedElementwiseDiv,
+  kFusedElementwiseAddScalar,
+  kFusedElementwiseMulScalar,
+  kFusedElementwiseRelu,
+};
+
+constexpr int32_t kFusedElementwiseOpSize = 4;
+
+}  // namespace one
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_OP_INTERPRETER_EAGER_ELEMENTWISE_FUSION_H_
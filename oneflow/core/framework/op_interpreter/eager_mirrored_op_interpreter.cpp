@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/framework/op_interpreter/eager_elementwise_fusion.h"
 #include "oneflow/core/framework/instructions_builder.h"
 #include "oneflow/core/framework/op_arg_util.h"
 #include "oneflow/core/framework/scope_util.h"
@@ -28,6 +29,7 @@ limitations under the License.
 #include "oneflow/core/framework/tensor_tuple.h"
 #include "oneflow/core/framework/stride.h"
 #include "oneflow/core/framework/op_expr_helper.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 #include "oneflow/core/eager/foreign_boxing_util.h"
 #include "oneflow/core/memory/memory_case_util.h"
 #include "oneflow/core/operator/operator.h"
@@ -111,32 +113,69 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
     }
   }
   Symbol<Device> op_device;
-  bool need_check_mem_case = true;
-
-  // Infer devices
-  if (!user_op_expr.has_device_infer_fn()) {
-    op_device = default_device;
+  const bool need_check_mem_case = !user_op_expr.has_device_infer_fn();
+  // Calls with the same input metas and attrs as a call before take its inference results.
+  std::shared_ptr<const LocalTensorInferResult> infer_result;
+  LocalTensorMetaInferArgs infer_args;
+  auto* infer_cache = user_op_expr.mut_local_tensor_infer_cache();
+  if (LocalTensorInferCache::Enabled()) {
+    JUST(infer_args.Init(attrs, default_device, inputs));
+    infer_result = infer_cache->Find(infer_args);
+  }
+  if (infer_result) {
+    op_device = infer_result->op_device();
     for (int i = 0; i < outputs->size(); i++) {
       auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
-      *JUST(tensor_impl->mut_device()) = default_device;
+      *JUST(tensor_impl->mut_device()) = infer_result->output_devices().at(i);
+      // Copied into the shape of the output, which changes with the blob of a dynamic output.
+      const TensorMeta& tensor_meta = infer_result->output_tensor_metas().at(i);
+      TensorMeta* output_tensor_meta = output_tensor_metas->at(i);
+      *output_tensor_meta->mut_shape() = tensor_meta.shape();
+      output_tensor_meta->set_dtype(tensor_meta.dtype());
+      output_tensor_meta->set_is_dynamic(tensor_meta.is_dynamic());
     }
   } else {
-    need_check_mem_case = false;
-    op_device = JUST(user_op_expr.InferDevices(attrs, inputs, outputs));
-  }
+    // Infer devices
+    if (!user_op_expr.has_device_infer_fn()) {
+      op_device = default_device;
+      for (int i = 0; i < outputs->size(); i++) {
+        auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
+        *JUST(tensor_impl->mut_device()) = default_device;
+      }
+    } else {
+      op_device = JUST(user_op_expr.InferDevices(attrs, inputs, outputs));
+    }
 
-  // Infer shapes and dtypes
-  const auto& device_tag = JUST(op_device->of_type());
-  JUST(user_op_expr.InferPhysicalShapeAndDType(
-      attrs, device_tag,
-      [&](int32_t i) -> const TensorMeta* {
-        return CHECK_JUST(TensorImpl4Tensor(inputs.at(i)))->mut_tensor_meta();
-      },
-      [&](int32_t i) -> TensorMeta* {
-        // using thread_local TensorMeta pointer if inplace.
-        // using tensor_impl TensorMeta pointer if not inplace.
-        return output_tensor_metas->at(i);
-      }));
+    // Infer shapes and dtypes
+    const auto& device_tag = JUST(op_device->of_type());
+    JUST(user_op_expr.InferPhysicalShapeAndDType(
+        attrs, device_tag,
+        [&](int32_t i) -> const TensorMeta* {
+          return CHECK_JUST(TensorImpl4Tensor(inputs.at(i)))->mut_tensor_meta();
+        },
+        [&](int32_t i) -> TensorMeta* {
+          // using thread_local TensorMeta pointer if inplace.
+          // using tensor_impl TensorMeta pointer if not inplace.
+          return output_tensor_metas->at(i);
+        }));
+
+    if (LocalTensorInferCache::Enabled()) {
+      std::vector<Symbol<Device>> output_devices;
+      std::vector<TensorMeta> inferred_tensor_metas;
+      output_devices.reserve(outputs->size());
+      inferred_tensor_metas.reserve(outputs->size());
+      for (int i = 0; i < outputs->size(); i++) {
+        output_devices.push_back(JUST(TensorImpl4Tensor(outputs->at(i)))->device());
+        const TensorMeta* output_tensor_meta = output_tensor_metas->at(i);
+        const auto& shape = std::make_shared<const Shape>(output_tensor_meta->shape());
+        inferred_tensor_metas.emplace_back(shape, output_tensor_meta->dtype());
+        inferred_tensor_metas.back().set_is_dynamic(output_tensor_meta->is_dynamic());
+      }
+      infer_result = std::make_shared<LocalTensorInferResult>(
+          op_device, std::move(output_devices), std::move(inferred_tensor_metas));
+      infer_cache->Insert(infer_args, infer_result);
+    }
+  }
 
   for (int i = 0; i < output_eager_blob_objects->size(); i++) {
     auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
@@ -162,7 +201,7 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
 
   JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
     return builder->LocalCallOpKernel(kernel, input_eager_blob_objects, output_eager_blob_objects,
-                                      ctx, op_device);
+                                      infer_result, ctx, op_device);
   }));
   return Maybe<void>::Ok();
 }
@@ -194,6 +233,10 @@ static Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTu
 Maybe<void> EagerMirroredInterpreter::ApplyImpl(const UserOpExpr& op_expr,
                                                 const TensorTuple& inputs, TensorTuple* outputs,
                                                 const OpExprInterpContext& ctx) const {
+  if (IsEagerElementwiseFusionEnabled()
+      && JUST(TryBufferElementwiseOp(op_expr, inputs, outputs, ctx.attrs))) {
+    return Maybe<void>::Ok();
+  }
   return NaiveInterpret(op_expr, inputs, outputs, ctx);
 }
 
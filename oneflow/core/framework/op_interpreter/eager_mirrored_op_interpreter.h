@@ -24,7 +24,12 @@ class ParallelDesc;
 namespace one {
 
 class Tensor;
+class UserOpExpr;
+struct OpExprInterpContext;
 
+Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
+                           const Symbol<Device>& default_device, TensorTuple* outputs,
+                           const OpExprInterpContext& ctx);
 Maybe<void> RunEmptyOp(TensorTuple* outputs);
 Maybe<Tensor> Broadcast(const std::shared_ptr<Tensor>& tensor, int64_t src_rank,
                         Symbol<ParallelDesc> parallel_desc, bool inplace);
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/tensor_impl.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/stride.h"
+#include "oneflow/core/framework/op_interpreter/eager_elementwise_fusion.h"
 #include "oneflow/core/job/parallel_desc.h"
 #include "oneflow/core/job/sbp_parallel.cfg.h"
 #include "oneflow/core/functional/functional.h"
@@ -78,18 +79,43 @@ Maybe<MirroredTensorImpl> LazyMirroredTensorImpl::detach() const {
 }
 
 EagerMirroredTensorImpl::EagerMirroredTensorImpl()
-    : MirroredTensorImpl(std::make_shared<const MirroredTensorMeta>(), false, false) {}
+    : MirroredTensorImpl(std::make_shared<const MirroredTensorMeta>(), false, false),
+      is_pending_fusion_(false) {}
 
 EagerMirroredTensorImpl::EagerMirroredTensorImpl(
     const std::shared_ptr<const MirroredTensorMeta>& tensor_meta, bool requires_grad, bool is_leaf)
-    : MirroredTensorImpl(tensor_meta, requires_grad, is_leaf) {}
+    : MirroredTensorImpl(tensor_meta, requires_grad, is_leaf), is_pending_fusion_(false) {}
 
 EagerMirroredTensorImpl::~EagerMirroredTensorImpl() {}
 
 EagerMirroredTensorImpl::EagerMirroredTensorImpl(
     const std::shared_ptr<const MirroredTensorMeta>& tensor_meta,
     std::shared_ptr<TensorStorage> tensor_storage, bool requires_grad, bool is_leaf)
-    : MirroredTensorImpl(tensor_meta, requires_grad, is_leaf), tensor_storage_(tensor_storage) {}
+    : MirroredTensorImpl(tensor_meta, requires_grad, is_leaf),
+      tensor_storage_(tensor_storage),
+      is_pending_fusion_(false) {}
+
+Maybe<void> EagerMirroredTensorImpl::FlushIfPendingFusion() const {
+  if (is_pending_fusion()) { JUST(one::FlushEagerElementwiseFusion()); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<vm::EagerBlobObject> EagerMirroredTensorImpl::eager_blob_object() const {
+  JUST(FlushIfPendingFusion());
+  CHECK_OR_RETURN(eager_blob_object_);
+  return eager_blob_object_;
+}
+
+Maybe<TensorStorage> EagerMirroredTensorImpl::tensor_storage() const {
+  JUST(FlushIfPendingFusion());
+  CHECK_OR_RETURN(eager_blob_object_);
+  return tensor_storage_;
+}
+
+Maybe<bool> EagerMirroredTensorImpl::has_eager_blob_object() const {
+  JUST(FlushIfPendingFusion());
+  return eager_blob_object_.get();
+}
 
 Maybe<void> EagerMirroredTensorImpl::UpdateTensorStorage() {
   const auto& eager_blob_object = eager_blob_object_;
@@ -154,6 +180,7 @@ const std::shared_ptr<const Shape>& EagerMirroredTensorImpl::shape() const {
 }
 
 Maybe<MirroredTensorImpl> EagerMirroredTensorImpl::detach() const {
+  JUST(FlushIfPendingFusion());
   auto detached_impl =
       std::make_shared<EagerMirroredTensorImpl>(tensor_meta_, tensor_storage_, false, true);
   detached_impl->eager_blob_object_ = eager_blob_object_;
@@ -216,21 +216,20 @@ class EagerMirroredTensorImpl final : public MirroredTensorImpl {
   bool is_lazy() const override { return false; }
 
   // Getters valid only for EagerMirroredTensorImpl
-  Maybe<vm::EagerBlobObject> eager_blob_object() const override {
-    CHECK_OR_RETURN(eager_blob_object_);
-    return eager_blob_object_;
-  }
+  Maybe<vm::EagerBlobObject> eager_blob_object() const override;
   Maybe<LocalDepObject*> compute_local_dep_object() const override;
-  Maybe<TensorStorage> tensor_storage() const override {
-    CHECK_OR_RETURN(eager_blob_object_);
-    return tensor_storage_;
-  }
-  Maybe<bool> has_eager_blob_object() const override { return eager_blob_object_.get(); }
+  Maybe<TensorStorage> tensor_storage() const override;
+  Maybe<bool> has_eager_blob_object() const override;
   Maybe<const Stride> stride() const override { return tensor_meta_->stride_ptr(); }
   Maybe<int64_t> storage_offset() const override { return tensor_meta_->storage_offset(); }
+  // True while the tensor is the output of an op buffered for eager elementwise fusion.
+  bool is_pending_fusion() const { return is_pending_fusion_.load(std::memory_order_acquire); }
 
   // Setters
   TensorStorage* mut_tensor_storage() { return tensor_storage_.get(); }
+  void set_is_pending_fusion(bool val) {
+    is_pending_fusion_.store(val, std::memory_order_release);
+  }
 
   Maybe<void> InitEagerBlobObject(LocalDepObject* dep_object);
   Maybe<EagerMirroredTensorImpl*> mut_eager_mirrored_tensor_impl() override { return this; }
@@ -238,9 +237,11 @@ class EagerMirroredTensorImpl final : public MirroredTensorImpl {
  private:
   Maybe<void> UpdateTensorStorage();
   Maybe<void> set_eager_blob_object(std::shared_ptr<vm::EagerBlobObject> eager_blob_object);
+  Maybe<void> FlushIfPendingFusion() const;
 
   std::shared_ptr<TensorStorage> tensor_storage_;
   std::shared_ptr<vm::EagerBlobObject> eager_blob_object_;
+  std::atomic<bool> is_pending_fusion_;
 };
 
 class LazyConsistentTensorImpl final : public ConsistentTensorImpl {
@@ -47,6 +47,7 @@ limitations under the License.
 #include "oneflow/core/kernel/sync_check_kernel_observer.h"
 #include "oneflow/core/kernel/blob_access_checker_kernel_observer.h"
 #include "oneflow/core/kernel/profiler_kernel_observer.h"
+#include "oneflow/core/profiler/host_tracer.h"
 #ifdef WITH_RDMA
 #include "oneflow/core/platform/include/ibv.h"
 #endif  // WITH_RDMA
@@ -218,6 +219,11 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
 }
 
 EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
+  // A trace that cannot be written must not abort the process at exit.
+  const auto& maybe_dumped = profiler::StopAndDumpHostTraceIfEnvSet();
+  if (!maybe_dumped.IsOk()) {
+    LOG(ERROR) << "Failed to dump the host trace: " << maybe_dumped.GetSerializedError();
+  }
   auto session_ctx = Global<MultiClientSessionContext>::Get();
   if (session_ctx != nullptr) {
     VLOG(2) << "Multi client session has not closed , env close it at env scope destruction.";
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job/mem_lifetime_packing.h"
 
 namespace oneflow {
 
@@ -29,6 +30,7 @@ enum MemAllocAlgoType {
   kMemSizeFirstAlgo = 0,
   kMutualExclusionFirstAlgo = 1,
   kTimeLineAlgo = 2,
+  kLifetimePackingAlgo = 3,
 };
 
 }  // namespace oneflow
@@ -662,6 +664,10 @@ void BfcAllocator::FreeRaw(int64_t offset, int64_t size) {
   MergeFreePieceAndCheckValid();
 }
 
+int64_t GetRegstMemSize(const RegstDescProto* regst) {
+  return RtRegstDesc(*regst).TotalMainByteSize4AllRegst();
+}
+
 void MemReusedAlgorithm_TimeLineAlgo(
     const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
     const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline, MemBlockResultInfo* result) {
@@ -670,30 +676,85 @@ void MemReusedAlgorithm_TimeLineAlgo(
   int64_t buffer_size = 1;
   BfcAllocator bfc_allocator(buffer_size);
 
-  auto GetRegstSize = [](const RegstDescProto* regst) -> int64_t {
-    return RtRegstDesc(*regst).TotalMainByteSize4AllRegst();
-  };
-
   CHECK_EQ(alloc_regsts_timeline.size(), free_regsts_timeline.size());
   for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
     for (RegstDescProto* alloc_regst : alloc_regsts_timeline.at(i)) {
       CHECK(regst_desc2offset
-                ->emplace(alloc_regst, bfc_allocator.AllocateRaw(GetRegstSize(alloc_regst)))
+                ->emplace(alloc_regst, bfc_allocator.AllocateRaw(GetRegstMemSize(alloc_regst)))
                 .second);
     }
     for (RegstDescProto* free_regst : free_regsts_timeline.at(i)) {
       CHECK(regst_desc2offset->find(free_regst) != regst_desc2offset->end());
-      bfc_allocator.FreeRaw(regst_desc2offset->at(free_regst), GetRegstSize(free_regst));
+      bfc_allocator.FreeRaw(regst_desc2offset->at(free_regst), GetRegstMemSize(free_regst));
     }
   }
   result->mem_block_size = bfc_allocator.buffer_size();
 }
 
+// The regsts are numbered in alloc order, ties broken by regst desc id.
+std::vector<MemLifetimeInterval> GenLifetimeIntervals(
+    const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+    const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
+    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
+    std::vector<RegstDescProto*>* id2regst) {
+  CHECK_EQ(alloc_regsts_timeline.size(), free_regsts_timeline.size());
+  std::vector<MemLifetimeInterval> intervals;
+  HashMap<RegstDescProto*, int64_t> regst2id;
+  id2regst->clear();
+  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
+    std::vector<RegstDescProto*> regsts(alloc_regsts_timeline.at(i).begin(),
+                                        alloc_regsts_timeline.at(i).end());
+    std::sort(regsts.begin(), regsts.end(), [](RegstDescProto* lhs, RegstDescProto* rhs) {
+      return lhs->regst_desc_id() < rhs->regst_desc_id();
+    });
+    for (RegstDescProto* regst : regsts) {
+      CHECK(regst2id.emplace(regst, intervals.size()).second);
+      id2regst->push_back(regst);
+      MemLifetimeInterval interval;
+      interval.size = GetRegstMemSize(regst);
+      interval.alloc_index = i;
+      interval.free_index = -1;
+      intervals.push_back(interval);
+    }
+  }
+  for (int64_t i = 0; i < free_regsts_timeline.size(); ++i) {
+    for (RegstDescProto* regst : free_regsts_timeline.at(i)) {
+      intervals.at(regst2id.at(regst)).free_index = i;
+    }
+  }
+  for (int64_t id = 0; id < intervals.size(); ++id) {
+    MemLifetimeInterval* interval = &intervals.at(id);
+    CHECK_GE(interval->free_index, interval->alloc_index);
+    for (RegstDescProto* mutual_regst : regst2mutual_exclusion_regsts.at(id2regst->at(id))) {
+      interval->mutual_exclusion_ids.push_back(regst2id.at(mutual_regst));
+    }
+  }
+  CHECK_EQ(intervals.size(), regst2mutual_exclusion_regsts.size());
+  return intervals;
+}
+
+void MemReusedAlgorithm_LifetimePackingAlgo(
+    const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+    const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
+    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
+    int64_t max_iteration_num, MemBlockResultInfo* result) {
+  std::vector<RegstDescProto*> id2regst;
+  const std::vector<MemLifetimeInterval> intervals = GenLifetimeIntervals(
+      alloc_regsts_timeline, free_regsts_timeline, regst2mutual_exclusion_regsts, &id2regst);
+  std::vector<int64_t> offsets;
+  const int64_t mem_block_size = PackMemLifetimeIntervals(intervals, max_iteration_num, &offsets);
+  HashMap<RegstDescProto*, int64_t>* regst_desc2offset = &(result->regst_desc2offset);
+  for (int64_t id = 0; id < intervals.size(); ++id) {
+    CHECK(regst_desc2offset->emplace(id2regst.at(id), offsets.at(id)).second);
+  }
+  result->mem_block_size = std::max<int64_t>(mem_block_size, 1);
+}
+
 void SelectAlgorithmGenMemBlockOffset4Regsts(
     MemAllocAlgoType algo_id, const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
     const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
     const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
-    MemBlockResultInfo* result) {
+    int64_t lifetime_packing_max_iteration_num, MemBlockResultInfo* result) {
   CHECK_EQ(result->mem_block_size, 0);
   CHECK(result->regst_desc2offset.empty());
   switch (algo_id) {
@@ -706,6 +767,11 @@ void SelectAlgorithmGenMemBlockOffset4Regsts(
     case kTimeLineAlgo:
       MemReusedAlgorithm_TimeLineAlgo(alloc_regsts_timeline, free_regsts_timeline, result);
       break;
+    case kLifetimePackingAlgo:
+      MemReusedAlgorithm_LifetimePackingAlgo(alloc_regsts_timeline, free_regsts_timeline,
+                                             regst2mutual_exclusion_regsts,
+                                             lifetime_packing_max_iteration_num, result);
+      break;
     default: UNIMPLEMENTED();
   }
   CHECK_GT(result->mem_block_size, 0);
@@ -719,6 +785,7 @@ int64_t CountMemAllocAlgoNum() {
   if (mem_alloc_algo_conf.use_mem_size_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_mutual_exclusion_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_time_line_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.use_lifetime_packing_algo()) { ++ret; }
   CHECK_GE(ret, 0);
   return ret;
 }
@@ -736,6 +803,9 @@ void InitAlgo2Result(HashMap<MemAllocAlgoType, MemBlockResultInfo>* algo2result)
   if (mem_alloc_algo_conf.use_time_line_algo()) {
     CHECK(algo2result->emplace(kTimeLineAlgo, MemBlockResultInfo()).second);
   }
+  if (mem_alloc_algo_conf.use_lifetime_packing_algo()) {
+    CHECK(algo2result->emplace(kLifetimePackingAlgo, MemBlockResultInfo()).second);
+  }
 }
 
 }  // namespace
@@ -775,6 +845,11 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
   {
     int64_t work_size = mem_chain2mem_reused_regsts.size() * CountMemAllocAlgoNum();
     int64_t thread_pool_size = std::min<int64_t>(work_size, std::thread::hardware_concurrency());
+    const int64_t lifetime_packing_max_iteration_num =
+        GlobalJobDesc()
+            .job_conf()
+            .memory_allocation_algorithm_conf()
+            .lifetime_packing_algo_max_iteration_num();
     BlockingCounter counter(work_size);
     ThreadPool thread_pool(thread_pool_size);
     for (int64_t mem_chain_id : mem_chains) {
@@ -784,11 +859,12 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
         MemBlockResultInfo* result = &pair.second;
         thread_pool.AddWork([algo_id, mem_chain_id, &mem_chain2task2alloc_regsts,
                              &mem_chain2task2free_regsts, &mem_chain2regst2mutual_exclusion_regsts,
-                             result, &counter]() {
+                             lifetime_packing_max_iteration_num, result, &counter]() {
           SelectAlgorithmGenMemBlockOffset4Regsts(
               algo_id, mem_chain2task2alloc_regsts.at(mem_chain_id),
               mem_chain2task2free_regsts.at(mem_chain_id),
-              mem_chain2regst2mutual_exclusion_regsts.at(mem_chain_id), result);
+              mem_chain2regst2mutual_exclusion_regsts.at(mem_chain_id),
+              lifetime_packing_max_iteration_num, result);
           counter.Decrease();
         });
       }
@@ -806,6 +882,11 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
     }
     CHECK(best_result != nullptr);
     int64_t mem_block_id = Global<IDMgr>::Get()->NewMemBlockId();
+    std::vector<RegstDescProto*> id2regst;
+    (*plan->mutable_mem_block_id2mem_size_lower_bound())[mem_block_id] =
+        MemLifetimeIntervalsSizeLowerBound(GenLifetimeIntervals(
+            mem_chain2task2alloc_regsts.at(pair.first), mem_chain2task2free_regsts.at(pair.first),
+            mem_chain2regst2mutual_exclusion_regsts.at(pair.first), &id2regst));
     CHECK_EQ(mem_chain2mem_reused_regsts.at(pair.first).size(),
              (best_result->regst_desc2offset.size()
               + mem_chain2consumer2inplaced_regst.at(pair.first).size()));
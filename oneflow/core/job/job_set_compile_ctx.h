@@ -29,6 +29,12 @@ class JobSetCompileCtx final {
   PbMap<std::string, int64_t>* GetVarOpName2randomSeed() {
     return job_set_compile_ctx_proto_.mutable_var_op_name2random_seed();
   }
+  PbMap<std::string, std::string>* GetSparseEmbeddingVarOpName2JobName() {
+    return job_set_compile_ctx_proto_.mutable_sparse_embedding_var_op_name2job_name();
+  }
+  PbMap<std::string, std::string>* GetVarOpName2ReaderJobName() {
+    return job_set_compile_ctx_proto_.mutable_var_op_name2reader_job_name();
+  }
 
  private:
   JobSetCompileCtxProto job_set_compile_ctx_proto_;
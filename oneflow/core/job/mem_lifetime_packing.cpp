@@ -0,0 +1,159 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/mem_lifetime_packing.h"
+#include "oneflow/core/common/util.h"
+#include <numeric>
+#include <random>
+
+namespace oneflow {
+
+namespace {
+
+// Places the intervals in order, each into the tightest gap left by the placed intervals whose
+// lifetime overlaps with it. Returns the mem block size.
+int64_t PlaceByBestFit(const std::vector<MemLifetimeInterval>& intervals,
+                       const std::vector<int64_t>& order, std::vector<int64_t>* offsets) {
+  offsets->assign(intervals.size(), -1);
+  std::vector<std::pair<int64_t, int64_t>> occupied_ranges;
+  int64_t mem_block_size = 0;
+  for (int64_t id : order) {
+    const MemLifetimeInterval& interval = intervals.at(id);
+    occupied_ranges.clear();
+    for (int64_t mutual_id : interval.mutual_exclusion_ids) {
+      const int64_t mutual_offset = offsets->at(mutual_id);
+      if (mutual_offset == -1) { continue; }
+      occupied_ranges.emplace_back(mutual_offset, mutual_offset + intervals.at(mutual_id).size);
+    }
+    std::sort(occupied_ranges.begin(), occupied_ranges.end());
+    int64_t offset = -1;
+    int64_t best_gap_size = std::numeric_limits<int64_t>::max();
+    int64_t gap_begin = 0;
+    auto TryGap = [&](int64_t gap_end) {
+      const int64_t gap_size = gap_end - gap_begin;
+      if (gap_size >= interval.size && gap_size < best_gap_size) {
+        offset = gap_begin;
+        best_gap_size = gap_size;
+      }
+    };
+    for (const auto& range : occupied_ranges) {
+      TryGap(range.first);
+      gap_begin = std::max(gap_begin, range.second);
+    }
+    TryGap(mem_block_size);
+    if (offset == -1) { offset = gap_begin; }
+    offsets->at(id) = offset;
+    mem_block_size = std::max(mem_block_size, offset + interval.size);
+  }
+  return mem_block_size;
+}
+
+}  // namespace
+
+int64_t MemLifetimeIntervalsSizeLowerBound(const std::vector<MemLifetimeInterval>& intervals) {
+  std::vector<std::pair<int64_t, int64_t>> index2size_delta;
+  for (const MemLifetimeInterval& interval : intervals) {
+    CHECK_GE(interval.free_index, interval.alloc_index);
+    index2size_delta.emplace_back(interval.alloc_index, interval.size);
+    index2size_delta.emplace_back(interval.free_index + 1, -interval.size);
+  }
+  // Frees sort ahead of allocs of the same index, as a buffer freed by the i-th task is reusable
+  // from the (i + 1)-th task on.
+  std::sort(index2size_delta.begin(), index2size_delta.end());
+  int64_t live_size = 0;
+  int64_t peak_size = 0;
+  for (const auto& pair : index2size_delta) {
+    live_size += pair.second;
+    peak_size = std::max(peak_size, live_size);
+  }
+  CHECK_EQ(live_size, 0);
+  return peak_size;
+}
+
+int64_t PackMemLifetimeIntervals(const std::vector<MemLifetimeInterval>& intervals,
+                                 int64_t max_iteration_num, std::vector<int64_t>* offsets) {
+  const int64_t lower_bound = MemLifetimeIntervalsSizeLowerBound(intervals);
+  auto Lifetime = [&](int64_t id) {
+    return intervals.at(id).free_index - intervals.at(id).alloc_index + 1;
+  };
+  std::vector<int64_t> ids(intervals.size());
+  std::iota(ids.begin(), ids.end(), 0);
+  std::vector<std::function<bool(int64_t, int64_t)>> order_comps;
+  order_comps.emplace_back([&](int64_t lhs, int64_t rhs) {
+    const auto& l = intervals.at(lhs);
+    const auto& r = intervals.at(rhs);
+    if (l.size != r.size) { return l.size > r.size; }
+    return Lifetime(lhs) > Lifetime(rhs);
+  });
+  order_comps.emplace_back([&](int64_t lhs, int64_t rhs) {
+    return intervals.at(lhs).size * Lifetime(lhs) > intervals.at(rhs).size * Lifetime(rhs);
+  });
+  order_comps.emplace_back([&](int64_t lhs, int64_t rhs) {
+    if (Lifetime(lhs) != Lifetime(rhs)) { return Lifetime(lhs) > Lifetime(rhs); }
+    return intervals.at(lhs).size > intervals.at(rhs).size;
+  });
+  order_comps.emplace_back([&](int64_t lhs, int64_t rhs) {
+    const auto& l = intervals.at(lhs);
+    const auto& r = intervals.at(rhs);
+    if (l.alloc_index != r.alloc_index) { return l.alloc_index < r.alloc_index; }
+    return l.size > r.size;
+  });
+  std::vector<int64_t> best_order;
+  int64_t best_size = std::numeric_limits<int64_t>::max();
+  std::vector<int64_t> order;
+  std::vector<int64_t> cur_offsets;
+  for (const auto& Comp : order_comps) {
+    order = ids;
+    std::stable_sort(order.begin(), order.end(), Comp);
+    const int64_t size = PlaceByBestFit(intervals, order, &cur_offsets);
+    if (size < best_size) {
+      best_size = size;
+      best_order.swap(order);
+      offsets->swap(cur_offsets);
+    }
+  }
+  // Local search: an interval reaching the top of the mem block is moved ahead in the order, so
+  // it gets placed before the intervals it was stacked on. Equal sizes are accepted to walk
+  // across plateaus.
+  std::mt19937 gen(intervals.size());
+  std::vector<int64_t> top_positions;
+  for (int64_t iter = 0; iter < max_iteration_num && best_size > lower_bound; ++iter) {
+    top_positions.clear();
+    for (int64_t i = 0; i < best_order.size(); ++i) {
+      const int64_t id = best_order.at(i);
+      if (offsets->at(id) + intervals.at(id).size == best_size) { top_positions.push_back(i); }
+    }
+    CHECK(!top_positions.empty());
+    order = best_order;
+    const int64_t from =
+        top_positions.at(std::uniform_int_distribution<int64_t>(0, top_positions.size() - 1)(gen));
+    if (from > 0) {
+      const int64_t to = std::uniform_int_distribution<int64_t>(0, from - 1)(gen);
+      std::rotate(order.begin() + to, order.begin() + from, order.begin() + from + 1);
+    } else {
+      std::uniform_int_distribution<int64_t> dist(0, order.size() - 1);
+      std::swap(order.at(dist(gen)), order.at(dist(gen)));
+    }
+    const int64_t size = PlaceByBestFit(intervals, order, &cur_offsets);
+    if (size <= best_size) {
+      best_size = size;
+      best_order.swap(order);
+      offsets->swap(cur_offsets);
+    }
+  }
+  return best_size;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,43 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_MEM_LIFETIME_PACKING_H_
+#define ONEFLOW_CORE_JOB_MEM_LIFETIME_PACKING_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace oneflow {
+
+// A buffer alive from the alloc_index-th to the free_index-th task of a mem chain. It must not
+// share bytes with the intervals listed in mutual_exclusion_ids.
+struct MemLifetimeInterval {
+  int64_t size;
+  int64_t alloc_index;
+  int64_t free_index;
+  std::vector<int64_t> mutual_exclusion_ids;
+};
+
+// The peak of the sizes of the intervals alive at the same time, no offset plan can be smaller.
+int64_t MemLifetimeIntervalsSizeLowerBound(const std::vector<MemLifetimeInterval>& intervals);
+
+// Plans the offsets of the intervals in one mem block and returns the mem block size. Several
+// priority orders are tried, then at most max_iteration_num local search steps improve the best.
+int64_t PackMemLifetimeIntervals(const std::vector<MemLifetimeInterval>& intervals,
+                                 int64_t max_iteration_num, std::vector<int64_t>* offsets);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_MEM_LIFETIME_PACKING_H_
@@ -0,0 +1,108 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/job/mem_lifetime_packing.h"
+#include <random>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+bool IsLifetimeOverlapped(const MemLifetimeInterval& lhs, const MemLifetimeInterval& rhs) {
+  return lhs.alloc_index <= rhs.free_index && rhs.alloc_index <= lhs.free_index;
+}
+
+std::vector<MemLifetimeInterval> GenRandomIntervals(int64_t seed, int64_t interval_num,
+                                                    int64_t task_num, int64_t max_size) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int64_t> index_dist(0, task_num - 1);
+  std::uniform_int_distribution<int64_t> size_dist(1, max_size);
+  std::vector<MemLifetimeInterval> intervals(interval_num);
+  for (MemLifetimeInterval& interval : intervals) {
+    interval.size = size_dist(gen);
+    interval.alloc_index = index_dist(gen);
+    interval.free_index = interval.alloc_index + index_dist(gen) % (task_num / 4 + 1);
+  }
+  for (int64_t i = 0; i < interval_num; ++i) {
+    for (int64_t j = 0; j < interval_num; ++j) {
+      if (i != j && IsLifetimeOverlapped(intervals.at(i), intervals.at(j))) {
+        intervals.at(i).mutual_exclusion_ids.push_back(j);
+      }
+    }
+  }
+  return intervals;
+}
+
+void CheckPacking(const std::vector<MemLifetimeInterval>& intervals, int64_t max_iteration_num) {
+  std::vector<int64_t> offsets;
+  const int64_t mem_block_size = PackMemLifetimeIntervals(intervals, max_iteration_num, &offsets);
+  ASSERT_EQ(offsets.size(), intervals.size());
+  ASSERT_GE(mem_block_size, MemLifetimeIntervalsSizeLowerBound(intervals));
+  for (int64_t i = 0; i < intervals.size(); ++i) {
+    ASSERT_GE(offsets.at(i), 0);
+    ASSERT_LE(offsets.at(i) + intervals.at(i).size, mem_block_size);
+    for (int64_t j = i + 1; j < intervals.size(); ++j) {
+      if (!IsLifetimeOverlapped(intervals.at(i), intervals.at(j))) { continue; }
+      const bool is_bytes_shared = offsets.at(i) < offsets.at(j) + intervals.at(j).size
+                                   && offsets.at(j) < offsets.at(i) + intervals.at(i).size;
+      ASSERT_FALSE(is_bytes_shared) << "intervals " << i << " and " << j;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(MemLifetimePacking, lower_bound) {
+  std::vector<MemLifetimeInterval> intervals(3);
+  intervals.at(0) = MemLifetimeInterval{4, 0, 1, {1}};
+  intervals.at(1) = MemLifetimeInterval{2, 1, 2, {0, 2}};
+  intervals.at(2) = MemLifetimeInterval{8, 2, 2, {1}};
+  // A buffer freed by a task is reusable from the next task on.
+  ASSERT_EQ(MemLifetimeIntervalsSizeLowerBound(intervals), 10);
+  CheckPacking(intervals, 0);
+}
+
+TEST(MemLifetimePacking, random_intervals) {
+  for (int64_t seed = 0; seed < 32; ++seed) {
+    const auto intervals = GenRandomIntervals(seed, 64, 32, 1024);
+    CheckPacking(intervals, 0);
+    CheckPacking(intervals, 200);
+  }
+}
+
+TEST(MemLifetimePacking, deterministic) {
+  const auto intervals = GenRandomIntervals(7, 128, 48, 4096);
+  std::vector<int64_t> offsets;
+  const int64_t mem_block_size = PackMemLifetimeIntervals(intervals, 100, &offsets);
+  std::vector<int64_t> other_offsets;
+  ASSERT_EQ(PackMemLifetimeIntervals(intervals, 100, &other_offsets), mem_block_size);
+  ASSERT_EQ(other_offsets, offsets);
+}
+
+TEST(MemLifetimePacking, search_does_not_grow) {
+  for (int64_t seed = 0; seed < 8; ++seed) {
+    const auto intervals = GenRandomIntervals(seed, 96, 40, 2048);
+    std::vector<int64_t> offsets;
+    const int64_t greedy_size = PackMemLifetimeIntervals(intervals, 0, &offsets);
+    ASSERT_LE(PackMemLifetimeIntervals(intervals, 500, &offsets), greedy_size);
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
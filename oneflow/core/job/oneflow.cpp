@@ -232,6 +232,9 @@ void MergePlan(Plan* plan, Plan&& other) {
     CHECK(
         plan->mutable_collective_boxing_plan()->mutable_job_id2request_set()->insert(pair).second);
   }
+  for (const auto& pair : other.mem_block_id2mem_size_lower_bound()) {
+    CHECK(plan->mutable_mem_block_id2mem_size_lower_bound()->insert(pair).second);
+  }
   for (auto& pair : *(other.mutable_job_id2op_attribute_ref_table())) {
     CHECK(plan->job_id2op_attribute_ref_table().find(pair.first)
           == plan->job_id2op_attribute_ref_table().end())
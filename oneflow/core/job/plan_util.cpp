@@ -928,6 +928,28 @@ void PlanUtil::PlanMemoryLog(Plan* plan, const std::string& plan_name) {
     LOG(INFO) << " Plan: " << plan_name << " needs to allocate [ " << mem_size
               << " MiB ] device memory in Rank: " << rank_id << " , Device: " << device_id << "\n";
   }
+
+  // NOTE: the gap between the reused mem blocks and the peak of their live regsts is what a
+  //   better offset plan could save at most.
+  HashMap<std::pair<int64_t, int64_t>, std::pair<int64_t, int64_t>> rank_device2reused_size7bound;
+  for (const MemBlockProto& mem_block : plan->block_chunk_list().mem_block()) {
+    if (!mem_block.mem_case().has_device_cuda_mem()) { continue; }
+    auto bound_it = plan->mem_block_id2mem_size_lower_bound().find(mem_block.mem_block_id());
+    if (bound_it == plan->mem_block_id2mem_size_lower_bound().end()) { continue; }
+    auto& size7bound = rank_device2reused_size7bound[std::make_pair(
+        mem_block.machine_id(), mem_block.mem_case().device_cuda_mem().device_id())];
+    size7bound.first += mem_block.mem_size();
+    size7bound.second += bound_it->second;
+  }
+  for (const auto& pair : rank_device2reused_size7bound) {
+    double reused_mem_size = pair.second.first * 1.0 / 1000000.0;
+    double lower_bound = pair.second.second * 1.0 / 1000000.0;
+    double gap = pair.second.second > 0 ? (reused_mem_size / lower_bound - 1.0) * 100.0 : 0.0;
+    LOG(INFO) << " Plan: " << plan_name << " reuses [ " << reused_mem_size
+              << " MiB ] device memory for regsts whose lower bound is [ " << lower_bound
+              << " MiB ], gap: " << gap << "% in Rank: " << pair.first.first
+              << " , Device: " << pair.first.second << "\n";
+  }
 }
 
 const oneflow::OpAttribute& PlanUtil::GetOpAttribute(const Plan* plan, int64_t job_id,
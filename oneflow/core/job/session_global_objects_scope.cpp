@@ -36,6 +36,7 @@ limitations under the License.
 #include "oneflow/core/job/version.h"
 #include "oneflow/core/memory/chunk_manager.h"
 #include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/register/register_manager.h"
 #include "oneflow/user/summary/events_writer.h"
 #include "oneflow/core/thread/thread_manager.h"
@@ -135,6 +136,7 @@ Maybe<void> SessionGlobalObjectsScope::Init(const ConfigProto& config_proto) {
     Global<summary::EventsWriter>::New();
     Global<boxing::collective::CollectiveBoxingExecutor>::New();
     Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::New();
+    Global<BackgroundSnapshotSaver>::New();
   }
 
   return Maybe<void>::Ok();
@@ -152,6 +154,8 @@ Maybe<void> SessionGlobalObjectsScope::EagerInit(const ConfigProto& config_proto
 SessionGlobalObjectsScope::~SessionGlobalObjectsScope() {
   {
     // NOTE(chengcheng): Delete Global Runtime objects.
+    // Finishes the pending snapshot save while the file systems and the env are still alive.
+    Global<BackgroundSnapshotSaver>::Delete();
     Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::Delete();
     Global<boxing::collective::CollectiveBoxingExecutor>::Delete();
     Global<summary::EventsWriter>::Delete();
@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_set_compile_ctx.h"
+
+namespace oneflow {
+
+namespace {
+
+// The variables kept in sparse embedding tables by one job are placeholders, so no other job may
+// read them. The variables read by a job are recorded, so that a job compiled later keeps them
+// dense.
+class CheckSparseEmbeddingVariablesPass final : public JobPass {
+ public:
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    // Multi-client variables are never kept in sparse embedding tables.
+    if (JUST(*Global<Maybe<bool>, MultiClient>::Get())) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    const std::string& job_name = ctx->job_desc().job_name();
+    const auto* sparse_embedding_var_op_name2job_name =
+        Global<JobSetCompileCtx>::Get()->GetSparseEmbeddingVarOpName2JobName();
+    auto* var_op_name2reader_job_name =
+        Global<JobSetCompileCtx>::Get()->GetVarOpName2ReaderJobName();
+    return op_graph.MaybeForEachNode([&](OpNode* op_node) -> Maybe<void> {
+      if (!op_node->op().op_conf().has_variable_conf()) { return Maybe<void>::Ok(); }
+      if (op_node->out_edges().empty()) { return Maybe<void>::Ok(); }
+      const std::string& var_op_name = op_node->op().op_name();
+      const auto it = sparse_embedding_var_op_name2job_name->find(var_op_name);
+      if (it == sparse_embedding_var_op_name2job_name->end()) {
+        var_op_name2reader_job_name->insert({var_op_name, job_name});
+      } else {
+        CHECK_EQ_OR_RETURN(it->second, job_name)
+            << "variable " << var_op_name << " is kept in a sparse embedding table by job "
+            << it->second << ", other jobs can not read it";
+      }
+      return Maybe<void>::Ok();
+    });
+  }
+};
+
+REGISTER_JOB_PASS("CheckSparseEmbeddingVariablesPass", CheckSparseEmbeddingVariablesPass);
+
+}  // namespace
+
+}  // namespace oneflow
@@ -15,9 +15,185 @@ limitations under the License.
 */
 #include "oneflow/core/job_rewriter/job_pass.h"
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_set_compile_ctx.h"
 
 namespace oneflow {
 
+namespace {
+
+std::vector<std::string> SparseEmbeddingStateArgNames(const user_op::UserOpConfWrapper& update_op) {
+  if (update_op.op_type_name() == "momentum_update") { return {"momentum"}; }
+  if (update_op.op_type_name() == "adam_update") {
+    if (update_op.attr<bool>("amsgrad")) { return {"m", "v", "max_v"}; }
+    return {"m", "v"};
+  }
+  return {};
+}
+
+bool IsAllBroadcast(const cfg::NdSbp& nd_sbp) {
+  for (int64_t i = 0; i < nd_sbp.sbp_parallel_size(); ++i) {
+    if (!nd_sbp.sbp_parallel(i).has_broadcast_parallel()) { return false; }
+  }
+  return true;
+}
+
+// Returns the variable op producing lbn if it is only read by op_nodes, and by no other job
+// compiled before.
+const OpNode* FindVariableOnlyReadBy(const OpGraph& op_graph, const std::string& lbn,
+                                     const std::vector<const OpNode*>& op_nodes) {
+  const OpNode* variable_node = op_graph.OpNode4OpName(GenLogicalBlobId(lbn).op_name());
+  if (!variable_node->op().op_conf().has_variable_conf()) { return nullptr; }
+  const auto* var_op_name2reader_job_name =
+      Global<JobSetCompileCtx>::Get()->GetVarOpName2ReaderJobName();
+  const auto it = var_op_name2reader_job_name->find(variable_node->op().op_name());
+  if (it != var_op_name2reader_job_name->end() && it->second != GlobalJobDesc().job_name()) {
+    return nullptr;
+  }
+  for (const OpEdge* edge : variable_node->out_edges()) {
+    if (std::find(op_nodes.cbegin(), op_nodes.cend(), edge->dst_node()) == op_nodes.cend()) {
+      return nullptr;
+    }
+  }
+  return variable_node;
+}
+
+// With lazy_sparse_rows, a CPU embedding can live in a sparse embedding table whose rows are
+// created the first time their ids are seen, when its variable is only read by a gather, the
+// gradient of the gather and the update op. Returns that gather, or nullptr.
+const OpNode* FindSparseEmbeddingGather(const OpGraph& op_graph, const OpNode* src_node,
+                                        const OpNode* update_node) {
+  const user_op::UserOpConfWrapper update_op(update_node->op().op_conf());
+  if (update_node->parallel_desc().device_type() != DeviceType::kCPU) { return nullptr; }
+  const std::string& model_lbn = update_op.input("model", 0);
+  const OpNode* model_node = op_graph.OpNode4OpName(GenLogicalBlobId(model_lbn).op_name());
+  const OpNode* gather_node = nullptr;
+  for (const OpEdge* edge : model_node->out_edges()) {
+    const OpNode* node = edge->dst_node();
+    if (node == src_node || node == update_node || node == gather_node) { continue; }
+    if (gather_node != nullptr || !node->op().op_conf().has_user_conf()) { return nullptr; }
+    const user_op::UserOpConfWrapper gather_op(node->op().op_conf());
+    if (gather_op.op_type_name() != "gather" || gather_op.attr<int64_t>("axis") != 0
+        || gather_op.input("in", 0) != model_lbn
+        || node->parallel_desc().device_type() != DeviceType::kCPU) {
+      return nullptr;
+    }
+    gather_node = node;
+  }
+  if (gather_node == nullptr) { return nullptr; }
+  if (FindVariableOnlyReadBy(op_graph, model_lbn, {gather_node, src_node, update_node})
+      == nullptr) {
+    return nullptr;
+  }
+  const VariableOpConf& variable_conf = model_node->op().op_conf().variable_conf();
+  if (variable_conf.shape().dim_size() != 2 || !variable_conf.has_initializer()) { return nullptr; }
+  const InitializerConf& initializer_conf = variable_conf.initializer();
+  if (!initializer_conf.has_constant_conf() && !initializer_conf.has_random_uniform_conf()
+      && !initializer_conf.has_random_normal_conf()) {
+    return nullptr;
+  }
+  if (!IsAllBroadcast(model_node->NdSbp4Lbi(GenLogicalBlobId(model_lbn)))) { return nullptr; }
+  for (const std::string& arg_name : {"momentum", "m", "v", "max_v"}) {
+    if (update_op.has_input(arg_name, 0)
+        && FindVariableOnlyReadBy(op_graph, update_op.input(arg_name, 0), {update_node})
+               == nullptr) {
+      return nullptr;
+    }
+  }
+  return gather_node;
+}
+
+// Turns the gather into a sparse_embedding_lookup and adds a sparse_embedding_*_update in place of
+// update_op. The variables of the model and its optimizer states become placeholders of one
+// element, which only order the lookup after the update of the previous iteration. They are
+// recorded so that other jobs reading them fail to compile.
+void RewriteToSparseEmbedding(const OpGraph& op_graph, const OpNode* gather_node,
+                              const user_op::UserOpConfWrapper& update_op,
+                              const std::string& indices_lbn, const std::string& values_lbn,
+                              int64_t scope_symbol_id, const ParallelConf& parallel_conf,
+                              JobBuilder* job_builder) {
+  const std::string& model_lbn = update_op.input("model", 0);
+  const std::string model_op_name = GenLogicalBlobId(model_lbn).op_name();
+  const VariableOpConf& variable_conf =
+      op_graph.OpNode4OpName(model_op_name)->op().op_conf().variable_conf();
+  const std::string& initializer_conf = PbMessage2TxtString(variable_conf.initializer());
+  const int64_t embedding_size = variable_conf.shape().dim(1);
+  const int64_t num_states = SparseEmbeddingStateArgNames(update_op).size();
+
+  OperatorConf lookup_op_conf = gather_node->op().op_conf();
+  const user_op::UserOpConfWrapper gather_op(lookup_op_conf);
+  *lookup_op_conf.mutable_user_conf() =
+      user_op::UserOpConfWrapperBuilder(lookup_op_conf.name())
+          .Op("sparse_embedding_lookup")
+          .Input("ids", gather_op.input("indices", 0))
+          .Input("model", model_lbn)
+          .Output("out")
+          .Attr<std::string>("table_name", model_op_name)
+          .Attr<int64_t>("embedding_size", embedding_size)
+          .Attr<int64_t>("num_states", num_states)
+          .Attr<std::string>("initializer_conf", initializer_conf)
+          .Attr<int64_t>("seed", variable_conf.random_seed())
+          .Build()
+          .op_conf()
+          .user_conf();
+  std::vector<OperatorConf> op_confs_to_mut{lookup_op_conf};
+
+  user_op::UserOpConfWrapperBuilder update_op_builder("System-Optimizer-SparseEmbedding-"
+                                                      + model_op_name);
+  update_op_builder.OpTypeName("sparse_embedding_" + update_op.op_type_name())
+      .Input("model", model_lbn)
+      .Input("model_diff_indices", indices_lbn)
+      .Input("model_diff_values", values_lbn)
+      .Attr<std::string>("table_name", model_op_name)
+      .Attr<int64_t>("embedding_size", embedding_size)
+      .Attr<int64_t>("num_states", num_states)
+      .Attr<std::string>("initializer_conf", initializer_conf)
+      .Attr<int64_t>("seed", variable_conf.random_seed())
+      .Attr<float>("learning_rate_val", update_op.attr<float>("learning_rate_val"))
+      .Attr<float>("weight_decay", update_op.attr<float>("weight_decay"))
+      .ScopeSymbolId(scope_symbol_id);
+  for (const std::string& arg_name :
+       {"learning_rate", "skip_if", "bias_correction1", "bias_correction2"}) {
+    if (update_op.has_input(arg_name, 0)) {
+      update_op_builder.Input(arg_name, update_op.input(arg_name, 0));
+    }
+  }
+  if (update_op.op_type_name() == "momentum_update") {
+    update_op_builder.Attr<float>("beta", update_op.attr<float>("beta"));
+  } else if (update_op.op_type_name() == "adam_update") {
+    update_op_builder
+        .Attr<float>("bias_correction1_val", update_op.attr<float>("bias_correction1_val"))
+        .Attr<float>("bias_correction2_val", update_op.attr<float>("bias_correction2_val"))
+        .Attr<float>("beta1", update_op.attr<float>("beta1"))
+        .Attr<float>("beta2", update_op.attr<float>("beta2"))
+        .Attr<float>("epsilon", update_op.attr<float>("epsilon"))
+        .Attr<bool>("amsgrad", update_op.attr<bool>("amsgrad"))
+        .Attr<bool>("do_bias_correction", update_op.attr<bool>("do_bias_correction"));
+  }
+
+  std::vector<std::string> variable_lbns{model_lbn};
+  for (const std::string& arg_name : {"momentum", "m", "v", "max_v"}) {
+    if (update_op.has_input(arg_name, 0)) { variable_lbns.push_back(update_op.input(arg_name, 0)); }
+  }
+  auto* sparse_embedding_var_op_name2job_name =
+      Global<JobSetCompileCtx>::Get()->GetSparseEmbeddingVarOpName2JobName();
+  for (const std::string& lbn : variable_lbns) {
+    OperatorConf variable_op_conf =
+        op_graph.OpNode4OpName(GenLogicalBlobId(lbn).op_name())->op().op_conf();
+    (*sparse_embedding_var_op_name2job_name)[variable_op_conf.name()] =
+        GlobalJobDesc().job_name();
+    ShapeProto* shape = variable_op_conf.mutable_variable_conf()->mutable_shape();
+    shape->clear_dim();
+    shape->add_dim(1);
+    op_confs_to_mut.push_back(variable_op_conf);
+  }
+  job_builder->MutOpsOnlyOnce(op_confs_to_mut);
+  job_builder->AddOps(parallel_conf, {update_op_builder.Build().op_conf()});
+}
+
+}  // namespace
+
 class IndexedSlicesOptimizerRewritePass final : public JobPass {
  public:
   IndexedSlicesOptimizerRewritePass() = default;
@@ -40,10 +216,14 @@ class IndexedSlicesOptimizerRewritePass final : public JobPass {
 
 Maybe<void> IndexedSlicesOptimizerRewritePass::Apply(const OpGraph& op_graph,
                                                      JobBuilder* job_builder) const {
-  const PbRpf<std::string>& include_op_names =
-      GlobalJobDesc().job_conf().indexed_slices_optimizer_conf().include_op_names().op_name();
+  const IndexedSlicesOptimizerConf& conf =
+      GlobalJobDesc().job_conf().indexed_slices_optimizer_conf();
+  const PbRpf<std::string>& include_op_names = conf.include_op_names().op_name();
   const std::set<std::string> include_op_name_set(
       {include_op_names.cbegin(), include_op_names.cend()});
+  // Multi-client variables are eager tensors, which can not become placeholders.
+  const bool lazy_sparse_rows =
+      conf.lazy_sparse_rows() && !JUST(*Global<Maybe<bool>, MultiClient>::Get());
   op_graph.ForEachNode([&](const OpNode* src_node) {
     const OperatorConf& src_op_conf = src_node->op().op_conf();
     if (src_node->out_edges().size() != 1) { return; }
@@ -127,6 +307,8 @@ Maybe<void> IndexedSlicesOptimizerRewritePass::Apply(const OpGraph& op_graph,
     CHECK(!indices_lbn.empty());
     CHECK(!values_lbn.empty());
     if (include_op_name_set.find(model_op_name) == include_op_name_set.end()) { return; }
+    const OpNode* gather_node =
+        lazy_sparse_rows ? FindSparseEmbeddingGather(op_graph, src_node, dst_node) : nullptr;
     for (const OpNode* node : op_nodes_to_remove) { job_builder->DelOps({node->op().op_conf()}); }
     for (const OpNode* node : op_nodes_apply_to_diff) {
       OperatorConf new_conf = node->op().op_conf();
@@ -143,6 +325,12 @@ Maybe<void> IndexedSlicesOptimizerRewritePass::Apply(const OpGraph& op_graph,
         .Input("model_diff_values", values_lbn)
         .ScopeSymbolId(src_op_conf.scope_symbol_id());
     job_builder->DelOps({src_op_conf, user_op_conf.op_conf()});
+    if (gather_node != nullptr) {
+      RewriteToSparseEmbedding(op_graph, gather_node, user_op_conf, indices_lbn, values_lbn,
+                               src_op_conf.scope_symbol_id(),
+                               dst_node->parallel_desc().parallel_conf(), job_builder);
+      return;
+    }
     job_builder->AddOps(dst_node->parallel_desc().parallel_conf(),
                         {indexed_slices_op_builder.Build().op_conf()});
   });
@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/vm/symbol_storage.h"
+
+namespace oneflow {
+
+namespace {
+
+const std::vector<std::string>& StateArgNames4OpTypeName(const std::string& op_type_name) {
+  static const HashMap<std::string, std::vector<std::string>> op_type_name2state_arg_names{
+      {"sgd_update", {}}, {"momentum_update", {"momentum"}}, {"adam_update", {"m", "v", "max_v"}}};
+  return op_type_name2state_arg_names.at(op_type_name);
+}
+
+// The inputs shared by the update ops of a group, all of them are scalars.
+const std::vector<std::string>& SharedArgNames() {
+  static const std::vector<std::string> arg_names{"learning_rate", "scale_by_tensor", "skip_if",
+                                                  "bias_correction1", "bias_correction2"};
+  return arg_names;
+}
+
+bool IsMultiTensorUpdateSupported(const std::string& op_type_name) {
+  return op_type_name == "sgd_update" || op_type_name == "momentum_update"
+         || op_type_name == "adam_update";
+}
+
+// Returns false if the model can not be split or broadcast like the multi tensor update does.
+bool TryGenNdSbpKey(const cfg::NdSbp& nd_sbp, std::string* key) {
+  for (const auto& sbp_parallel : nd_sbp.sbp_parallel()) {
+    if (sbp_parallel.has_broadcast_parallel()) {
+      key->append("B");
+    } else if (sbp_parallel.has_split_parallel()) {
+      key->append("S" + std::to_string(sbp_parallel.split_parallel().axis()));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+class MultiTensorModelUpdatePass final : public JobPass {
+ public:
+  MultiTensorModelUpdatePass() = default;
+  ~MultiTensorModelUpdatePass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_multi_tensor_model_update();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
+                                              JobBuilder* job_builder) const {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  auto TryGenGroupKey = [&](const OpNode* op_node, std::string* key) -> bool {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf()) { return false; }
+    if (!IsMultiTensorUpdateSupported(op_conf.user_conf().op_type_name())) { return false; }
+    if (op_node->parallel_desc().device_type() != DeviceType::kCPU) { return false; }
+    if (!op_conf.ctrl_in_op_name().empty()) { return false; }
+    if (ctrl_in_op_names.find(op_conf.name()) != ctrl_in_op_names.end()) { return false; }
+    if (!op_conf.has_scope_symbol_id()) { return false; }
+    const user_op::UserOpConfWrapper user_op_conf(op_conf);
+    const LogicalBlobId model_lbi = GenLogicalBlobId(user_op_conf.input("model", 0));
+    const DataType data_type = op_node->LogicalBlobDesc4Lbi(model_lbi).data_type();
+    const LogicalBlobId model_diff_lbi = GenLogicalBlobId(user_op_conf.input("model_diff", 0));
+    if (op_node->LogicalBlobDesc4Lbi(model_diff_lbi).data_type() != data_type) { return false; }
+    *key = user_op_conf.op_type_name() + "," + DataType_Name(data_type) + ",";
+    if (!TryGenNdSbpKey(op_node->NdSbp4Lbi(model_lbi), key)) { return false; }
+    key->append("," + op_node->parallel_desc().parallel_conf().DebugString());
+    const Scope& scope = Global<symbol::Storage<Scope>>::Get()->Get(op_conf.scope_symbol_id());
+    key->append(",stage:" + std::to_string(scope.Int64("pipeline_stage_id_hint")));
+    for (const std::string& arg_name : SharedArgNames()) {
+      if (user_op_conf.has_input(arg_name, 0)) {
+        key->append("," + arg_name + ":" + user_op_conf.input(arg_name, 0));
+      }
+    }
+    std::map<std::string, std::string> attr_name2value;
+    for (const auto& pair : op_conf.user_conf().attr()) {
+      attr_name2value.emplace(pair.first, pair.second.SerializeAsString());
+    }
+    for (const auto& pair : attr_name2value) { key->append("," + pair.first + ":" + pair.second); }
+    return true;
+  };
+
+  // Ops in a group share everything but their model, model_diff and optimizer states.
+  std::vector<std::string> group_keys;
+  HashMap<std::string, std::vector<const OpNode*>> key2op_nodes;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    std::string key;
+    if (!TryGenGroupKey(op_node, &key)) { return; }
+    auto it = key2op_nodes.find(key);
+    if (it == key2op_nodes.end()) {
+      group_keys.push_back(key);
+      it = key2op_nodes.emplace(key, std::vector<const OpNode*>()).first;
+    }
+    it->second.push_back(op_node);
+  });
+
+  std::vector<std::string> del_op_names;
+  for (const std::string& key : group_keys) {
+    const std::vector<const OpNode*>& op_nodes = key2op_nodes.at(key);
+    if (op_nodes.size() < 2) { continue; }
+    const OperatorConf& first_op_conf = op_nodes.front()->op().op_conf();
+    const user_op::UserOpConfWrapper first_user_op_conf(first_op_conf);
+    const std::string& op_type_name = first_user_op_conf.op_type_name();
+    user_op::UserOpConfWrapperBuilder multi_tensor_op_builder(
+        "System-MultiTensorModelUpdate-" + op_type_name + "-" + NewUniqueId());
+    multi_tensor_op_builder.OpTypeName("multi_tensor_" + op_type_name)
+        .ScopeSymbolId(first_op_conf.scope_symbol_id());
+    for (const OpNode* op_node : op_nodes) {
+      const user_op::UserOpConfWrapper user_op_conf(op_node->op().op_conf());
+      multi_tensor_op_builder.Input("model", user_op_conf.input("model", 0))
+          .Input("model_diff", user_op_conf.input("model_diff", 0));
+      for (const std::string& arg_name : StateArgNames4OpTypeName(op_type_name)) {
+        multi_tensor_op_builder.Input(arg_name, user_op_conf.input(arg_name, 0));
+      }
+      del_op_names.push_back(user_op_conf.op_name());
+    }
+    for (const std::string& arg_name : SharedArgNames()) {
+      if (first_user_op_conf.has_input(arg_name, 0)) {
+        multi_tensor_op_builder.Input(arg_name, first_user_op_conf.input(arg_name, 0));
+      }
+    }
+    OperatorConf multi_tensor_op_conf = multi_tensor_op_builder.Build().op_conf();
+    *multi_tensor_op_conf.mutable_user_conf()->mutable_attr() = first_op_conf.user_conf().attr();
+    job_builder->AddOps(op_nodes.front()->parallel_desc().parallel_conf(), {multi_tensor_op_conf});
+  }
+  job_builder->DelOps(del_op_names);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("MultiTensorModelUpdatePass", MultiTensorModelUpdatePass);
+
+}  // namespace oneflow
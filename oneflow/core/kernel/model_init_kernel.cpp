@@ -60,7 +60,7 @@ class ModelInitKernel final : public Kernel {
     const auto InitializeWithSnapshot = [&](const std::string& snapshot_path,
                                             const std::string& key, Blob* blob) {
       SnapshotReader* reader = GetSnapshotReader(snapshot_path);
-      reader->Read(key, blob);
+      reader->AsyncRead(key, blob);
     };
     FOR_RANGE(int64_t, i, 0, num_var) {
       Blob* out_i = ctx->BnInOp2Blob(GenRepeatedBn("out", i));
@@ -82,6 +82,7 @@ class ModelInitKernel final : public Kernel {
         UNIMPLEMENTED();
       }
     }
+    for (const auto& pair : path2snapshot_reader) { pair.second->Close(); }
   }
 };
 
@@ -302,15 +302,20 @@ class ModelLoadV2Kernel final : public Kernel {
     const Blob* path = ctx->BnInOp2Blob("path");
     const std::string snapshot_path = SyncReadStringFromBlob<device_type>(ctx->device_ctx(), path);
     SnapshotReader reader(snapshot_path);
+    // The variables are read concurrently, and copied to the device once all of them are read.
+    std::vector<std::unique_ptr<AutoSyncBlobAccessor<device_type>>> ref_accessors;
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
       Blob* ref = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       const Shape logical_blob_shape(original_variable_conf.shape());
       const std::string& var_lbn =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
-      AutoSyncBlobAccessor<device_type> ref_accessor(ctx->device_ctx(), ref, false, true);
-      reader.Read(var_lbn, logical_blob_shape, tensor_slice_views_.at(i), ref_accessor.host_blob());
+      ref_accessors.emplace_back(
+          new AutoSyncBlobAccessor<device_type>(ctx->device_ctx(), ref, false, true));
+      reader.AsyncRead(var_lbn, logical_blob_shape, tensor_slice_views_.at(i),
+                       ref_accessors.back()->host_blob());
     }
+    reader.Close();
   }
   std::vector<TensorSliceView> tensor_slice_views_;
 };
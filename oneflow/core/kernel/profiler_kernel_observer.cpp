@@ -22,10 +22,12 @@ namespace oneflow {
 void ProfilerKernelObserver::WillForwardDataContent(KernelContext* kernel_ctx,
                                                     const Kernel* kernel) {
   OF_PROFILER_ONLY_CODE(profiler::TraceKernelForwardDataContentStart(kernel_ctx, kernel));
+  profiler::HostProfileKernelForwardDataContentStart(kernel_ctx, kernel);
 }
 
 void ProfilerKernelObserver::DidForwardDataContent(KernelContext* kernel_ctx,
                                                    const Kernel* kernel) {
+  profiler::HostProfileKernelForwardDataContentEnd(kernel_ctx, kernel);
   OF_PROFILER_ONLY_CODE(profiler::TraceKernelForwardDataContentEnd(kernel_ctx, kernel));
 }
 
@@ -0,0 +1,134 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_reduce.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// Sums x over the axes y has size 1 at, the reference the specialized reduces are checked with.
+std::vector<double> NaiveReduceSum(const std::vector<int64_t>& x_dims,
+                                   const std::vector<int64_t>& y_dims,
+                                   const std::vector<float>& x) {
+  int64_t y_elem_num = 1;
+  for (int64_t dim : y_dims) { y_elem_num *= dim; }
+  std::vector<double> y(y_elem_num, 0);
+  std::vector<int64_t> index(x_dims.size(), 0);
+  for (float value : x) {
+    int64_t y_offset = 0;
+    for (size_t i = 0; i < x_dims.size(); ++i) {
+      y_offset = y_offset * y_dims[i] + (y_dims[i] == 1 ? 0 : index[i]);
+    }
+    y[y_offset] += value;
+    for (int i = static_cast<int>(x_dims.size()) - 1; i >= 0; --i) {
+      if (++index[i] < x_dims[i]) { break; }
+      index[i] = 0;
+    }
+  }
+  return y;
+}
+
+template<template<typename> class binary_func>
+std::vector<float> Reduce(const std::vector<int64_t>& x_dims, const std::vector<int64_t>& y_dims,
+                          const std::vector<float>& x) {
+  const Shape x_shape(DimVector(x_dims.begin(), x_dims.end()));
+  const Shape y_shape(DimVector(y_dims.begin(), y_dims.end()));
+  std::vector<float> y(y_shape.elem_cnt());
+  std::vector<float> tmp(x.size());
+  NdarrayReduce<DeviceType::kCPU, float, binary_func>::Reduce(
+      nullptr, XpuVarNdarray<float>(y_shape, y.data()),
+      XpuVarNdarray<const float>(x_shape, x.data()), XpuVarNdarray<float>(x_shape, tmp.data()));
+  return y;
+}
+
+std::vector<float> NewInput(const std::vector<int64_t>& x_dims) {
+  int64_t x_elem_num = 1;
+  for (int64_t dim : x_dims) { x_elem_num *= dim; }
+  std::vector<float> x(x_elem_num);
+  for (size_t i = 0; i < x.size(); ++i) { x[i] = static_cast<float>(i % 17) * 0.1f - 0.8f; }
+  return x;
+}
+
+void TestReduceSum(const std::vector<int64_t>& x_dims, const std::vector<int64_t>& y_dims) {
+  const std::vector<float>& x = NewInput(x_dims);
+  const std::vector<float>& y = Reduce<BinaryFuncSum>(x_dims, y_dims, x);
+  const std::vector<double>& expected = NaiveReduceSum(x_dims, y_dims, x);
+  const double reduced_num = static_cast<double>(x.size()) / y.size();
+  for (size_t i = 0; i < y.size(); ++i) { ASSERT_NEAR(y[i], expected[i], 1e-5 * reduced_num); }
+}
+
+// Reduces on a thread pool and checks the results against the reduce on the calling thread.
+void TestParallelReduce(const std::vector<int64_t>& x_dims, const std::vector<int64_t>& y_dims) {
+  const std::vector<float>& x = NewInput(x_dims);
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  const std::vector<float>& serial_sum = Reduce<BinaryFuncSum>(x_dims, y_dims, x);
+  const std::vector<float>& serial_max = Reduce<BinaryFuncMax>(x_dims, y_dims, x);
+  if (own_thread_pool) { Global<ThreadPool>::New(4); }
+  const std::vector<float>& sum = Reduce<BinaryFuncSum>(x_dims, y_dims, x);
+  const std::vector<float>& max = Reduce<BinaryFuncMax>(x_dims, y_dims, x);
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+  const double reduced_num = static_cast<double>(x.size()) / sum.size();
+  ASSERT_EQ(sum.size(), serial_sum.size());
+  for (size_t i = 0; i < sum.size(); ++i) {
+    ASSERT_NEAR(sum[i], serial_sum[i], 1e-5 * reduced_num);
+  }
+  ASSERT_EQ(max, serial_max);
+}
+
+}  // namespace
+
+TEST(CpuNdarrayReduce, scalar) {
+  TestReduceSum({1000003}, {1});
+  TestReduceSum({7, 11, 13}, {1, 1, 1});
+}
+
+TEST(CpuNdarrayReduce, matrix_row) {
+  TestReduceSum({1000, 513}, {1000, 1});
+  TestReduceSum({2, 3, 100000}, {2, 3, 1});
+}
+
+TEST(CpuNdarrayReduce, matrix_col) {
+  TestReduceSum({100000, 3}, {1, 3});
+  TestReduceSum({300, 2049}, {1, 2049});
+}
+
+TEST(CpuNdarrayReduce, xyz_cube_xz) {
+  // Bias gradient of an NCHW tensor.
+  TestReduceSum({8, 64, 28, 28}, {1, 64, 1, 1});
+  TestReduceSum({1000, 3, 5}, {1, 3, 1});
+}
+
+TEST(CpuNdarrayReduce, default_reduce) {
+  TestReduceSum({4, 5, 6, 7}, {4, 1, 6, 1});
+}
+
+TEST(CpuNdarrayReduce, thread_pool) {
+  TestParallelReduce({1000003}, {1});
+  TestParallelReduce({1000, 513}, {1000, 1});
+  TestParallelReduce({2, 3, 100000}, {2, 3, 1});
+  TestParallelReduce({100000, 3}, {1, 3});
+  TestParallelReduce({300, 2049}, {1, 2049});
+  TestParallelReduce({8, 64, 28, 28}, {1, 64, 1, 1});
+  TestParallelReduce({1000, 3, 5}, {1, 3, 1});
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -17,25 +17,248 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                            \
-  template<typename T, template<typename> class binary_func>                                       \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                     \
-    static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {              \
-      return false;                                                                                \
-    }                                                                                              \
-    static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x, \
-                       const XpuVarNdarray<T>& tmp_storage) {                                      \
-      UNIMPLEMENTED();                                                                             \
-    }                                                                                              \
-  }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+namespace {
+
+// Inputs up to this length are reduced by one straight loop, longer ones are cut in halves, which
+// keeps the rounding error of float sums growing with log(n) instead of n.
+constexpr int64_t kPairwiseBlockSize = 128;
+// Independent accumulators of the straight loop, they let the compiler vectorize it.
+constexpr int64_t kNumLanes = 8;
+// Columns accumulated together by a column reduce, the accumulators stay in L1.
+constexpr int64_t kColBlockSize = 1024;
+
+template<typename T>
+struct ReduceAccType {
+  using type = T;
+};
+
+template<>
+struct ReduceAccType<float16> {
+  using type = float;
+};
+
+// Number of parallel works elem_num elements are worth.
+int64_t ParallelPartNum(int64_t elem_num) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr) { return 1; }
+  return std::max<int64_t>(
+      std::min<int64_t>(thread_pool->thread_num() + 1, elem_num / kCpuParallelGrainSize), 1);
+}
+
+template<typename T, template<typename> class binary_func>
+struct CpuReduceUtil final {
+  using AccT = typename ReduceAccType<T>::type;
+
+  static AccT Unit() { return UnitOfBinaryFunc<AccT, binary_func>::Val(); }
+  static AccT Invoke(const AccT x, const AccT y) { return binary_func<AccT>::Invoke(x, y); }
+
+  static AccT ReduceContiguous(const T* x, int64_t n) {
+    if (n > kPairwiseBlockSize) {
+      const int64_t half = n / (2 * kNumLanes) * kNumLanes;
+      return Invoke(ReduceContiguous(x, half), ReduceContiguous(x + half, n - half));
+    }
+    AccT lanes[kNumLanes];
+    for (int64_t j = 0; j < kNumLanes; ++j) { lanes[j] = Unit(); }
+    int64_t i = 0;
+    for (; i + kNumLanes <= n; i += kNumLanes) {
+      for (int64_t j = 0; j < kNumLanes; ++j) {
+        lanes[j] = Invoke(lanes[j], static_cast<AccT>(x[i + j]));
+      }
+    }
+    AccT reduced = Unit();
+    for (; i < n; ++i) { reduced = Invoke(reduced, static_cast<AccT>(x[i])); }
+    for (int64_t j = 0; j < kNumLanes; ++j) { reduced = Invoke(reduced, lanes[j]); }
+    return reduced;
+  }
+
+  // Reduces seg_num segments of seg_size contiguous elements, seg_stride elements apart.
+  static AccT ReduceSegments(const T* x, int64_t seg_num, int64_t seg_stride, int64_t seg_size) {
+    if (seg_num == 1) { return ReduceContiguous(x, seg_size); }
+    const int64_t half = seg_num / 2;
+    return Invoke(ReduceSegments(x, half, seg_stride, seg_size),
+                  ReduceSegments(x + half * seg_stride, seg_num - half, seg_stride, seg_size));
+  }
+
+  static void FillUnit(int64_t num, T* y) {
+    for (int64_t i = 0; i < num; ++i) { y[i] = static_cast<T>(Unit()); }
+  }
+
+  // Folds part_num rows of num partial results into y.
+  static void ReducePartials(const std::vector<AccT>& partials, int64_t part_num, int64_t num,
+                             T* y) {
+    GlobalThreadPoolParallelFor(
+        num, std::max<int64_t>(kCpuParallelGrainSize / part_num, 1),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            AccT reduced = partials[i];
+            for (int64_t p = 1; p < part_num; ++p) {
+              reduced = Invoke(reduced, partials[p * num + i]);
+            }
+            y[i] = static_cast<T>(reduced);
+          }
+        });
+  }
+
+  // y[i] = reduce(x[i, :]) for the num_rows x num_cols matrix x.
+  static void ReduceRows(const T* x, int64_t num_rows, int64_t num_cols, T* y) {
+    if (num_rows * num_cols == 0) { return FillUnit(num_rows, y); }
+    // Few long rows are cut into parts, so that they still keep every thread busy.
+    const int64_t part_num = std::max<int64_t>(
+        std::min<int64_t>(ParallelPartNum(num_rows * num_cols) / num_rows, num_cols), 1);
+    const BalancedSplitter col_splitter(num_cols, part_num);
+    std::vector<AccT> partials(part_num == 1 ? 0 : part_num * num_rows);
+    GlobalThreadPoolParallelFor(
+        part_num * num_rows,
+        std::max<int64_t>(kCpuParallelGrainSize * part_num / num_cols, 1),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t part = i / num_rows;
+            const int64_t row = i % num_rows;
+            const Range range = col_splitter.At(part);
+            const AccT reduced = ReduceContiguous(x + row * num_cols + range.begin(), range.size());
+            if (part_num == 1) {
+              y[row] = static_cast<T>(reduced);
+            } else {
+              partials[i] = reduced;
+            }
+          }
+        });
+    if (part_num > 1) { ReducePartials(partials, part_num, num_rows, y); }
+  }
+
+  // y[j] = reduce(x[:, j]) for the num_rows x num_cols matrix x.
+  static void ReduceCols(const T* x, int64_t num_rows, int64_t num_cols, T* y) {
+    if (num_rows * num_cols == 0) { return FillUnit(num_cols, y); }
+    const int64_t col_block_num = (num_cols + kColBlockSize - 1) / kColBlockSize;
+    const int64_t part_num = std::max<int64_t>(
+        std::min<int64_t>(ParallelPartNum(num_rows * num_cols) / col_block_num, num_rows), 1);
+    const BalancedSplitter row_splitter(num_rows, part_num);
+    std::vector<AccT> partials(part_num * num_cols);
+    GlobalThreadPoolParallelFor(
+        part_num * col_block_num,
+        std::max<int64_t>(kCpuParallelGrainSize * part_num / (num_rows * kColBlockSize), 1),
+        [&](int64_t begin, int64_t end) {
+          // The rows are added kPairwiseBlockSize at a time into block_acc before joining acc.
+          AccT block_acc[kColBlockSize];
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t part = i / col_block_num;
+            const int64_t col_begin = (i % col_block_num) * kColBlockSize;
+            const int64_t cols = std::min(kColBlockSize, num_cols - col_begin);
+            const Range range = row_splitter.At(part);
+            AccT* acc = partials.data() + part * num_cols + col_begin;
+            for (int64_t j = 0; j < cols; ++j) { acc[j] = Unit(); }
+            for (int64_t row_begin = range.begin(); row_begin < range.end();
+                 row_begin += kPairwiseBlockSize) {
+              const int64_t row_end = std::min(row_begin + kPairwiseBlockSize, range.end());
+              for (int64_t j = 0; j < cols; ++j) { block_acc[j] = Unit(); }
+              for (int64_t row = row_begin; row < row_end; ++row) {
+                const T* x_row = x + row * num_cols + col_begin;
+                for (int64_t j = 0; j < cols; ++j) {
+                  block_acc[j] = Invoke(block_acc[j], static_cast<AccT>(x_row[j]));
+                }
+              }
+              for (int64_t j = 0; j < cols; ++j) { acc[j] = Invoke(acc[j], block_acc[j]); }
+            }
+          }
+        });
+    ReducePartials(partials, part_num, num_cols, y);
+  }
+
+  // y[j] = reduce(x[:, j, :]) for the dim_x x dim_y x dim_z cube x.
+  static void ReduceXZ(const T* x, int64_t dim_x, int64_t dim_y, int64_t dim_z, T* y) {
+    if (dim_x * dim_y * dim_z == 0) { return FillUnit(dim_y, y); }
+    const int64_t part_num = std::max<int64_t>(
+        std::min<int64_t>(ParallelPartNum(dim_x * dim_y * dim_z) / dim_y, dim_x), 1);
+    const BalancedSplitter x_splitter(dim_x, part_num);
+    std::vector<AccT> partials(part_num == 1 ? 0 : part_num * dim_y);
+    GlobalThreadPoolParallelFor(
+        part_num * dim_y,
+        std::max<int64_t>(kCpuParallelGrainSize * part_num / (dim_x * dim_z), 1),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t part = i / dim_y;
+            const int64_t j = i % dim_y;
+            const Range range = x_splitter.At(part);
+            const AccT reduced = ReduceSegments(x + (range.begin() * dim_y + j) * dim_z,
+                                                range.size(), dim_y * dim_z, dim_z);
+            if (part_num == 1) {
+              y[j] = static_cast<T>(reduced);
+            } else {
+              partials[i] = reduced;
+            }
+          }
+        });
+    if (part_num > 1) { ReducePartials(partials, part_num, dim_y, y); }
+  }
+};
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuReduceUtil<T, binary_func>::ReduceRows(x.ptr(), 1, x.shape().ElemNum(), y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuReduceUtil<T, binary_func>::ReduceRows(x.ptr(), x.shape().At(0), x.shape().At(1),
+                                              y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuReduceUtil<T, binary_func>::ReduceCols(x.ptr(), x.shape().At(0), x.shape().At(1),
+                                              y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuReduceUtil<T, binary_func>::ReduceXZ(x.ptr(), x.shape().At(0), x.shape().At(1),
+                                            x.shape().At(2), y.ptr());
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
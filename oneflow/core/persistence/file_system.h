@@ -39,6 +39,29 @@ class RandomAccessFile {
  private:
 };
 
+// A readonly memmapped file abstraction.
+//
+// The implementation must guarantee that all memory is accessible when the
+// object exists, independently from the FileSystem that created it.
+class ReadOnlyMemoryRegion {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReadOnlyMemoryRegion);
+  ReadOnlyMemoryRegion() = default;
+  virtual ~ReadOnlyMemoryRegion() = default;
+
+  // Returns a pointer to the memory region.
+  virtual const char* data() const = 0;
+
+  // Returns the length of the memory region in bytes.
+  virtual uint64_t length() const = 0;
+
+  // Hints that the region is going to be read from the beginning to the end.
+  virtual void AdviseSequential() const {}
+
+  // Hints that [offset, offset + n) is going to be read soon.
+  virtual void Prefetch(uint64_t offset, uint64_t n) const {}
+};
+
 //  A file abstraction for sequential writing.
 //
 // The implementation must provide buffering since callers may append
@@ -89,6 +112,19 @@ class FileSystem {
   virtual void NewRandomAccessFile(const std::string& fname,
                                    std::unique_ptr<RandomAccessFile>* result) = 0;
 
+  // Creates a readonly region of memory with the file context.
+  //
+  // On success, stores a pointer to the region in *result. File systems
+  // that cannot map files into memory store NULL in *result, and the
+  // caller should fall back to a RandomAccessFile.
+  //
+  // The ownership of the returned ReadOnlyMemoryRegion is passed to the caller
+  // and the object should be deleted when is not used.
+  virtual void NewReadOnlyMemoryRegionFromFile(const std::string& fname,
+                                               std::unique_ptr<ReadOnlyMemoryRegion>* result) {
+    result->reset();
+  }
+
   // Creates an object that writes to a new file with the specified
   // name.
   //
@@ -54,6 +54,14 @@ void TestFileOperation(FileSystem* file_system) {
   random_access_file->Read(0, file_size, read_array);
   std::string read_content(read_array, file_size);
   ASSERT_EQ(write_content + append_content, read_content);
+  // read through memory map
+  std::unique_ptr<ReadOnlyMemoryRegion> memory_region;
+  file_system->NewReadOnlyMemoryRegionFromFile(file_name, &memory_region);
+  if (memory_region) {
+    ASSERT_EQ(memory_region->length(), file_size);
+    ASSERT_EQ(std::string(memory_region->data(), memory_region->length()), read_content);
+    memory_region.reset();
+  }
   file_system->DelFile(file_name);
   delete[] read_array;
 }
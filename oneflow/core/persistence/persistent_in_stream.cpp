@@ -25,6 +25,8 @@ namespace oneflow {
 namespace {
 
 constexpr size_t kDefaultBufferSize = 32 * 1024;  // 32KB
+// Mapped files are prefetched this far ahead of the reads.
+constexpr int64_t kMmapPrefetchSize = 4 * 1024 * 1024;
 
 size_t GetBufferSize() {
   const char* buf_size_str = std::getenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES");
@@ -41,6 +43,12 @@ size_t GetBufferSize() {
   return kDefaultBufferSize;
 }
 
+// Off by default: a mapped file that shrinks under the reader raises SIGBUS instead of a read
+// error.
+bool IsMmapEnabled() {
+  return ParseBooleanFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_ENABLE_MMAP", false);
+}
+
 }  // namespace
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -50,8 +58,10 @@ PersistentInStream::PersistentInStream(fs::FileSystem* fs,
 
 PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
                                        const std::vector<std::string>& file_paths, uint64_t offset,
-                                       bool cyclic, bool with_local_copy) {
+                                       bool cyclic, bool with_local_copy)
+    : next_region_id_(0), cyclic_(cyclic), cur_region_(nullptr), prefetched_end_(nullptr) {
   if (with_local_copy) { CHECK_EQ(offset, 0); }
+  if (!with_local_copy && IsMmapEnabled() && TryMapFiles(fs, file_paths, offset)) { return; }
   std::vector<std::shared_ptr<BinaryInStream>> streams;
   for (auto& file_path : file_paths) {
     if (with_local_copy) {
@@ -68,7 +78,7 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
   buffer_.resize(GetBufferSize() + 1);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data();
-  *cur_buf_end_ = '\0';
+  buffer_.at(0) = '\0';
 }
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -92,26 +102,56 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
                                        const std::string& file_path)
     : PersistentInStream(session_id, fs, std::vector<std::string>({file_path}), 0, false, false) {}
 
+bool PersistentInStream::TryMapFiles(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                                     uint64_t offset) {
+  for (const auto& file_path : file_paths) {
+    std::unique_ptr<fs::ReadOnlyMemoryRegion> region;
+    fs->NewReadOnlyMemoryRegionFromFile(file_path, &region);
+    if (!region) {
+      regions_.clear();
+      return false;
+    }
+    region->AdviseSequential();
+    regions_.push_back(std::move(region));
+  }
+  cur_buf_begin_ = nullptr;
+  cur_buf_end_ = nullptr;
+  while (next_region_id_ < regions_.size()) {
+    const fs::ReadOnlyMemoryRegion* region = regions_.at(next_region_id_++).get();
+    if (offset < region->length()) {
+      cur_region_ = region;
+      cur_buf_begin_ = region->data() + offset;
+      cur_buf_end_ = region->data() + region->length();
+      prefetched_end_ = cur_buf_begin_;
+      return true;
+    }
+    offset -= region->length();
+  }
+  CHECK_EQ(offset, 0);
+  return true;
+}
+
 int32_t PersistentInStream::ReadLine(std::string* l) {
   if (IsEof()) { return -1; }
   l->clear();
-  while (*cur_buf_begin_ != '\n') {
+  while (true) {
     if (cur_buf_begin_ == cur_buf_end_) {
       UpdateBuffer();
-      if (cur_buf_begin_ == cur_buf_end_) {
-        return 0;
-      } else {
-        continue;
-      }
+      if (cur_buf_begin_ == cur_buf_end_) { return 0; }
+    }
+    const char* line_end = std::find(cur_buf_begin_, cur_buf_end_, '\n');
+    l->append(cur_buf_begin_, line_end);
+    if (line_end != cur_buf_end_) {
+      cur_buf_begin_ = line_end + 1;
+      return 0;
     }
-    l->push_back(*cur_buf_begin_++);
+    cur_buf_begin_ = cur_buf_end_;
   }
-  ++cur_buf_begin_;
-  return 0;
 }
 
 int32_t PersistentInStream::ReadFully(char* s, size_t n) {
   if (IsEof()) { return -1; }
+  PrefetchMapped();
   while (n) {
     if (cur_buf_begin_ == cur_buf_end_) { UpdateBuffer(); }
     CHECK_LT(cur_buf_begin_, cur_buf_end_);
@@ -124,15 +164,69 @@ int32_t PersistentInStream::ReadFully(char* s, size_t n) {
   return 0;
 }
 
+int32_t PersistentInStream::ReadView(size_t n, const char** data) {
+  if (IsEof()) { return -1; }
+  if (cur_buf_begin_ == cur_buf_end_ && n > 0) { UpdateBuffer(); }
+  if (cur_buf_end_ - cur_buf_begin_ >= static_cast<int64_t>(n)) {
+    PrefetchMapped();
+    *data = cur_buf_begin_;
+    cur_buf_begin_ += n;
+    return 0;
+  }
+  view_buffer_.resize(n);
+  CHECK_EQ(ReadFully(view_buffer_.data(), n), 0);
+  *data = view_buffer_.data();
+  return 0;
+}
+
 void PersistentInStream::UpdateBuffer() {
   CHECK_EQ(cur_buf_begin_, cur_buf_end_);
+  if (!regions_.empty()) {
+    UpdateMappedBuffer();
+    return;
+  }
   uint64_t n = stream_scanner_->UpdateBuffer(&buffer_);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data() + n;
-  *cur_buf_end_ = '\0';
+  buffer_.at(n) = '\0';
+}
+
+void PersistentInStream::UpdateMappedBuffer() {
+  // Empty files are skipped, at most one round of them.
+  FOR_RANGE(size_t, i, 0, regions_.size()) {
+    if (next_region_id_ == regions_.size()) {
+      if (!cyclic_) { return; }
+      next_region_id_ = 0;
+    }
+    const fs::ReadOnlyMemoryRegion* region = regions_.at(next_region_id_++).get();
+    if (region->length() > 0) {
+      cur_region_ = region;
+      cur_buf_begin_ = region->data();
+      cur_buf_end_ = region->data() + region->length();
+      prefetched_end_ = cur_buf_begin_;
+      return;
+    }
+  }
+}
+
+void PersistentInStream::PrefetchMapped() {
+  if (cur_region_ == nullptr || prefetched_end_ - cur_buf_begin_ > kMmapPrefetchSize / 2) {
+    return;
+  }
+  const int64_t prefetch_size =
+      std::min<int64_t>(cur_buf_begin_ + kMmapPrefetchSize - prefetched_end_,
+                        cur_buf_end_ - prefetched_end_);
+  if (prefetch_size <= 0) { return; }
+  cur_region_->Prefetch(prefetched_end_ - cur_region_->data(), prefetch_size);
+  prefetched_end_ += prefetch_size;
 }
 
 bool PersistentInStream::IsEof() const {
-  return cur_buf_begin_ == cur_buf_end_ && stream_scanner_->IsEof();
+  if (cur_buf_begin_ != cur_buf_end_) { return false; }
+  if (regions_.empty()) { return stream_scanner_->IsEof(); }
+  for (size_t i = cyclic_ ? 0 : next_region_id_; i < regions_.size(); ++i) {
+    if (regions_.at(i)->length() > 0) { return false; }
+  }
+  return true;
 }
 }  // namespace oneflow
@@ -43,16 +43,30 @@ class PersistentInStream {
   // -1: eof
   int32_t ReadLine(std::string* l);
   int32_t ReadFully(char* s, size_t n);
+  // Like ReadFully, but points *data to the n bytes, which are only copied when they span two
+  // files or buffers. *data stays valid until the next read.
+  int32_t ReadView(size_t n, const char** data);
 
  private:
   bool IsEof() const;
   void UpdateBuffer();
+  bool TryMapFiles(fs::FileSystem* fs, const std::vector<std::string>& file_paths, uint64_t offset);
+  void UpdateMappedBuffer();
+  void PrefetchMapped();
 
   std::unique_ptr<StreamScanner> stream_scanner_;
 
+  // Files mapped by the file system replace stream_scanner_, the buffer then points into them.
+  std::vector<std::unique_ptr<fs::ReadOnlyMemoryRegion>> regions_;
+  size_t next_region_id_;
+  bool cyclic_;
+  const fs::ReadOnlyMemoryRegion* cur_region_;
+  const char* prefetched_end_;
+
   std::vector<char> buffer_;
-  char* cur_buf_begin_;
-  char* cur_buf_end_;
+  std::vector<char> view_buffer_;
+  const char* cur_buf_begin_;
+  const char* cur_buf_end_;
 };
 
 }  // namespace oneflow
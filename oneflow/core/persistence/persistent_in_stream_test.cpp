@@ -0,0 +1,178 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+const char* kMmapEnv = "ONEFLOW_PERSISTENT_IN_STREAM_ENABLE_MMAP";
+const char* kBufferSizeEnv = "ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES";
+
+// Files holding the given contents, deleted with it.
+class TmpFiles final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TmpFiles);
+  explicit TmpFiles(const std::vector<std::string>& contents) {
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir,
+                    "tmp_persistent_in_stream_test_" + std::to_string(NewRandomSeed()));
+    LocalFS()->RecursivelyCreateDirIfNotExist(dir_);
+    FOR_RANGE(size_t, i, 0, contents.size()) {
+      const std::string file_path = JoinPath(dir_, std::to_string(i));
+      std::unique_ptr<fs::WritableFile> file;
+      LocalFS()->NewWritableFile(file_path, &file);
+      file->Append(contents.at(i).data(), contents.at(i).size());
+      file->Close();
+      file_paths_.push_back(file_path);
+    }
+  }
+  ~TmpFiles() { LocalFS()->RecursivelyDeleteDir(dir_); }
+
+  const std::vector<std::string>& file_paths() const { return file_paths_; }
+
+ private:
+  std::string dir_;
+  std::vector<std::string> file_paths_;
+};
+
+// Runs test in the buffered mode, with a buffer of a few bytes so that reads span refills, then
+// with the files mapped.
+void ForEachMode(const std::function<void()>& test) {
+  for (const char* enable_mmap : {"0", "1"}) {
+    setenv(kMmapEnv, enable_mmap, 1);
+    setenv(kBufferSizeEnv, "4", 1);
+    test();
+  }
+  unsetenv(kMmapEnv);
+  unsetenv(kBufferSizeEnv);
+}
+
+std::string ReadFully(PersistentInStream* in_stream, size_t n) {
+  std::string ret(n, '\0');
+  CHECK_EQ(in_stream->ReadFully(&ret.at(0), n), 0);
+  return ret;
+}
+
+std::string ReadView(PersistentInStream* in_stream, size_t n) {
+  const char* data = nullptr;
+  CHECK_EQ(in_stream->ReadView(n, &data), 0);
+  return std::string(data, n);
+}
+
+}  // namespace
+
+TEST(PersistentInStream, read_line) {
+  ForEachMode([]() {
+    TmpFiles files({"first\nsec", "ond\n\nlast line"});
+    PersistentInStream in_stream(LocalFS(), files.file_paths(), false, false);
+    std::string line;
+    for (const std::string& expected : {"first", "second", "", "last line"}) {
+      ASSERT_EQ(in_stream.ReadLine(&line), 0);
+      ASSERT_EQ(line, expected);
+    }
+    ASSERT_EQ(in_stream.ReadLine(&line), -1);
+  });
+}
+
+TEST(PersistentInStream, read_fully) {
+  ForEachMode([]() {
+    TmpFiles files({"0123456789", "abcdef"});
+    PersistentInStream in_stream(LocalFS(), files.file_paths(), false, false);
+    ASSERT_EQ(ReadFully(&in_stream, 3), "012");
+    // Across the files.
+    ASSERT_EQ(ReadFully(&in_stream, 9), "3456789ab");
+    ASSERT_EQ(ReadFully(&in_stream, 4), "cdef");
+    char c = '\0';
+    ASSERT_EQ(in_stream.ReadFully(&c, 1), -1);
+  });
+}
+
+TEST(PersistentInStream, offset) {
+  ForEachMode([]() {
+    TmpFiles files({"0123456789", "abcdef"});
+    for (uint64_t offset : {0, 4, 10, 13}) {
+      const std::string expected = std::string("0123456789abcdef").substr(offset);
+      PersistentInStream in_stream(LocalFS(), files.file_paths(), offset, false, false);
+      ASSERT_EQ(ReadFully(&in_stream, expected.size()), expected);
+      char c = '\0';
+      ASSERT_EQ(in_stream.ReadFully(&c, 1), -1);
+    }
+    PersistentInStream in_stream(LocalFS(), files.file_paths(), 16, false, false);
+    char c = '\0';
+    ASSERT_EQ(in_stream.ReadFully(&c, 1), -1);
+  });
+}
+
+TEST(PersistentInStream, cyclic) {
+  ForEachMode([]() {
+    TmpFiles files({"abc", "de"});
+    PersistentInStream in_stream(LocalFS(), files.file_paths(), 1, true, false);
+    ASSERT_EQ(ReadFully(&in_stream, 12), "bcdeabcdeabc");
+  });
+}
+
+TEST(PersistentInStream, read_view) {
+  ForEachMode([]() {
+    TmpFiles files({"0123456789", "abcdef"});
+    PersistentInStream in_stream(LocalFS(), files.file_paths(), false, false);
+    ASSERT_EQ(ReadView(&in_stream, 2), "01");
+    ASSERT_EQ(ReadView(&in_stream, 0), "");
+    ASSERT_EQ(ReadFully(&in_stream, 3), "234");
+    // Across the files, and across buffers in the buffered mode.
+    ASSERT_EQ(ReadView(&in_stream, 7), "56789ab");
+    ASSERT_EQ(ReadView(&in_stream, 4), "cdef");
+    const char* data = nullptr;
+    ASSERT_EQ(in_stream.ReadView(1, &data), -1);
+  });
+}
+
+// The buffered mode takes no empty files.
+TEST(PersistentInStream, mapped_empty_files) {
+  setenv(kMmapEnv, "1", 1);
+  {
+    TmpFiles files({"", "ab", "", "", "cd", ""});
+    PersistentInStream acyclic(LocalFS(), files.file_paths(), false, false);
+    ASSERT_EQ(ReadFully(&acyclic, 4), "abcd");
+    char c = '\0';
+    ASSERT_EQ(acyclic.ReadFully(&c, 1), -1);
+    PersistentInStream cyclic(LocalFS(), files.file_paths(), 3, true, false);
+    ASSERT_EQ(ReadFully(&cyclic, 7), "dabcdab");
+    std::string line;
+    PersistentInStream line_stream(LocalFS(), files.file_paths(), false, false);
+    ASSERT_EQ(line_stream.ReadLine(&line), 0);
+    ASSERT_EQ(line, "abcd");
+    ASSERT_EQ(line_stream.ReadLine(&line), -1);
+  }
+  {
+    TmpFiles files({"", ""});
+    PersistentInStream in_stream(LocalFS(), files.file_paths(), false, false);
+    std::string line;
+    ASSERT_EQ(in_stream.ReadLine(&line), -1);
+    const char* data = nullptr;
+    ASSERT_EQ(in_stream.ReadView(1, &data), -1);
+  }
+  unsetenv(kMmapEnv);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -62,6 +62,35 @@ class PosixRandomAccessFile : public RandomAccessFile {
   }
 };
 
+class PosixReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
+ private:
+  const void* address_;
+  uint64_t length_;
+
+ public:
+  PosixReadOnlyMemoryRegion(const void* address, uint64_t length)
+      : address_(address), length_(length) {}
+  ~PosixReadOnlyMemoryRegion() override {
+    if (length_ > 0) { munmap(const_cast<void*>(address_), length_); }
+  }
+
+  const char* data() const override { return reinterpret_cast<const char*>(address_); }
+  uint64_t length() const override { return length_; }
+
+  // Failed hints are harmless, so the results of madvise are ignored.
+  void AdviseSequential() const override {
+    if (length_ > 0) { madvise(const_cast<void*>(address_), length_, MADV_SEQUENTIAL); }
+  }
+
+  void Prefetch(uint64_t offset, uint64_t n) const override {
+    static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    const uint64_t begin = offset / page_size * page_size;
+    const uint64_t end = std::min(offset + n, length_);
+    if (begin >= end) { return; }
+    madvise(const_cast<char*>(data()) + begin, end - begin, MADV_WILLNEED);
+  }
+};
+
 class PosixWritableFile : public WritableFile {
  private:
   std::string fname_;
@@ -99,6 +128,23 @@ void PosixFileSystem::NewRandomAccessFile(const std::string& fname,
   CHECK_NOTNULL(result->get());
 }
 
+void PosixFileSystem::NewReadOnlyMemoryRegionFromFile(
+    const std::string& fname, std::unique_ptr<ReadOnlyMemoryRegion>* result) {
+  std::string translated_fname = TranslateName(fname);
+  int fd = open(translated_fname.c_str(), O_RDONLY);
+  PCHECK(fd >= 0) << "Fail to open file " << fname << ", errno is " << errno;
+  struct stat st;
+  PCHECK(fstat(fd, &st) == 0) << "Fail to stat file " << fname << ", errno is " << errno;
+  const void* address = nullptr;
+  // mmap refuses empty mappings.
+  if (st.st_size > 0) {
+    address = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    PCHECK(address != MAP_FAILED) << "Fail to mmap file " << fname << ", errno is " << errno;
+  }
+  close(fd);
+  result->reset(new PosixReadOnlyMemoryRegion(address, st.st_size));
+}
+
 void PosixFileSystem::NewWritableFile(const std::string& fname,
                                       std::unique_ptr<WritableFile>* result) {
   std::string translated_fname = TranslateName(fname);
@@ -15,23 +15,104 @@ limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/common/str_util.h"
-#include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
 #include "oneflow/core/register/tensor_slice_copier.h"
 #include "oneflow/core/device/cpu_device_context.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
 namespace {
 
+const int64_t kDefaultSnapshotIoThreadNum = 8;
+const int64_t kDefaultSnapshotIoChunkSize = 8 * 1024 * 1024;
+
 std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+// Snapshot io mostly waits on the file system, so it gets its own threads instead of taking the
+// compute threads of Global<ThreadPool>.
+ThreadPool* SnapshotIoThreadPool() {
+  static ThreadPool thread_pool(std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_IO_THREAD_NUM", kDefaultSnapshotIoThreadNum), 1));
+  return &thread_pool;
+}
+
+int64_t SnapshotIoChunkSize() {
+  static const int64_t chunk_size = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_IO_CHUNK_SIZE", kDefaultSnapshotIoChunkSize), 1);
+  return chunk_size;
+}
+
+void ReadFileRange(const fs::RandomAccessFile& file, uint64_t offset, size_t size, char* dst) {
+  SnapshotIoThreadPool()->ParallelFor(0, size, SnapshotIoChunkSize(),
+                                      [&](int64_t begin, int64_t end) {
+                                        file.Read(offset + begin, end - begin, dst + begin);
+                                      });
+}
+
+void WriteFile(const std::string& root_path, const std::string& key, const char* data,
+               size_t size) {
+  const std::string path = GenDataFilePath(root_path, key);
+  const std::string dir_path = Dirname(path);
+  SnapshotFS()->CreateDirIfNotExist(dir_path);
+  CHECK(!SnapshotFS()->FileExists(path));
+  PersistentOutStream out_stream(SnapshotFS(), path);
+  out_stream.Write(data, size);
+}
+
+void MarkSnapshotDone(const std::string& root_path) {
+  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path, "snapshot_done"));
+}
+
+void WaitAll(std::vector<std::future<void>>* futures) {
+  for (auto& future : *futures) { future.get(); }
+  futures->clear();
+}
+
 }  // namespace
 
+BackgroundSnapshotSaver::BackgroundSnapshotSaver() : is_saving_(false) {
+  thread_ = std::thread([this]() {
+    std::function<void()> save;
+    while (channel_.Receive(&save) == kChannelStatusSuccess) {
+      save();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        is_saving_ = false;
+      }
+      cond_.notify_all();
+    }
+  });
+}
+
+BackgroundSnapshotSaver::~BackgroundSnapshotSaver() {
+  channel_.Close();
+  thread_.join();
+}
+
+void BackgroundSnapshotSaver::Schedule(const std::string& root_path,
+                                       const std::function<void()>& save) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this]() { return !is_saving_; });
+  is_saving_ = true;
+  saving_root_path_ = root_path;
+  CHECK_EQ(channel_.Send(save), kChannelStatusSuccess);
+}
+
+void BackgroundSnapshotSaver::WaitUntilSaved(const std::string& root_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [&]() { return !is_saving_ || saving_root_path_ != root_path; });
+}
+
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {}
+    : root_path_(snapshot_root_path) {
+  BackgroundSnapshotSaver* saver = Global<BackgroundSnapshotSaver>::Get();
+  if (saver != nullptr) { saver->WaitUntilSaved(snapshot_root_path); }
+}
+
+SnapshotReader::~SnapshotReader() { Wait(); }
 
 bool SnapshotReader::HasKey(const std::string& key) const {
   const std::string path = GenDataFilePath(root_path_, key);
@@ -53,18 +134,31 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
   CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
       << "unexpected model snapshot size, path: " << path;
   if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
-    PersistentInStream in_stream(
-        SnapshotFS(), path,
-        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
-    in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
+    std::unique_ptr<fs::RandomAccessFile> file;
+    SnapshotFS()->NewRandomAccessFile(path, &file);
+    const int64_t elem_size = GetSizeOfDataType(data_type);
+    ReadFileRange(*file, slice.At(0).begin() * slice.shape().Count(1) * elem_size,
+                  slice.shape().elem_cnt() * elem_size, dst);
   } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
+    // Only the pages holding the slice are read from a memory mapped file.
+    std::unique_ptr<fs::ReadOnlyMemoryRegion> region;
+    SnapshotFS()->NewReadOnlyMemoryRegionFromFile(path, &region);
+    std::vector<char> buffer;
+    const char* src = nullptr;
+    if (region) {
+      CHECK_EQ(region->length(), logical_blob_size);
+      src = region->data();
+    } else {
+      buffer.resize(logical_blob_size);
+      std::unique_ptr<fs::RandomAccessFile> file;
+      SnapshotFS()->NewRandomAccessFile(path, &file);
+      ReadFileRange(*file, 0, logical_blob_size, buffer.data());
+      src = buffer.data();
+    }
     TensorSliceCopier copier(slice, logical_blob_slice, data_type);
     CpuDeviceCtx device_ctx;
     std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
-    copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
+    copier.Copy(&device_ctx, *host_memory_copier, dst, src);
   }
 }
 
@@ -74,10 +168,34 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
   Read(key, logical_blob_shape, blob->data_type(), slice, blob->mut_dptr<char>());
 }
 
-void SnapshotReader::Close() {}
+void SnapshotReader::AsyncRead(const std::string& key, const Shape& logical_blob_shape,
+                               DataType data_type, const TensorSliceView& slice, char* dst) {
+  pending_reads_.push_back(SnapshotIoThreadPool()->Submit(
+      [this, key, logical_blob_shape, data_type, slice, dst]() {
+        Read(key, logical_blob_shape, data_type, slice, dst);
+      }));
+}
+
+void SnapshotReader::AsyncRead(const std::string& key, const Shape& logical_blob_shape,
+                               const TensorSliceView& slice, Blob* blob) {
+  CHECK_EQ(ShapeView(slice.shape()), blob->shape());
+  AsyncRead(key, logical_blob_shape, blob->data_type(), slice, blob->mut_dptr<char>());
+}
+
+void SnapshotReader::AsyncRead(const std::string& key, Blob* blob) {
+  Shape shape;
+  blob->shape().ToShape(&shape);
+  AsyncRead(key, shape, blob->data_type(), TensorSliceView(shape), blob->mut_dptr<char>());
+}
+
+void SnapshotReader::Wait() { WaitAll(&pending_reads_); }
+
+void SnapshotReader::Close() { Wait(); }
 
 SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {
+    : root_path_(snapshot_root_path),
+      async_save_(ParseBooleanFromEnv("ONEFLOW_SNAPSHOT_ASYNC_SAVE", false)
+                  && Global<BackgroundSnapshotSaver>::Get() != nullptr) {
   OfCallOnce("SnapshotWriteCheckRootPath-" + snapshot_root_path, [&]() {
     if (SnapshotFS()->FileExists(snapshot_root_path)) {
       CHECK(SnapshotFS()->IsDirectory(snapshot_root_path))
@@ -90,21 +208,48 @@ SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
   });
 }
 
+SnapshotWriter::~SnapshotWriter() { WaitAll(&pending_writes_); }
+
 void SnapshotWriter::Write(const std::string& key, const char* data, size_t size) {
-  const std::string path = GenDataFilePath(root_path_, key);
-  const std::string dir_path = Dirname(path);
-  SnapshotFS()->CreateDirIfNotExist(dir_path);
-  CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
-  out_stream.Write(data, size);
+  WriteFile(root_path_, key, data, size);
 }
 
 void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
   Write(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
 }
 
+void SnapshotWriter::AsyncWrite(const std::string& key, const Blob* blob) {
+  const char* data = blob->dptr<char>();
+  const size_t size = blob->ByteSizeOfBlobBody();
+  if (async_save_) {
+    key2copied_data_.emplace_back(key, std::make_shared<std::vector<char>>(data, data + size));
+  } else {
+    const std::string root_path = root_path_;
+    pending_writes_.push_back(SnapshotIoThreadPool()->Submit(
+        [root_path, key, data, size]() { WriteFile(root_path, key, data, size); }));
+  }
+}
+
 void SnapshotWriter::Close() {
-  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  WaitAll(&pending_writes_);
+  if (key2copied_data_.empty()) {
+    MarkSnapshotDone(root_path_);
+    return;
+  }
+  const std::string root_path = root_path_;
+  auto key2copied_data = std::make_shared<
+      std::vector<std::pair<std::string, std::shared_ptr<std::vector<char>>>>>();
+  key2copied_data->swap(key2copied_data_);
+  Global<BackgroundSnapshotSaver>::Get()->Schedule(root_path, [root_path, key2copied_data]() {
+    SnapshotIoThreadPool()->ParallelFor(
+        0, key2copied_data->size(), 1, [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const auto& pair = key2copied_data->at(i);
+            WriteFile(root_path, pair.first, pair.second->data(), pair.second->size());
+          }
+        });
+    MarkSnapshotDone(root_path);
+  });
 }
 
 }  // namespace oneflow
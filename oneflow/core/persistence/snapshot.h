@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_H_
 #define ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_H_
 
+#include <future>
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/register/tensor_slice_view.h"
 
@@ -24,23 +26,57 @@ namespace oneflow {
 
 class Blob;
 
+// Runs the saves of ONEFLOW_SNAPSHOT_ASYNC_SAVE one after another on a background thread. At most
+// one save is in flight, so a new one waits for the previous one and at most one copy of the
+// model is kept in memory. It is a session global, deleted before the rest of the runtime, and
+// its destructor finishes the pending save.
+class BackgroundSnapshotSaver final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BackgroundSnapshotSaver);
+  BackgroundSnapshotSaver();
+  ~BackgroundSnapshotSaver();
+
+  void Schedule(const std::string& root_path, const std::function<void()>& save);
+  void WaitUntilSaved(const std::string& root_path);
+
+ private:
+  Channel<std::function<void()>> channel_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_saving_;
+  std::string saving_root_path_;
+  std::thread thread_;
+};
+
+// Contiguous slices are read straight into the destination, several threads at a time for large
+// variables. Other slices are copied out of the memory mapped file when the file system supports
+// it.
 class SnapshotReader final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SnapshotReader);
   SnapshotReader() = delete;
   explicit SnapshotReader(const std::string& snapshot_root_path);
-  ~SnapshotReader() = default;
+  ~SnapshotReader();
 
   void Read(const std::string& key, const Shape& logical_blob_shape, DataType data_type,
             const TensorSliceView& slice, char* dst) const;
   void Read(const std::string& key, const Shape& logical_blob_shape, const TensorSliceView& slice,
             Blob* blob) const;
   void Read(const std::string& key, Blob* blob) const;
+  // Same as Read, but run on the snapshot io threads. The destination must stay valid until Wait()
+  // or Close() returns.
+  void AsyncRead(const std::string& key, const Shape& logical_blob_shape, DataType data_type,
+                 const TensorSliceView& slice, char* dst);
+  void AsyncRead(const std::string& key, const Shape& logical_blob_shape,
+                 const TensorSliceView& slice, Blob* blob);
+  void AsyncRead(const std::string& key, Blob* blob);
+  void Wait();
   bool HasKey(const std::string& key) const;
   void Close();
 
  private:
   const std::string root_path_;
+  std::vector<std::future<void>> pending_reads_;
 };
 
 class SnapshotWriter final {
@@ -48,14 +84,21 @@ class SnapshotWriter final {
   OF_DISALLOW_COPY_AND_MOVE(SnapshotWriter);
   SnapshotWriter() = delete;
   explicit SnapshotWriter(const std::string& snapshot_root_path);
-  ~SnapshotWriter() = default;
+  ~SnapshotWriter();
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
+  // Writes on the snapshot io threads, the blob must stay valid until Close() returns. With
+  // ONEFLOW_SNAPSHOT_ASYNC_SAVE in a session, the blob is copied instead, and the files are
+  // written and the snapshot is marked done in the background after Close() has returned.
+  void AsyncWrite(const std::string& key, const Blob* blob);
   void Close();
 
  private:
   const std::string root_path_;
+  const bool async_save_;
+  std::vector<std::future<void>> pending_writes_;
+  std::vector<std::pair<std::string, std::shared_ptr<std::vector<char>>>> key2copied_data_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,157 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstring>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/register/blob.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// A float blob in host memory.
+class HostBlob final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostBlob);
+  explicit HostBlob(const Shape& shape) : blob_desc_(shape, DataType::kFloat) {
+    header_.resize(blob_desc_.AlignedByteSizeOfBlobHeader());
+    body_.resize(blob_desc_.AlignedByteSizeOfBlobBody());
+    MemoryCase host_mem_case;
+    host_mem_case.mutable_host_mem();
+    blob_.reset(new Blob(host_mem_case, &blob_desc_, header_.data(), body_.data()));
+  }
+  ~HostBlob() = default;
+
+  Blob* blob() const { return blob_.get(); }
+  float* data() const { return blob_->mut_dptr<float>(); }
+  int64_t elem_cnt() const { return blob_desc_.shape().elem_cnt(); }
+
+ private:
+  BlobDesc blob_desc_;
+  std::vector<char> header_;
+  std::vector<char> body_;
+  std::unique_ptr<Blob> blob_;
+};
+
+// The root of a snapshot that does not exist yet, deleted with it.
+class TmpSnapshotRoot final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TmpSnapshotRoot);
+  TmpSnapshotRoot() {
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    path_ = JoinPath(current_dir, "tmp_snapshot_test_" + std::to_string(NewRandomSeed()));
+  }
+  ~TmpSnapshotRoot() {
+    if (SnapshotFS()->FileExists(path_)) { SnapshotFS()->RecursivelyDeleteDir(path_); }
+  }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+void Fill(const HostBlob& host_blob, float base) {
+  for (int64_t i = 0; i < host_blob.elem_cnt(); ++i) { host_blob.data()[i] = base + i; }
+}
+
+// Reads key back whole, as rows and as columns, and checks the bytes against expected, a rows x
+// cols matrix.
+void CheckRead(const std::string& root_path, const std::string& key,
+               const std::vector<float>& expected, int64_t rows, int64_t cols) {
+  const Shape shape({rows, cols});
+  HostBlob whole(shape);
+  const int64_t row_begin = rows / 4;
+  const int64_t row_end = rows - rows / 3;
+  std::vector<float> row_slice((row_end - row_begin) * cols);
+  const int64_t col_begin = cols / 3;
+  const int64_t col_end = cols - cols / 4;
+  std::vector<float> col_slice(rows * (col_end - col_begin));
+  SnapshotReader reader(root_path);
+  ASSERT_TRUE(reader.HasKey(key));
+  reader.AsyncRead(key, whole.blob());
+  // Whole rows are read straight from the file, parts of rows from the memory mapped file.
+  reader.AsyncRead(key, shape, DataType::kFloat,
+                   TensorSliceView({Range(row_begin, row_end), Range(0, cols)}),
+                   reinterpret_cast<char*>(row_slice.data()));
+  reader.AsyncRead(key, shape, DataType::kFloat,
+                   TensorSliceView({Range(0, rows), Range(col_begin, col_end)}),
+                   reinterpret_cast<char*>(col_slice.data()));
+  reader.Wait();
+  ASSERT_EQ(std::memcmp(whole.data(), expected.data(), expected.size() * sizeof(float)), 0);
+  ASSERT_EQ(std::memcmp(row_slice.data(), expected.data() + row_begin * cols,
+                        row_slice.size() * sizeof(float)),
+            0);
+  for (int64_t i = 0; i < rows; ++i) {
+    ASSERT_EQ(std::memcmp(col_slice.data() + i * (col_end - col_begin),
+                          expected.data() + i * cols + col_begin,
+                          (col_end - col_begin) * sizeof(float)),
+              0);
+  }
+}
+
+}  // namespace
+
+TEST(Snapshot, async_write_and_read) {
+  TmpSnapshotRoot root;
+  // Larger than an io chunk, so the whole read is split between threads.
+  const int64_t rows = 3001;
+  const int64_t cols = 1024;
+  HostBlob large(Shape({rows, cols}));
+  Fill(large, 0);
+  HostBlob small(Shape({7, 5}));
+  Fill(small, 100);
+  SnapshotWriter writer(root.path());
+  writer.AsyncWrite("large", large.blob());
+  writer.AsyncWrite("small/out", small.blob());
+  writer.Close();
+  ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root.path(), "snapshot_done")));
+  const std::vector<float> large_data(large.data(), large.data() + large.elem_cnt());
+  CheckRead(root.path(), "large", large_data, rows, cols);
+  const std::vector<float> small_data(small.data(), small.data() + small.elem_cnt());
+  CheckRead(root.path(), "small/out", small_data, 7, 5);
+}
+
+TEST(Snapshot, background_save) {
+  const char* kAsyncSaveEnv = "ONEFLOW_SNAPSHOT_ASYNC_SAVE";
+  setenv(kAsyncSaveEnv, "1", 1);
+  Global<BackgroundSnapshotSaver>::New();
+  TmpSnapshotRoot root;
+  const int64_t rows = 301;
+  const int64_t cols = 67;
+  HostBlob host_blob(Shape({rows, cols}));
+  Fill(host_blob, 0);
+  const std::vector<float> saved(host_blob.data(), host_blob.data() + host_blob.elem_cnt());
+  SnapshotWriter writer(root.path());
+  writer.AsyncWrite("model/weight", host_blob.blob());
+  writer.Close();
+  // The saver works on a copy, the blob can be updated right after Close().
+  Fill(host_blob, 1000);
+  CheckRead(root.path(), "model/weight", saved, rows, cols);
+  ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root.path(), "snapshot_done")));
+  Global<BackgroundSnapshotSaver>::Delete();
+  unsetenv(kAsyncSaveEnv);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -50,34 +50,55 @@ void SimplifyPermutation(size_t num_dims, const int64_t* src_dims, const int* pe
                          size_t* simplified_num_dims, int64_t* simplified_src_dims,
                          int* simplified_permutation) {
   CHECK_NE(num_dims, 0);
+  // Drops the dims of size 1 first, so that the dims merged below are really adjacent.
+  int64_t squeezed_dims[max_num_dims];
+  int squeezed_permutation[max_num_dims];
+  int squeezed_index[max_num_dims];
+  size_t squeezed_num_dims = 0;
+  for (size_t i = 0; i < num_dims; ++i) {
+    if (src_dims[i] == 1) {
+      squeezed_index[i] = -1;
+    } else {
+      squeezed_index[i] = squeezed_num_dims;
+      squeezed_dims[squeezed_num_dims] = src_dims[i];
+      squeezed_num_dims += 1;
+    }
+  }
+  if (squeezed_num_dims == 0) {
+    *simplified_num_dims = 1;
+    simplified_src_dims[0] = 1;
+    simplified_permutation[0] = 0;
+    return;
+  }
+  size_t squeezed_permutation_index = 0;
+  for (size_t i = 0; i < num_dims; ++i) {
+    const int squeezed = squeezed_index[permutation[i]];
+    if (squeezed >= 0) {
+      squeezed_permutation[squeezed_permutation_index] = squeezed;
+      squeezed_permutation_index += 1;
+    }
+  }
   int inverse[max_num_dims];
-  for (size_t i = 0; i < num_dims; ++i) { inverse[permutation[i]] = i; }
+  for (size_t i = 0; i < squeezed_num_dims; ++i) { inverse[squeezed_permutation[i]] = i; }
   int mapping[max_num_dims];
   size_t valid_num_dims = 0;
-  for (size_t i = 0; i < num_dims; ++i) {
-    const int src_dim = src_dims[i];
-    if (src_dim == 1 || (i != 0 && inverse[i] == inverse[i - 1] + 1)) {
+  for (size_t i = 0; i < squeezed_num_dims; ++i) {
+    if (i != 0 && inverse[i] == inverse[i - 1] + 1) {
       mapping[i] = -1;
-      if (src_dim != 1) { simplified_src_dims[valid_num_dims - 1] *= src_dim; }
+      simplified_src_dims[valid_num_dims - 1] *= squeezed_dims[i];
     } else {
       mapping[i] = valid_num_dims;
-      simplified_src_dims[valid_num_dims] = src_dim;
+      simplified_src_dims[valid_num_dims] = squeezed_dims[i];
       valid_num_dims += 1;
     }
   }
-  if (valid_num_dims == 0) {
-    *simplified_num_dims = 1;
-    simplified_src_dims[0] = 1;
-    simplified_permutation[0] = 0;
-  } else {
-    *simplified_num_dims = valid_num_dims;
-    size_t permutation_index = 0;
-    for (size_t i = 0; i < num_dims; ++i) {
-      const int mapped = mapping[permutation[i]];
-      if (mapped >= 0) {
-        simplified_permutation[permutation_index] = mapped;
-        permutation_index += 1;
-      }
+  *simplified_num_dims = valid_num_dims;
+  size_t permutation_index = 0;
+  for (size_t i = 0; i < squeezed_num_dims; ++i) {
+    const int mapped = mapping[squeezed_permutation[i]];
+    if (mapped >= 0) {
+      simplified_permutation[permutation_index] = mapped;
+      permutation_index += 1;
     }
   }
 }
@@ -15,6 +15,10 @@ limitations under the License.
 */
 #include "oneflow/core/primitive/include/permute.h"
 #include "oneflow/core/primitive/common/permute.h"
+#include "oneflow/core/thread/thread_pool.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif  // defined(__SSE2__)
 
 namespace oneflow {
 
@@ -24,21 +28,179 @@ namespace permute_internal {
 
 namespace {
 
+// Side of the square tiles a transposed plane is cut into, a tile of 16-byte elements takes 16KiB.
+constexpr int64_t kTileSize = 32;
+
+// Transposes the rows x cols matrix at src, whose rows are src_stride elements apart, into the
+// cols x rows matrix at dst, whose rows are dst_stride elements apart.
+template<typename T>
+void TransposeTile(const T* src, int64_t src_stride, T* dst, int64_t dst_stride, int64_t rows,
+                   int64_t cols) {
+  for (int64_t j = 0; j < cols; ++j) {
+    for (int64_t i = 0; i < rows; ++i) { dst[j * dst_stride + i] = src[i * src_stride + j]; }
+  }
+}
+
+#if defined(__SSE2__)
+
+// 4 x 4 blocks of 4-byte elements are transposed in registers.
+template<>
+void TransposeTile<std::aligned_storage<4, 4>::type>(const std::aligned_storage<4, 4>::type* src,
+                                                     int64_t src_stride,
+                                                     std::aligned_storage<4, 4>::type* dst,
+                                                     int64_t dst_stride, int64_t rows,
+                                                     int64_t cols) {
+  const float* src_ptr = reinterpret_cast<const float*>(src);
+  float* dst_ptr = reinterpret_cast<float*>(dst);
+  const int64_t block_rows = rows / 4 * 4;
+  const int64_t block_cols = cols / 4 * 4;
+  for (int64_t i = 0; i < block_rows; i += 4) {
+    for (int64_t j = 0; j < block_cols; j += 4) {
+      const float* s = src_ptr + i * src_stride + j;
+      __m128 row0 = _mm_loadu_ps(s);
+      __m128 row1 = _mm_loadu_ps(s + src_stride);
+      __m128 row2 = _mm_loadu_ps(s + 2 * src_stride);
+      __m128 row3 = _mm_loadu_ps(s + 3 * src_stride);
+      _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+      float* d = dst_ptr + j * dst_stride + i;
+      _mm_storeu_ps(d, row0);
+      _mm_storeu_ps(d + dst_stride, row1);
+      _mm_storeu_ps(d + 2 * dst_stride, row2);
+      _mm_storeu_ps(d + 3 * dst_stride, row3);
+    }
+  }
+  for (int64_t j = 0; j < cols; ++j) {
+    const int64_t i_begin = j < block_cols ? block_rows : 0;
+    for (int64_t i = i_begin; i < rows; ++i) {
+      dst_ptr[j * dst_stride + i] = src_ptr[i * src_stride + j];
+    }
+  }
+}
+
+// 2 x 2 blocks of 8-byte elements are transposed in registers.
+template<>
+void TransposeTile<std::aligned_storage<8, 8>::type>(const std::aligned_storage<8, 8>::type* src,
+                                                     int64_t src_stride,
+                                                     std::aligned_storage<8, 8>::type* dst,
+                                                     int64_t dst_stride, int64_t rows,
+                                                     int64_t cols) {
+  const double* src_ptr = reinterpret_cast<const double*>(src);
+  double* dst_ptr = reinterpret_cast<double*>(dst);
+  const int64_t block_rows = rows / 2 * 2;
+  const int64_t block_cols = cols / 2 * 2;
+  for (int64_t i = 0; i < block_rows; i += 2) {
+    for (int64_t j = 0; j < block_cols; j += 2) {
+      const double* s = src_ptr + i * src_stride + j;
+      const __m128d row0 = _mm_loadu_pd(s);
+      const __m128d row1 = _mm_loadu_pd(s + src_stride);
+      double* d = dst_ptr + j * dst_stride + i;
+      _mm_storeu_pd(d, _mm_unpacklo_pd(row0, row1));
+      _mm_storeu_pd(d + dst_stride, _mm_unpackhi_pd(row0, row1));
+    }
+  }
+  for (int64_t j = 0; j < cols; ++j) {
+    const int64_t i_begin = j < block_cols ? block_rows : 0;
+    for (int64_t i = i_begin; i < rows; ++i) {
+      dst_ptr[j * dst_stride + i] = src_ptr[i * src_stride + j];
+    }
+  }
+}
+
+#endif  // defined(__SSE2__)
+
+// Instead of decomposing the index of every element, the permutation is run as one of
+//  - a copy of contiguous rows, when the last dimension stays in place;
+//  - a tiled transpose of the plane formed by the last dimension of src and the last dimension
+//    of dst, repeated over the other dimensions.
+// The index decomposition is only done once per row or per tile.
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void PermuteKernel(PermuteKernelParams<num_dims, IndexType> params) {
   using T = typename std::aligned_storage<movement_size, movement_size>::type;
   const T* src = reinterpret_cast<const T*>(params.src);
   T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
+  const int64_t count = params.count;
+  if (count == 0) { return; }
+  const int* permutation = params.permutation;
+  // The helpers only keep strides, the dims are recovered from them.
+  IndexType src_strides[num_dims];
+  IndexType dst_strides[num_dims];
+  for (size_t dim = 0; dim < num_dims; ++dim) {
+    IndexType unit_index[num_dims] = {};
+    unit_index[dim] = 1;
+    src_strides[dim] = params.src_index_helper.NdIndexToOffset(unit_index);
+    dst_strides[dim] = params.dst_index_helper.NdIndexToOffset(unit_index);
+  }
+  int64_t dst_dims[num_dims];
+  dst_dims[0] = count / dst_strides[0];
+  for (size_t dim = 1; dim < num_dims; ++dim) {
+    dst_dims[dim] = dst_strides[dim - 1] / dst_strides[dim];
+  }
+  const auto DstOffsetToSrcOffset = [&](IndexType dst_offset) -> IndexType {
     IndexType src_index[num_dims];
     IndexType dst_index[num_dims];
-    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
-    for (size_t dim = 0; dim < num_dims; ++dim) {
-      src_index[params.permutation[dim]] = dst_index[dim];
-    }
-    IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    dst[i] = src[src_offset];
+    params.dst_index_helper.OffsetToNdIndex(dst_offset, dst_index);
+    for (size_t dim = 0; dim < num_dims; ++dim) { src_index[permutation[dim]] = dst_index[dim]; }
+    return params.src_index_helper.NdIndexToOffset(src_index);
+  };
+
+  if (permutation[num_dims - 1] == num_dims - 1) {
+    const int64_t row_size = dst_dims[num_dims - 1];
+    // Long rows, e.g. the identity permutation, are also split between threads.
+    const int64_t piece_size = std::min(row_size, kCpuParallelGrainSize);
+    const int64_t piece_num_per_row = (row_size + piece_size - 1) / piece_size;
+    const int64_t piece_num = count / row_size * piece_num_per_row;
+    GlobalThreadPoolParallelFor(
+        piece_num, std::max<int64_t>(kCpuParallelGrainSize / piece_size, 1),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t piece = begin; piece < end; ++piece) {
+            const int64_t row = piece / piece_num_per_row;
+            const int64_t col_begin = (piece % piece_num_per_row) * piece_size;
+            const int64_t size = std::min(piece_size, row_size - col_begin);
+            const int64_t dst_offset = row * row_size + col_begin;
+            std::memcpy(dst + dst_offset, src + DstOffsetToSrcOffset(dst_offset), size * sizeof(T));
+          }
+        });
+    return;
   }
+
+  // Rows of the plane walk the src dimension which is the last one of dst, and its columns walk
+  // the last src dimension, which is dst dimension `dst_col_dim`.
+  const int src_row_dim = permutation[num_dims - 1];
+  int dst_col_dim = 0;
+  while (permutation[dst_col_dim] != num_dims - 1) { ++dst_col_dim; }
+  const int64_t rows = dst_dims[num_dims - 1];
+  const int64_t cols = dst_dims[dst_col_dim];
+  const int64_t src_row_stride = src_strides[src_row_dim];
+  const int64_t dst_col_stride = dst_strides[dst_col_dim];
+  const int64_t row_tile_num = (rows + kTileSize - 1) / kTileSize;
+  const int64_t col_tile_num = (cols + kTileSize - 1) / kTileSize;
+  const int64_t tile_num_per_plane = row_tile_num * col_tile_num;
+  const int64_t plane_num = count / (rows * cols);
+  // Dst dims of a plane index, the plane dims being folded to 1.
+  IndexType plane_dims[num_dims];
+  for (size_t dim = 0; dim < num_dims; ++dim) { plane_dims[dim] = dst_dims[dim]; }
+  plane_dims[dst_col_dim] = 1;
+  plane_dims[num_dims - 1] = 1;
+  const NdIndexOffsetHelper<IndexType, num_dims> plane_index_helper(plane_dims);
+  GlobalThreadPoolParallelFor(
+      plane_num * tile_num_per_plane,
+      std::max<int64_t>(kCpuParallelGrainSize / (kTileSize * kTileSize), 1),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t tile = begin; tile < end; ++tile) {
+          const int64_t plane = tile / tile_num_per_plane;
+          const int64_t tile_in_plane = tile % tile_num_per_plane;
+          const int64_t row_begin = (tile_in_plane / col_tile_num) * kTileSize;
+          const int64_t col_begin = (tile_in_plane % col_tile_num) * kTileSize;
+          IndexType dst_index[num_dims];
+          plane_index_helper.OffsetToNdIndex(plane, dst_index);
+          dst_index[dst_col_dim] = col_begin;
+          dst_index[num_dims - 1] = row_begin;
+          const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
+          TransposeTile<T>(src + DstOffsetToSrcOffset(dst_offset), src_row_stride, dst + dst_offset,
+                           dst_col_stride, std::min(kTileSize, rows - row_begin),
+                           std::min(kTileSize, cols - col_begin));
+        }
+      });
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
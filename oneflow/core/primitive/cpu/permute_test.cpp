@@ -0,0 +1,169 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/primitive/include/permute.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <chrono>
+#include <random>
+
+namespace oneflow {
+
+namespace primitive {
+
+namespace {
+
+// The per element implementation the primitive used to have.
+template<typename T>
+void NaivePermute(const std::vector<int64_t>& src_dims, const T* src,
+                  const std::vector<int>& permutation, T* dst) {
+  const size_t num_dims = src_dims.size();
+  std::vector<int64_t> src_strides(num_dims, 1);
+  std::vector<int64_t> dst_dims(num_dims);
+  for (int i = static_cast<int>(num_dims) - 2; i >= 0; --i) {
+    src_strides[i] = src_strides[i + 1] * src_dims[i + 1];
+  }
+  int64_t count = 1;
+  for (size_t i = 0; i < num_dims; ++i) {
+    dst_dims[i] = src_dims[permutation[i]];
+    count *= src_dims[i];
+  }
+  std::vector<int64_t> dst_index(num_dims);
+  for (int64_t offset = 0; offset < count; ++offset) {
+    int64_t remaining = offset;
+    for (int i = static_cast<int>(num_dims) - 1; i >= 0; --i) {
+      dst_index[i] = remaining % dst_dims[i];
+      remaining /= dst_dims[i];
+    }
+    int64_t src_offset = 0;
+    for (size_t i = 0; i < num_dims; ++i) {
+      src_offset += dst_index[i] * src_strides[permutation[i]];
+    }
+    dst[offset] = src[src_offset];
+  }
+}
+
+template<typename T>
+void TestPermute(DataType data_type, const std::vector<int64_t>& src_dims,
+                 const std::vector<int>& permutation) {
+  int64_t count = 1;
+  for (int64_t dim : src_dims) { count *= dim; }
+  std::vector<T> src(count);
+  for (int64_t i = 0; i < count; ++i) { src[i] = static_cast<T>(i % 127); }
+  std::vector<T> expected(count);
+  NaivePermute<T>(src_dims, src.data(), permutation, expected.data());
+  std::vector<T> dst(count);
+  std::unique_ptr<Permute> permute =
+      NewPrimitive<PermuteFactory>(DeviceType::kCPU, src_dims.size());
+  ASSERT_TRUE(permute);
+  permute->Launch(nullptr, data_type, src_dims.size(), src_dims.data(), src.data(),
+                  permutation.data(), dst.data());
+  ASSERT_EQ(dst, expected);
+}
+
+void TestAllDataTypes(const std::vector<int64_t>& src_dims, const std::vector<int>& permutation) {
+  TestPermute<int8_t>(DataType::kInt8, src_dims, permutation);
+  TestPermute<float>(DataType::kFloat, src_dims, permutation);
+  TestPermute<double>(DataType::kDouble, src_dims, permutation);
+}
+
+}  // namespace
+
+TEST(Permute, transpose_2d) {
+  TestAllDataTypes({1, 1}, {1, 0});
+  TestAllDataTypes({7, 5}, {1, 0});
+  TestAllDataTypes({64, 32}, {1, 0});
+  TestAllDataTypes({67, 131}, {1, 0});
+}
+
+TEST(Permute, batch_transpose) {
+  // NCHW to NHWC and back.
+  TestAllDataTypes({2, 3, 17, 19}, {0, 2, 3, 1});
+  TestAllDataTypes({2, 19, 17, 3}, {0, 3, 1, 2});
+  // Attention heads.
+  TestAllDataTypes({2, 33, 4, 5}, {0, 2, 1, 3});
+  TestAllDataTypes({2, 4, 33, 5}, {0, 2, 3, 1});
+}
+
+TEST(Permute, random_permutations) {
+  std::mt19937 rng(0);
+  for (int iter = 0; iter < 200; ++iter) {
+    const size_t num_dims = 1 + rng() % 6;
+    std::vector<int64_t> src_dims(num_dims);
+    for (size_t i = 0; i < num_dims; ++i) { src_dims[i] = 1 + rng() % 7; }
+    std::vector<int> permutation(num_dims);
+    for (size_t i = 0; i < num_dims; ++i) { permutation[i] = i; }
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+    TestAllDataTypes(src_dims, permutation);
+  }
+}
+
+TEST(Permute, thread_pool) {
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(4); }
+  // Large enough to be split between the threads of the pool.
+  TestAllDataTypes({517, 301}, {1, 0});
+  TestAllDataTypes({3, 61, 43, 47}, {0, 2, 3, 1});
+  TestAllDataTypes({3, 47, 61, 43}, {0, 3, 1, 2});
+  TestAllDataTypes({5, 67, 3, 331}, {0, 2, 1, 3});
+  TestAllDataTypes({2, 100003}, {0, 1});
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(Permute, DISABLED_benchmark) {
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(std::thread::hardware_concurrency()); }
+  const std::vector<std::pair<std::vector<int64_t>, std::vector<int>>> cases = {
+      {{2048, 2048}, {1, 0}},
+      {{32, 64, 56, 56}, {0, 2, 3, 1}},
+      {{32, 56, 56, 64}, {0, 3, 1, 2}},
+      {{16, 128, 12, 64}, {0, 2, 1, 3}},
+      {{16, 12, 128, 64}, {0, 1, 3, 2}},
+  };
+  std::unique_ptr<Permute> permute = NewPrimitive<PermuteFactory>(DeviceType::kCPU, 4);
+  for (const auto& pair : cases) {
+    const std::vector<int64_t>& src_dims = pair.first;
+    const std::vector<int>& permutation = pair.second;
+    int64_t count = 1;
+    for (int64_t dim : src_dims) { count *= dim; }
+    std::vector<float> src(count);
+    for (int64_t i = 0; i < count; ++i) { src[i] = static_cast<float>(i); }
+    std::vector<float> expected(count);
+    std::vector<float> dst(count);
+    const auto Time = [](const std::function<void()>& Run) {
+      Run();
+      const auto start = std::chrono::steady_clock::now();
+      const int repeat = 5;
+      for (int i = 0; i < repeat; ++i) { Run(); }
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                 .count()
+             / repeat;
+    };
+    const double naive_ms =
+        Time([&]() { NaivePermute<float>(src_dims, src.data(), permutation, expected.data()); });
+    const double ms = Time([&]() {
+      permute->Launch(nullptr, DataType::kFloat, src_dims.size(), src_dims.data(), src.data(),
+                      permutation.data(), dst.data());
+    });
+    std::cout << "permute " << count << " floats: " << naive_ms << " ms per element indexing, "
+              << ms << " ms tiled" << std::endl;
+    ASSERT_EQ(dst, expected);
+  }
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+}  // namespace primitive
+
+}  // namespace oneflow
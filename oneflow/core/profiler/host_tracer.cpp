@@ -0,0 +1,228 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/host_tracer.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace internal {
+
+std::atomic<bool> host_trace_enabled(false);
+
+}  // namespace internal
+
+namespace {
+
+constexpr int64_t kEventChunkSize = 1024;
+
+struct EventChunk {
+  EventChunk() : size(0), next(nullptr) {}
+  HostTraceEvent events[kEventChunkSize];
+  std::atomic<int64_t> size;
+  std::atomic<EventChunk*> next;
+};
+
+// Events one thread recorded in one trace session. Only the owner thread appends, the dumper reads
+// the published part concurrently.
+class ThreadEventBuffer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ThreadEventBuffer);
+  explicit ThreadEventBuffer(int64_t tid) : tid_(tid), head_(new EventChunk()), tail_(head_) {}
+  ~ThreadEventBuffer() {
+    EventChunk* chunk = head_;
+    while (chunk != nullptr) {
+      EventChunk* next = chunk->next.load(std::memory_order_relaxed);
+      delete chunk;
+      chunk = next;
+    }
+  }
+
+  int64_t tid() const { return tid_; }
+
+  void Append(HostTraceEvent&& event) {
+    int64_t size = tail_->size.load(std::memory_order_relaxed);
+    if (size == kEventChunkSize) {
+      EventChunk* chunk = new EventChunk();
+      tail_->next.store(chunk, std::memory_order_release);
+      tail_ = chunk;
+      size = 0;
+    }
+    tail_->events[size] = std::move(event);
+    tail_->size.store(size + 1, std::memory_order_release);
+  }
+
+  void ForEach(const std::function<void(const HostTraceEvent&)>& Handler) const {
+    for (const EventChunk* chunk = head_; chunk != nullptr;
+         chunk = chunk->next.load(std::memory_order_acquire)) {
+      const int64_t size = chunk->size.load(std::memory_order_acquire);
+      for (int64_t i = 0; i < size; ++i) { Handler(chunk->events[i]); }
+    }
+  }
+
+ private:
+  int64_t tid_;
+  EventChunk* head_;
+  EventChunk* tail_;
+};
+
+struct TraceSession {
+  int64_t id;
+  int64_t start_ns;
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadEventBuffer>> buffers;
+};
+
+std::mutex session_mutex;
+std::shared_ptr<TraceSession> current_session;
+std::atomic<int64_t> current_session_id(-1);
+std::atomic<int64_t> thread_cnt(0);
+
+thread_local std::shared_ptr<ThreadEventBuffer> thread_buffer;
+thread_local int64_t thread_buffer_session_id = -1;
+thread_local int64_t thread_tid = -1;
+
+const std::string& HostTraceFileFromEnv() {
+  static const std::string file = GetStringFromEnv("ONEFLOW_PROFILER_HOST_TRACE_FILE", "");
+  return file;
+}
+
+void StartHostTraceIfEnvSet() {
+  if (!HostTraceFileFromEnv().empty()) { StartHostTrace(); }
+}
+
+COMMAND(StartHostTraceIfEnvSet());
+
+std::shared_ptr<TraceSession> GetCurrentSession() {
+  std::unique_lock<std::mutex> lock(session_mutex);
+  return current_session;
+}
+
+void WriteJsonString(std::ostream& out, const std::string& str) {
+  out << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+          << std::dec << std::setfill(' ');
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+void StartHostTrace() {
+  std::unique_lock<std::mutex> lock(session_mutex);
+  std::shared_ptr<TraceSession> session(new TraceSession());
+  session->id = current_session_id.load(std::memory_order_relaxed) + 1;
+  session->start_ns = HostTraceNowNs();
+  current_session = session;
+  current_session_id.store(session->id, std::memory_order_release);
+  internal::host_trace_enabled.store(true, std::memory_order_release);
+}
+
+void StopHostTrace() { internal::host_trace_enabled.store(false, std::memory_order_release); }
+
+int64_t HostTraceNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RecordHostTraceEvent(HostTraceEvent&& event) {
+  if (thread_buffer_session_id != current_session_id.load(std::memory_order_acquire)) {
+    std::shared_ptr<TraceSession> session = GetCurrentSession();
+    if (!session) { return; }
+    if (thread_tid < 0) { thread_tid = thread_cnt++; }
+    thread_buffer.reset(new ThreadEventBuffer(thread_tid));
+    thread_buffer_session_id = session->id;
+    std::unique_lock<std::mutex> lock(session->mutex);
+    session->buffers.push_back(thread_buffer);
+  }
+  thread_buffer->Append(std::move(event));
+}
+
+Maybe<void> DumpHostTrace(const std::string& path) {
+  std::shared_ptr<TraceSession> session = GetCurrentSession();
+  CHECK_OR_RETURN(session) << "host trace has never been started";
+  std::vector<std::shared_ptr<ThreadEventBuffer>> buffers;
+  {
+    std::unique_lock<std::mutex> lock(session->mutex);
+    buffers = session->buffers;
+  }
+  std::ofstream out(path);
+  CHECK_OR_RETURN(out.is_open()) << path << ": " << strerror(errno);
+  const int64_t pid = getpid();
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  out << std::fixed << std::setprecision(3);
+  for (const auto& buffer : buffers) {
+    buffer->ForEach([&](const HostTraceEvent& event) {
+      if (!first) { out << ","; }
+      first = false;
+      out << "\n{\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid() << ",\"cat\":";
+      WriteJsonString(out, event.category);
+      out << ",\"name\":";
+      WriteJsonString(out, event.name);
+      out << ",\"ts\":" << (event.begin_ns - session->start_ns) / 1000.0
+          << ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000.0 << ",\"args\":{";
+      out << "\"op_type\":";
+      WriteJsonString(out, event.op_type);
+      out << ",\"shapes\":";
+      WriteJsonString(out, event.shapes);
+      out << ",\"bytes\":" << event.bytes << "}}";
+    });
+  }
+  out << "\n]}\n";
+  out.close();
+  CHECK_OR_RETURN(out.good()) << path << ": " << strerror(errno);
+  return Maybe<void>::Ok();
+}
+
+std::string HostTraceFile4Rank(const std::string& path, int64_t rank) {
+  const size_t dot_pos = path.find_last_of('.');
+  const size_t slash_pos = path.find_last_of('/');
+  if (dot_pos == std::string::npos || (slash_pos != std::string::npos && dot_pos < slash_pos)) {
+    return path + "." + std::to_string(rank);
+  }
+  return path.substr(0, dot_pos) + "." + std::to_string(rank) + path.substr(dot_pos);
+}
+
+Maybe<void> StopAndDumpHostTraceIfEnvSet() {
+  std::string path = HostTraceFileFromEnv();
+  if (path.empty()) { return Maybe<void>::Ok(); }
+  // Ranks would overwrite each other's dump.
+  if (GlobalProcessCtx::WorldSize() > 1) {
+    path = HostTraceFile4Rank(path, GlobalProcessCtx::Rank());
+  }
+  StopHostTrace();
+  JUST(DumpHostTrace(path));
+  LOG(INFO) << "host trace is dumped to " << path;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,100 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_HOST_TRACER_H_
+#define ONEFLOW_CORE_PROFILER_HOST_TRACER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// A finished host range, category is a string literal.
+struct HostTraceEvent {
+  const char* category;
+  std::string name;
+  std::string op_type;
+  std::string shapes;
+  int64_t bytes;
+  int64_t begin_ns;
+  int64_t end_ns;
+};
+
+namespace internal {
+
+extern std::atomic<bool> host_trace_enabled;
+
+}  // namespace internal
+
+// The host tracer records ranges of kernels, actors and vm instructions into per-thread buffers
+// and dumps them as Chrome trace json, which chrome://tracing and Perfetto open. Tracing starts at
+// launch and is dumped at exit when ONEFLOW_PROFILER_HOST_TRACE_FILE is set.
+inline bool IsHostTraceEnabled() {
+  return internal::host_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// Drops the events recorded so far and starts recording.
+void StartHostTrace();
+
+void StopHostTrace();
+
+// Writes the events recorded since the last StartHostTrace, tracing may still be going on.
+Maybe<void> DumpHostTrace(const std::string& path);
+
+// "trace.json" becomes "trace.<rank>.json", "trace" becomes "trace.<rank>".
+std::string HostTraceFile4Rank(const std::string& path, int64_t rank);
+
+// Stops tracing and dumps to ONEFLOW_PROFILER_HOST_TRACE_FILE if it is set. With several ranks,
+// each dumps to HostTraceFile4Rank of it.
+Maybe<void> StopAndDumpHostTraceIfEnvSet();
+
+int64_t HostTraceNowNs();
+
+// Lock free unless this thread records its first event since StartHostTrace.
+void RecordHostTraceEvent(HostTraceEvent&& event);
+
+class HostTraceRange final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostTraceRange);
+  // Does nothing when tracing is disabled, GetName is only called otherwise.
+  template<typename NameGetter>
+  HostTraceRange(const char* category, const NameGetter& GetName) : begin_ns_(-1) {
+    if (IsHostTraceEnabled()) {
+      event_.category = category;
+      event_.name = GetName();
+      event_.bytes = 0;
+      begin_ns_ = HostTraceNowNs();
+    }
+  }
+  ~HostTraceRange() {
+    if (begin_ns_ >= 0) {
+      event_.begin_ns = begin_ns_;
+      event_.end_ns = HostTraceNowNs();
+      RecordHostTraceEvent(std::move(event_));
+    }
+  }
+
+ private:
+  HostTraceEvent event_;
+  int64_t begin_ns_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_HOST_TRACER_H_
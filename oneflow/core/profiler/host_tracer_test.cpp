@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/host_tracer.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+int64_t CountOf(const std::string& str, const std::string& pattern) {
+  int64_t cnt = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + pattern.size())) {
+    ++cnt;
+  }
+  return cnt;
+}
+
+}  // namespace
+
+TEST(HostTracer, disabled) {
+  StopHostTrace();
+  bool name_got = false;
+  {
+    HostTraceRange range("test", [&]() {
+      name_got = true;
+      return std::string("disabled");
+    });
+  }
+  ASSERT_FALSE(name_got);
+}
+
+TEST(HostTracer, multi_thread) {
+  const int64_t thread_num = 4;
+  // More than one buffer chunk per thread.
+  const int64_t event_num = 3000;
+  StartHostTrace();
+  {
+    HostTraceRange range("test", []() { return std::string("\"quoted\"\n"); });
+  }
+  std::vector<std::thread> threads;
+  for (int64_t i = 0; i < thread_num; ++i) {
+    threads.emplace_back([event_num]() {
+      for (int64_t j = 0; j < event_num; ++j) {
+        HostTraceRange range("test", []() { return std::string("range"); });
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  StopHostTrace();
+  {
+    HostTraceRange range("test", []() { return std::string("stopped"); });
+  }
+  const std::string path = "host_tracer_test_" + std::to_string(getpid()) + ".json";
+  ASSERT_TRUE(DumpHostTrace(path).IsOk());
+  const std::string json = ReadFile(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0);
+  ASSERT_EQ(CountOf(json, "\"ph\":\"X\""), thread_num * event_num + 1);
+  ASSERT_EQ(CountOf(json, "\"name\":\"range\""), thread_num * event_num);
+  ASSERT_EQ(CountOf(json, "\"name\":\"\\\"quoted\\\"\\u000a\""), 1);
+  ASSERT_EQ(CountOf(json, "stopped"), 0);
+
+  // A new session drops the old events.
+  StartHostTrace();
+  {
+    HostTraceRange range("test", []() { return std::string("second"); });
+  }
+  StopHostTrace();
+  ASSERT_TRUE(DumpHostTrace(path).IsOk());
+  const std::string second_json = ReadFile(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(CountOf(second_json, "\"ph\":\"X\""), 1);
+  ASSERT_EQ(CountOf(second_json, "\"name\":\"second\""), 1);
+}
+
+TEST(HostTracer, file_for_rank) {
+  ASSERT_EQ(HostTraceFile4Rank("trace.json", 3), "trace.3.json");
+  ASSERT_EQ(HostTraceFile4Rank("/tmp/run.1/trace.json", 0), "/tmp/run.1/trace.0.json");
+  ASSERT_EQ(HostTraceFile4Rank("/tmp/run.1/trace", 2), "/tmp/run.1/trace.2");
+  ASSERT_EQ(HostTraceFile4Rank("trace", 1), "trace.1");
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -16,6 +16,8 @@ limitations under the License.
 
 #include "oneflow/core/profiler/kernel.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/host_tracer.h"
+#include "oneflow/core/profiler/op_stats.h"
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/device/cuda_device_context.h"
 
@@ -37,6 +39,13 @@ void Init() {
 
 COMMAND(Init());
 
+thread_local int64_t host_profile_kernel_begin_ns = -1;
+
+std::string OpTypeName4OpConf(const OperatorConf& op_conf) {
+  if (op_conf.has_user_conf()) { return op_conf.user_conf().op_type_name(); }
+  return GetMessageInPbMessage(op_conf, op_conf.op_type_case()).GetDescriptor()->name();
+}
+
 #if defined(WITH_CUDA)
 thread_local cudaEvent_t cuda_memory_bandwidth_profile_start_event = nullptr;
 thread_local cudaEvent_t cuda_memory_bandwidth_profile_end_event = nullptr;
@@ -101,6 +110,52 @@ void TraceKernelForwardDataContentEnd(KernelContext* kernel_ctx, const Kernel* k
 #endif  // WITH_CUDA
 }
 
+void HostProfileKernelForwardDataContentStart(KernelContext* kernel_ctx, const Kernel* kernel) {
+  if (IsHostTraceEnabled() || IsOpStatsEnabled()) {
+    host_profile_kernel_begin_ns = HostTraceNowNs();
+  }
+}
+
+void HostProfileKernelForwardDataContentEnd(KernelContext* kernel_ctx, const Kernel* kernel) {
+  if (host_profile_kernel_begin_ns < 0) { return; }
+  const int64_t begin_ns = host_profile_kernel_begin_ns;
+  const int64_t end_ns = HostTraceNowNs();
+  host_profile_kernel_begin_ns = -1;
+  const bool trace = IsHostTraceEnabled();
+  std::string shapes;
+  const auto BlobsBytes = [&](const PbRpf<std::string>& bns) {
+    int64_t bytes = 0;
+    for (const auto& bn : bns) {
+      const Blob* blob = kernel_ctx->BnInOp2Blob(bn);
+      if (blob == nullptr) { continue; }
+      bytes += blob->shape().elem_cnt() * GetSizeOfDataType(blob->data_type());
+      if (trace) {
+        if (!shapes.empty() && shapes.back() != ' ') { shapes += ","; }
+        shapes += blob->shape().ToString();
+      }
+    }
+    return bytes;
+  };
+  const int64_t input_bytes = BlobsBytes(kernel->op_attribute().input_bns());
+  if (trace) { shapes += " -> "; }
+  const int64_t output_bytes = BlobsBytes(kernel->op_attribute().output_bns());
+  const std::string op_type = OpTypeName4OpConf(kernel->op_conf());
+  if (IsOpStatsEnabled()) {
+    RecordOpStats(kernel->op_conf().name(), op_type, input_bytes, output_bytes, end_ns - begin_ns);
+  }
+  if (trace) {
+    HostTraceEvent event;
+    event.category = "kernel";
+    event.name = kernel->op_conf().name();
+    event.op_type = op_type;
+    event.shapes = std::move(shapes);
+    event.bytes = input_bytes + output_bytes;
+    event.begin_ns = begin_ns;
+    event.end_ns = end_ns;
+    RecordHostTraceEvent(std::move(event));
+  }
+}
+
 }  // namespace profiler
 
 }  // namespace oneflow
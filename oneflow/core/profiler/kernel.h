@@ -30,6 +30,11 @@ void TraceKernelForwardDataContentStart(KernelContext* kernel_ctx, const Kernel*
 
 void TraceKernelForwardDataContentEnd(KernelContext* kernel_ctx, const Kernel* kernel);
 
+// Records the kernel into the host trace and the op stats, see host_tracer.h and op_stats.h.
+void HostProfileKernelForwardDataContentStart(KernelContext* kernel_ctx, const Kernel* kernel);
+
+void HostProfileKernelForwardDataContentEnd(KernelContext* kernel_ctx, const Kernel* kernel);
+
 }  // namespace profiler
 
 }  // namespace oneflow
@@ -0,0 +1,172 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/op_stats.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace internal {
+
+std::atomic<bool> op_stats_enabled(false);
+
+}  // namespace internal
+
+namespace {
+
+// Durations below 2^kSubBucketBits ns have a bucket each, longer ones are split into
+// 2^kSubBucketBits buckets per power of two, so a percentile is off by at most 1/16.
+constexpr int64_t kSubBucketBits = 3;
+constexpr int64_t kSubBucketNum = 1 << kSubBucketBits;
+constexpr int64_t kMaxDurationBits = 50;
+constexpr int64_t kBucketNum = (kMaxDurationBits - kSubBucketBits + 1) * kSubBucketNum;
+
+int64_t Bucket4Duration(int64_t ns) {
+  ns = std::min<int64_t>(std::max<int64_t>(ns, 0), (int64_t(1) << kMaxDurationBits) - 1);
+  if (ns < kSubBucketNum) { return ns; }
+  const int64_t high_bit = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+  const int64_t shift = high_bit - kSubBucketBits;
+  return (shift + 1) * kSubBucketNum + ((ns >> shift) & (kSubBucketNum - 1));
+}
+
+// The middle of the durations falling into bucket.
+int64_t Duration4Bucket(int64_t bucket) {
+  if (bucket < kSubBucketNum) { return bucket; }
+  const int64_t shift = bucket / kSubBucketNum - 1;
+  const int64_t lower = (kSubBucketNum + bucket % kSubBucketNum) << shift;
+  return lower + (int64_t(1) << shift) / 2;
+}
+
+struct OpStatsEntry {
+  OpStatsEntry() : count(0), total_ns(0), input_bytes(0), output_bytes(0), histogram(kBucketNum) {}
+
+  void Merge(const OpStatsEntry& other) {
+    count += other.count;
+    total_ns += other.total_ns;
+    input_bytes += other.input_bytes;
+    output_bytes += other.output_bytes;
+    for (int64_t i = 0; i < kBucketNum; ++i) { histogram[i] += other.histogram[i]; }
+  }
+
+  int64_t Percentile(double p) const {
+    const int64_t rank = std::max<int64_t>(static_cast<int64_t>(p * count + 0.5), 1);
+    int64_t seen = 0;
+    for (int64_t i = 0; i < kBucketNum; ++i) {
+      seen += histogram[i];
+      if (seen >= rank) { return Duration4Bucket(i); }
+    }
+    return 0;
+  }
+
+  std::string op_type;
+  int64_t count;
+  int64_t total_ns;
+  int64_t input_bytes;
+  int64_t output_bytes;
+  std::vector<int64_t> histogram;
+};
+
+// Stats recorded by one thread, the lock is only contended by queries.
+struct OpStatsShard {
+  std::mutex mutex;
+  HashMap<std::string, OpStatsEntry> op_name2entry;
+};
+
+std::mutex shards_mutex;
+std::vector<std::shared_ptr<OpStatsShard>> shards;
+
+OpStatsShard* ThreadShard() {
+  thread_local std::shared_ptr<OpStatsShard> shard;
+  if (!shard) {
+    shard.reset(new OpStatsShard());
+    std::unique_lock<std::mutex> lock(shards_mutex);
+    shards.push_back(shard);
+  }
+  return shard.get();
+}
+
+void EnableOpStatsIfEnvSet() {
+  if (ParseBooleanFromEnv("ONEFLOW_PROFILER_OP_STATS", false)) { EnableOpStats(true); }
+}
+
+COMMAND(EnableOpStatsIfEnvSet());
+
+}  // namespace
+
+void EnableOpStats(bool enabled) {
+  internal::op_stats_enabled.store(enabled, std::memory_order_release);
+}
+
+void ResetOpStats() {
+  std::unique_lock<std::mutex> lock(shards_mutex);
+  for (const auto& shard : shards) {
+    std::unique_lock<std::mutex> shard_lock(shard->mutex);
+    shard->op_name2entry.clear();
+  }
+}
+
+void RecordOpStats(const std::string& op_name, const std::string& op_type, int64_t input_bytes,
+                   int64_t output_bytes, int64_t duration_ns) {
+  OpStatsShard* shard = ThreadShard();
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  OpStatsEntry& entry = shard->op_name2entry[op_name];
+  if (entry.count == 0) { entry.op_type = op_type; }
+  entry.count += 1;
+  entry.total_ns += duration_ns;
+  entry.input_bytes += input_bytes;
+  entry.output_bytes += output_bytes;
+  entry.histogram[Bucket4Duration(duration_ns)] += 1;
+}
+
+std::vector<OpStatsSummary> GetOpStats(bool group_by_op_type) {
+  HashMap<std::string, OpStatsEntry> key2entry;
+  {
+    std::unique_lock<std::mutex> lock(shards_mutex);
+    for (const auto& shard : shards) {
+      std::unique_lock<std::mutex> shard_lock(shard->mutex);
+      for (const auto& pair : shard->op_name2entry) {
+        OpStatsEntry& entry = key2entry[group_by_op_type ? pair.second.op_type : pair.first];
+        if (entry.count == 0) { entry.op_type = pair.second.op_type; }
+        entry.Merge(pair.second);
+      }
+    }
+  }
+  std::vector<OpStatsSummary> summaries;
+  summaries.reserve(key2entry.size());
+  for (const auto& pair : key2entry) {
+    const OpStatsEntry& entry = pair.second;
+    OpStatsSummary summary;
+    summary.name = pair.first;
+    summary.op_type = entry.op_type;
+    summary.count = entry.count;
+    summary.total_ns = entry.total_ns;
+    summary.p50_ns = entry.Percentile(0.5);
+    summary.p99_ns = entry.Percentile(0.99);
+    summary.input_bytes = entry.input_bytes;
+    summary.output_bytes = entry.output_bytes;
+    summaries.push_back(summary);
+  }
+  std::sort(summaries.begin(), summaries.end(),
+            [](const OpStatsSummary& lhs, const OpStatsSummary& rhs) {
+              if (lhs.total_ns != rhs.total_ns) { return lhs.total_ns > rhs.total_ns; }
+              return lhs.name < rhs.name;
+            });
+  return summaries;
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_OP_STATS_H_
+#define ONEFLOW_CORE_PROFILER_OP_STATS_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// Aggregated host wall time of the calls to one op name or one op type. Device kernels are timed
+// from the host, so it is their launch time unless the stream synchronizes.
+struct OpStatsSummary {
+  std::string name;
+  std::string op_type;
+  int64_t count;
+  int64_t total_ns;
+  int64_t p50_ns;
+  int64_t p99_ns;
+  int64_t input_bytes;
+  int64_t output_bytes;
+};
+
+namespace internal {
+
+extern std::atomic<bool> op_stats_enabled;
+
+}  // namespace internal
+
+// Op stats are collected by the lazy kernel observer and by eager user kernels when enabled, which
+// ONEFLOW_PROFILER_OP_STATS does at launch.
+inline bool IsOpStatsEnabled() {
+  return internal::op_stats_enabled.load(std::memory_order_relaxed);
+}
+
+void EnableOpStats(bool enabled);
+
+void ResetOpStats();
+
+void RecordOpStats(const std::string& op_name, const std::string& op_type, int64_t input_bytes,
+                   int64_t output_bytes, int64_t duration_ns);
+
+// Summaries grouped by op name, or by op type in which case name is the op type too, sorted by
+// total time in descending order. Safe to call while ops are running.
+std::vector<OpStatsSummary> GetOpStats(bool group_by_op_type);
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_OP_STATS_H_
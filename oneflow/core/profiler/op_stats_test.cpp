@@ -0,0 +1,64 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/op_stats.h"
+#include <thread>
+
+namespace oneflow {
+
+namespace profiler {
+
+TEST(OpStats, aggregate) {
+  ResetOpStats();
+  const int64_t thread_num = 4;
+  std::vector<std::thread> threads;
+  for (int64_t i = 0; i < thread_num; ++i) {
+    threads.emplace_back([]() {
+      // 1us..100us for matmul_0 and 1ms for relu_0.
+      for (int64_t j = 1; j <= 100; ++j) { RecordOpStats("matmul_0", "matmul", 8, 4, j * 1000); }
+      RecordOpStats("relu_0", "relu", 2, 2, 1000000);
+      RecordOpStats("relu_1", "relu", 2, 2, 1000000);
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+
+  const std::vector<OpStatsSummary> by_name = GetOpStats(false);
+  ASSERT_EQ(by_name.size(), 3);
+  ASSERT_EQ(by_name.at(1).name, "relu_0");
+  ASSERT_EQ(by_name.at(2).name, "relu_1");
+  const OpStatsSummary& matmul = by_name.at(0);
+  ASSERT_EQ(matmul.name, "matmul_0");
+  ASSERT_EQ(matmul.op_type, "matmul");
+  ASSERT_EQ(matmul.count, thread_num * 100);
+  ASSERT_EQ(matmul.total_ns, thread_num * 5050 * 1000);
+  ASSERT_EQ(matmul.input_bytes, thread_num * 100 * 8);
+  ASSERT_EQ(matmul.output_bytes, thread_num * 100 * 4);
+  ASSERT_NEAR(matmul.p50_ns, 50000, 50000 / 16);
+  ASSERT_NEAR(matmul.p99_ns, 99000, 99000 / 16);
+
+  const std::vector<OpStatsSummary> by_type = GetOpStats(true);
+  ASSERT_EQ(by_type.size(), 2);
+  ASSERT_EQ(by_type.at(0).name, "matmul");
+  ASSERT_EQ(by_type.at(1).name, "relu");
+  ASSERT_EQ(by_type.at(1).count, thread_num * 2);
+  ASSERT_NEAR(by_type.at(1).p99_ns, 1000000, 1000000 / 16);
+
+  ResetOpStats();
+  ASSERT_TRUE(GetOpStats(false).empty());
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
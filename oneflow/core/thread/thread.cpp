@@ -28,6 +28,10 @@ Thread::Thread(const StreamId& stream_id) : thrd_id_(SerializeStreamIdToInt64(st
   local_msg_queue_enabled_ =
       ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", false);
   light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", false);
+  if (ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_MPSC_MAILBOX", false)) {
+    mpsc_msg_channel_.reset(new MpscChannel<ActorMsg>(
+        ParseIntegerFromEnv("ONEFLOW_THREAD_MPSC_MAILBOX_CAPACITY", 4096)));
+  }
   StreamContext* stream_ctx =
       NewObj<int, StreamContext, const StreamId&>(stream_id.device_id().device_type(), stream_id);
   stream_ctx_.reset(stream_ctx);
@@ -43,6 +47,7 @@ Thread::~Thread() {
   actor_thread_.join();
   CHECK(id2task_.empty());
   msg_channel_.Close();
+  if (mpsc_msg_channel_) { mpsc_msg_channel_->Close(); }
 }
 
 void Thread::AddTask(const TaskProto& task) {
@@ -53,7 +58,11 @@ void Thread::AddTask(const TaskProto& task) {
 void Thread::PollMsgChannel() {
   while (true) {
     if (local_msg_queue_.empty()) {
-      CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      if (mpsc_msg_channel_) {
+        CHECK_EQ(mpsc_msg_channel_->ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      } else {
+        CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      }
     }
     ActorMsg msg = std::move(local_msg_queue_.front());
     local_msg_queue_.pop();
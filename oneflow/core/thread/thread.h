@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/actor/actor_message_bus.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/mpsc_channel.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/task.pb.h"
 #include "oneflow/core/thread/thread_context.h"
@@ -35,13 +36,11 @@ class Thread {
 
   void AddTask(const TaskProto&);
 
-  Channel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
-
   inline void EnqueueActorMsg(const ActorMsg& msg) {
     if (UseLocalMsgQueue()) {
       local_msg_queue_.push(msg);
     } else {
-      msg_channel_.Send(msg);
+      SendToMsgChannel(msg);
     }
   }
 
@@ -50,7 +49,7 @@ class Thread {
     if (UseLocalMsgQueue()) {
       for (auto it = first; it != last; ++it) { local_msg_queue_.push(*it); }
     } else {
-      for (auto it = first; it != last; ++it) { msg_channel_.Send(*it); }
+      for (auto it = first; it != last; ++it) { SendToMsgChannel(*it); }
     }
   }
 
@@ -64,11 +63,20 @@ class Thread {
     return local_msg_queue_enabled_ && std::this_thread::get_id() == actor_thread_.get_id();
   }
 
+  inline void SendToMsgChannel(const ActorMsg& msg) {
+    if (mpsc_msg_channel_) {
+      mpsc_msg_channel_->Send(msg);
+    } else {
+      msg_channel_.Send(msg);
+    }
+  }
+
   HashMap<int64_t, TaskProto> id2task_;
   std::mutex id2task_mtx_;
 
   std::thread actor_thread_;
   Channel<ActorMsg> msg_channel_;
+  std::unique_ptr<MpscChannel<ActorMsg>> mpsc_msg_channel_;
   HashMap<int64_t, std::unique_ptr<ActorBase>> id2actor_ptr_;
   HashMap<int64_t, int64_t> id2job_id_;
   std::queue<ActorMsg> local_msg_queue_;
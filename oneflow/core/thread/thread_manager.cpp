@@ -26,7 +26,7 @@ namespace oneflow {
 ThreadMgr::~ThreadMgr() {
   for (auto& thread_pair : threads_) {
     ActorMsg msg = ActorMsg::BuildCommandMsg(-1, ActorCmd::kStopThread);
-    thread_pair.second->GetMsgChannelPtr()->Send(msg);
+    thread_pair.second->EnqueueActorMsg(msg);
     thread_pair.second.reset();
     LOG(INFO) << "actor thread " << thread_pair.first << " finish";
   }
@@ -48,20 +48,12 @@ void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback);
 template<typename DoEachT>
 void MultiThreadLoop(size_t num, const DoEachT& DoEach) {
   if (num == 0) { return; }
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  thread_num = std::min(num, thread_num);
-  BalancedSplitter bs(num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, DoEach] {
-      size_t start = bs.At(range_id).begin();
-      size_t end = bs.At(range_id).end();
-      FOR_RANGE(size_t, i, start, end) { DoEach(i); }
-      bc.Decrease();
-    });
-  }
-  // buzy loop wait.
-  bc.WaitUntilCntEqualZero();
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  // Several chunks per thread, so that idle threads can steal the rest of an imbalanced loop.
+  const int64_t grain = std::max<int64_t>(num / (4 * thread_pool->thread_num()), 1);
+  thread_pool->ParallelFor(0, num, grain, [&DoEach](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { DoEach(i); }
+  });
 }
 
 }  // namespace oneflow
@@ -17,28 +17,145 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+thread_local const ThreadPool* current_thread_pool = nullptr;
+thread_local int32_t current_worker_id = -1;
+
+struct ParallelForState {
+  ParallelForState() : next_chunk(0), done_chunk_cnt(0) {}
+  std::atomic<int64_t> next_chunk;
+  std::atomic<int64_t> done_chunk_cnt;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+}  // namespace
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : threads_(thread_num), work_cnt_(0), pending_work_cnt_(0), is_shutdown_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) { work_queues_.emplace_back(new WorkQueue()); }
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
+    threads_[i] = std::thread([this, i]() {
+      current_thread_pool = this;
+      current_worker_id = i;
+      WorkerLoop(i);
     });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    is_shutdown_ = true;
   }
+  idle_cond_.notify_all();
+  for (std::thread& thread : threads_) { thread.join(); }
 }
 
 void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+  // Works added from a worker of this pool stay on that worker, they are likely to touch the
+  // same data as the work which spawns them.
+  const size_t queue_idx =
+      current_thread_pool == this
+          ? current_worker_id
+          : work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_queues_.size();
+  {
+    WorkQueue* queue = work_queues_.at(queue_idx).get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->works.push_back(work);
+  }
+  pending_work_cnt_.fetch_add(1, std::memory_order_release);
+  {
+    // Pairs with the predicate check in WorkerLoop, so the notification can not get lost.
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+  }
+  idle_cond_.notify_one();
+}
+
+bool ThreadPool::TryGetWork(int32_t worker_id, std::function<void()>* work) {
+  const int32_t queue_num = work_queues_.size();
+  {
+    WorkQueue* queue = work_queues_.at(worker_id).get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!queue->works.empty()) {
+      *work = std::move(queue->works.front());
+      queue->works.pop_front();
+      return true;
+    }
+  }
+  FOR_RANGE(int32_t, i, 1, queue_num) {
+    WorkQueue* victim = work_queues_.at((worker_id + i) % queue_num).get();
+    std::unique_lock<std::mutex> lock(victim->mutex);
+    if (!victim->works.empty()) {
+      *work = std::move(victim->works.back());
+      victim->works.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  std::function<void()> work;
+  while (true) {
+    if (TryGetWork(worker_id, &work)) {
+      pending_work_cnt_.fetch_sub(1, std::memory_order_relaxed);
+      work();
+      work = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cond_.wait(lock, [this]() {
+      return pending_work_cnt_.load(std::memory_order_acquire) > 0 || is_shutdown_;
+    });
+    // Remaining works are still run on shutdown, as the former Channel based pool did.
+    if (is_shutdown_ && pending_work_cnt_.load(std::memory_order_acquire) == 0) { break; }
+  }
+}
+
+void ThreadPool::ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                             const std::function<void(int64_t begin, int64_t end)>& DoRange) {
+  if (end <= begin) { return; }
+  grain = std::max<int64_t>(grain, 1);
+  const int64_t chunk_num = (end - begin + grain - 1) / grain;
+  if (chunk_num == 1 || threads_.empty()) {
+    DoRange(begin, end);
+    return;
+  }
+  // Helpers may start after ParallelFor has returned, they only find no chunk left by then and
+  // must not touch anything but the shared state.
+  std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+  const std::function<void(int64_t, int64_t)>* do_range = &DoRange;
+  auto RunChunks = [state, begin, end, grain, chunk_num, do_range]() {
+    while (true) {
+      const int64_t chunk = state->next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunk_num) { break; }
+      const int64_t chunk_begin = begin + chunk * grain;
+      (*do_range)(chunk_begin, std::min(chunk_begin + grain, end));
+      if (state->done_chunk_cnt.fetch_add(1, std::memory_order_acq_rel) + 1 == chunk_num) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cond.notify_all();
+      }
+    }
+  };
+  const int64_t helper_num = std::min<int64_t>(thread_num(), chunk_num - 1);
+  FOR_RANGE(int64_t, i, 0, helper_num) { AddWork(RunChunks); }
+  RunChunks();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cond.wait(lock, [&state, chunk_num]() {
+    return state->done_chunk_cnt.load(std::memory_order_acquire) == chunk_num;
+  });
+}
+
+void GlobalThreadPoolParallelFor(int64_t num, int64_t grain,
+                                 const std::function<void(int64_t begin, int64_t end)>& DoRange) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr) {
+    DoRange(0, num);
+  } else {
+    thread_pool->ParallelFor(0, num, grain, DoRange);
+  }
 }
 
 }  // namespace oneflow
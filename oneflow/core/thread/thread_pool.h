@@ -16,11 +16,15 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
+#include <deque>
+#include <future>
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
 
 namespace oneflow {
 
+// Every worker owns a deque of works. A worker runs its own works in FIFO order and, when it runs
+// out of them, steals from the tail of the other workers' deques, so one slow work only delays the
+// works queued behind it until an idle worker picks them up.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -31,13 +35,52 @@ class ThreadPool final {
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
 
+  template<typename F>
+  std::future<typename std::result_of<F()>::type> Submit(F&& work);
+
+  // Calls DoRange on disjoint sub-ranges of [begin, end) holding at most `grain` indices each and
+  // returns when all of them are done. The calling thread runs sub-ranges too, so ParallelFor can
+  // be nested inside a work of the same pool.
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                   const std::function<void(int64_t begin, int64_t end)>& DoRange);
+
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> works;
+  };
+
+  bool TryGetWork(int32_t worker_id, std::function<void()>* work);
+  void WorkerLoop(int32_t worker_id);
+
+  std::vector<std::unique_ptr<WorkQueue>> work_queues_;
   std::vector<std::thread> threads_;
 
   std::atomic<size_t> work_cnt_;
+  std::atomic<int64_t> pending_work_cnt_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  bool is_shutdown_;
 };
 
+template<typename F>
+std::future<typename std::result_of<F()>::type> ThreadPool::Submit(F&& work) {
+  using ResultT = typename std::result_of<F()>::type;
+  auto task = std::make_shared<std::packaged_task<ResultT()>>(std::forward<F>(work));
+  std::future<ResultT> future = task->get_future();
+  AddWork([task]() { (*task)(); });
+  return future;
+}
+
+// Elements a parallel work of a memory bound CPU loop takes at least, smaller loops stay on the
+// calling thread.
+constexpr int64_t kCpuParallelGrainSize = 32768;
+
+// ThreadPool::ParallelFor over [0, num) on Global<ThreadPool>, or a single DoRange(0, num) on the
+// calling thread when there is no global pool, as in unit tests.
+void GlobalThreadPoolParallelFor(int64_t num, int64_t grain,
+                                 const std::function<void(int64_t begin, int64_t end)>& DoRange);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_THREAD_THREAD_POOL_H_
@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+TEST(ThreadPool, add_work) {
+  ThreadPool thread_pool(4);
+  const int work_num = 1000;
+  std::atomic<int> cnt(0);
+  BlockingCounter bc(work_num);
+  FOR_RANGE(int, i, 0, work_num) {
+    thread_pool.AddWork([&cnt, &bc]() {
+      cnt.fetch_add(1);
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(cnt.load(), work_num);
+}
+
+TEST(ThreadPool, single_thread_keeps_order) {
+  std::vector<int> visit;
+  {
+    ThreadPool thread_pool(1);
+    FOR_RANGE(int, i, 0, 100) {
+      thread_pool.AddWork([&visit, i]() { visit.push_back(i); });
+    }
+  }
+  ASSERT_EQ(visit.size(), 100);
+  FOR_RANGE(int, i, 0, 100) { ASSERT_EQ(visit.at(i), i); }
+}
+
+TEST(ThreadPool, submit) {
+  ThreadPool thread_pool(4);
+  std::vector<std::future<int64_t>> futures;
+  FOR_RANGE(int64_t, i, 0, 100) { futures.push_back(thread_pool.Submit([i]() { return i * i; })); }
+  FOR_RANGE(int64_t, i, 0, 100) { ASSERT_EQ(futures.at(i).get(), i * i); }
+}
+
+TEST(ThreadPool, slow_work_does_not_block_queue) {
+  ThreadPool thread_pool(2);
+  std::atomic<bool> release(false);
+  // The slow work and the fast works are queued round-robin on both workers, the fast works
+  // queued behind the slow one must be stolen by the other worker.
+  std::future<void> slow = thread_pool.Submit([&release]() {
+    while (!release.load()) { std::this_thread::yield(); }
+  });
+  std::vector<std::future<void>> fast;
+  FOR_RANGE(int, i, 0, 10) { fast.push_back(thread_pool.Submit([]() {})); }
+  for (auto& future : fast) { future.wait(); }
+  release.store(true);
+  slow.wait();
+}
+
+TEST(ThreadPool, parallel_for) {
+  ThreadPool thread_pool(4);
+  const int64_t num = 10007;
+  std::vector<int> visit(num, 0);
+  thread_pool.ParallelFor(0, num, 100, [&visit](int64_t begin, int64_t end) {
+    ASSERT_LE(end - begin, 100);
+    FOR_RANGE(int64_t, i, begin, end) { ++visit.at(i); }
+  });
+  FOR_RANGE(int64_t, i, 0, num) { ASSERT_EQ(visit.at(i), 1); }
+}
+
+TEST(ThreadPool, nested_parallel_for) {
+  ThreadPool thread_pool(2);
+  const int64_t num = 64;
+  std::vector<std::atomic<int>> visit(num * num);
+  for (auto& v : visit) { v.store(0); }
+  thread_pool.ParallelFor(0, num, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      thread_pool.ParallelFor(0, num, 1, [&](int64_t inner_begin, int64_t inner_end) {
+        FOR_RANGE(int64_t, j, inner_begin, inner_end) { visit.at(i * num + j).fetch_add(1); }
+      });
+    }
+  });
+  for (auto& v : visit) { ASSERT_EQ(v.load(), 1); }
+}
+
+}  // namespace oneflow
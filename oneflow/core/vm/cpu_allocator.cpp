@@ -15,18 +15,124 @@ limitations under the License.
 */
 #include <cstdlib>
 #include "oneflow/core/vm/cpu_allocator.h"
-#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+constexpr size_t CpuAllocator::kMinBlockSize;
+constexpr size_t CpuAllocator::kMaxCachedBlockSize;
+constexpr int32_t CpuAllocator::kShardNum;
+
+CpuAllocator::CpuAllocator(size_t max_cached_bytes)
+    : Allocator(),
+      max_cached_bytes_(max_cached_bytes),
+      reserved_bytes_(0),
+      in_use_bytes_(0),
+      peak_in_use_bytes_(0),
+      cached_bytes_(0) {
+  FOR_RANGE(int32_t, i, 0, kShardNum) { shards_.emplace_back(new Shard()); }
+}
+
+CpuAllocator::~CpuAllocator() { EmptyCache(); }
+
+size_t CpuAllocator::SizeClass4Size(size_t size) {
+  if (size <= kMinBlockSize) { return kMinBlockSize; }
+  // size lies in (2^msb, 2^(msb + 1)], which is cut into four classes of 2^(msb - 2) bytes.
+  const int32_t msb = 63 ^ __builtin_clzll(static_cast<uint64_t>(size - 1));
+  return RoundUp(size, static_cast<size_t>(1) << (msb - 2));
+}
+
+CpuAllocator::Shard* CpuAllocator::ShardOfCurrentThread() {
+  static thread_local size_t shard_id =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) % kShardNum;
+  return shards_.at(shard_id).get();
+}
+
+char* CpuAllocator::TryAllocateFromCache(size_t size_class) {
+  if (cached_bytes_.load(std::memory_order_relaxed) < size_class) { return nullptr; }
+  Shard* own_shard = ShardOfCurrentThread();
+  const auto& TryPop = [&](Shard* shard) -> char* {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    auto it = shard->size_class2free_blocks.find(size_class);
+    if (it == shard->size_class2free_blocks.end() || it->second.empty()) { return nullptr; }
+    char* mem_ptr = it->second.back();
+    it->second.pop_back();
+    return mem_ptr;
+  };
+  char* mem_ptr = TryPop(own_shard);
+  // Blocks are often freed by another thread than the one allocating them.
+  for (int32_t i = 0; mem_ptr == nullptr && i < kShardNum; ++i) {
+    if (shards_.at(i).get() != own_shard) { mem_ptr = TryPop(shards_.at(i).get()); }
+  }
+  if (mem_ptr != nullptr) { cached_bytes_.fetch_sub(size_class, std::memory_order_relaxed); }
+  return mem_ptr;
+}
+
+char* CpuAllocator::AllocateFromSystem(size_t size_class) {
+  char* mem_ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, size_class));
+  if (mem_ptr == nullptr) {
+    EmptyCache();
+    mem_ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, size_class));
+  }
+  CHECK_NOTNULL(mem_ptr);
+  reserved_bytes_.fetch_add(size_class, std::memory_order_relaxed);
+  return mem_ptr;
+}
+
+void CpuAllocator::DeallocateToSystem(char* mem_ptr, size_t size_class) {
+  std::free(mem_ptr);
+  reserved_bytes_.fetch_sub(size_class, std::memory_order_relaxed);
+}
+
+void CpuAllocator::UpdatePeakInUseBytes(size_t cur_in_use_bytes) {
+  size_t peak = peak_in_use_bytes_.load(std::memory_order_relaxed);
+  while (cur_in_use_bytes > peak
+         && !peak_in_use_bytes_.compare_exchange_weak(peak, cur_in_use_bytes,
+                                                      std::memory_order_relaxed)) {}
+}
+
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
-  *mem_ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, size));
+  const size_t size_class = SizeClass4Size(size);
+  char* ptr = nullptr;
+  if (size_class <= kMaxCachedBlockSize) { ptr = TryAllocateFromCache(size_class); }
+  if (ptr == nullptr) { ptr = AllocateFromSystem(size_class); }
+  UpdatePeakInUseBytes(in_use_bytes_.fetch_add(size_class, std::memory_order_relaxed)
+                       + size_class);
+  *mem_ptr = ptr;
+}
+
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+  const size_t size_class = SizeClass4Size(size);
+  in_use_bytes_.fetch_sub(size_class, std::memory_order_relaxed);
+  if (size_class <= kMaxCachedBlockSize) {
+    if (cached_bytes_.fetch_add(size_class, std::memory_order_relaxed) + size_class
+        <= max_cached_bytes_) {
+      Shard* shard = ShardOfCurrentThread();
+      std::unique_lock<std::mutex> lock(shard->mutex);
+      shard->size_class2free_blocks[size_class].push_back(mem_ptr);
+      return;
+    }
+    cached_bytes_.fetch_sub(size_class, std::memory_order_relaxed);
+  }
+  DeallocateToSystem(mem_ptr, size_class);
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::EmptyCache() {
+  for (const auto& shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    for (auto& pair : shard->size_class2free_blocks) {
+      for (char* mem_ptr : pair.second) {
+        DeallocateToSystem(mem_ptr, pair.first);
+        cached_bytes_.fetch_sub(pair.first, std::memory_order_relaxed);
+      }
+    }
+    shard->size_class2free_blocks.clear();
+  }
+}
 
-COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
+COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator(
+    ParseIntegerFromEnv("ONEFLOW_VM_CPU_ALLOCATOR_MAX_CACHED_BYTES", 4LL << 30))));
 
 }  // namespace vm
 }  // namespace oneflow
@@ -18,17 +18,65 @@ limitations under the License.
 
 #include <cstdint>
 #include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+// CpuAllocator caches freed blocks instead of returning them to the system, so that eager loops
+// which allocate the same sizes step after step stop paying for malloc and for page faulting
+// fresh memory.
+//
+// Requested sizes are rounded up to size classes, four classes per power of two (at most 25%
+// waste), and free blocks are kept per size class. The free lists are sharded by thread: a thread
+// frees into and allocates from its own shard first, and only looks at the other shards on a
+// miss, so threads rarely contend on the same mutex.
+//
+// Blocks larger than kMaxCachedBlockSize, and blocks that would push the cache over
+// max_cached_bytes_, go straight back to the system.
 class CpuAllocator final : public Allocator {
  public:
-  explicit CpuAllocator() = default;
-  ~CpuAllocator() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CpuAllocator);
+  explicit CpuAllocator(size_t max_cached_bytes);
+  ~CpuAllocator() override;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  // Returns all cached free blocks to the system.
+  void EmptyCache();
+
+  // Bytes obtained from the system and not yet returned, whether in use or cached.
+  size_t reserved_bytes() const { return reserved_bytes_.load(std::memory_order_relaxed); }
+  // Bytes of the blocks currently handed out, counted with their size class.
+  size_t in_use_bytes() const { return in_use_bytes_.load(std::memory_order_relaxed); }
+  size_t peak_in_use_bytes() const { return peak_in_use_bytes_.load(std::memory_order_relaxed); }
+  void ResetPeakInUseBytes() { peak_in_use_bytes_.store(in_use_bytes()); }
+
+  static size_t SizeClass4Size(size_t size);
+
+ private:
+  static constexpr size_t kMinBlockSize = 512;
+  static constexpr size_t kMaxCachedBlockSize = 1UL << 30;
+  static constexpr int32_t kShardNum = 16;
+
+  struct Shard {
+    std::mutex mutex;
+    HashMap<size_t, std::vector<char*>> size_class2free_blocks;
+  };
+
+  Shard* ShardOfCurrentThread();
+  char* TryAllocateFromCache(size_t size_class);
+  char* AllocateFromSystem(size_t size_class);
+  void DeallocateToSystem(char* mem_ptr, size_t size_class);
+  void UpdatePeakInUseBytes(size_t cur_in_use_bytes);
+
+  const size_t max_cached_bytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<size_t> reserved_bytes_;
+  std::atomic<size_t> in_use_bytes_;
+  std::atomic<size_t> peak_in_use_bytes_;
+  std::atomic<size_t> cached_bytes_;
 };
 
 }  // namespace vm
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cpu_allocator.h"
+
+namespace oneflow {
+namespace vm {
+
+TEST(CpuAllocator, size_class) {
+  ASSERT_EQ(CpuAllocator::SizeClass4Size(1), 512);
+  ASSERT_EQ(CpuAllocator::SizeClass4Size(512), 512);
+  ASSERT_EQ(CpuAllocator::SizeClass4Size(513), 640);
+  ASSERT_EQ(CpuAllocator::SizeClass4Size(1024), 1024);
+  ASSERT_EQ(CpuAllocator::SizeClass4Size(1025), 1280);
+  ASSERT_EQ(CpuAllocator::SizeClass4Size(3 << 20), 3 << 20);
+  ASSERT_EQ(CpuAllocator::SizeClass4Size((3 << 20) + 1), 7 << 19);
+  for (size_t size = 1; size < (1 << 20); size = size * 3 / 2 + 1) {
+    const size_t size_class = CpuAllocator::SizeClass4Size(size);
+    ASSERT_GE(size_class, size);
+    ASSERT_LE(size_class, std::max<size_t>(512, size + size / 4));
+    ASSERT_EQ(CpuAllocator::SizeClass4Size(size_class), size_class);
+  }
+}
+
+TEST(CpuAllocator, cache_and_stats) {
+  CpuAllocator allocator(1 << 20);
+  char* ptr = nullptr;
+  allocator.Allocate(&ptr, 1000);
+  ASSERT_TRUE(ptr != nullptr);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % kHostAlignSize, 0);
+  ASSERT_EQ(allocator.in_use_bytes(), 1024);
+  ASSERT_EQ(allocator.reserved_bytes(), 1024);
+  allocator.Deallocate(ptr, 1000);
+  ASSERT_EQ(allocator.in_use_bytes(), 0);
+  ASSERT_EQ(allocator.reserved_bytes(), 1024);
+  char* cached_ptr = nullptr;
+  allocator.Allocate(&cached_ptr, 1020);
+  ASSERT_EQ(cached_ptr, ptr);
+  ASSERT_EQ(allocator.reserved_bytes(), 1024);
+  char* another_ptr = nullptr;
+  allocator.Allocate(&another_ptr, 4096);
+  ASSERT_EQ(allocator.peak_in_use_bytes(), 1024 + 4096);
+  allocator.Deallocate(cached_ptr, 1020);
+  allocator.Deallocate(another_ptr, 4096);
+  ASSERT_EQ(allocator.reserved_bytes(), 1024 + 4096);
+  allocator.EmptyCache();
+  ASSERT_EQ(allocator.reserved_bytes(), 0);
+  ASSERT_EQ(allocator.peak_in_use_bytes(), 1024 + 4096);
+  allocator.ResetPeakInUseBytes();
+  ASSERT_EQ(allocator.peak_in_use_bytes(), 0);
+}
+
+TEST(CpuAllocator, max_cached_bytes) {
+  CpuAllocator allocator(4096);
+  std::vector<char*> ptrs(4, nullptr);
+  for (char*& ptr : ptrs) { allocator.Allocate(&ptr, 2048); }
+  ASSERT_EQ(allocator.reserved_bytes(), 4 * 2048);
+  for (char* ptr : ptrs) { allocator.Deallocate(ptr, 2048); }
+  ASSERT_EQ(allocator.reserved_bytes(), 4096);
+}
+
+TEST(CpuAllocator, cross_thread_deallocate) {
+  CpuAllocator allocator(1 << 20);
+  char* ptr = nullptr;
+  allocator.Allocate(&ptr, 100);
+  std::thread([&]() { allocator.Deallocate(ptr, 100); }).join();
+  char* cached_ptr = nullptr;
+  allocator.Allocate(&cached_ptr, 100);
+  ASSERT_EQ(cached_ptr, ptr);
+  allocator.Deallocate(cached_ptr, 100);
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/vm/instruction.msg.h"
 #include "oneflow/core/vm/no_arg_cb_phy_instr_operand.h"
 #include "oneflow/core/vm/vm_util.h"
+#include "oneflow/core/vm/scheduler_backoff.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/global_for.h"
@@ -85,6 +86,19 @@ void GetWorkerThreadInitializer(ObjectMsgPtr<vm::VirtualMachine> vm,
   };
 }
 
+// Off by default. Worker threads wake a waiting scheduler after each batch they run, but device
+// instructions finish without notifying it, so it notices them up to
+// ONEFLOW_VM_SCHEDULER_MAX_WAIT_US late.
+int64_t SchedulerSpinMicroseconds() {
+  static const int64_t spin_us = ParseIntegerFromEnv("ONEFLOW_VM_SCHEDULER_SPIN_US", -1);
+  return spin_us;
+}
+
+int64_t SchedulerMaxWaitMicroseconds() {
+  static const int64_t max_wait_us = ParseIntegerFromEnv("ONEFLOW_VM_SCHEDULER_MAX_WAIT_US", 200);
+  return max_wait_us;
+}
+
 }  // namespace
 
 OneflowVM::OneflowVM(const Resource& resource, int64_t this_machine_id)
@@ -94,8 +108,12 @@ OneflowVM::OneflowVM(const Resource& resource, int64_t this_machine_id)
   std::function<void(vm::ThreadCtx*)> WorkerInitializer;
   GetWorkerThreadInitializer(vm_, &WorkerInitializer);
   CHECK_JUST(ForEachThreadCtx(vm_.Mutable(), [&](vm::ThreadCtx* thread_ctx) -> Maybe<void> {
-    auto thread =
-        std::make_unique<std::thread>(&vm::ThreadCtx::LoopRun, thread_ctx, WorkerInitializer);
+    // Wakes a backing off scheduler up to release the instructions that have just run. The busy
+    // scheduler does not need it.
+    std::function<void()> AfterRun;
+    if (SchedulerSpinMicroseconds() >= 0) { AfterRun = [this]() { notifier_.Notify(); }; }
+    auto thread = std::make_unique<std::thread>(&vm::ThreadCtx::LoopRun, thread_ctx,
+                                                WorkerInitializer, AfterRun);
     worker_threads_.push_back(std::move(thread));
     return Maybe<void>::Ok();
   }));
@@ -139,6 +157,8 @@ Maybe<void> OneflowVM::Receive(vm::InstructionMsgList* instr_list) {
 void OneflowVM::Loop(const std::function<void()>& Initializer) {
   Initializer();
   auto* vm = mut_vm();
+  vm::SchedulerBackoff backoff(&notifier_, SchedulerSpinMicroseconds(),
+                              SchedulerMaxWaitMicroseconds());
   while (notifier_.WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
     // Use ThreadUnsafeEmpty to avoid acquiring mutex lock.
     // It's safe to use ThreadUnsafeEmpty here. notifier_.notified_cnt_ will be greater than zero
@@ -147,7 +167,16 @@ void OneflowVM::Loop(const std::function<void()>& Initializer) {
     // get handled in the next iteration.
     //  OneflowVM::Receive may be less effiencient if the thread safe version `vm->Empty()` used
     //  here, because OneflowVM::Loop is more likely to get the mutex lock.
-    while (!vm->ThreadUnsafeEmpty()) { vm->Schedule(); }
+    // Notifications consumed by the backoff are not lost, the pending instructions they announce
+    // are scheduled before the loop exits.
+    backoff.Reset();
+    while (!vm->ThreadUnsafeEmpty()) {
+      if (vm->Schedule()) {
+        backoff.Reset();
+      } else {
+        backoff.Idle();
+      }
+    }
   }
   while (!vm->Empty()) { vm->Schedule(); }
   CHECK_JUST(ForEachThreadCtx(vm_.Mutable(), [&](vm::ThreadCtx* thread_ctx) -> Maybe<void> {
@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/scheduler_backoff.h"
+
+namespace oneflow {
+namespace vm {
+
+SchedulerBackoff::SchedulerBackoff(Notifier* notifier, int64_t spin_us, int64_t max_wait_us)
+    : notifier_(notifier), spin_us_(spin_us), max_wait_us_(std::max<int64_t>(max_wait_us, 1)) {
+  Reset();
+}
+
+void SchedulerBackoff::Reset() {
+  idle_ = false;
+  wait_us_ = 1;
+}
+
+void SchedulerBackoff::Idle() {
+  if (spin_us_ < 0) { return; }
+  const auto now = std::chrono::steady_clock::now();
+  if (!idle_) {
+    idle_ = true;
+    idle_begin_ = now;
+    return;
+  }
+  if (now - idle_begin_ < std::chrono::microseconds(spin_us_)) { return; }
+  if (notifier_->TimedWaitAndClearNotifiedCnt(wait_us_) == kNotifierStatusTimeout) {
+    wait_us_ = std::min(wait_us_ * 2, max_wait_us_);
+  }
+}
+
+}  // namespace vm
+}  // namespace oneflow
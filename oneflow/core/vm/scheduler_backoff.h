@@ -0,0 +1,53 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_SCHEDULER_BACKOFF_H_
+#define ONEFLOW_CORE_VM_SCHEDULER_BACKOFF_H_
+
+#include <chrono>
+#include "oneflow/core/common/notifier.h"
+
+namespace oneflow {
+namespace vm {
+
+// Once the scheduler makes no progress, it keeps spinning for spin_us since small instructions
+// usually finish by then. Then it waits to be notified by Receive or by a worker thread, with a
+// timeout doubling up to max_wait_us, because device instructions finish without notifying. A
+// negative spin_us keeps it spinning.
+class SchedulerBackoff final {
+ public:
+  SchedulerBackoff(const SchedulerBackoff&) = delete;
+  SchedulerBackoff(SchedulerBackoff&&) = delete;
+  SchedulerBackoff(Notifier* notifier, int64_t spin_us, int64_t max_wait_us);
+  ~SchedulerBackoff() = default;
+
+  // Called whenever the scheduler makes progress.
+  void Reset();
+  // Called whenever the scheduler makes no progress.
+  void Idle();
+
+ private:
+  Notifier* notifier_;
+  const int64_t spin_us_;
+  const int64_t max_wait_us_;
+  bool idle_;
+  std::chrono::steady_clock::time_point idle_begin_;
+  int64_t wait_us_;
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_SCHEDULER_BACKOFF_H_
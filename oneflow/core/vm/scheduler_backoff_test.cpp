@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/scheduler_backoff.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+int64_t IdleMicroseconds(SchedulerBackoff* backoff) {
+  const auto begin = std::chrono::steady_clock::now();
+  backoff->Idle();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+}
+
+}  // namespace
+
+TEST(SchedulerBackoff, backs_off) {
+  Notifier notifier;
+  SchedulerBackoff backoff(&notifier, 0, 8000);
+  // Starts idling, then waits 1us, 2us, ..., 4096us and 8000us twice without a notification.
+  ASSERT_LT(IdleMicroseconds(&backoff), 8000);
+  int64_t wait_us = 0;
+  FOR_RANGE(int32_t, i, 0, 15) { wait_us += IdleMicroseconds(&backoff); }
+  ASSERT_GE(wait_us, 8191 + 2 * 8000);
+}
+
+TEST(SchedulerBackoff, spins_with_negative_spin_time) {
+  Notifier notifier;
+  SchedulerBackoff backoff(&notifier, -1, 8000);
+  int64_t wait_us = 0;
+  FOR_RANGE(int32_t, i, 0, 16) { wait_us += IdleMicroseconds(&backoff); }
+  ASSERT_LT(wait_us, 8000);
+}
+
+TEST(SchedulerBackoff, wakes_up_on_notify) {
+  Notifier notifier;
+  SchedulerBackoff backoff(&notifier, 0, 10 * 1000 * 1000);
+  // Backs off until the next wait is at least 400ms.
+  while (IdleMicroseconds(&backoff) < 200 * 1000) {}
+  std::thread notify_thread([&notifier]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    notifier.Notify();
+  });
+  ASSERT_LT(IdleMicroseconds(&backoff), 300 * 1000);
+  notify_thread.join();
+  // Progress starts the backoff over.
+  backoff.Reset();
+  ASSERT_LT(IdleMicroseconds(&backoff) + IdleMicroseconds(&backoff), 100 * 1000);
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/vm/instruction.msg.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/object_msg/object_msg.h"
+#include "oneflow/core/profiler/host_tracer.h"
 
 namespace oneflow {
 namespace vm {
@@ -57,6 +58,8 @@ void StreamType::DeleteInstructionStatusIf(const Stream& stream,
 void StreamType::Run(Instruction* instruction) const {
   const auto& stream_type_id = instruction->stream().stream_id().stream_type_id();
   auto interpret_type = stream_type_id.interpret_type();
+  profiler::HostTraceRange trace_range(
+      "instruction", [&]() { return instruction->instr_msg().instr_type_name(); });
   if (interpret_type == InterpretType::kCompute) {
     Compute(instruction);
   } else if (interpret_type == InterpretType::kInfer) {
@@ -68,6 +71,8 @@ void StreamType::Run(Instruction* instruction) const {
 
 void StreamType::Run(VirtualMachine* vm, InstructionMsg* instr_msg) const {
   InterpretType interpret_type = instr_msg->instr_type_id().stream_type_id().interpret_type();
+  profiler::HostTraceRange trace_range("instruction",
+                                       [&]() { return instr_msg->instr_type_name(); });
   if (interpret_type == InterpretType::kCompute) {
     Compute(vm, instr_msg);
   } else if (interpret_type == InterpretType::kInfer) {
@@ -79,6 +84,8 @@ void StreamType::Run(VirtualMachine* vm, InstructionMsg* instr_msg) const {
 
 void StreamType::Run(VirtualMachine* vm, Instruction* instruction) const {
   auto interpret_type = instruction->stream().stream_id().stream_type_id().interpret_type();
+  profiler::HostTraceRange trace_range(
+      "instruction", [&]() { return instruction->instr_msg().instr_type_name(); });
   if (interpret_type == InterpretType::kCompute) {
     Compute(vm, instruction);
   } else if (interpret_type == InterpretType::kInfer) {
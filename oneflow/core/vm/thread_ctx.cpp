@@ -19,9 +19,12 @@ limitations under the License.
 namespace oneflow {
 namespace vm {
 
-void ThreadCtx::LoopRun(const std::function<void(ThreadCtx*)>& Initializer) {
+void ThreadCtx::LoopRun(const std::function<void(ThreadCtx*)>& Initializer,
+                        const std::function<void()>& AfterRun) {
   Initializer(this);
-  while (ReceiveAndRun() == kObjectMsgConditionListStatusSuccess) {}
+  while (ReceiveAndRun() == kObjectMsgConditionListStatusSuccess) {
+    if (AfterRun) { AfterRun(); }
+  }
 }
 
 ObjectMsgConditionListStatus ThreadCtx::ReceiveAndRun() {
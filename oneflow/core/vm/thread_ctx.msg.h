@@ -29,7 +29,9 @@ OBJECT_MSG_BEGIN(ThreadCtx);
   OF_PUBLIC void __Init__(const StreamRtDesc& stream_rt_desc) {
     set_stream_rt_desc(&stream_rt_desc);
   }
-  OF_PUBLIC void LoopRun(const std::function<void(ThreadCtx*)>& Initializer);
+  // AfterRun, unless empty, is called after each batch of pending instructions has run.
+  OF_PUBLIC void LoopRun(const std::function<void(ThreadCtx*)>& Initializer,
+                         const std::function<void()>& AfterRun);
   // fields
   OBJECT_MSG_DEFINE_PTR(const StreamRtDesc, stream_rt_desc); 
 
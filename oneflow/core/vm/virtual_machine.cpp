@@ -658,15 +658,20 @@ void VirtualMachine::TryDeleteLogicalObjects() {
   }
 }
 
-void VirtualMachine::Schedule() {
+bool VirtualMachine::Schedule() {
   ReadyInstructionList* ready_instruction_list = mut_ready_instruction_list();
   auto* active_stream_list = mut_active_stream_list();
+  const size_t running_instruction_cnt = vm_stat_running_instruction_list().size();
   OBJECT_MSG_LIST_FOR_EACH_PTR(active_stream_list, stream) {
     TryReleaseFinishedInstructions(stream, /*out*/ ready_instruction_list);
     if (stream->running_instruction_list().empty()) { active_stream_list->Erase(stream); }
   }
+  bool progressed = vm_stat_running_instruction_list().size() != running_instruction_cnt
+                    || !delete_logical_object_list().empty();
   TryDeleteLogicalObjects();
+  const size_t front_seq_instruction_cnt = front_seq_compute_instr_list().size();
   TryRunFrontSeqInstruction(/*out*/ ready_instruction_list);
+  progressed = progressed || front_seq_compute_instr_list().size() != front_seq_instruction_cnt;
   auto* waiting_instruction_list = mut_waiting_instruction_list();
   // Use thread_unsafe_size to avoid acquiring mutex lock.
   // The inconsistency between pending_msg_list.list_head_.list_head_.container_ and
@@ -677,6 +682,7 @@ void VirtualMachine::Schedule() {
   //  `pending_msg_list().size()` used here, because VirtualMachine::Schedule is more likely to get
   //  the mutex lock.
   if (pending_msg_list().thread_unsafe_size() > 0) {
+    progressed = true;
     TmpPendingInstrMsgList tmp_pending_msg_list;
     // MoveTo is under a lock.
     mut_pending_msg_list()->MoveTo(&tmp_pending_msg_list);
@@ -687,10 +693,12 @@ void VirtualMachine::Schedule() {
     FilterReadyInstructions(&new_instruction_list, /*out*/ ready_instruction_list);
     new_instruction_list.MoveTo(waiting_instruction_list);
   }
+  progressed = progressed || !ready_instruction_list->empty();
   DispatchAndPrescheduleInstructions(ready_instruction_list);
   *mut_flying_instruction_cnt() = mut_waiting_instruction_list()->size()
                                   + mut_ready_instruction_list()->size()
                                   + mutable_vm_stat_running_instruction_list()->size();
+  return progressed;
 }
 
 bool VirtualMachine::ThreadUnsafeEmpty() const {
@@ -39,7 +39,8 @@ OBJECT_MSG_BEGIN(VirtualMachine);
   OF_PUBLIC void __Init__(const VmDesc& vm_desc);
   OF_PUBLIC Maybe<void> Receive(InstructionMsgList* instr_list);
   OF_PUBLIC Maybe<void> Receive(ObjectMsgPtr<InstructionMsg>&& instruction_msg);
-  OF_PUBLIC void Schedule();
+  // Returns false if no instruction was received, dispatched or released.
+  OF_PUBLIC bool Schedule();
   OF_PUBLIC bool ThreadUnsafeEmpty() const;
   OF_PUBLIC bool Empty() const;
   OF_PUBLIC Maybe<const ParallelDesc> GetInstructionParallelDesc(const InstructionMsg&);
@@ -63,6 +63,15 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
     // iter0 | 0, 1, 2, | 3, 4, 5, | 6, 7, 8, | 9, 0, 1, |
     // iter1 | 2, 3, 4, | 5, 6, 7, | 8, 9, 0, | 1, 2, 3, |
     LoadTargetShdPtrVec ret = base_dataset_->At(index_seq_.at(pos_));
+    Advance();
+    return ret;
+  }
+
+  // Moves on as if Next() had been called n times, without loading the samples.
+  void Skip(int64_t n) { FOR_RANGE(int64_t, i, 0, n) { Advance(); } }
+
+ private:
+  void Advance() {
     if (stride_partition_) {
       pos_ += num_shards_;
     } else {
@@ -74,10 +83,8 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
       }
     }
     CheckRanOutOfSize();
-    return ret;
   }
 
- private:
   void CheckRanOutOfSize() {
     if (pos_ >= index_seq_.size()) {
       GenNewIndexSequence();
@@ -0,0 +1,95 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/distributed_training_dataset.h"
+
+namespace oneflow {
+namespace data {
+
+namespace test {
+
+namespace {
+
+class IndexDataset final : public RandomAccessDataset<int64_t> {
+ public:
+  explicit IndexDataset(size_t size) : size_(size) {}
+  ~IndexDataset() override = default;
+
+  LoadTargetShdPtrVec At(int64_t index) const override {
+    return {std::make_shared<int64_t>(index)};
+  }
+  size_t Size() const override { return size_; }
+
+ private:
+  size_t size_;
+};
+
+std::unique_ptr<DistributedTrainingDataset<int64_t>> NewDataset(int64_t parallel_num,
+                                                                int64_t parallel_id,
+                                                                bool stride_partition,
+                                                                bool shuffle) {
+  return std::make_unique<DistributedTrainingDataset<int64_t>>(
+      parallel_num, parallel_id, stride_partition, shuffle, 1234,
+      std::make_unique<IndexDataset>(10));
+}
+
+std::vector<int64_t> NextSamples(DistributedTrainingDataset<int64_t>* dataset, int64_t n) {
+  std::vector<int64_t> ret;
+  FOR_RANGE(int64_t, i, 0, n) { ret.push_back(*dataset->Next().front()); }
+  return ret;
+}
+
+}  // namespace
+
+TEST(DistributedTrainingDataset, skip) {
+  for (int64_t parallel_num : {1, 3}) {
+    for (bool stride_partition : {true, false}) {
+      for (bool shuffle : {false, true}) {
+        // Also past several epochs of 10 samples.
+        for (int64_t skip_num : {0, 1, 4, 11, 37}) {
+          FOR_RANGE(int64_t, parallel_id, 0, parallel_num) {
+            auto skipped = NewDataset(parallel_num, parallel_id, stride_partition, shuffle);
+            skipped->Skip(skip_num);
+            auto loaded = NewDataset(parallel_num, parallel_id, stride_partition, shuffle);
+            NextSamples(loaded.get(), skip_num);
+            ASSERT_EQ(NextSamples(skipped.get(), 25), NextSamples(loaded.get(), 25));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(DistributedTrainingDataset, ranks_draw_disjoint_samples) {
+  for (bool shuffle : {false, true}) {
+    // 12 samples over 3 ranks, 4 per rank and epoch.
+    std::vector<int64_t> samples;
+    FOR_RANGE(int64_t, parallel_id, 0, 3) {
+      auto dataset = std::make_unique<DistributedTrainingDataset<int64_t>>(
+          3, parallel_id, true, shuffle, 1234, std::make_unique<IndexDataset>(12));
+      const std::vector<int64_t> rank_samples = NextSamples(dataset.get(), 4);
+      samples.insert(samples.end(), rank_samples.cbegin(), rank_samples.cend());
+    }
+    std::sort(samples.begin(), samples.end());
+    std::vector<int64_t> expected(12);
+    std::iota(expected.begin(), expected.end(), 0);
+    ASSERT_EQ(samples, expected);
+  }
+}
+
+}  // namespace test
+
+}  // namespace data
+}  // namespace oneflow
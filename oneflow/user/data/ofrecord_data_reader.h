@@ -18,6 +18,8 @@ limitations under the License.
 
 #include "oneflow/user/data/data_reader.h"
 #include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/user/data/ofrecord_indexed_dataset.h"
+#include "oneflow/user/data/distributed_training_dataset.h"
 #include "oneflow/user/data/ofrecord_parser.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
@@ -29,10 +31,32 @@ namespace data {
 class OFRecordDataReader final : public DataReader<TensorBuffer> {
  public:
   OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
-    loader_.reset(new OFRecordDataset(ctx));
     parser_.reset(new OFRecordParser());
-    if (ctx->Attr<bool>("random_shuffle")) {
-      loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+    if (ParseBooleanFromEnv("ONEFLOW_DATA_OFRECORD_INDEXED", false)) {
+      // All ranks index all part files and take every parallel_num-th record of one global
+      // order, shuffled on the index when asked, so they draw disjoint samples. The seed has to be
+      // the same on all ranks.
+      int32_t parallel_id = 0;
+      int32_t parallel_num = 0;
+      GetOFRecordParallelIdAndNum(ctx, &parallel_id, &parallel_num);
+      const bool shuffle =
+          ctx->Attr<bool>("random_shuffle") || ctx->Attr<bool>("shuffle_after_epoch");
+      int64_t seed = ctx->Attr<int64_t>("seed");
+      if (seed == -1) { seed = kOneflowDatasetSeed; }
+      std::unique_ptr<RandomAccessDataset<TensorBuffer>> indexed_dataset(
+          new OFRecordIndexedDataset(OFRecordDataFilePaths(ctx)));
+      std::unique_ptr<DistributedTrainingDataset<TensorBuffer>> dataset(
+          new DistributedTrainingDataset<TensorBuffer>(parallel_num, parallel_id, true, shuffle,
+                                                       seed, std::move(indexed_dataset)));
+      // Samples this rank has consumed before a restart.
+      dataset->Skip(ParseIntegerFromEnv("ONEFLOW_DATA_OFRECORD_SKIP_SAMPLE_NUM", 0));
+      loader_ = std::move(dataset);
+    } else {
+      if (ctx->Attr<bool>("random_shuffle")) {
+        loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, NewOFRecordDatasetShards(ctx)));
+      } else {
+        loader_.reset(new OFRecordDataset(ctx));
+      }
     }
     int32_t batch_size = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     loader_.reset(new BatchDataset<TensorBuffer>(batch_size, std::move(loader_)));
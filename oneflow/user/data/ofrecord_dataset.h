@@ -28,76 +28,203 @@ limitations under the License.
 namespace oneflow {
 namespace data {
 
+static const int64_t kDefaultOFRecordReadaheadByteSize = 256LL * 1024 * 1024;
+
+inline std::vector<std::string> OFRecordDataFilePaths(user_op::KernelInitContext* ctx) {
+  const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
+  const std::string& data_dir = ctx->Attr<std::string>("data_dir");
+  const std::string& part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
+  const int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
+  std::vector<std::string> data_file_paths;
+  for (int i = 0; i < data_part_num; ++i) {
+    std::string num = std::to_string(i);
+    int32_t zero_count = std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
+    data_file_paths.push_back(
+        JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
+  }
+  return data_file_paths;
+}
+
+inline void GetOFRecordParallelIdAndNum(user_op::KernelInitContext* ctx, int32_t* parallel_id,
+                                        int32_t* parallel_num) {
+  bool is_local = false;
+  // NOTE(zwx): OFRecordDataset is used by OFRecordDataReader and
+  // OFRecordImageClassificationDataReader both, the latter has no attr nd_sbp,
+  // so it couldn't work in DDP for now. The If condition here could be removed when
+  // OFRecordImageClassificationDataReader had supported DDP (add attr nd_sbp)
+  // or been deprecated.
+  if (ctx->op_type_name() == "OFRecordReader") {
+    auto nd_sbp_str_vec = ctx->Attr<std::vector<std::string>>("nd_sbp");
+    // NOTE(zwx): OFRecordDataset is not consistent since attr nd_sbp is empty,
+    // we assume that it works in DDP
+    if (nd_sbp_str_vec.empty() && CHECK_JUST(GlobalMultiClientEnv())) { is_local = true; }
+  }
+  if (is_local) {
+    *parallel_id = GlobalProcessCtx::Rank();
+    *parallel_num = GlobalProcessCtx::WorldSize();
+  } else {
+    *parallel_id = ctx->parallel_ctx().parallel_id();
+    *parallel_num = ctx->parallel_ctx().parallel_num();
+  }
+}
+
+inline Range GetOFRecordLocalRange(user_op::KernelInitContext* ctx) {
+  int32_t parallel_id = 0;
+  int32_t parallel_num = 0;
+  GetOFRecordParallelIdAndNum(ctx, &parallel_id, &parallel_num);
+  const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
+  CHECK_LE(parallel_num, data_part_num);
+  return BalancedSplitter(data_part_num, parallel_num).At(parallel_id);
+}
+
+// With ONEFLOW_DATA_OFRECORD_READER_THREAD_NUM > 1 and more than one local part file, the part
+// files of this rank are dealt out to reader threads in turn, each reading its files ahead into a
+// queue of up to its share of ONEFLOW_DATA_OFRECORD_READAHEAD_BYTE_SIZE bytes. Next() takes the
+// files from the threads in the order of the local file list, so the records come in the same
+// order as from a single stream.
 class OFRecordDataset final : public Dataset<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
   OF_DISALLOW_COPY_AND_MOVE(OFRecordDataset);
-  OFRecordDataset(user_op::KernelInitContext* ctx) {
-    current_epoch_ = 0;
-    shuffle_after_epoch_ = ctx->Attr<bool>("shuffle_after_epoch");
-
-    // in stream
-    data_part_num_ = ctx->Attr<int32_t>("data_part_num");
-    std::string data_dir = ctx->Attr<std::string>("data_dir");
-    std::string part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
-    int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
-
-    for (int i = 0; i < data_part_num_; ++i) {
-      std::string num = std::to_string(i);
-      int32_t zero_count =
-          std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
-      data_file_paths_.push_back(
-          JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
+  OFRecordDataset(user_op::KernelInitContext* ctx)
+      : OFRecordDataset(OFRecordDataFilePaths(ctx), GetOFRecordLocalRange(ctx),
+                        ctx->Attr<bool>("shuffle_after_epoch"),
+                        ParseIntegerFromEnv("ONEFLOW_DATA_OFRECORD_READER_THREAD_NUM", 1),
+                        ParseIntegerFromEnv("ONEFLOW_DATA_OFRECORD_READAHEAD_BYTE_SIZE",
+                                            kDefaultOFRecordReadaheadByteSize)) {}
+  // Reads data_file_paths[range) of the part files, which are all shuffled after each epoch when
+  // shuffle_after_epoch is set.
+  OFRecordDataset(const std::vector<std::string>& data_file_paths, const Range& range,
+                  bool shuffle_after_epoch, int64_t reader_thread_num, int64_t readahead_byte_size)
+      : current_epoch_(0),
+        shuffle_after_epoch_(shuffle_after_epoch),
+        range_(range),
+        data_file_paths_(data_file_paths),
+        is_closed_(false),
+        cur_file_id_(0) {
+    CHECK_GT(range_.size(), 0);
+    reader_thread_num = std::min<int64_t>(reader_thread_num, range_.size());
+    if (reader_thread_num <= 1) {
+      std::vector<std::string> local_file_paths = GetLocalFilePaths();
+      in_stream_.reset(
+          new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
+      return;
     }
-
-    bool is_local = false;
-    // NOTE(zwx): OFRecordDataset is used by OFRecordDataReader and
-    // OFRecordImageClassificationDataReader both, the latter has no attr nd_sbp,
-    // so it couldn't work in DDP for now. The If condition here could be removed when
-    // OFRecordImageClassificationDataReader had supported DDP (add attr nd_sbp)
-    // or been deprecated.
-    if (ctx->op_type_name() == "OFRecordReader") {
-      auto nd_sbp_str_vec = ctx->Attr<std::vector<std::string>>("nd_sbp");
-      // NOTE(zwx): OFRecordDataset is not consistent since attr nd_sbp is empty,
-      // we assume that it works in DDP
-      if (nd_sbp_str_vec.empty() && CHECK_JUST(GlobalMultiClientEnv())) { is_local = true; }
+    FOR_RANGE(int64_t, i, 0, reader_thread_num) {
+      std::unique_ptr<ReaderShard> shard(new ReaderShard());
+      shard->byte_capacity = std::max<int64_t>(readahead_byte_size / reader_thread_num, 1);
+      shard->byte_size = 0;
+      shards_.push_back(std::move(shard));
     }
-    if (is_local) {
-      parallel_id_ = GlobalProcessCtx::Rank();
-      parallel_num_ = GlobalProcessCtx::WorldSize();
-    } else {
-      parallel_id_ = ctx->parallel_ctx().parallel_id();
-      parallel_num_ = ctx->parallel_ctx().parallel_num();
+    FOR_RANGE(int64_t, i, 0, reader_thread_num) {
+      reader_threads_.emplace_back([this, i]() { ReadShard(i); });
     }
-    CHECK_LE(parallel_num_, data_part_num_);
-    BalancedSplitter bs(data_part_num_, parallel_num_);
-    range_ = bs.At(parallel_id_);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
   }
-  ~OFRecordDataset() = default;
+  ~OFRecordDataset() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      is_closed_ = true;
+    }
+    cond_.notify_all();
+    for (std::thread& thread : reader_threads_) { thread.join(); }
+  }
 
   LoadTargetPtrList Next() override {
     LoadTargetPtrList ret;
-    LoadTargetPtr sample_ptr(new TensorBuffer());
-    ReadSample(*sample_ptr);
-    ret.push_back(std::move(sample_ptr));
+    if (shards_.empty()) {
+      LoadTargetPtr sample_ptr(new TensorBuffer());
+      ReadSample(*sample_ptr);
+      ret.push_back(std::move(sample_ptr));
+    } else {
+      ret.push_back(PopSample());
+    }
     return ret;
   }
 
  private:
+  // Records one reader thread has read ahead, nullptr marks the end of a file.
+  struct ReaderShard {
+    std::deque<LoadTargetPtr> samples;
+    int64_t byte_capacity;
+    int64_t byte_size;
+  };
+
   void ReadSample(TensorBuffer& tensor) {
-    int64_t OFRecord_size = -1;
-    char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
-    if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
+    if (!TryReadSample(in_stream_.get(), &tensor)) {
       ShuffleAfterEpoch();
-      CHECK_EQ(in_stream_->ReadFully(size_ptr, sizeof(int64_t)), 0);
+      CHECK(TryReadSample(in_stream_.get(), &tensor));
     }
+  }
+
+  // Returns false at the end of in_stream.
+  static bool TryReadSample(PersistentInStream* in_stream, TensorBuffer* tensor) {
+    int64_t OFRecord_size = -1;
+    char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
+    if (in_stream->ReadFully(size_ptr, sizeof(int64_t)) != 0) { return false; }
     CHECK_GT(OFRecord_size, 0);
-    tensor.Resize(Shape({OFRecord_size}), DataType::kChar);
-    CHECK_EQ(in_stream_->ReadFully(tensor.mut_data<char>(), OFRecord_size), 0);
+    tensor->Resize(Shape({OFRecord_size}), DataType::kChar);
+    CHECK_EQ(in_stream->ReadFully(tensor->mut_data<char>(), OFRecord_size), 0);
+    return true;
+  }
+
+  // Reads local part files shard_id, shard_id + shard num, ... epoch after epoch, shuffling its own
+  // copy of the file list the same way ShuffleAfterEpoch does.
+  void ReadShard(int64_t shard_id) {
+    ReaderShard* shard = shards_.at(shard_id).get();
+    std::vector<std::string> file_paths = data_file_paths_;
+    for (int32_t epoch = 0;; ++epoch) {
+      if (epoch > 0 && shuffle_after_epoch_) {
+        std::mt19937 g(kOneflowDatasetSeed + epoch);
+        std::shuffle(file_paths.begin(), file_paths.end(), g);
+      }
+      for (int64_t i = range_.begin() + shard_id; i < range_.end(); i += shards_.size()) {
+        PersistentInStream in_stream(DataFS(), file_paths.at(i), 0, false, false);
+        while (true) {
+          LoadTargetPtr sample_ptr(new TensorBuffer());
+          if (!TryReadSample(&in_stream, sample_ptr.get())) { break; }
+          if (!PushSample(shard, std::move(sample_ptr))) { return; }
+        }
+        if (!PushSample(shard, nullptr)) { return; }
+      }
+    }
+  }
+
+  // Waits for room in shard, returns false once the dataset is closed.
+  bool PushSample(ReaderShard* shard, LoadTargetPtr&& sample_ptr) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this, shard]() {
+        return is_closed_ || shard->samples.empty() || shard->byte_size < shard->byte_capacity;
+      });
+      if (is_closed_) { return false; }
+      if (sample_ptr) { shard->byte_size += sample_ptr->nbytes(); }
+      shard->samples.push_back(std::move(sample_ptr));
+    }
+    cond_.notify_all();
+    return true;
+  }
+
+  // Takes the records of local file cur_file_id_ from the shard reading it, then moves on to the
+  // next file, wrapping around to the first one at the end of an epoch.
+  LoadTargetPtr PopSample() {
+    LoadTargetPtr sample_ptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!sample_ptr) {
+        ReaderShard* shard = shards_.at(cur_file_id_ % shards_.size()).get();
+        cond_.wait(lock, [shard]() { return !shard->samples.empty(); });
+        sample_ptr = std::move(shard->samples.front());
+        shard->samples.pop_front();
+        if (sample_ptr) {
+          shard->byte_size -= sample_ptr->nbytes();
+        } else {
+          cur_file_id_ = (cur_file_id_ + 1) % range_.size();
+        }
+      }
+    }
+    cond_.notify_all();
+    return sample_ptr;
   }
 
   void ShuffleAfterEpoch() {
@@ -118,14 +245,44 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   int32_t current_epoch_;
   bool shuffle_after_epoch_;
 
-  int32_t data_part_num_;
-  int32_t parallel_id_;
-  int32_t parallel_num_;
   Range range_;
   std::vector<std::string> data_file_paths_;
   std::unique_ptr<PersistentInStream> in_stream_;
+
+  std::vector<std::unique_ptr<ReaderShard>> shards_;
+  std::vector<std::thread> reader_threads_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_closed_;
+  int64_t cur_file_id_;
 };
 
+// Splits the part files of this rank over up to ONEFLOW_DATA_SHUFFLE_LOADER_THREAD_NUM datasets,
+// one for each loader thread of a RandomShuffleDataset.
+inline std::vector<std::unique_ptr<Dataset<TensorBuffer>>> NewOFRecordDatasetShards(
+    user_op::KernelInitContext* ctx) {
+  const Range range = GetOFRecordLocalRange(ctx);
+  const int64_t shard_num = std::min<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_DATA_SHUFFLE_LOADER_THREAD_NUM", 1), range.size());
+  std::vector<std::unique_ptr<Dataset<TensorBuffer>>> ret;
+  if (shard_num <= 1) {
+    ret.emplace_back(new OFRecordDataset(ctx));
+    return ret;
+  }
+  const std::vector<std::string> data_file_paths = OFRecordDataFilePaths(ctx);
+  const BalancedSplitter bs(range.size(), shard_num);
+  FOR_RANGE(int64_t, i, 0, shard_num) {
+    const Range shard_range(range.begin() + bs.At(i).begin(), range.begin() + bs.At(i).end());
+    ret.emplace_back(new OFRecordDataset(
+        data_file_paths, shard_range, ctx->Attr<bool>("shuffle_after_epoch"),
+        ParseIntegerFromEnv("ONEFLOW_DATA_OFRECORD_READER_THREAD_NUM", 1),
+        ParseIntegerFromEnv("ONEFLOW_DATA_OFRECORD_READAHEAD_BYTE_SIZE",
+                            kDefaultOFRecordReadaheadByteSize)
+            / shard_num));
+  }
+  return ret;
+}
+
 }  // namespace data
 }  // namespace oneflow
 
@@ -0,0 +1,147 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/core/common/process_state.h"
+
+namespace oneflow {
+namespace data {
+
+namespace test {
+
+namespace {
+
+// Part files part-0, part-1, ... in the OFRecord file layout, part i holds record_nums[i] records
+// "<i>-<j>".
+class OFRecordPartFiles final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordPartFiles);
+  explicit OFRecordPartFiles(const std::vector<int64_t>& record_nums) {
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    dir_ = JoinPath(current_dir, "tmp_ofrecord_dataset_test_" + std::to_string(NewRandomSeed()));
+    LocalFS()->RecursivelyCreateDirIfNotExist(dir_);
+    FOR_RANGE(size_t, i, 0, record_nums.size()) {
+      std::vector<std::string> records;
+      FOR_RANGE(int64_t, j, 0, record_nums.at(i)) {
+        records.push_back(std::to_string(i) + "-" + std::to_string(j));
+      }
+      const std::string file_path = JoinPath(dir_, "part-" + std::to_string(i));
+      std::unique_ptr<fs::WritableFile> file;
+      LocalFS()->NewWritableFile(file_path, &file);
+      for (const std::string& record : records) {
+        const int64_t record_size = record.size();
+        file->Append(reinterpret_cast<const char*>(&record_size), sizeof(int64_t));
+        file->Append(record.data(), record.size());
+      }
+      file->Close();
+      file_paths_.push_back(file_path);
+      records_.push_back(records);
+    }
+  }
+  ~OFRecordPartFiles() { LocalFS()->RecursivelyDeleteDir(dir_); }
+
+  const std::vector<std::string>& file_paths() const { return file_paths_; }
+
+  // The records of epoch_num epochs of a single stream over file_paths()[range) without shuffle.
+  std::vector<std::string> ExpectedRecords(const Range& range, int64_t epoch_num) const {
+    std::vector<std::string> ret;
+    FOR_RANGE(int64_t, epoch, 0, epoch_num) {
+      FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+        ret.insert(ret.end(), records_.at(i).begin(), records_.at(i).end());
+      }
+    }
+    return ret;
+  }
+
+ private:
+  std::string dir_;
+  std::vector<std::string> file_paths_;
+  std::vector<std::vector<std::string>> records_;
+};
+
+std::vector<std::string> ReadRecords(const OFRecordPartFiles& part_files, const Range& range,
+                                     bool shuffle_after_epoch, int64_t reader_thread_num,
+                                     int64_t readahead_byte_size, int64_t record_num) {
+  OFRecordDataset dataset(part_files.file_paths(), range, shuffle_after_epoch, reader_thread_num,
+                          readahead_byte_size);
+  std::vector<std::string> ret;
+  FOR_RANGE(int64_t, i, 0, record_num) {
+    const auto sample_list = dataset.Next();
+    CHECK_EQ(sample_list.size(), 1);
+    ret.emplace_back(sample_list.front()->data<char>(), sample_list.front()->elem_cnt());
+  }
+  return ret;
+}
+
+// Record nums of the part files, with an empty one in the middle.
+const std::vector<int64_t> kRecordNums = {3, 7, 0, 1, 5, 2};
+const int64_t kRecordNumPerEpoch = 18;
+
+}  // namespace
+
+TEST(OFRecordDataset, threaded_reader_keeps_order) {
+  OFRecordPartFiles part_files(kRecordNums);
+  const Range range(0, kRecordNums.size());
+  const std::vector<std::string> expected = part_files.ExpectedRecords(range, 3);
+  ASSERT_EQ(ReadRecords(part_files, range, false, 1, 0, expected.size()), expected);
+  for (int64_t reader_thread_num : {2, 3, 4, 16}) {
+    // Also with room for a single record in each queue.
+    for (int64_t readahead_byte_size : {1, 1024 * 1024}) {
+      ASSERT_EQ(ReadRecords(part_files, range, false, reader_thread_num, readahead_byte_size,
+                            expected.size()),
+                expected);
+    }
+  }
+}
+
+TEST(OFRecordDataset, threaded_reader_wraps_around_local_range) {
+  OFRecordPartFiles part_files(kRecordNums);
+  const Range range(1, 5);
+  const std::vector<std::string> expected = part_files.ExpectedRecords(range, 4);
+  ASSERT_EQ(ReadRecords(part_files, range, false, 1, 0, expected.size()), expected);
+  for (int64_t reader_thread_num : {2, 3}) {
+    ASSERT_EQ(ReadRecords(part_files, range, false, reader_thread_num, 16, expected.size()),
+              expected);
+  }
+}
+
+TEST(OFRecordDataset, threaded_reader_shuffles_after_epoch) {
+  OFRecordPartFiles part_files(kRecordNums);
+  const Range range(0, kRecordNums.size());
+  const int64_t epoch_num = 4;
+  const std::vector<std::string> records =
+      ReadRecords(part_files, range, true, 1, 0, epoch_num * kRecordNumPerEpoch);
+  const std::vector<std::string> unshuffled = part_files.ExpectedRecords(range, epoch_num);
+  ASSERT_NE(records, unshuffled);
+  // Each epoch reads every record once.
+  std::vector<std::string> sorted_records(unshuffled.begin(),
+                                          unshuffled.begin() + kRecordNumPerEpoch);
+  std::sort(sorted_records.begin(), sorted_records.end());
+  FOR_RANGE(int64_t, epoch, 0, epoch_num) {
+    std::vector<std::string> epoch_records(records.begin() + epoch * kRecordNumPerEpoch,
+                                           records.begin() + (epoch + 1) * kRecordNumPerEpoch);
+    std::sort(epoch_records.begin(), epoch_records.end());
+    ASSERT_EQ(epoch_records, sorted_records);
+  }
+  for (int64_t reader_thread_num : {2, 4}) {
+    ASSERT_EQ(ReadRecords(part_files, range, true, reader_thread_num, 1, records.size()), records);
+  }
+}
+
+}  // namespace test
+
+}  // namespace data
+}  // namespace oneflow
@@ -33,9 +33,11 @@ class OFRecordImageClassificationDataReader final
  public:
   explicit OFRecordImageClassificationDataReader(user_op::KernelInitContext* ctx)
       : DataReader<ImageClassificationDataInstance>(ctx) {
-    std::unique_ptr<Dataset<TensorBuffer>> base(new OFRecordDataset(ctx));
+    std::unique_ptr<Dataset<TensorBuffer>> base;
     if (ctx->Attr<bool>("random_shuffle")) {
-      base.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(base)));
+      base.reset(new RandomShuffleDataset<TensorBuffer>(ctx, NewOFRecordDatasetShards(ctx)));
+    } else {
+      base.reset(new OFRecordDataset(ctx));
     }
     loader_.reset(new OFRecordImageClassificationDataset(ctx, std::move(base)));
     const int64_t batch_size = ctx->TensorDesc4ArgNameAndIndex("image", 0)->shape().elem_cnt();
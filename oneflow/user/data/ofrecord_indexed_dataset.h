@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_INDEXED_DATASET_H_
+#define ONEFLOW_USER_DATA_OFRECORD_INDEXED_DATASET_H_
+
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+namespace data {
+
+// The index of an OFRecord part file lives next to it as <part>.index and is written by
+// `python3 -m oneflow.utils.data.ofrecord_index`. After the 8 byte magic it holds little endian
+// int64s: the size of the part file, the record num, then the offset and length of each record
+// body.
+static const char kOFRecordIndexMagic[] = "OFRINDEX";
+static const size_t kOFRecordIndexMagicSize = 8;
+
+struct OFRecordIndexEntry {
+  int64_t offset;
+  int64_t length;
+};
+
+inline std::string OFRecordIndexPath(const std::string& part_path) {
+  return part_path + ".index";
+}
+
+// Scans part_path when it has no index.
+inline std::vector<OFRecordIndexEntry> LoadOFRecordIndex(fs::FileSystem* fs,
+                                                         const std::string& part_path) {
+  const int64_t part_size = fs->GetFileSize(part_path);
+  std::vector<OFRecordIndexEntry> entries;
+  const std::string& index_path = OFRecordIndexPath(part_path);
+  if (!fs->FileExists(index_path)) {
+    LOG(WARNING) << index_path << " not found, scanning " << part_path;
+    PersistentInStream in_stream(fs, part_path);
+    int64_t offset = 0;
+    while (true) {
+      int64_t length = -1;
+      if (in_stream.ReadFully(reinterpret_cast<char*>(&length), sizeof(int64_t)) != 0) { break; }
+      CHECK_GT(length, 0);
+      offset += sizeof(int64_t);
+      const char* body = nullptr;
+      CHECK_EQ(in_stream.ReadView(length, &body), 0);
+      entries.push_back(OFRecordIndexEntry{offset, length});
+      offset += length;
+    }
+    return entries;
+  }
+  const int64_t header_size = kOFRecordIndexMagicSize + 2 * sizeof(int64_t);
+  const int64_t index_size = fs->GetFileSize(index_path);
+  CHECK_GE(index_size, header_size) << index_path;
+  std::vector<char> index(index_size);
+  std::unique_ptr<fs::RandomAccessFile> index_file;
+  fs->NewRandomAccessFile(index_path, &index_file);
+  index_file->Read(0, index_size, index.data());
+  CHECK_EQ(std::memcmp(index.data(), kOFRecordIndexMagic, kOFRecordIndexMagicSize), 0)
+      << index_path << " is not an OFRecord index";
+  int64_t header[2];
+  std::memcpy(header, index.data() + kOFRecordIndexMagicSize, sizeof(header));
+  CHECK_EQ(header[0], part_size) << index_path << " is stale, rebuild it";
+  const int64_t record_num = header[1];
+  CHECK_EQ(index_size, header_size + record_num * sizeof(OFRecordIndexEntry)) << index_path;
+  entries.resize(record_num);
+  std::memcpy(entries.data(), index.data() + header_size, record_num * sizeof(OFRecordIndexEntry));
+  for (const OFRecordIndexEntry& entry : entries) {
+    CHECK_GT(entry.length, 0) << index_path;
+    CHECK_LE(entry.offset + entry.length, part_size) << index_path;
+  }
+  return entries;
+}
+
+// The records of all part files in order, each read with one random access.
+class OFRecordIndexedDataset final : public RandomAccessDataset<TensorBuffer> {
+ public:
+  using LoadTargetShdPtr = std::shared_ptr<TensorBuffer>;
+  using LoadTargetShdPtrVec = std::vector<LoadTargetShdPtr>;
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordIndexedDataset);
+  explicit OFRecordIndexedDataset(const std::vector<std::string>& data_file_paths) {
+    part_record_offsets_.push_back(0);
+    for (const std::string& path : data_file_paths) {
+      std::vector<OFRecordIndexEntry> entries = LoadOFRecordIndex(DataFS(), path);
+      part_record_offsets_.push_back(part_record_offsets_.back() + entries.size());
+      entries_.insert(entries_.end(), entries.begin(), entries.end());
+      std::unique_ptr<fs::RandomAccessFile> file;
+      DataFS()->NewRandomAccessFile(path, &file);
+      CHECK(file) << path;
+      part_files_.push_back(std::move(file));
+    }
+    CHECK(!entries_.empty()) << "no OFRecord found";
+  }
+  ~OFRecordIndexedDataset() = default;
+
+  LoadTargetShdPtrVec At(int64_t index) const override {
+    const OFRecordIndexEntry& entry = entries_.at(index);
+    const int64_t part_id = std::upper_bound(part_record_offsets_.begin(),
+                                             part_record_offsets_.end(), index)
+                            - part_record_offsets_.begin() - 1;
+    LoadTargetShdPtr sample(new TensorBuffer());
+    sample->Resize(Shape({entry.length}), DataType::kChar);
+    part_files_.at(part_id)->Read(entry.offset, entry.length, sample->mut_data<char>());
+    return {sample};
+  }
+
+  size_t Size() const override { return entries_.size(); }
+
+ private:
+  std::vector<std::unique_ptr<fs::RandomAccessFile>> part_files_;
+  std::vector<OFRecordIndexEntry> entries_;
+  // Index of the first record of each part, and the record num at last.
+  std::vector<int64_t> part_record_offsets_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_INDEXED_DATASET_H_
@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_indexed_dataset.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+
+namespace oneflow {
+namespace data {
+
+namespace test {
+
+namespace {
+
+void WriteFile(const std::string& file_path, const std::string& content) {
+  std::unique_ptr<fs::WritableFile> file;
+  LocalFS()->NewWritableFile(file_path, &file);
+  file->Append(content.data(), content.size());
+  file->Close();
+}
+
+std::string Int64ToBytes(int64_t val) {
+  return std::string(reinterpret_cast<const char*>(&val), sizeof(int64_t));
+}
+
+}  // namespace
+
+TEST(OFRecordIndexedDataset, read_with_and_without_index) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string dir =
+      JoinPath(current_dir, "tmp_ofrecord_indexed_dataset_test_" + std::to_string(NewRandomSeed()));
+  LocalFS()->RecursivelyCreateDirIfNotExist(dir);
+  // Part 1 is empty and part 2 has no index.
+  const std::vector<int64_t> record_nums = {3, 0, 4, 2};
+  std::vector<std::string> file_paths;
+  std::vector<std::string> expected;
+  FOR_RANGE(size_t, i, 0, record_nums.size()) {
+    std::string part;
+    std::string index_entries;
+    FOR_RANGE(int64_t, j, 0, record_nums.at(i)) {
+      const std::string record = std::to_string(i) + "-" + std::string(j + 1, 'x');
+      part += Int64ToBytes(record.size());
+      index_entries += Int64ToBytes(part.size()) + Int64ToBytes(record.size());
+      part += record;
+      expected.push_back(record);
+    }
+    const std::string file_path = JoinPath(dir, "part-" + std::to_string(i));
+    WriteFile(file_path, part);
+    if (i != 2) {
+      WriteFile(OFRecordIndexPath(file_path),
+                std::string(kOFRecordIndexMagic, kOFRecordIndexMagicSize)
+                    + Int64ToBytes(part.size()) + Int64ToBytes(record_nums.at(i))
+                    + index_entries);
+    }
+    file_paths.push_back(file_path);
+  }
+  {
+    OFRecordIndexedDataset dataset(file_paths);
+    ASSERT_EQ(dataset.Size(), expected.size());
+    // Out of order, across parts.
+    for (int64_t index : {8, 0, 5, 2, 3, 6, 1, 7, 4}) {
+      const auto sample_list = dataset.At(index);
+      ASSERT_EQ(sample_list.size(), 1);
+      ASSERT_EQ(std::string(sample_list.front()->data<char>(), sample_list.front()->elem_cnt()),
+                expected.at(index));
+    }
+  }
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+}  // namespace test
+
+}  // namespace data
+}  // namespace oneflow
@@ -23,51 +23,175 @@ limitations under the License.
 namespace oneflow {
 namespace data {
 
+template<typename LoadTarget>
+size_t ByteSizeOfSample(const LoadTarget& sample) {
+  return sizeof(LoadTarget);
+}
+
+inline size_t ByteSizeOfSample(const TensorBuffer& sample) { return sample.nbytes(); }
+
+// Each shard of the shuffle buffer is filled in the background by a thread of its own, which pulls
+// from its own upstream loader. Next() takes a random sample out of a candidate pool, which starts
+// at a quarter of `shuffle_buffer_size` and grows by one sample per call up to
+// `shuffle_buffer_size` samples, or ONEFLOW_DATA_SHUFFLE_BUFFER_BYTE_SIZE bytes when that is set.
+// The pool takes the loaded samples from the shards in turn. It only depends on the number of calls
+// and on the samples themselves, never on how far the loader threads have got, so a fixed seed
+// gives a fixed order.
 template<typename LoadTarget>
 class RandomShuffleDataset final : public Dataset<LoadTarget> {
  public:
   using LoadTargetPtr = std::shared_ptr<LoadTarget>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
-  RandomShuffleDataset(user_op::KernelInitContext* ctx,
-                       std::unique_ptr<Dataset<LoadTarget>>&& data_set)
-      : loader_(std::move(data_set)) {
+  using DatasetUnqPtr = std::unique_ptr<Dataset<LoadTarget>>;
+  RandomShuffleDataset(user_op::KernelInitContext* ctx, DatasetUnqPtr&& data_set)
+      : RandomShuffleDataset(ctx, MakeLoaders(std::move(data_set))) {}
+  // One shard for each of `loaders`.
+  RandomShuffleDataset(user_op::KernelInitContext* ctx, std::vector<DatasetUnqPtr>&& loaders)
+      : RandomShuffleDataset(ctx->Attr<int64_t>("seed"), ctx->Attr<int32_t>("shuffle_buffer_size"),
+                             ParseIntegerFromEnv("ONEFLOW_DATA_SHUFFLE_BUFFER_BYTE_SIZE", 0),
+                             std::move(loaders)) {}
+  // Non-positive `buffer_byte_size` means no limit on bytes.
+  RandomShuffleDataset(int64_t seed, int64_t buffer_size, int64_t buffer_byte_size,
+                       std::vector<DatasetUnqPtr>&& loaders)
+      : seed_(seed),
+        buffer_size_(std::max<int64_t>(buffer_size, 1)),
+        buffer_byte_size_(buffer_byte_size > 0 ? buffer_byte_size : GetMaxVal<int64_t>()),
+        initial_pool_size_(std::max<int64_t>(buffer_size_ / kInitialPoolDivisor, 1)),
+        pool_byte_size_(0),
+        pending_byte_size_(0),
+        taken_cnt_(0),
+        next_shard_id_(0),
+        waiting_shard_id_(-1),
+        is_closed_(false) {
+    CHECK(!loaders.empty());
+    shard_buffer_size_ = RoundUp(buffer_size_, loaders.size()) / loaders.size();
     // random
-    seed_ = ctx->Attr<int64_t>("seed");
     if (seed_ == -1) { seed_ = NewRandomSeed(); }
     std::seed_seq seq({seed_});
     rand_engine_ = std::default_random_engine(seq);
-
-    // fill buffer
-    initial_buffer_fill_ = ctx->Attr<int32_t>("shuffle_buffer_size");
-    int32_t remain_cnt = initial_buffer_fill_;
-    while (remain_cnt > 0) {
-      LoadTargetPtrList sample_list = loader_->Next();
-      for (auto& sample_ptr : sample_list) {
-        sample_buffer_.push_back(std::move(sample_ptr));
-        remain_cnt--;
-      }
+    for (auto& loader : loaders) {
+      std::unique_ptr<Shard> shard(new Shard());
+      shard->loader = std::move(loader);
+      shards_.push_back(std::move(shard));
+    }
+    FOR_RANGE(int64_t, i, 0, shards_.size()) {
+      shards_.at(i)->fill_thread = std::thread([this, i]() { Fill(i); });
     }
   }
-  ~RandomShuffleDataset() = default;
+  ~RandomShuffleDataset() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      is_closed_ = true;
+    }
+    cond_.notify_all();
+    for (auto& shard : shards_) { shard->fill_thread.join(); }
+  }
 
   LoadTargetPtrList Next() override {
-    LoadTargetPtrList ret = loader_->Next();
-    for (auto& sample_ptr : ret) {
-      std::uniform_int_distribution<> dis(0, sample_buffer_.size() - 1);
-      int offset = dis(rand_engine_);
-      std::swap(sample_buffer_[offset], sample_ptr);
+    LoadTargetPtrList ret;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      const int64_t pool_size = std::min<int64_t>(buffer_size_, initial_pool_size_ + taken_cnt_);
+      // A sample larger than the byte limit still gets into an empty pool.
+      while (static_cast<int64_t>(pool_.size()) < pool_size
+             && (pool_.empty() || pool_byte_size_ < buffer_byte_size_)) {
+        Shard* shard = shards_.at(next_shard_id_).get();
+        if (shard->pending.empty()) {
+          waiting_shard_id_ = next_shard_id_;
+          cond_.notify_all();
+          cond_.wait(lock, [shard]() { return !shard->pending.empty(); });
+          waiting_shard_id_ = -1;
+        }
+        const int64_t byte_size = ByteSizeOfSample(*shard->pending.front());
+        pending_byte_size_ -= byte_size;
+        pool_byte_size_ += byte_size;
+        pool_.push_back(std::move(shard->pending.front()));
+        shard->pending.pop_front();
+        next_shard_id_ = (next_shard_id_ + 1) % shards_.size();
+      }
+      std::uniform_int_distribution<size_t> dis(0, pool_.size() - 1);
+      std::swap(pool_.at(dis(rand_engine_)), pool_.back());
+      ret.push_back(std::move(pool_.back()));
+      pool_.pop_back();
+      pool_byte_size_ -= ByteSizeOfSample(*ret.front());
+      taken_cnt_ += 1;
     }
+    cond_.notify_all();
     return ret;
   }
 
  private:
-  std::unique_ptr<Dataset<LoadTarget>> loader_;
-  std::vector<LoadTargetPtr> sample_buffer_;
+  // Next() first picks among this share of the shuffle buffer, so that it does not wait for the
+  // whole buffer before returning the first sample.
+  static constexpr int64_t kInitialPoolDivisor = 4;
 
-  int32_t initial_buffer_fill_;
+  struct Shard {
+    DatasetUnqPtr loader;
+    // Samples loaded in the background, in loader order, which are not in the pool yet.
+    std::deque<LoadTargetPtr> pending;
+    std::thread fill_thread;
+  };
+
+  static std::vector<DatasetUnqPtr> MakeLoaders(DatasetUnqPtr&& data_set) {
+    std::vector<DatasetUnqPtr> loaders;
+    loaders.push_back(std::move(data_set));
+    return loaders;
+  }
+
+  int64_t PendingSize() const {
+    int64_t pending_size = 0;
+    for (const auto& shard : shards_) { pending_size += shard->pending.size(); }
+    return pending_size;
+  }
+
+  bool NeedsMore(int64_t shard_id) const {
+    // The limits never hold back a sample that Next() is waiting for.
+    if (waiting_shard_id_ == shard_id) { return true; }
+    return static_cast<int64_t>(shards_.at(shard_id)->pending.size()) < shard_buffer_size_
+           && static_cast<int64_t>(pool_.size()) + PendingSize() < buffer_size_
+           && pool_byte_size_ + pending_byte_size_ < buffer_byte_size_;
+  }
+
+  void Fill(int64_t shard_id) {
+    Shard* shard = shards_.at(shard_id).get();
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this, shard_id]() { return is_closed_ || NeedsMore(shard_id); });
+        if (is_closed_) { return; }
+      }
+      LoadTargetPtrList sample_list = shard->loader->Next();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto& sample_ptr : sample_list) {
+          pending_byte_size_ += ByteSizeOfSample(*sample_ptr);
+          shard->pending.push_back(std::move(sample_ptr));
+        }
+      }
+      cond_.notify_all();
+    }
+  }
 
-  std::default_random_engine rand_engine_;
   int64_t seed_;
+  std::default_random_engine rand_engine_;
+  const int64_t buffer_size_;
+  const int64_t buffer_byte_size_;
+  const int64_t initial_pool_size_;
+  // Samples each shard loads ahead at most.
+  int64_t shard_buffer_size_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  // Samples Next() picks from.
+  std::vector<LoadTargetPtr> pool_;
+  int64_t pool_byte_size_;
+  int64_t pending_byte_size_;
+  int64_t taken_cnt_;
+  // The shard the pool takes its next sample from.
+  int64_t next_shard_id_;
+  int64_t waiting_shard_id_;
+  bool is_closed_;
+  std::vector<std::unique_ptr<Shard>> shards_;
 };
 
 }  // namespace data
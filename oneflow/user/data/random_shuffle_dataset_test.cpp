@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/random_shuffle_dataset.h"
+
+namespace oneflow {
+namespace data {
+
+namespace test {
+
+namespace {
+
+// Yields start, start + step, start + 2 * step, ... and sleeps a random while before some of them,
+// so that the loader threads of RandomShuffleDataset run at a different pace on every run.
+class CountingDataset final : public Dataset<int64_t> {
+ public:
+  CountingDataset(int64_t start, int64_t step)
+      : cur_(start), step_(step), rand_engine_(std::random_device{}()) {}
+  ~CountingDataset() override = default;
+
+  LoadTargetPtrList Next() override {
+    if (std::uniform_int_distribution<int32_t>(0, 7)(rand_engine_) == 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(std::uniform_int_distribution<int32_t>(0, 200)(rand_engine_)));
+    }
+    LoadTargetPtrList ret;
+    ret.push_back(std::make_shared<int64_t>(cur_));
+    cur_ += step_;
+    return ret;
+  }
+
+ private:
+  int64_t cur_;
+  int64_t step_;
+  std::mt19937 rand_engine_;
+};
+
+// The shards yield 0, 1, 2, ... together, since the pool takes their samples in turn.
+std::vector<int64_t> Shuffle(int64_t seed, int64_t buffer_size, int64_t buffer_byte_size,
+                             int64_t sample_num, int64_t shard_num) {
+  std::vector<std::unique_ptr<Dataset<int64_t>>> loaders;
+  FOR_RANGE(int64_t, i, 0, shard_num) {
+    loaders.push_back(std::make_unique<CountingDataset>(i, shard_num));
+  }
+  RandomShuffleDataset<int64_t> dataset(seed, buffer_size, buffer_byte_size, std::move(loaders));
+  std::mt19937 rand_engine(std::random_device{}());
+  std::vector<int64_t> ret;
+  FOR_RANGE(int64_t, i, 0, sample_num) {
+    if (std::uniform_int_distribution<int32_t>(0, 15)(rand_engine) == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    const auto sample_list = dataset.Next();
+    CHECK_EQ(sample_list.size(), 1);
+    ret.push_back(*sample_list.front());
+  }
+  return ret;
+}
+
+}  // namespace
+
+TEST(RandomShuffleDataset, same_seed_same_order) {
+  for (int64_t shard_num : {1, 3}) {
+    const std::vector<int64_t> expected = Shuffle(1234, 64, 0, 1000, shard_num);
+    FOR_RANGE(int32_t, i, 0, 5) { ASSERT_EQ(Shuffle(1234, 64, 0, 1000, shard_num), expected); }
+    ASSERT_NE(Shuffle(4321, 64, 0, 1000, shard_num), expected);
+  }
+}
+
+TEST(RandomShuffleDataset, same_seed_same_order_with_byte_limit) {
+  // Holds at most 16 samples though the buffer size allows 64.
+  const int64_t buffer_byte_size = 16 * sizeof(int64_t);
+  for (int64_t shard_num : {1, 3}) {
+    const std::vector<int64_t> expected = Shuffle(1234, 64, buffer_byte_size, 1000, shard_num);
+    FOR_RANGE(int32_t, i, 0, 5) {
+      ASSERT_EQ(Shuffle(1234, 64, buffer_byte_size, 1000, shard_num), expected);
+    }
+    FOR_RANGE(int64_t, i, 0, expected.size()) { ASSERT_LT(expected.at(i), i + 16); }
+  }
+}
+
+TEST(RandomShuffleDataset, every_sample_once) {
+  const int64_t buffer_size = 64;
+  const int64_t sample_num = 1000;
+  for (int64_t shard_num : {1, 3, 4}) {
+    const std::vector<int64_t> samples = Shuffle(-1, buffer_size, 0, sample_num, shard_num);
+    HashSet<int64_t> seen;
+    FOR_RANGE(int64_t, i, 0, sample_num) {
+      // The i-th sample comes from the first i + buffer_size samples of the loaders.
+      ASSERT_LT(samples.at(i), i + buffer_size);
+      ASSERT_TRUE(seen.insert(samples.at(i)).second);
+    }
+    ASSERT_NE(samples, Shuffle(-1, buffer_size, 0, sample_num, shard_num));
+  }
+}
+
+}  // namespace test
+
+}  // namespace data
+}  // namespace oneflow
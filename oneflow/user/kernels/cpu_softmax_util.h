@@ -0,0 +1,223 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CPU_SOFTMAX_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CPU_SOFTMAX_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/kernel/kernel_util.cuh"
+#include "oneflow/core/thread/thread_pool.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif  // defined(__SSE2__)
+
+namespace oneflow {
+
+// Rows up to this size are read again from cache, longer ones use the online max and sum.
+constexpr int64_t kSoftmaxCacheResidentRowBytes = 64 * 1024;
+// Elements the online max and sum look at together, small enough to be read twice from L1.
+constexpr int64_t kSoftmaxChunkSize = 1024;
+// Elements handled by one parallel work.
+constexpr int64_t kSoftmaxParallelGrainSize = 16384;
+// Independent accumulators of a row reduce, they let the compiler vectorize it.
+constexpr int64_t kSoftmaxNumLanes = 8;
+
+// Row by row softmax, log-softmax and their grads on a n x w matrix. Each row is finished while it
+// is still in cache and rows are spread over Global<ThreadPool>, no temporary storage is needed.
+template<typename T>
+struct CpuSoftmaxUtil final {
+  static void Softmax(int64_t n, int64_t w, const T* in, T* prob) {
+    ParallelForRows(n, w, [&](int64_t row) {
+      const T* x = in + row * w;
+      T* y = prob + row * w;
+      T max;
+      T sum;
+      if (w * sizeof(T) <= kSoftmaxCacheResidentRowBytes) {
+        max = RowMax(x, w);
+        sum = ExpAndSum(x, w, max, y);
+      } else {
+        RowMaxAndSumExp(x, w, &max, &sum);
+        ExpAndSum(x, w, max, y);
+      }
+      const T scale = T(1) / sum;
+      for (int64_t j = 0; j < w; ++j) { y[j] *= scale; }
+    });
+  }
+
+  static void LogSoftmax(int64_t n, int64_t w, const T* in, T* prob, T* out) {
+    ParallelForRows(n, w, [&](int64_t row) {
+      const T* x = in + row * w;
+      T* y = out + row * w;
+      T* p = prob + row * w;
+      T max;
+      T sum;
+      RowMaxAndSumExp(x, w, &max, &sum);
+      const T log_sum_exp = max + SafeLog(sum);
+      for (int64_t j = 0; j < w; ++j) { y[j] = x[j] - log_sum_exp; }
+      ExpAndSum(y, w, T(0), p);
+    });
+  }
+
+  // dx = (dy - sum(dy * y)) * y
+  static void SoftmaxGrad(int64_t n, int64_t w, const T* dy, const T* out, T* dx) {
+    ParallelForRows(n, w, [&](int64_t row) {
+      const T* dy_row = dy + row * w;
+      const T* y = out + row * w;
+      T* dx_row = dx + row * w;
+      const T dot = RowSum(w, [&](int64_t j) { return dy_row[j] * y[j]; });
+      for (int64_t j = 0; j < w; ++j) { dx_row[j] = (dy_row[j] - dot) * y[j]; }
+    });
+  }
+
+  // dx = dy - sum(dy) * prob
+  static void LogSoftmaxGrad(int64_t n, int64_t w, const T* dy, const T* prob, T* dx) {
+    ParallelForRows(n, w, [&](int64_t row) {
+      const T* dy_row = dy + row * w;
+      const T* p = prob + row * w;
+      T* dx_row = dx + row * w;
+      const T sum = RowSum(w, [&](int64_t j) { return dy_row[j]; });
+      for (int64_t j = 0; j < w; ++j) { dx_row[j] = dy_row[j] - sum * p[j]; }
+    });
+  }
+
+  // Stores exp(x - shift) to y unless y is nullptr and returns its sum.
+  static T ExpAndSum(const T* x, int64_t w, T shift, T* y) {
+    return RowSum(w, [&](int64_t j) {
+      const T e = std::exp(x[j] - shift);
+      if (y != nullptr) { y[j] = e; }
+      return e;
+    });
+  }
+
+ private:
+  template<typename F>
+  static void ParallelForRows(int64_t n, int64_t w, const F& DoRow) {
+    const auto DoRange = [&](int64_t begin, int64_t end) {
+      for (int64_t row = begin; row < end; ++row) { DoRow(row); }
+    };
+    ThreadPool* thread_pool = Global<ThreadPool>::Get();
+    if (thread_pool == nullptr) {
+      DoRange(0, n);
+    } else {
+      const int64_t grain =
+          std::max<int64_t>(kSoftmaxParallelGrainSize / std::max<int64_t>(w, 1), 1);
+      thread_pool->ParallelFor(0, n, grain, DoRange);
+    }
+  }
+
+  template<typename F>
+  static T RowSum(int64_t w, const F& Get) {
+    T lanes[kSoftmaxNumLanes];
+    for (int64_t k = 0; k < kSoftmaxNumLanes; ++k) { lanes[k] = 0; }
+    int64_t j = 0;
+    for (; j + kSoftmaxNumLanes <= w; j += kSoftmaxNumLanes) {
+      for (int64_t k = 0; k < kSoftmaxNumLanes; ++k) { lanes[k] += Get(j + k); }
+    }
+    T sum = 0;
+    for (; j < w; ++j) { sum += Get(j); }
+    for (int64_t k = 0; k < kSoftmaxNumLanes; ++k) { sum += lanes[k]; }
+    return sum;
+  }
+
+  static T RowMax(const T* x, int64_t w) {
+    const T lowest = -std::numeric_limits<T>::infinity();
+    T lanes[kSoftmaxNumLanes];
+    for (int64_t k = 0; k < kSoftmaxNumLanes; ++k) { lanes[k] = lowest; }
+    int64_t j = 0;
+    for (; j + kSoftmaxNumLanes <= w; j += kSoftmaxNumLanes) {
+      for (int64_t k = 0; k < kSoftmaxNumLanes; ++k) {
+        lanes[k] = x[j + k] > lanes[k] ? x[j + k] : lanes[k];
+      }
+    }
+    T max = lowest;
+    for (; j < w; ++j) { max = x[j] > max ? x[j] : max; }
+    for (int64_t k = 0; k < kSoftmaxNumLanes; ++k) { max = lanes[k] > max ? lanes[k] : max; }
+    return max;
+  }
+
+  // One pass over x for its max and sum(exp(x - max)), the sum is rescaled whenever a chunk raises
+  // the max.
+  static void RowMaxAndSumExp(const T* x, int64_t w, T* max, T* sum) {
+    *max = -std::numeric_limits<T>::infinity();
+    *sum = 0;
+    for (int64_t begin = 0; begin < w; begin += kSoftmaxChunkSize) {
+      const T* chunk = x + begin;
+      const int64_t size = std::min<int64_t>(kSoftmaxChunkSize, w - begin);
+      const T chunk_max = RowMax(chunk, size);
+      if (chunk_max > *max) {
+        if (begin > 0) { *sum *= std::exp(*max - chunk_max); }
+        *max = chunk_max;
+      }
+      *sum += ExpAndSum(chunk, size, *max, nullptr);
+    }
+  }
+};
+
+#if defined(__SSE2__)
+
+// Cephes' expf on four lanes, within 2 ulp of std::exp. Results below FLT_MIN are flushed to zero
+// and NaN is kept. GCC leaves the scalar form unvectorized since its clamps might trap.
+inline __m128 SoftmaxExp4(__m128 x) {
+  x = _mm_min_ps(_mm_set1_ps(88.3762626647949f), _mm_max_ps(_mm_set1_ps(-88.3762626647949f), x));
+  const __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+  __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  // Truncation rounded negative values up, floor them.
+  n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), _mm_set1_ps(1.0f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+  x = _mm_add_ps(x, _mm_mul_ps(n, _mm_set1_ps(2.12194440e-4f)));
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), x), _mm_set1_ps(1.0f));
+  const __m128i bits =
+      _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(bits));
+}
+
+template<>
+inline float CpuSoftmaxUtil<float>::ExpAndSum(const float* x, int64_t w, float shift, float* y) {
+  const __m128 shift4 = _mm_set1_ps(shift);
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+  int64_t j = 0;
+  for (; j + 8 <= w; j += 8) {
+    const __m128 e0 = SoftmaxExp4(_mm_sub_ps(_mm_loadu_ps(x + j), shift4));
+    const __m128 e1 = SoftmaxExp4(_mm_sub_ps(_mm_loadu_ps(x + j + 4), shift4));
+    if (y != nullptr) {
+      _mm_storeu_ps(y + j, e0);
+      _mm_storeu_ps(y + j + 4, e1);
+    }
+    sum0 = _mm_add_ps(sum0, e0);
+    sum1 = _mm_add_ps(sum1, e1);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; j < w; ++j) {
+    const float e = std::exp(x[j] - shift);
+    if (y != nullptr) { y[j] = e; }
+    sum += e;
+  }
+  return sum;
+}
+
+#endif  // defined(__SSE2__)
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CPU_SOFTMAX_UTIL_H_
@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_interpreter/eager_elementwise_fusion.h"
+
+namespace oneflow {
+
+namespace {
+
+// Elements evaluated by every op of the program before moving to the next block, so that the
+// intermediate results of one block stay in L1.
+constexpr int64_t kBlockSize = 1024;
+
+template<typename T>
+void RunFusedElementwiseOp(int32_t opcode, int64_t n, const T* lhs, const T* rhs, T scalar,
+                           T* out) {
+  switch (opcode) {
+    case one::kFusedElementwiseAdd:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] + rhs[i]; }
+      break;
+    case one::kFusedElementwiseSub:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] - rhs[i]; }
+      break;
+    case one::kFusedElementwiseMul:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] * rhs[i]; }
+      break;
+    case one::kFusedElementwiseDiv:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] / rhs[i]; }
+      break;
+    case one::kFusedElementwiseAddScalar:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] + scalar; }
+      break;
+    case one::kFusedElementwiseMulScalar:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] * scalar; }
+      break;
+    case one::kFusedElementwiseRelu:
+      for (int64_t i = 0; i < n; ++i) { out[i] = lhs[i] > static_cast<T>(0) ? lhs[i] : 0; }
+      break;
+    default: UNIMPLEMENTED();
+  }
+}
+
+}  // namespace
+
+template<typename T>
+class EagerFusedElementwiseKernel final : public user_op::OpKernel {
+ public:
+  EagerFusedElementwiseKernel() = default;
+  ~EagerFusedElementwiseKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto& program = ctx->Attr<std::vector<int32_t>>("program");
+    const auto& scalars = ctx->Attr<std::vector<float>>("scalars");
+    const auto& output_value_ids = ctx->Attr<std::vector<int32_t>>("output_value_ids");
+    const int32_t input_num = ctx->input_size("in");
+    CHECK_EQ(program.size() % one::kFusedElementwiseOpSize, 0);
+    const int64_t op_num = program.size() / one::kFusedElementwiseOpSize;
+    const int64_t value_num = input_num + op_num;
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("in", 0)->shape().elem_cnt();
+
+    // Values that are outputs are written in place, the others live in a block of the buffer.
+    std::vector<T*> output_ptrs(value_num, nullptr);
+    FOR_RANGE(int32_t, i, 0, output_value_ids.size()) {
+      output_ptrs.at(output_value_ids.at(i)) = ctx->Tensor4ArgNameAndIndex("out", i)->mut_dptr<T>();
+    }
+    std::vector<T> buffer(op_num * kBlockSize);
+    std::vector<const T*> value_ptrs(value_num);
+    for (int64_t offset = 0; offset < elem_cnt; offset += kBlockSize) {
+      const int64_t n = std::min(kBlockSize, elem_cnt - offset);
+      FOR_RANGE(int32_t, i, 0, input_num) {
+        value_ptrs.at(i) = ctx->Tensor4ArgNameAndIndex("in", i)->dptr<T>() + offset;
+      }
+      FOR_RANGE(int64_t, i, 0, op_num) {
+        const int32_t* op = program.data() + i * one::kFusedElementwiseOpSize;
+        const int64_t value_id = input_num + i;
+        T* out = output_ptrs.at(value_id) != nullptr ? output_ptrs.at(value_id) + offset
+                                                     : buffer.data() + i * kBlockSize;
+        CHECK_LT(op[1], value_id);
+        CHECK_LT(op[2], value_id);
+        const T scalar = op[3] >= 0 ? static_cast<T>(scalars.at(op[3])) : static_cast<T>(0);
+        RunFusedElementwiseOp<T>(op[0], n, value_ptrs.at(op[1]), value_ptrs.at(op[2]), scalar, out);
+        value_ptrs.at(value_id) = out;
+      }
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_EAGER_FUSED_ELEMENTWISE_KERNEL(dtype)                     \
+  REGISTER_USER_KERNEL("eager_fused_elementwise")                          \
+      .SetCreateFn<EagerFusedElementwiseKernel<dtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == DeviceType::kCPU)       \
+                       & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_EAGER_FUSED_ELEMENTWISE_KERNEL(float)
+
+}  // namespace oneflow
@@ -14,9 +14,181 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
+namespace {
+
+// Number of independent accumulators kept per row. Every lane sees the same number of elements,
+// so the per-step update factor is shared and the lane loop is vectorized by the compiler.
+constexpr int64_t kLayerNormNumLanes = 16;
+
+// Minimal number of parameter columns handled by one thread when reducing gamma/beta diff.
+constexpr int64_t kLayerNormParamGradMinColsPerThread = 64;
+
+template<typename T>
+void WelfordCombine(T b_mean, T b_m2, int64_t b_count, T* mean, T* m2, int64_t* count) {
+  if (b_count == 0) { return; }
+  const int64_t new_count = *count + b_count;
+  const T nb_over_n = static_cast<T>(b_count) / static_cast<T>(new_count);
+  const T delta = b_mean - *mean;
+  *mean += delta * nb_over_n;
+  *m2 += b_m2 + delta * delta * static_cast<T>(*count) * nb_over_n;
+  *count = new_count;
+}
+
+template<typename T>
+void RowWelford(const T* x, const int64_t norm_size, T* mean, T* variance) {
+  T lane_mean[kLayerNormNumLanes] = {0};
+  T lane_m2[kLayerNormNumLanes] = {0};
+  const int64_t num_steps = norm_size / kLayerNormNumLanes;
+  for (int64_t step = 0; step < num_steps; ++step) {
+    const T* x_step = x + step * kLayerNormNumLanes;
+    const T inv_count = static_cast<T>(1) / static_cast<T>(step + 1);
+    for (int64_t lane = 0; lane < kLayerNormNumLanes; ++lane) {
+      const T delta = x_step[lane] - lane_mean[lane];
+      lane_mean[lane] += delta * inv_count;
+      lane_m2[lane] += delta * (x_step[lane] - lane_mean[lane]);
+    }
+  }
+  T row_mean = 0;
+  T row_m2 = 0;
+  int64_t row_count = 0;
+  for (int64_t lane = 0; lane < kLayerNormNumLanes; ++lane) {
+    WelfordCombine(lane_mean[lane], lane_m2[lane], num_steps, &row_mean, &row_m2, &row_count);
+  }
+  for (int64_t col = num_steps * kLayerNormNumLanes; col < norm_size; ++col) {
+    WelfordCombine(x[col], static_cast<T>(0), 1, &row_mean, &row_m2, &row_count);
+  }
+  *mean = row_mean;
+  *variance = row_m2 / static_cast<T>(norm_size);
+}
+
+template<typename T>
+void LayerNormForwardRow(const int64_t row, const int64_t norm_size, const int64_t instance_size,
+                         const T epsilon, const T* x, const T* gamma, const T* beta, T* mean,
+                         T* inv_variance, T* normalized, T* y) {
+  const int64_t row_offset = row * norm_size;
+  const T* x_row = x + row_offset;
+  T* y_row = y + row_offset;
+  T row_mean;
+  T row_variance;
+  RowWelford(x_row, norm_size, &row_mean, &row_variance);
+  const T row_inv_var = static_cast<T>(1) / std::sqrt(row_variance + epsilon);
+  mean[row] = row_mean;
+  inv_variance[row] = row_inv_var;
+  if (gamma == nullptr && beta == nullptr) {
+    for (int64_t col = 0; col < norm_size; ++col) {
+      y_row[col] = (x_row[col] - row_mean) * row_inv_var;
+    }
+    return;
+  }
+  T* normalized_row = gamma != nullptr ? normalized + row_offset : nullptr;
+  if (instance_size == norm_size) {
+    if (gamma != nullptr && beta != nullptr) {
+      for (int64_t col = 0; col < norm_size; ++col) {
+        const T v = (x_row[col] - row_mean) * row_inv_var;
+        normalized_row[col] = v;
+        y_row[col] = v * gamma[col] + beta[col];
+      }
+    } else if (gamma != nullptr) {
+      for (int64_t col = 0; col < norm_size; ++col) {
+        const T v = (x_row[col] - row_mean) * row_inv_var;
+        normalized_row[col] = v;
+        y_row[col] = v * gamma[col];
+      }
+    } else {
+      for (int64_t col = 0; col < norm_size; ++col) {
+        y_row[col] = (x_row[col] - row_mean) * row_inv_var + beta[col];
+      }
+    }
+  } else {
+    // begin_params_axis differs from begin_norm_axis, params are indexed by the flat offset.
+    FOR_RANGE(int64_t, col, 0, norm_size) {
+      const int64_t elem_id = (row_offset + col) % instance_size;
+      T v = (x_row[col] - row_mean) * row_inv_var;
+      if (gamma != nullptr) {
+        normalized_row[col] = v;
+        v *= gamma[elem_id];
+      }
+      if (beta != nullptr) { v += beta[elem_id]; }
+      y_row[col] = v;
+    }
+  }
+}
+
+template<typename T>
+void LayerNormBackwardRow(const int64_t row, const int64_t norm_size, const T* x, const T* dy,
+                          const T* mean, const T* inv_variance, const T* add_to_output, T* dx) {
+  const int64_t row_offset = row * norm_size;
+  const T* x_row = x + row_offset;
+  const T* dy_row = dy + row_offset;
+  T* dx_row = dx + row_offset;
+  const T row_mean = mean[row];
+  const T row_inv_var = inv_variance[row];
+  T sum_dy = 0;
+  T sum_dy_x = 0;
+  for (int64_t col = 0; col < norm_size; ++col) {
+    sum_dy += dy_row[col];
+    sum_dy_x += dy_row[col] * x_row[col];
+  }
+  // sum(dy * normalized) = inv_var * (sum(dy * x) - mean * sum(dy))
+  const T inv_norm_size = static_cast<T>(1) / static_cast<T>(norm_size);
+  const T mean_dy = sum_dy * inv_norm_size;
+  const T mean_dy_normalized = (sum_dy_x - row_mean * sum_dy) * row_inv_var * inv_norm_size;
+  if (add_to_output != nullptr) {
+    const T* add_row = add_to_output + row_offset;
+    for (int64_t col = 0; col < norm_size; ++col) {
+      const T normalized = (x_row[col] - row_mean) * row_inv_var;
+      dx_row[col] =
+          add_row[col] + row_inv_var * (dy_row[col] - mean_dy - normalized * mean_dy_normalized);
+    }
+  } else {
+    for (int64_t col = 0; col < norm_size; ++col) {
+      const T normalized = (x_row[col] - row_mean) * row_inv_var;
+      dx_row[col] = row_inv_var * (dy_row[col] - mean_dy - normalized * mean_dy_normalized);
+    }
+  }
+}
+
+// Reduces dy and dy * normalized over n rows for the columns in [col_begin, col_end), and
+// produces normalized_diff = dy * gamma for the same columns on the way.
+template<typename T>
+void LayerNormParamGradCols(const int64_t n, const int64_t m, const int64_t col_begin,
+                            const int64_t col_end, const T* dy, const T* normalized,
+                            const T* gamma, T* gamma_diff, T* beta_diff, T* normalized_diff) {
+  if (gamma_diff != nullptr) { std::fill(gamma_diff + col_begin, gamma_diff + col_end, 0); }
+  if (beta_diff != nullptr) { std::fill(beta_diff + col_begin, beta_diff + col_end, 0); }
+  FOR_RANGE(int64_t, row, 0, n) {
+    const int64_t row_offset = row * m;
+    const T* dy_row = dy + row_offset;
+    if (gamma_diff != nullptr) {
+      const T* normalized_row = normalized + row_offset;
+      for (int64_t col = col_begin; col < col_end; ++col) {
+        gamma_diff[col] += dy_row[col] * normalized_row[col];
+      }
+    }
+    if (beta_diff != nullptr) {
+      for (int64_t col = col_begin; col < col_end; ++col) { beta_diff[col] += dy_row[col]; }
+    }
+    if (normalized_diff != nullptr) {
+      T* normalized_diff_row = normalized_diff + row_offset;
+      if (gamma != nullptr) {
+        for (int64_t col = col_begin; col < col_end; ++col) {
+          normalized_diff_row[col] = dy_row[col] * gamma[col];
+        }
+      } else {
+        for (int64_t col = col_begin; col < col_end; ++col) {
+          normalized_diff_row[col] = dy_row[col];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
 template<typename T>
 class LayerNormCpuKernel final : public user_op::OpKernel {
  public:
@@ -25,7 +197,46 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    user_op::Tensor* normalized = scale ? ctx->Tensor4ArgNameAndIndex("normalized", 0) : y;
+    const T epsilon = static_cast<T>(ctx->Attr<double>("epsilon"));
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    int64_t instance_size = 0;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (scale) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      instance_size = gamma->shape().elem_cnt();
+      gamma_ptr = gamma->dptr<T>();
+    }
+    if (center) {
+      const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      if (gamma_ptr) {
+        CHECK_EQ(beta->shape().elem_cnt(), instance_size);
+      } else {
+        instance_size = beta->shape().elem_cnt();
+      }
+      beta_ptr = beta->dptr<T>();
+    }
+    if (scale || center) { CHECK_EQ(y->shape().elem_cnt() % instance_size, 0); }
+    const T* x_ptr = x->dptr<T>();
+    T* mean_ptr = mean->mut_dptr<T>();
+    T* inv_variance_ptr = inv_variance->mut_dptr<T>();
+    T* normalized_ptr = normalized->mut_dptr<T>();
+    T* y_ptr = y->mut_dptr<T>();
+    MultiThreadLoop(num_instances, [&](size_t row) {
+      LayerNormForwardRow<T>(row, norm_size, instance_size, epsilon, x_ptr, gamma_ptr, beta_ptr,
+                             mean_ptr, inv_variance_ptr, normalized_ptr, y_ptr);
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)             \
@@ -45,14 +256,46 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape(), dx->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const T* x_ptr = x->dptr<T>();
+    const T* dy_ptr = dy->dptr<T>();
+    const T* mean_ptr = mean->dptr<T>();
+    const T* inv_variance_ptr = inv_variance->dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    MultiThreadLoop(num_instances, [&](size_t row) {
+      LayerNormBackwardRow<T>(row, norm_size, x_ptr, dy_ptr, mean_ptr, inv_variance_ptr,
+                              add_to_output_ptr, dx_ptr);
+    });
+  };
 };
 
-#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)        \
-  REGISTER_USER_KERNEL("layer_norm_grad")                 \
-      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()       \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu") \
-                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("layer_norm_grad")                                                       \
+      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
+                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))          \
+      .SetInplaceProposalFn([](const user_op::InferContext& ctx,                                \
+                               user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
+        if (ctx.has_input("_add_to_output", 0)) {                                               \
+          OF_RETURN_IF_ERROR(AddInplaceArgPairFn("dx", 0, "_add_to_output", 0, true));          \
+        }                                                                                       \
+        return Maybe<void>::Ok();                                                               \
+      });
 
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(float)
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(double)
@@ -65,7 +308,52 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    const int64_t m = dy->shape().Count(begin_params_axis);
+    if (m == 0) { return; }
+    CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+    const int64_t n = dy->shape().elem_cnt() / m;
+    const T* normalized_ptr = nullptr;
+    T* gamma_diff_ptr = nullptr;
+    T* beta_diff_ptr = nullptr;
+    T* normalized_diff_ptr = nullptr;
+    const T* gamma_ptr = nullptr;
+    if (gamma_diff != nullptr) {
+      CHECK_EQ(m, gamma_diff->shape().elem_cnt());
+      normalized_ptr = ctx->Tensor4ArgNameAndIndex("normalized", 0)->dptr<T>();
+      gamma_diff_ptr = gamma_diff->mut_dptr<T>();
+    }
+    if (beta_diff != nullptr) {
+      CHECK_EQ(m, beta_diff->shape().elem_cnt());
+      beta_diff_ptr = beta_diff->mut_dptr<T>();
+    }
+    if (normalized_diff != nullptr) {
+      normalized_diff_ptr = normalized_diff->mut_dptr<T>();
+      if (gamma != nullptr) {
+        CHECK_EQ(m, gamma->shape().elem_cnt());
+        gamma_ptr = gamma->dptr<T>();
+      }
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    // Partition over parameter columns so that every thread owns its slice of gamma/beta diff and
+    // no cross-thread reduction is needed.
+    const int64_t thread_num = Global<ThreadPool>::Get()->thread_num();
+    const int64_t cols_per_part =
+        std::max(kLayerNormParamGradMinColsPerThread, (m + thread_num - 1) / thread_num);
+    const int64_t num_parts = (m + cols_per_part - 1) / cols_per_part;
+    MultiThreadLoop(num_parts, [&](size_t part_id) {
+      const int64_t col_begin = part_id * cols_per_part;
+      const int64_t col_end = std::min(col_begin + cols_per_part, m);
+      LayerNormParamGradCols<T>(n, m, col_begin, col_end, dy_ptr, normalized_ptr, gamma_ptr,
+                                gamma_diff_ptr, beta_diff_ptr, normalized_diff_ptr);
+    });
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)  \
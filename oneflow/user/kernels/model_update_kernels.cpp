@@ -16,8 +16,10 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/model_update_kernel_util.h"
 #include "oneflow/user/kernels/indexed_slices_reduce_sum_kernel_util.h"
+#include "oneflow/user/kernels/sparse_embedding_kernel_util.h"
 #include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/kernel/cuda_graph_support.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -640,6 +642,212 @@ class IndexedSlicesAdamUpdateKernel final : public user_op::OpKernel {
 OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_INDEXED_SLICES_ADAM_UPDATE_KERNEL, DEVICE_TYPE_SEQ,
                                  FLOATING_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ)
 
+template<typename T, typename K>
+size_t GetSparseEmbeddingRowsOffset(int64_t num_indices, int64_t num_values) {
+  TmpBufferManager<DeviceType::kCPU, T, K> buffer_manager(nullptr, num_indices, num_values);
+  return GetCudaAlignedSize(buffer_manager.GetTotalBufferSize());
+}
+
+template<typename T, typename K>
+user_op::InferTmpSizeFn GenSparseEmbeddingInferTmpSizeFn() {
+  return [](user_op::InferContext* ctx) {
+    const int64_t num_indices = ctx->InputTensorDesc("model_diff_indices", 0).shape().elem_cnt();
+    const int64_t num_values = ctx->InputTensorDesc("model_diff_values", 0).shape().elem_cnt();
+    return GetSparseEmbeddingRowsOffset<T, K>(num_indices, num_values) + num_indices * sizeof(T*);
+  };
+}
+
+bool SkipSparseEmbeddingUpdate(user_op::KernelComputeContext* ctx) {
+  if (!ctx->has_input("skip_if", 0)) { return false; }
+  return *ctx->Tensor4ArgNameAndIndex("skip_if", 0)->dptr<int64_t>() != 0;
+}
+
+float GetSparseEmbeddingLearningRate(user_op::KernelComputeContext* ctx) {
+  if (!ctx->has_input("learning_rate", 0)) { return ctx->Attr<float>("learning_rate_val"); }
+  return *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+}
+
+// Sums the diffs of the same ids, then finds or creates the table rows of the unique ids. Returns
+// the unique id num.
+template<typename T, typename K>
+int64_t ReduceSparseEmbeddingDiff(user_op::KernelComputeContext* ctx,
+                                  const SparseEmbeddingOpKernelState* kernel_state,
+                                  const T** unique_values, T*** rows) {
+  const user_op::Tensor* model_diff_indices = ctx->Tensor4ArgNameAndIndex("model_diff_indices", 0);
+  const user_op::Tensor* model_diff_values = ctx->Tensor4ArgNameAndIndex("model_diff_values", 0);
+  const int64_t num_indices = model_diff_indices->shape().elem_cnt();
+  const int64_t num_values = model_diff_values->shape().elem_cnt();
+  if (num_indices == 0) {
+    CHECK_EQ(num_values, 0);
+    return 0;
+  }
+  const int64_t embedding_size = kernel_state->embedding_size();
+  CHECK_EQ(num_values, num_indices * embedding_size);
+  user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+  TmpBufferManager<DeviceType::kCPU, T, K> buffer_manager(tmp_buffer->mut_dptr(), num_indices,
+                                                          num_values);
+  const size_t rows_offset = GetSparseEmbeddingRowsOffset<T, K>(num_indices, num_values);
+  CHECK_GE(tmp_buffer->shape().elem_cnt(), rows_offset + num_indices * sizeof(T*));
+  IndexedSlicesReduceSumKernelUtil<DeviceType::kCPU, K, T, int32_t>::ReduceSum(
+      ctx->device_ctx(), num_indices, embedding_size, model_diff_indices->dptr<K>(),
+      model_diff_values->dptr<T>(), buffer_manager.NumUniqueDiffIndicesPtr(),
+      buffer_manager.UniqueDiffIndicesPtr(), buffer_manager.UniqueDiffValuesPtr(),
+      buffer_manager.UniqueWorkspacePtr(), buffer_manager.UniqueWorkspaceBytes());
+  const int64_t num_unique = *buffer_manager.NumUniqueDiffIndicesPtr();
+  *unique_values = buffer_manager.UniqueDiffValuesPtr();
+  *rows = reinterpret_cast<T**>(tmp_buffer->mut_dptr<char>() + rows_offset);
+  kernel_state->FindOrCreateRows(num_unique, buffer_manager.UniqueDiffIndicesPtr(), *rows);
+  return num_unique;
+}
+
+template<typename T, typename K>
+class SparseEmbeddingSGDUpdateKernel final : public user_op::OpKernel {
+ public:
+  SparseEmbeddingSGDUpdateKernel() = default;
+  ~SparseEmbeddingSGDUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<SparseEmbeddingOpKernelState>(ctx);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    if (SkipSparseEmbeddingUpdate(ctx)) { return; }
+    const auto* kernel_state = dynamic_cast<SparseEmbeddingOpKernelState*>(state);
+    CHECK_NOTNULL(kernel_state);
+    const float learning_rate = GetSparseEmbeddingLearningRate(ctx);
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const int64_t embedding_size = kernel_state->embedding_size();
+    const T* values = nullptr;
+    T** rows = nullptr;
+    const int64_t num_unique = ReduceSparseEmbeddingDiff<T, K>(ctx, kernel_state, &values, &rows);
+    MultiThreadLoop(num_unique, [&](size_t i) {
+      const T* model_diff = values + i * embedding_size;
+      T* model = rows[i];
+      FOR_RANGE(int64_t, j, 0, embedding_size) {
+        SGDUpdateFunctor<T, T>()(model_diff + j, model + j, static_cast<T>(1), 0.0, 0.0,
+                                 weight_decay, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+template<typename T, typename K>
+class SparseEmbeddingMomentumUpdateKernel final : public user_op::OpKernel {
+ public:
+  SparseEmbeddingMomentumUpdateKernel() = default;
+  ~SparseEmbeddingMomentumUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<SparseEmbeddingOpKernelState>(ctx);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    if (SkipSparseEmbeddingUpdate(ctx)) { return; }
+    const auto* kernel_state = dynamic_cast<SparseEmbeddingOpKernelState*>(state);
+    CHECK_NOTNULL(kernel_state);
+    const float learning_rate = GetSparseEmbeddingLearningRate(ctx);
+    const auto beta = ctx->Attr<float>("beta");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const int64_t embedding_size = kernel_state->embedding_size();
+    const T* values = nullptr;
+    T** rows = nullptr;
+    const int64_t num_unique = ReduceSparseEmbeddingDiff<T, K>(ctx, kernel_state, &values, &rows);
+    MultiThreadLoop(num_unique, [&](size_t i) {
+      const T* model_diff = values + i * embedding_size;
+      T* model = rows[i];
+      T* momentum = model + embedding_size;
+      FOR_RANGE(int64_t, j, 0, embedding_size) {
+        MomentumUpdateFunctor<T, T>()(model_diff + j, model + j, momentum + j, static_cast<T>(1),
+                                      0.0, 0.0, beta, weight_decay, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+template<typename T, typename K>
+class SparseEmbeddingAdamUpdateKernel final : public user_op::OpKernel {
+ public:
+  SparseEmbeddingAdamUpdateKernel() = default;
+  ~SparseEmbeddingAdamUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<SparseEmbeddingOpKernelState>(ctx);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    if (SkipSparseEmbeddingUpdate(ctx)) { return; }
+    const auto* kernel_state = dynamic_cast<SparseEmbeddingOpKernelState*>(state);
+    CHECK_NOTNULL(kernel_state);
+    const float learning_rate = GetSparseEmbeddingLearningRate(ctx);
+    float bias_correction1 = ctx->Attr<float>("bias_correction1_val");
+    if (ctx->has_input("bias_correction1", 0)) {
+      bias_correction1 = *ctx->Tensor4ArgNameAndIndex("bias_correction1", 0)->dptr<float>();
+    }
+    float bias_correction2 = ctx->Attr<float>("bias_correction2_val");
+    if (ctx->has_input("bias_correction2", 0)) {
+      bias_correction2 = *ctx->Tensor4ArgNameAndIndex("bias_correction2", 0)->dptr<float>();
+    }
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const bool amsgrad = ctx->Attr<bool>("amsgrad");
+    const int64_t embedding_size = kernel_state->embedding_size();
+    const T* values = nullptr;
+    T** rows = nullptr;
+    const int64_t num_unique = ReduceSparseEmbeddingDiff<T, K>(ctx, kernel_state, &values, &rows);
+    MultiThreadLoop(num_unique, [&](size_t i) {
+      const T* model_diff = values + i * embedding_size;
+      T* model = rows[i];
+      T* m = model + embedding_size;
+      T* v = m + embedding_size;
+      // Only rows of amsgrad have max_v, and only amsgrad reads it.
+      T* max_v = amsgrad ? v + embedding_size : v;
+      FOR_RANGE(int64_t, j, 0, embedding_size) {
+        AdamUpdateFunctor<T, T>()(model_diff + j, model + j, m + j, v + j, max_v + j,
+                                  static_cast<T>(1), 0.0, 0.0, beta1, beta2, epsilon, weight_decay,
+                                  amsgrad, bias_correction1, bias_correction2, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_SPARSE_EMBEDDING_UPDATE_KERNEL(op_type_name, kernel, data_type_pair,              \
+                                                indices_type_pair)                                 \
+  REGISTER_USER_KERNEL(op_type_name)                                                               \
+      .SetCreateFn<                                                                                \
+          kernel<OF_PP_PAIR_FIRST(data_type_pair), OF_PP_PAIR_FIRST(indices_type_pair)>>()         \
+      .SetIsMatchedHob(                                                                            \
+          (user_op::HobDeviceTag() == "cpu")                                                       \
+          & (user_op::HobDataType("model", 0) == OF_PP_PAIR_SECOND(data_type_pair))                \
+          & (user_op::HobDataType("model_diff_indices", 0)                                         \
+             == OF_PP_PAIR_SECOND(indices_type_pair)))                                             \
+      .SetInferTmpSizeFn(GenSparseEmbeddingInferTmpSizeFn<OF_PP_PAIR_FIRST(data_type_pair),        \
+                                                          OF_PP_PAIR_FIRST(indices_type_pair)>());
+
+#define REGISTER_SPARSE_EMBEDDING_UPDATE_KERNELS(data_type_pair, indices_type_pair)            \
+  REGISTER_SPARSE_EMBEDDING_UPDATE_KERNEL("sparse_embedding_sgd_update",                       \
+                                          SparseEmbeddingSGDUpdateKernel, data_type_pair,      \
+                                          indices_type_pair)                                   \
+  REGISTER_SPARSE_EMBEDDING_UPDATE_KERNEL("sparse_embedding_momentum_update",                  \
+                                          SparseEmbeddingMomentumUpdateKernel, data_type_pair, \
+                                          indices_type_pair)                                   \
+  REGISTER_SPARSE_EMBEDDING_UPDATE_KERNEL("sparse_embedding_adam_update",                      \
+                                          SparseEmbeddingAdamUpdateKernel, data_type_pair,     \
+                                          indices_type_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_SPARSE_EMBEDDING_UPDATE_KERNELS, FLOATING_DATA_TYPE_SEQ,
+                                 INDEX_DATA_TYPE_SEQ)
+
 template<DeviceType device_type, typename T>
 class LambTmpBufferManager final {
  public:
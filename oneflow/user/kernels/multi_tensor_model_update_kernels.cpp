@@ -0,0 +1,215 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// The models are updated in chunks of at most kChunkSize elements spread over the threads, so
+// that many small models share a thread and a large one is split.
+constexpr int64_t kChunkSize = 32 * 1024;
+
+struct ModelChunk {
+  int64_t model_id;
+  int64_t begin;
+  int64_t end;
+};
+
+std::vector<ModelChunk> GenModelChunks(user_op::KernelComputeContext* ctx) {
+  std::vector<ModelChunk> chunks;
+  FOR_RANGE(int64_t, i, 0, ctx->input_size("model")) {
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("model", i)->shape().elem_cnt();
+    for (int64_t begin = 0; begin < elem_cnt; begin += kChunkSize) {
+      chunks.push_back(ModelChunk{i, begin, std::min(begin + kChunkSize, elem_cnt)});
+    }
+  }
+  return chunks;
+}
+
+template<typename T>
+const T* OptionalScalarDptr(user_op::KernelComputeContext* ctx, const std::string& arg_name) {
+  if (!ctx->has_input(arg_name, 0)) { return nullptr; }
+  const user_op::Tensor* tensor = ctx->Tensor4ArgNameAndIndex(arg_name, 0);
+  CHECK_EQ(tensor->shape().elem_cnt(), 1);
+  return tensor->dptr<T>();
+}
+
+template<typename T>
+std::vector<T*> MutDptrs(user_op::KernelComputeContext* ctx, const std::string& arg_name) {
+  std::vector<T*> dptrs(ctx->input_size(arg_name));
+  FOR_RANGE(int64_t, i, 0, dptrs.size()) {
+    dptrs.at(i) = ctx->Tensor4ArgNameAndIndex(arg_name, i)->mut_dptr<T>();
+  }
+  return dptrs;
+}
+
+template<typename T>
+std::vector<const T*> Dptrs(user_op::KernelComputeContext* ctx, const std::string& arg_name) {
+  std::vector<const T*> dptrs(ctx->input_size(arg_name));
+  FOR_RANGE(int64_t, i, 0, dptrs.size()) {
+    dptrs.at(i) = ctx->Tensor4ArgNameAndIndex(arg_name, i)->dptr<T>();
+  }
+  return dptrs;
+}
+
+// Returns false if the update is skipped.
+template<typename T>
+bool GetLearningRateAndScale(user_op::KernelComputeContext* ctx, float* learning_rate, T* scale) {
+  const int64_t* skip_if_ptr = OptionalScalarDptr<int64_t>(ctx, "skip_if");
+  if (skip_if_ptr != nullptr && *skip_if_ptr != 0) { return false; }
+  *learning_rate = ctx->Attr<float>("learning_rate_val");
+  const float* learning_rate_ptr = OptionalScalarDptr<float>(ctx, "learning_rate");
+  if (learning_rate_ptr != nullptr) { *learning_rate = *learning_rate_ptr; }
+  *scale = static_cast<T>(ctx->Attr<double>("scale"));
+  const T* scale_by_ptr = OptionalScalarDptr<T>(ctx, "scale_by_tensor");
+  if (scale_by_ptr != nullptr) { *scale *= *scale_by_ptr; }
+  return true;
+}
+
+template<typename T>
+class MultiTensorSGDUpdateKernel final : public user_op::OpKernel {
+ public:
+  MultiTensorSGDUpdateKernel() = default;
+  ~MultiTensorSGDUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    float learning_rate = 0;
+    T scale = 0;
+    if (!GetLearningRateAndScale<T>(ctx, &learning_rate, &scale)) { return; }
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const std::vector<const T*> model_diffs = Dptrs<T>(ctx, "model_diff");
+    const std::vector<T*> models = MutDptrs<T>(ctx, "model");
+    const std::vector<ModelChunk> chunks = GenModelChunks(ctx);
+    MultiThreadLoop(chunks.size(), [&](size_t i) {
+      const ModelChunk& chunk = chunks.at(i);
+      const T* model_diff = model_diffs.at(chunk.model_id);
+      T* model = models.at(chunk.model_id);
+      for (int64_t j = chunk.begin; j < chunk.end; ++j) {
+        SGDUpdateFunctor<T, T>()(model_diff + j, model + j, scale, l1, l2, weight_decay,
+                                 learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+template<typename T>
+class MultiTensorMomentumUpdateKernel final : public user_op::OpKernel {
+ public:
+  MultiTensorMomentumUpdateKernel() = default;
+  ~MultiTensorMomentumUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    float learning_rate = 0;
+    T scale = 0;
+    if (!GetLearningRateAndScale<T>(ctx, &learning_rate, &scale)) { return; }
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto beta = ctx->Attr<float>("beta");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const std::vector<const T*> model_diffs = Dptrs<T>(ctx, "model_diff");
+    const std::vector<T*> models = MutDptrs<T>(ctx, "model");
+    const std::vector<T*> momentums = MutDptrs<T>(ctx, "momentum");
+    const std::vector<ModelChunk> chunks = GenModelChunks(ctx);
+    MultiThreadLoop(chunks.size(), [&](size_t i) {
+      const ModelChunk& chunk = chunks.at(i);
+      const T* model_diff = model_diffs.at(chunk.model_id);
+      T* model = models.at(chunk.model_id);
+      T* momentum = momentums.at(chunk.model_id);
+      for (int64_t j = chunk.begin; j < chunk.end; ++j) {
+        MomentumUpdateFunctor<T, T>()(model_diff + j, model + j, momentum + j, scale, l1, l2, beta,
+                                      weight_decay, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+template<typename T>
+class MultiTensorAdamUpdateKernel final : public user_op::OpKernel {
+ public:
+  MultiTensorAdamUpdateKernel() = default;
+  ~MultiTensorAdamUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    float learning_rate = 0;
+    T scale = 0;
+    if (!GetLearningRateAndScale<T>(ctx, &learning_rate, &scale)) { return; }
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const bool amsgrad = ctx->Attr<bool>("amsgrad");
+    float bias_correction1 = ctx->Attr<float>("bias_correction1_val");
+    const float* bias_correction1_ptr = OptionalScalarDptr<float>(ctx, "bias_correction1");
+    if (bias_correction1_ptr != nullptr) { bias_correction1 = *bias_correction1_ptr; }
+    float bias_correction2 = ctx->Attr<float>("bias_correction2_val");
+    const float* bias_correction2_ptr = OptionalScalarDptr<float>(ctx, "bias_correction2");
+    if (bias_correction2_ptr != nullptr) { bias_correction2 = *bias_correction2_ptr; }
+    const std::vector<const T*> model_diffs = Dptrs<T>(ctx, "model_diff");
+    const std::vector<T*> models = MutDptrs<T>(ctx, "model");
+    const std::vector<T*> ms = MutDptrs<T>(ctx, "m");
+    const std::vector<T*> vs = MutDptrs<T>(ctx, "v");
+    const std::vector<T*> max_vs = MutDptrs<T>(ctx, "max_v");
+    const std::vector<ModelChunk> chunks = GenModelChunks(ctx);
+    MultiThreadLoop(chunks.size(), [&](size_t i) {
+      const ModelChunk& chunk = chunks.at(i);
+      const T* model_diff = model_diffs.at(chunk.model_id);
+      T* model = models.at(chunk.model_id);
+      T* m = ms.at(chunk.model_id);
+      T* v = vs.at(chunk.model_id);
+      T* max_v = max_vs.at(chunk.model_id);
+      for (int64_t j = chunk.begin; j < chunk.end; ++j) {
+        AdamUpdateFunctor<T, T>()(model_diff + j, model + j, m + j, v + j, max_v + j, scale, l1, l2,
+                                  beta1, beta2, epsilon, weight_decay, amsgrad, bias_correction1,
+                                  bias_correction2, learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+}  // namespace
+
+#define REGISTER_MULTI_TENSOR_UPDATE_KERNEL(op_type_name, kernel, dtype)                  \
+  REGISTER_USER_KERNEL(op_type_name)                                                      \
+      .SetCreateFn<kernel<dtype>>()                                                       \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == DeviceType::kCPU)                      \
+                       & (user_op::HobDataType("model", 0) == GetDataType<dtype>::value)  \
+                       & (user_op::HobDataType("model_diff", 0) == GetDataType<dtype>::value));
+
+#define REGISTER_MULTI_TENSOR_UPDATE_KERNELS(dtype)                                            \
+  REGISTER_MULTI_TENSOR_UPDATE_KERNEL("multi_tensor_sgd_update", MultiTensorSGDUpdateKernel,   \
+                                      dtype)                                                   \
+  REGISTER_MULTI_TENSOR_UPDATE_KERNEL("multi_tensor_momentum_update",                          \
+                                      MultiTensorMomentumUpdateKernel, dtype)                  \
+  REGISTER_MULTI_TENSOR_UPDATE_KERNEL("multi_tensor_adam_update", MultiTensorAdamUpdateKernel, \
+                                      dtype)
+
+REGISTER_MULTI_TENSOR_UPDATE_KERNELS(float)
+REGISTER_MULTI_TENSOR_UPDATE_KERNELS(double)
+
+}  // namespace oneflow
@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SPARSE_EMBEDDING_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SPARSE_EMBEDDING_KERNEL_UTIL_H_
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/user/kernels/sparse_embedding_table.h"
+
+namespace oneflow {
+
+// The replica of the sparse embedding table on one rank, shared by the lookup and the update
+// kernels of the same table_name.
+class SparseEmbeddingOpKernelState final : public user_op::OpKernelState {
+ public:
+  explicit SparseEmbeddingOpKernelState(user_op::KernelInitContext* ctx)
+      : embedding_size_(ctx->Attr<int64_t>("embedding_size")),
+        seed_(ctx->Attr<int64_t>("seed")) {
+    CHECK(TxtString2PbMessage(ctx->Attr<std::string>("initializer_conf"), &initializer_conf_));
+    CHECK(IsSparseEmbeddingInitializerSupported(initializer_conf_));
+    const int64_t row_size =
+        (1 + ctx->Attr<int64_t>("num_states")) * embedding_size_
+        * GetSizeOfDataType(ctx->TensorDesc4ArgNameAndIndex("model", 0)->data_type());
+    table_ = GetOrCreateSparseEmbeddingTable(ctx->Attr<std::string>("table_name"),
+                                             ctx->parallel_ctx().parallel_id(), row_size);
+  }
+  ~SparseEmbeddingOpKernelState() override = default;
+
+  int64_t embedding_size() const { return embedding_size_; }
+
+  // Rows start with the embedding, followed by the optimizer states.
+  template<typename T, typename K>
+  void FindOrCreateRows(int64_t n, const K* ids, T** rows) const {
+    table_->FindOrCreateRows(n, ids, reinterpret_cast<char**>(rows), [&](int64_t i, char* row) {
+      CHECK_GE(ids[i], 0);
+      InitSparseEmbedding<T>(initializer_conf_, seed_, ids[i], embedding_size_,
+                             reinterpret_cast<T*>(row));
+    });
+  }
+
+ private:
+  std::shared_ptr<SparseEmbeddingTable> table_;
+  InitializerConf initializer_conf_;
+  int64_t embedding_size_;
+  int64_t seed_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SPARSE_EMBEDDING_KERNEL_UTIL_H_
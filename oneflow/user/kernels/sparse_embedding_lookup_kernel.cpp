@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/kernels/sparse_embedding_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T, typename K>
+class SparseEmbeddingLookupKernel final : public user_op::OpKernel {
+ public:
+  SparseEmbeddingLookupKernel() = default;
+  ~SparseEmbeddingLookupKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<SparseEmbeddingOpKernelState>(ctx);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    const auto* kernel_state = dynamic_cast<SparseEmbeddingOpKernelState*>(state);
+    CHECK_NOTNULL(kernel_state);
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t num_ids = ids->shape().elem_cnt();
+    const int64_t embedding_size = kernel_state->embedding_size();
+    CHECK_EQ(out->shape().elem_cnt(), num_ids * embedding_size);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), num_ids * sizeof(T*));
+    T** rows = reinterpret_cast<T**>(tmp_buffer->mut_dptr());
+    kernel_state->FindOrCreateRows(num_ids, ids->dptr<K>(), rows);
+    T* out_ptr = out->mut_dptr<T>();
+    MultiThreadLoop(num_ids, [&](size_t i) {
+      std::copy(rows[i], rows[i] + embedding_size, out_ptr + i * embedding_size);
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_SPARSE_EMBEDDING_LOOKUP_KERNEL(data_type_pair, indices_type_pair)                 \
+  REGISTER_USER_KERNEL("sparse_embedding_lookup")                                                  \
+      .SetCreateFn<SparseEmbeddingLookupKernel<OF_PP_PAIR_FIRST(data_type_pair),                   \
+                                               OF_PP_PAIR_FIRST(indices_type_pair)>>()             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                          \
+                       & (user_op::HobDataType("out", 0) == OF_PP_PAIR_SECOND(data_type_pair))     \
+                       & (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(indices_type_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                                \
+        return ctx->InputTensorDesc("ids", 0).shape().elem_cnt() * sizeof(void*);                  \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_SPARSE_EMBEDDING_LOOKUP_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 INDEX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
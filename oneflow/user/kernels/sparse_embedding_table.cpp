@@ -0,0 +1,212 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/sparse_embedding_table.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinSparseEmbeddingTableCapacity = 1024;
+constexpr int64_t kSparseEmbeddingBlockBytes = 4 << 20;
+
+// The 64 bit finalizer of MurmurHash3, all bits of the id affect the low bits picking the slot.
+uint64_t HashId(int64_t id) {
+  uint64_t h = static_cast<uint64_t>(id);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb93fe53ae63bULL;
+  h ^= h >> 33;
+  return h;
+}
+
+std::string SparseEmbeddingTableFileName(int64_t parallel_id) {
+  return "sparse_rows_" + std::to_string(parallel_id);
+}
+
+struct SparseEmbeddingTableRegistry {
+  std::mutex mutex;
+  HashMap<std::string, HashMap<int64_t, std::weak_ptr<SparseEmbeddingTable>>>
+      table_name2parallel_id2table;
+};
+
+SparseEmbeddingTableRegistry* GetSparseEmbeddingTableRegistry() {
+  static SparseEmbeddingTableRegistry registry;
+  return &registry;
+}
+
+// The alive tables of table_name, by parallel id.
+std::map<int64_t, std::shared_ptr<SparseEmbeddingTable>> GetSparseEmbeddingTables(
+    const std::string& table_name) {
+  SparseEmbeddingTableRegistry* registry = GetSparseEmbeddingTableRegistry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  std::map<int64_t, std::shared_ptr<SparseEmbeddingTable>> parallel_id2table;
+  const auto it = registry->table_name2parallel_id2table.find(table_name);
+  if (it == registry->table_name2parallel_id2table.end()) { return parallel_id2table; }
+  for (const auto& pair : it->second) {
+    std::shared_ptr<SparseEmbeddingTable> table = pair.second.lock();
+    if (table) { parallel_id2table.emplace(pair.first, std::move(table)); }
+  }
+  return parallel_id2table;
+}
+
+}  // namespace
+
+SparseEmbeddingTable::SparseEmbeddingTable(int64_t row_size)
+    : row_size_(row_size),
+      rows_per_block_(std::max<int64_t>(kSparseEmbeddingBlockBytes / row_size, 1)),
+      num_rows_(0),
+      slots_(kMinSparseEmbeddingTableCapacity, Slot{0, nullptr}) {
+  CHECK_GT(row_size, 0);
+}
+
+int64_t SparseEmbeddingTable::num_rows() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return num_rows_;
+}
+
+void SparseEmbeddingTable::ForEachRow(
+    const std::function<void(int64_t id, const char* row)>& Handler) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const Slot& slot : slots_) {
+    if (slot.row != nullptr) { Handler(slot.id, slot.row); }
+  }
+}
+
+void SparseEmbeddingTable::Save(fs::FileSystem* fs, const std::string& path) const {
+  std::unique_ptr<fs::WritableFile> file;
+  fs->NewWritableFile(path, &file);
+  auto WriteInt64 = [&](int64_t value) {
+    file->Append(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  WriteInt64(row_size_);
+  WriteInt64(num_rows());
+  ForEachRow([&](int64_t id, const char* row) {
+    WriteInt64(id);
+    file->Append(row, row_size_);
+  });
+  file->Close();
+}
+
+Maybe<void> SparseEmbeddingTable::Load(fs::FileSystem* fs, const std::string& path) {
+  // PersistentInStream aborts on reads past the end, the size is checked before reading.
+  const int64_t file_size = fs->GetFileSize(path);
+  const int64_t id_size = sizeof(int64_t);
+  CHECK_GE_OR_RETURN(file_size, 2 * id_size) << path << " is truncated";
+  PersistentInStream in_stream(fs, path);
+  auto ReadInt64 = [&]() -> Maybe<int64_t> {
+    int64_t value = 0;
+    CHECK_EQ_OR_RETURN(in_stream.ReadFully(reinterpret_cast<char*>(&value), sizeof(value)), 0)
+        << path << " is truncated";
+    return value;
+  };
+  const int64_t row_size = JUST(ReadInt64());
+  CHECK_EQ_OR_RETURN(row_size, row_size_) << "the rows in " << path << " have another size";
+  const int64_t num_rows = JUST(ReadInt64());
+  CHECK_GE_OR_RETURN(num_rows, 0) << path << " is corrupted";
+  CHECK_EQ_OR_RETURN(file_size, 2 * id_size + num_rows * (id_size + row_size_))
+      << path << " does not hold " << num_rows << " rows";
+  // The rows are read into another table first, a bad file leaves this one as it is.
+  SparseEmbeddingTable loaded(row_size_);
+  FOR_RANGE(int64_t, i, 0, num_rows) {
+    const int64_t id = JUST(ReadInt64());
+    CHECK_OR_RETURN(loaded.FindSlot(id)->row == nullptr) << path << " has id " << id << " twice";
+    Slot* slot = loaded.InsertSlot(id);
+    CHECK_EQ_OR_RETURN(in_stream.ReadFully(slot->row, row_size_), 0) << path << " is truncated";
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  blocks_.swap(loaded.blocks_);
+  std::swap(num_rows_, loaded.num_rows_);
+  slots_.swap(loaded.slots_);
+  return Maybe<void>::Ok();
+}
+
+SparseEmbeddingTable::Slot* SparseEmbeddingTable::FindSlot(int64_t id) const {
+  // The capacity is a power of two and at most half of the slots are used, so probing ends.
+  const uint64_t mask = slots_.size() - 1;
+  uint64_t i = HashId(id) & mask;
+  while (slots_[i].row != nullptr && slots_[i].id != id) { i = (i + 1) & mask; }
+  return const_cast<Slot*>(&slots_[i]);
+}
+
+SparseEmbeddingTable::Slot* SparseEmbeddingTable::InsertSlot(int64_t id) {
+  if (2 * (num_rows_ + 1) > static_cast<int64_t>(slots_.size())) { Rehash(2 * slots_.size()); }
+  Slot* slot = FindSlot(id);
+  CHECK(slot->row == nullptr);
+  slot->id = id;
+  slot->row = NewRow();
+  return slot;
+}
+
+char* SparseEmbeddingTable::NewRow() {
+  const int64_t row_in_block = num_rows_ % rows_per_block_;
+  if (row_in_block == 0) { blocks_.emplace_back(new char[rows_per_block_ * row_size_]()); }
+  num_rows_ += 1;
+  return blocks_.back().get() + row_in_block * row_size_;
+}
+
+void SparseEmbeddingTable::Rehash(int64_t capacity) {
+  std::vector<Slot> old_slots(capacity, Slot{0, nullptr});
+  old_slots.swap(slots_);
+  for (const Slot& slot : old_slots) {
+    if (slot.row != nullptr) { *FindSlot(slot.id) = slot; }
+  }
+}
+
+std::shared_ptr<SparseEmbeddingTable> GetOrCreateSparseEmbeddingTable(const std::string& table_name,
+                                                                      int64_t parallel_id,
+                                                                      int64_t row_size) {
+  SparseEmbeddingTableRegistry* registry = GetSparseEmbeddingTableRegistry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  std::weak_ptr<SparseEmbeddingTable>* weak_table =
+      &registry->table_name2parallel_id2table[table_name][parallel_id];
+  std::shared_ptr<SparseEmbeddingTable> table = weak_table->lock();
+  if (table) {
+    CHECK_EQ(table->row_size(), row_size) << "sparse embedding table " << table_name;
+  } else {
+    table.reset(new SparseEmbeddingTable(row_size));
+    *weak_table = table;
+  }
+  return table;
+}
+
+void SaveSparseEmbeddingTables(const std::string& table_name, const std::string& dir) {
+  const auto parallel_id2table = GetSparseEmbeddingTables(table_name);
+  if (parallel_id2table.empty()) { return; }
+  LocalFS()->RecursivelyCreateDir(dir);
+  for (const auto& pair : parallel_id2table) {
+    pair.second->Save(LocalFS(), JoinPath(dir, SparseEmbeddingTableFileName(pair.first)));
+  }
+}
+
+Maybe<void> LoadSparseEmbeddingTables(const std::string& table_name, const std::string& dir) {
+  for (const auto& pair : GetSparseEmbeddingTables(table_name)) {
+    const std::string path = JoinPath(dir, SparseEmbeddingTableFileName(pair.first));
+    CHECK_OR_RETURN(LocalFS()->FileExists(path))
+        << "the rows of sparse embedding table " << table_name << " are not saved in " << dir;
+    JUST(pair.second->Load(LocalFS(), path));
+  }
+  return Maybe<void>::Ok();
+}
+
+bool IsSparseEmbeddingInitializerSupported(const InitializerConf& initializer_conf) {
+  return initializer_conf.has_constant_conf() || initializer_conf.has_random_uniform_conf()
+         || initializer_conf.has_random_normal_conf();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,128 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SPARSE_EMBEDDING_TABLE_H_
+#define ONEFLOW_USER_KERNELS_SPARSE_EMBEDDING_TABLE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/job/initializer_conf.pb.h"
+#include "oneflow/core/persistence/file_system.h"
+#include <random>
+
+namespace oneflow {
+
+// The rows of an embedding created the first time their ids are seen, so memory grows with the
+// live ids rather than the vocabulary size. A row holds the embedding followed by the optimizer
+// states of the same size. Rows are carved out of blocks that never move, and ids are indexed by
+// an open addressing table with linear probing.
+class SparseEmbeddingTable final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SparseEmbeddingTable);
+  explicit SparseEmbeddingTable(int64_t row_size);
+  ~SparseEmbeddingTable() = default;
+
+  int64_t row_size() const { return row_size_; }
+  int64_t num_rows() const;
+
+  // Sets rows[i] to the row of ids[i]. Rows created by the call are zero filled, then passed to
+  // InitRow together with i, under the lock of the table.
+  template<typename K, typename InitRowT>
+  void FindOrCreateRows(int64_t n, const K* ids, char** rows, const InitRowT& InitRow);
+  void ForEachRow(const std::function<void(int64_t id, const char* row)>& Handler) const;
+  // Writes the ids and the rows to path. Load replaces all rows by the ones written there, and
+  // keeps the table as it is if the file is bad. Neither may run together with the kernels using
+  // the table.
+  void Save(fs::FileSystem* fs, const std::string& path) const;
+  Maybe<void> Load(fs::FileSystem* fs, const std::string& path);
+
+ private:
+  struct Slot {
+    int64_t id;
+    // nullptr for empty slots.
+    char* row;
+  };
+
+  Slot* FindSlot(int64_t id) const;
+  Slot* InsertSlot(int64_t id);
+  char* NewRow();
+  void Rehash(int64_t capacity);
+
+  const int64_t row_size_;
+  const int64_t rows_per_block_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  int64_t num_rows_;
+  std::vector<Slot> slots_;
+  mutable std::mutex mutex_;
+};
+
+template<typename K, typename InitRowT>
+void SparseEmbeddingTable::FindOrCreateRows(int64_t n, const K* ids, char** rows,
+                                            const InitRowT& InitRow) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  FOR_RANGE(int64_t, i, 0, n) {
+    const int64_t id = static_cast<int64_t>(ids[i]);
+    Slot* slot = FindSlot(id);
+    if (slot->row == nullptr) {
+      slot = InsertSlot(id);
+      InitRow(i, slot->row);
+    }
+    rows[i] = slot->row;
+  }
+}
+
+// Tables are shared by the kernels with the same table name and parallel id, and freed with the
+// last of them.
+std::shared_ptr<SparseEmbeddingTable> GetOrCreateSparseEmbeddingTable(const std::string& table_name,
+                                                                      int64_t parallel_id,
+                                                                      int64_t row_size);
+
+// Saves the tables of table_name alive in this process into dir, one file per parallel id. Load
+// fails if dir has no file for one of them. Both do nothing if no table of table_name is alive.
+void SaveSparseEmbeddingTables(const std::string& table_name, const std::string& dir);
+Maybe<void> LoadSparseEmbeddingTables(const std::string& table_name, const std::string& dir);
+
+bool IsSparseEmbeddingInitializerSupported(const InitializerConf& initializer_conf);
+
+// Fills the embedding of a new row from a constant, random uniform or random normal initializer.
+// The values only depend on the seed and the id, so replicas create the same row whichever rank
+// sees the id first.
+template<typename T>
+void InitSparseEmbedding(const InitializerConf& initializer_conf, int64_t seed, int64_t id,
+                         int64_t embedding_size, T* embedding) {
+  if (initializer_conf.has_constant_conf()) {
+    std::fill(embedding, embedding + embedding_size,
+              static_cast<T>(initializer_conf.constant_conf().value()));
+    return;
+  }
+  std::seed_seq seed_seq({static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                          static_cast<uint32_t>(id), static_cast<uint32_t>(id >> 32)});
+  std::mt19937 generator(seed_seq);
+  if (initializer_conf.has_random_uniform_conf()) {
+    const RandomUniformInitializerConf& conf = initializer_conf.random_uniform_conf();
+    std::uniform_real_distribution<T> distribution(conf.min(), conf.max());
+    FOR_RANGE(int64_t, i, 0, embedding_size) { embedding[i] = distribution(generator); }
+  } else if (initializer_conf.has_random_normal_conf()) {
+    const RandomNormalInitializerConf& conf = initializer_conf.random_normal_conf();
+    std::normal_distribution<T> distribution(conf.mean(), conf.std());
+    FOR_RANGE(int64_t, i, 0, embedding_size) { embedding[i] = distribution(generator); }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SPARSE_EMBEDDING_TABLE_H_
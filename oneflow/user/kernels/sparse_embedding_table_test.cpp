@@ -0,0 +1,142 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/sparse_embedding_table.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include <numeric>
+
+namespace oneflow {
+
+namespace {
+
+TEST(SparseEmbeddingTable, find_or_create_rows) {
+  const int64_t embedding_size = 5;
+  SparseEmbeddingTable table(2 * embedding_size * sizeof(float));
+  std::vector<int64_t> ids;
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> distribution(0, int64_t(1) << 40);
+  for (int64_t i = 0; i < 100000; ++i) { ids.push_back(distribution(generator)); }
+  ids.push_back(ids.front());
+  const int64_t num_ids = ids.size();
+  std::vector<char*> rows(num_ids);
+  int64_t num_created = 0;
+  table.FindOrCreateRows(num_ids, ids.data(), rows.data(), [&](int64_t i, char* row) {
+    const float* row_ptr = reinterpret_cast<const float*>(row);
+    ASSERT_TRUE(std::all_of(row_ptr, row_ptr + 2 * embedding_size, [](float x) { return x == 0; }));
+    reinterpret_cast<float*>(row)[0] = ids.at(i);
+    num_created += 1;
+  });
+  ASSERT_EQ(num_created, num_ids - 1);
+  ASSERT_EQ(table.num_rows(), num_ids - 1);
+  ASSERT_EQ(rows.front(), rows.back());
+  // Rows do not move when the index grows.
+  HashMap<int64_t, const char*> id2row;
+  table.ForEachRow([&](int64_t id, const char* row) { id2row[id] = row; });
+  ASSERT_EQ(id2row.size(), num_created);
+  for (int64_t i = 0; i < num_ids; ++i) {
+    ASSERT_EQ(id2row.at(ids.at(i)), rows.at(i));
+    ASSERT_EQ(reinterpret_cast<const float*>(rows.at(i))[0], static_cast<float>(ids.at(i)));
+  }
+}
+
+TEST(SparseEmbeddingTable, shared_by_key) {
+  std::shared_ptr<SparseEmbeddingTable> table = GetOrCreateSparseEmbeddingTable("embedding", 0, 16);
+  ASSERT_EQ(GetOrCreateSparseEmbeddingTable("embedding", 0, 16), table);
+  ASSERT_NE(GetOrCreateSparseEmbeddingTable("embedding", 1, 16), table);
+  const int64_t id = 7;
+  char* row = nullptr;
+  table->FindOrCreateRows(1, &id, &row, [](int64_t i, char* row) {});
+  table.reset();
+  // The table was freed with its last user.
+  table = GetOrCreateSparseEmbeddingTable("embedding", 0, 16);
+  ASSERT_EQ(table->num_rows(), 0);
+}
+
+TEST(SparseEmbeddingTable, save_and_load) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string dir =
+      JoinPath(current_dir, "tmp_sparse_embedding_table_test_" + std::to_string(NewRandomSeed()));
+  const int64_t row_size = 3 * sizeof(int64_t);
+  auto FillRow = [](int64_t i, char* row) { reinterpret_cast<int64_t*>(row)[2] = i; };
+  std::vector<int64_t> ids(5000);
+  std::iota(ids.begin(), ids.end(), -100);
+  std::vector<char*> rows(ids.size());
+  {
+    std::shared_ptr<SparseEmbeddingTable> table =
+        GetOrCreateSparseEmbeddingTable("saved_embedding", 3, row_size);
+    table->FindOrCreateRows(ids.size(), ids.data(), rows.data(), FillRow);
+    SaveSparseEmbeddingTables("saved_embedding", dir);
+  }
+  // Load drops the rows created since the save and keeps no table alive by itself.
+  ASSERT_TRUE(LoadSparseEmbeddingTables("saved_embedding", dir).IsOk());
+  std::shared_ptr<SparseEmbeddingTable> table =
+      GetOrCreateSparseEmbeddingTable("saved_embedding", 3, row_size);
+  const int64_t new_id = 1 << 20;
+  table->FindOrCreateRows(1, &new_id, rows.data(), FillRow);
+  ASSERT_TRUE(LoadSparseEmbeddingTables("saved_embedding", dir).IsOk());
+  ASSERT_EQ(table->num_rows(), ids.size());
+  table->ForEachRow([&](int64_t id, const char* row) {
+    ASSERT_EQ(reinterpret_cast<const int64_t*>(row)[2], id + 100);
+  });
+  // New rows still go to the loaded table.
+  table->FindOrCreateRows(1, &new_id, rows.data(), FillRow);
+  ASSERT_EQ(table->num_rows(), ids.size() + 1);
+  ASSERT_FALSE(
+      LoadSparseEmbeddingTables("saved_embedding", JoinPath(dir, "no_such_dir")).IsOk());
+  // Rows of another size and truncated files fail without touching the table.
+  SparseEmbeddingTable(2 * row_size).Save(LocalFS(), JoinPath(dir, "wide_rows"));
+  ASSERT_FALSE(table->Load(LocalFS(), JoinPath(dir, "wide_rows")).IsOk());
+  table->Save(LocalFS(), JoinPath(dir, "rows"));
+  const int64_t file_size = LocalFS()->GetFileSize(JoinPath(dir, "rows"));
+  std::vector<char> content(file_size);
+  PersistentInStream(LocalFS(), JoinPath(dir, "rows")).ReadFully(content.data(), file_size);
+  {
+    std::unique_ptr<fs::WritableFile> file;
+    LocalFS()->NewWritableFile(JoinPath(dir, "truncated_rows"), &file);
+    file->Append(content.data(), file_size - 5);
+    file->Close();
+  }
+  ASSERT_FALSE(table->Load(LocalFS(), JoinPath(dir, "truncated_rows")).IsOk());
+  ASSERT_EQ(table->num_rows(), ids.size() + 1);
+  ASSERT_TRUE(table->Load(LocalFS(), JoinPath(dir, "rows")).IsOk());
+  ASSERT_EQ(table->num_rows(), ids.size() + 1);
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+TEST(SparseEmbeddingTable, init_embedding) {
+  InitializerConf initializer_conf;
+  initializer_conf.mutable_random_normal_conf()->set_std(2);
+  ASSERT_TRUE(IsSparseEmbeddingInitializerSupported(initializer_conf));
+  std::vector<double> embedding(64);
+  std::vector<double> same_id(64);
+  std::vector<double> other_id(64);
+  InitSparseEmbedding<double>(initializer_conf, 1, 3, 64, embedding.data());
+  InitSparseEmbedding<double>(initializer_conf, 1, 3, 64, same_id.data());
+  InitSparseEmbedding<double>(initializer_conf, 1, 4, 64, other_id.data());
+  ASSERT_EQ(embedding, same_id);
+  ASSERT_NE(embedding, other_id);
+  initializer_conf.mutable_constant_conf()->set_value(0.5);
+  InitSparseEmbedding<double>(initializer_conf, 1, 3, 64, embedding.data());
+  ASSERT_TRUE(std::all_of(embedding.begin(), embedding.end(), [](double x) { return x == 0.5; }));
+  initializer_conf.mutable_xavier_conf();
+  ASSERT_FALSE(IsSparseEmbeddingInitializerSupported(initializer_conf));
+}
+
+}  // namespace
+
+}  // namespace oneflow
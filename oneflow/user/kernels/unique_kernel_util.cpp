@@ -14,9 +14,289 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
+namespace {
+
+// The hash table is open addressing with linear probing and lives in the workspace. It starts
+// small and grows up to twice the key num, rehashing the keys found so far, so a batch with few
+// unique keys does not pay for clearing a table sized for all of them. Slots are picked from the
+// low 32 bits of the hash by multiply and shift, so the capacity need not be a power of two.
+// Inputs of at least kParallelUniqueMinSize keys are radix partitioned by the high bits of their
+// hashes, then the partitions are made unique on the thread pool with a table each.
+constexpr int64_t kMinUniqueTableCapacity = 16;
+// Tables start at this fraction of their largest capacity, which bounds the rehashes to 4.
+constexpr int64_t kUniqueTableInitialFraction = 16;
+constexpr int64_t kParallelUniqueMinSize = 1 << 16;
+constexpr int64_t kUniquePartitionBits = 6;
+constexpr int64_t kUniquePartitionNum = 1 << kUniquePartitionBits;
+// Chunks of the input the partitions are counted and scattered by.
+constexpr int64_t kUniqueChunkNum = 64;
+
+template<typename KEY, typename IDX>
+struct UniqueTableSlot {
+  KEY key;
+  // Negative for empty slots.
+  IDX id;
+};
+
+template<typename KEY>
+typename std::enable_if<std::is_integral<KEY>::value, uint64_t>::type KeyBits(KEY key) {
+  return static_cast<uint64_t>(key);
+}
+
+template<typename KEY>
+typename std::enable_if<std::is_floating_point<KEY>::value, uint64_t>::type KeyBits(KEY key) {
+  // 0.0 and -0.0 are equal, so they must hash the same.
+  if (key == 0) { return 0; }
+  uint64_t bits = 0;
+  std::memcpy(&bits, &key, sizeof(KEY));
+  return bits;
+}
+
+// The 64 bit finalizer of MurmurHash3, all bits of the key affect both ends of the hash.
+template<typename KEY>
+uint64_t HashKey(KEY key) {
+  uint64_t h = KeyBits(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb93fe53ae63bULL;
+  h ^= h >> 33;
+  return h;
+}
+
+int64_t UniqueTableCapacity(int64_t n) { return std::max(2 * n, kMinUniqueTableCapacity); }
+
+// Hands out ids from first_id in the order keys are first found. NaN never equals a slot, so each
+// NaN gets an id of its own like it did with HashMap.
+template<typename KEY, typename IDX>
+class UniqueTable final {
+ public:
+  UniqueTable(UniqueTableSlot<KEY, IDX>* slots, int64_t max_capacity, IDX first_id)
+      : slots_(slots),
+        capacity_(std::max(max_capacity / kUniqueTableInitialFraction,
+                           std::min(kMinUniqueTableCapacity, max_capacity))),
+        max_capacity_(max_capacity),
+        first_id_(first_id),
+        next_id_(first_id) {
+    Reset();
+  }
+  ~UniqueTable() = default;
+
+  IDX size() const { return next_id_ - first_id_; }
+
+  // Key4Id returns the key of an id handed out before, for rehashing.
+  template<typename Key4IdT>
+  IDX FindOrInsert(KEY key, const Key4IdT& Key4Id, bool* inserted) {
+    const uint64_t hash = HashKey(key);
+    int64_t pos = Slot4Hash(hash);
+    while (true) {
+      UniqueTableSlot<KEY, IDX>* slot = slots_ + pos;
+      if (slot->id < 0) { break; }
+      if (slot->key == key) {
+        *inserted = false;
+        return slot->id;
+      }
+      pos = NextSlot(pos);
+    }
+    *inserted = true;
+    const IDX id = next_id_++;
+    if (2 * size() > capacity_ && capacity_ < max_capacity_) {
+      capacity_ = std::min(2 * capacity_, max_capacity_);
+      Reset();
+      FOR_RANGE(IDX, old_id, first_id_, id) { Insert(Key4Id(old_id), old_id); }
+      Insert(key, id);
+    } else {
+      slots_[pos].key = key;
+      slots_[pos].id = id;
+    }
+    return id;
+  }
+
+ private:
+  int64_t Slot4Hash(uint64_t hash) const {
+    return static_cast<int64_t>(((hash & 0xffffffffULL) * capacity_) >> 32);
+  }
+
+  int64_t NextSlot(int64_t pos) const { return pos + 1 == capacity_ ? 0 : pos + 1; }
+
+  void Insert(KEY key, IDX id) {
+    int64_t pos = Slot4Hash(HashKey(key));
+    while (slots_[pos].id >= 0) { pos = NextSlot(pos); }
+    slots_[pos].key = key;
+    slots_[pos].id = id;
+  }
+
+  void Reset() {
+    FOR_RANGE(int64_t, i, 0, capacity_) { slots_[i].id = -1; }
+  }
+
+  UniqueTableSlot<KEY, IDX>* slots_;
+  int64_t capacity_;
+  int64_t max_capacity_;
+  IDX first_id_;
+  IDX next_id_;
+};
+
+int64_t UniquePartition4Hash(uint64_t hash) {
+  return static_cast<int64_t>(hash >> (64 - kUniquePartitionBits));
+}
+
+template<typename KEY, typename IDX>
+int64_t SerialUniqueWorkspaceSize(int64_t n) {
+  return UniqueTableCapacity(n) * sizeof(UniqueTableSlot<KEY, IDX>);
+}
+
+// The workspace of the parallel unique, in order:
+//   chunk_offsets: int64_t[kUniqueChunkNum * kUniquePartitionNum]
+//   positions: IDX[n], the positions of the keys grouped by partition, ascending in each partition
+//   first_positions, counts, global_ids: IDX[n] each, indexed by the partition local ids, which
+//     start at the beginning of their partition in positions
+//   slots: the tables of the partitions
+template<typename KEY, typename IDX>
+int64_t ParallelUniqueWorkspaceSize(int64_t n) {
+  return GetCudaAlignedSize(kUniqueChunkNum * kUniquePartitionNum * sizeof(int64_t))
+         + 4 * GetCudaAlignedSize(n * sizeof(IDX))
+         + (2 * n + kUniquePartitionNum * kMinUniqueTableCapacity)
+               * sizeof(UniqueTableSlot<KEY, IDX>);
+}
+
+template<typename KEY, typename IDX>
+void SerialUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                            IDX* idx_out, IDX* count, void* workspace) {
+  UniqueTable<KEY, IDX> table(reinterpret_cast<UniqueTableSlot<KEY, IDX>*>(workspace),
+                              UniqueTableCapacity(n), 0);
+  const auto Key4Id = [unique_out](IDX id) { return unique_out[id]; };
+  FOR_RANGE(int64_t, i, 0, n) {
+    const KEY key = in[i];
+    bool inserted = false;
+    const IDX idx = table.FindOrInsert(key, Key4Id, &inserted);
+    if (inserted) {
+      unique_out[idx] = key;
+      if (count != nullptr) { count[idx] = 1; }
+    } else if (count != nullptr) {
+      count[idx] += 1;
+    }
+    idx_out[i] = idx;
+  }
+  *num_unique = table.size();
+}
+
+template<typename KEY, typename IDX>
+void ParallelUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                              IDX* idx_out, IDX* count, void* workspace) {
+  char* ptr = reinterpret_cast<char*>(workspace);
+  const auto Carve = [&ptr](int64_t size) {
+    char* begin = ptr;
+    ptr += GetCudaAlignedSize(size);
+    return begin;
+  };
+  auto* chunk_offsets =
+      reinterpret_cast<int64_t*>(Carve(kUniqueChunkNum * kUniquePartitionNum * sizeof(int64_t)));
+  IDX* positions = reinterpret_cast<IDX*>(Carve(n * sizeof(IDX)));
+  IDX* first_positions = reinterpret_cast<IDX*>(Carve(n * sizeof(IDX)));
+  IDX* counts = reinterpret_cast<IDX*>(Carve(n * sizeof(IDX)));
+  IDX* global_ids = reinterpret_cast<IDX*>(Carve(n * sizeof(IDX)));
+  auto* slots = reinterpret_cast<UniqueTableSlot<KEY, IDX>*>(ptr);
+  const int64_t chunk_size = RoundUp(n, kUniqueChunkNum) / kUniqueChunkNum;
+  const auto ChunkBegin = [&](int64_t chunk) { return std::min(chunk * chunk_size, n); };
+
+  // Count the keys of each partition in each chunk, then scatter their positions so that each
+  // partition is a range of positions in ascending order.
+  MultiThreadLoop(kUniqueChunkNum, [&](size_t chunk) {
+    int64_t* offsets = chunk_offsets + chunk * kUniquePartitionNum;
+    std::fill(offsets, offsets + kUniquePartitionNum, 0);
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      offsets[UniquePartition4Hash(HashKey(in[i]))] += 1;
+    }
+  });
+  std::vector<int64_t> partition_begins(kUniquePartitionNum + 1, 0);
+  std::vector<int64_t> table_begins(kUniquePartitionNum, 0);
+  int64_t table_end = 0;
+  FOR_RANGE(int64_t, partition, 0, kUniquePartitionNum) {
+    int64_t offset = partition_begins.at(partition);
+    FOR_RANGE(int64_t, chunk, 0, kUniqueChunkNum) {
+      int64_t* chunk_offset = chunk_offsets + chunk * kUniquePartitionNum + partition;
+      const int64_t chunk_count = *chunk_offset;
+      *chunk_offset = offset;
+      offset += chunk_count;
+    }
+    partition_begins.at(partition + 1) = offset;
+    table_begins.at(partition) = table_end;
+    table_end += UniqueTableCapacity(offset - partition_begins.at(partition));
+  }
+  MultiThreadLoop(kUniqueChunkNum, [&](size_t chunk) {
+    int64_t* offsets = chunk_offsets + chunk * kUniquePartitionNum;
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      positions[offsets[UniquePartition4Hash(HashKey(in[i]))]++] = i;
+    }
+  });
+
+  // Each partition gets local ids in the order of the first occurrences of its keys, idx_out holds
+  // them until the global ids are known.
+  MultiThreadLoop(kUniquePartitionNum, [&](size_t partition) {
+    const int64_t begin = partition_begins.at(partition);
+    const int64_t end = partition_begins.at(partition + 1);
+    UniqueTable<KEY, IDX> table(slots + table_begins.at(partition),
+                                UniqueTableCapacity(end - begin), begin);
+    const auto Key4Id = [in, first_positions](IDX id) { return in[first_positions[id]]; };
+    FOR_RANGE(int64_t, j, begin, end) {
+      const IDX i = positions[j];
+      const KEY key = in[i];
+      bool inserted = false;
+      const IDX local_id = table.FindOrInsert(key, Key4Id, &inserted);
+      if (inserted) {
+        first_positions[local_id] = i;
+        counts[local_id] = 1;
+      } else {
+        counts[local_id] += 1;
+      }
+      idx_out[i] = local_id;
+    }
+  });
+
+  // Keys are numbered in the order of their first occurrences, the same as the serial unique.
+  std::vector<IDX> chunk_unique_nums(kUniqueChunkNum + 1, 0);
+  MultiThreadLoop(kUniqueChunkNum, [&](size_t chunk) {
+    IDX unique_num = 0;
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      if (first_positions[idx_out[i]] == i) { unique_num += 1; }
+    }
+    chunk_unique_nums.at(chunk + 1) = unique_num;
+  });
+  FOR_RANGE(int64_t, chunk, 0, kUniqueChunkNum) {
+    chunk_unique_nums.at(chunk + 1) += chunk_unique_nums.at(chunk);
+  }
+  MultiThreadLoop(kUniqueChunkNum, [&](size_t chunk) {
+    IDX global_id = chunk_unique_nums.at(chunk);
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      const IDX local_id = idx_out[i];
+      if (first_positions[local_id] != i) { continue; }
+      global_ids[local_id] = global_id;
+      unique_out[global_id] = in[i];
+      if (count != nullptr) { count[global_id] = counts[local_id]; }
+      global_id += 1;
+    }
+  });
+  MultiThreadLoop(kUniqueChunkNum, [&](size_t chunk) {
+    FOR_RANGE(int64_t, i, ChunkBegin(chunk), ChunkBegin(chunk + 1)) {
+      idx_out[i] = global_ids[idx_out[i]];
+    }
+  });
+  *num_unique = chunk_unique_nums.back();
+}
+
+template<typename KEY, typename IDX>
+int64_t UniqueWorkspaceSize(int64_t n) {
+  if (n >= kParallelUniqueMinSize) { return ParallelUniqueWorkspaceSize<KEY, IDX>(n); }
+  return SerialUniqueWorkspaceSize<KEY, IDX>(n);
+}
+
+}  // namespace
+
 template<typename KEY, typename IDX>
 struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void Unique(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
@@ -27,31 +307,23 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
+    const int64_t serial_workspace_size = SerialUniqueWorkspaceSize<KEY, IDX>(n);
+    CHECK_GE(workspace_size_in_bytes, serial_workspace_size);
+    const ThreadPool* thread_pool = Global<ThreadPool>::Get();
+    if (n >= kParallelUniqueMinSize && thread_pool != nullptr && thread_pool->thread_num() > 1
+        && workspace_size_in_bytes >= ParallelUniqueWorkspaceSize<KEY, IDX>(n)) {
+      ParallelUniqueWithCounts(n, in, num_unique, unique_out, idx_out, count, workspace);
+    } else {
+      SerialUniqueWithCounts(n, in, num_unique, unique_out, idx_out, count, workspace);
     }
-    *num_unique = map.size();
   }
   static void GetUniqueWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = UniqueWorkspaceSize<KEY, IDX>(n);
   }
   static void GetUniqueWithCountsWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                                       int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = UniqueWorkspaceSize<KEY, IDX>(n);
   }
 };
 
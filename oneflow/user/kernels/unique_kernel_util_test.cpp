@@ -0,0 +1,174 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <chrono>
+#include <random>
+
+namespace oneflow {
+
+namespace {
+
+// The HashMap unique the CPU kernel used to have, ids are in the order of first occurrences.
+template<typename KEY, typename IDX>
+void HashMapUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                             IDX* idx_out, IDX* count) {
+  HashMap<KEY, IDX> map;
+  FOR_RANGE(int64_t, i, 0, n) {
+    auto it = map.find(in[i]);
+    if (it == map.end()) {
+      const IDX idx = map.size();
+      count[idx] = 1;
+      idx_out[i] = idx;
+      unique_out[idx] = in[i];
+      map[in[i]] = idx;
+    } else {
+      count[it->second] += 1;
+      idx_out[i] = it->second;
+    }
+  }
+  *num_unique = map.size();
+}
+
+template<typename KEY, typename IDX>
+struct UniqueResult {
+  explicit UniqueResult(int64_t n) : num_unique(-1), unique_out(n), idx_out(n), count(n) {}
+
+  IDX num_unique;
+  std::vector<KEY> unique_out;
+  std::vector<IDX> idx_out;
+  std::vector<IDX> count;
+};
+
+template<typename KEY, typename IDX>
+void RunUnique(const std::vector<KEY>& in, std::vector<char>* workspace,
+               UniqueResult<KEY, IDX>* result) {
+  UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::UniqueWithCounts(
+      nullptr, in.size(), in.data(), &result->num_unique, result->unique_out.data(),
+      result->idx_out.data(), result->count.data(), workspace->data(), workspace->size());
+}
+
+template<typename KEY, typename IDX>
+void TestUnique(const std::vector<KEY>& in) {
+  const int64_t n = in.size();
+  UniqueResult<KEY, IDX> expected(n);
+  HashMapUniqueWithCounts<KEY, IDX>(n, in.data(), &expected.num_unique,
+                                    expected.unique_out.data(), expected.idx_out.data(),
+                                    expected.count.data());
+  int64_t workspace_size = 0;
+  UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::GetUniqueWithCountsWorkspaceSizeInBytes(
+      nullptr, n, &workspace_size);
+  std::vector<char> workspace(workspace_size);
+  UniqueResult<KEY, IDX> result(n);
+  RunUnique<KEY, IDX>(in, &workspace, &result);
+  ASSERT_EQ(result.num_unique, expected.num_unique);
+  // Compares bits, each NaN is a key of its own.
+  ASSERT_EQ(std::memcmp(result.unique_out.data(), expected.unique_out.data(),
+                        expected.num_unique * sizeof(KEY)),
+            0);
+  ASSERT_EQ(result.idx_out, expected.idx_out);
+  result.count.resize(expected.num_unique);
+  expected.count.resize(expected.num_unique);
+  ASSERT_EQ(result.count, expected.count);
+}
+
+// Keys drawn from [0, key_range), skew > 1 favors the small ones.
+std::vector<int64_t> RandomKeys(int64_t n, int64_t key_range, double skew) {
+  std::mt19937 gen(n + key_range);
+  std::uniform_real_distribution<double> dis(0, 1);
+  std::vector<int64_t> keys(n);
+  for (int64_t& key : keys) {
+    key = static_cast<int64_t>(std::pow(dis(gen), skew) * key_range) * 7919;
+  }
+  return keys;
+}
+
+void TestUniqueWithSizes() {
+  for (int64_t n : {0, 1, 100, 5000, 70000, 300000}) {
+    for (double skew : {1.0, 4.0}) {
+      const std::vector<int64_t> keys = RandomKeys(n, std::max<int64_t>(n / 3, 1), skew);
+      TestUnique<int64_t, int32_t>(keys);
+      TestUnique<int64_t, int64_t>(keys);
+      TestUnique<int32_t, int32_t>(std::vector<int32_t>(keys.begin(), keys.end()));
+      std::vector<float> float_keys(keys.begin(), keys.end());
+      if (n > 100) {
+        float_keys.at(0) = 0.0f;
+        float_keys.at(1) = -0.0f;
+        float_keys.at(2) = std::numeric_limits<float>::quiet_NaN();
+        float_keys.at(n - 1) = std::numeric_limits<float>::quiet_NaN();
+      }
+      TestUnique<float, int32_t>(float_keys);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(UniqueKernelUtil, cpu_serial) { TestUniqueWithSizes(); }
+
+TEST(UniqueKernelUtil, cpu_parallel) {
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(4); }
+  TestUniqueWithSizes();
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(UniqueKernelUtil, DISABLED_cpu_benchmark) {
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(std::thread::hardware_concurrency()); }
+  const int64_t n = 1 << 22;
+  const auto Time = [](const std::function<void()>& Run) {
+    Run();
+    const auto start = std::chrono::steady_clock::now();
+    const int repeat = 3;
+    for (int i = 0; i < repeat; ++i) { Run(); }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+               .count()
+           / repeat;
+  };
+  // Feature ids that are all distinct, uniform, skewed, and all the same.
+  const std::vector<std::pair<int64_t, double>> cases = {
+      {n * 1000, 1.0}, {n / 8, 1.0}, {n / 8, 8.0}, {1, 1.0}};
+  for (const auto& pair : cases) {
+    const std::vector<int64_t> keys = RandomKeys(n, pair.first, pair.second);
+    UniqueResult<int64_t, int32_t> expected(n);
+    const double hash_map_ms = Time([&]() {
+      HashMapUniqueWithCounts<int64_t, int32_t>(n, keys.data(), &expected.num_unique,
+                                                expected.unique_out.data(),
+                                                expected.idx_out.data(), expected.count.data());
+    });
+    int64_t workspace_size = 0;
+    UniqueKernelUtil<DeviceType::kCPU, int64_t, int32_t>::GetUniqueWithCountsWorkspaceSizeInBytes(
+        nullptr, n, &workspace_size);
+    std::vector<char> workspace(workspace_size);
+    // Enough for the 2 * n slots of the serial table only.
+    std::vector<char> serial_workspace(2 * n * 2 * sizeof(int64_t));
+    UniqueResult<int64_t, int32_t> result(n);
+    const double serial_ms =
+        Time([&]() { RunUnique<int64_t, int32_t>(keys, &serial_workspace, &result); });
+    ASSERT_EQ(result.idx_out, expected.idx_out);
+    const double parallel_ms =
+        Time([&]() { RunUnique<int64_t, int32_t>(keys, &workspace, &result); });
+    ASSERT_EQ(result.idx_out, expected.idx_out);
+    std::cout << "unique " << n << " keys, " << expected.num_unique << " unique: " << hash_map_ms
+              << " ms HashMap, " << serial_ms << " ms table, " << parallel_ms << " ms "
+              << Global<ThreadPool>::Get()->thread_num() << " partitioned tables" << std::endl;
+  }
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+}  // namespace oneflow
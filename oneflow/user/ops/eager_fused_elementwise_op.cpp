@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+// Created by the eager elementwise fusion window, see eager_elementwise_fusion.h for the program.
+REGISTER_NO_GRAD_CPU_ONLY_USER_OP("eager_fused_elementwise")
+    .InputWithMinimum("in", 1)
+    .OutputWithMinimum("out", 1)
+    .Attr<std::vector<int32_t>>("program")
+    .Attr<std::vector<float>>("scalars")
+    .Attr<std::vector<int32_t>>("output_value_ids")
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      const user_op::TensorDesc& in_0 = ctx->InputTensorDesc("in", 0);
+      for (const auto& pair : ctx->inputs()) {
+        CHECK_EQ_OR_RETURN(ctx->InputShape(pair.first, pair.second), in_0.shape());
+      }
+      const auto& output_value_ids = ctx->Attr<std::vector<int32_t>>("output_value_ids");
+      CHECK_EQ_OR_RETURN(ctx->output_size("out"), output_value_ids.size());
+      FOR_RANGE(int32_t, i, 0, ctx->output_size("out")) {
+        *ctx->OutputShape("out", i) = in_0.shape();
+        *ctx->OutputIsDynamic("out", i) = in_0.is_dynamic();
+      }
+      return Maybe<void>::Ok();
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      const user_op::TensorDesc& in_0 = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0);
+      FOR_RANGE(int64_t, i, 0, in_0.shape().NumAxes()) {
+        ctx->NewBuilder().Split(ctx->inputs(), i).Split(ctx->outputs(), i).Build();
+      }
+      return Maybe<void>::Ok();
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      const DataType data_type = ctx->InputDType("in", 0);
+      for (const auto& pair : ctx->inputs()) {
+        CHECK_EQ_OR_RETURN(ctx->InputDType(pair.first, pair.second), data_type);
+      }
+      FOR_RANGE(int32_t, i, 0, ctx->output_size("out")) { *ctx->OutputDType("out", i) = data_type; }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
@@ -427,6 +427,94 @@ Maybe<void> InferLarsUpdateDataType(user_op::InferContext* ctx) {
   }
   return Maybe<void>::Ok();
 }
+// The model_diff and the optimizer states of the i-th model are the i-th of their inputs.
+Maybe<void> InferMultiTensorUpdateTensorDesc(user_op::InferContext* ctx,
+                                             const std::vector<std::string>& state_arg_names) {
+  const int64_t model_num = ctx->input_size("model");
+  CHECK_EQ_OR_RETURN(ctx->input_size("model_diff"), model_num);
+  for (const std::string& arg_name : state_arg_names) {
+    CHECK_EQ_OR_RETURN(ctx->input_size(arg_name), model_num);
+  }
+  FOR_RANGE(int64_t, i, 0, model_num) {
+    const user_op::TensorDesc& model = ctx->InputTensorDesc("model", i);
+    const user_op::TensorDesc& model_diff = ctx->InputTensorDesc("model_diff", i);
+    CHECK_EQ_OR_RETURN(model_diff.shape(), model.shape());
+    for (const std::string& arg_name : state_arg_names) {
+      const user_op::TensorDesc& state = ctx->InputTensorDesc(arg_name, i);
+      JUST(CheckShapeLike(&state, &model));
+    }
+  }
+  JUST(CheckLearningRateShape(ctx));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const auto& scale_by_tensor = ctx->InputTensorDesc("scale_by_tensor", 0);
+    JUST(CheckScalarShape(&scale_by_tensor));
+  }
+  return Maybe<void>::Ok();
+}
+Maybe<void> InferMultiTensorUpdateDataType(user_op::InferContext* ctx,
+                                           const std::vector<std::string>& state_arg_names) {
+  const user_op::TensorDesc& first_model = ctx->InputTensorDesc("model", 0);
+  FOR_RANGE(int64_t, i, 0, ctx->input_size("model")) {
+    const user_op::TensorDesc& model = ctx->InputTensorDesc("model", i);
+    JUST(CheckDataTypeLike(&model, &first_model));
+    const user_op::TensorDesc& model_diff = ctx->InputTensorDesc("model_diff", i);
+    JUST(CheckDataTypeLike(&model_diff, &first_model));
+    for (const std::string& arg_name : state_arg_names) {
+      const user_op::TensorDesc& state = ctx->InputTensorDesc(arg_name, i);
+      JUST(CheckDataTypeLike(&state, &first_model));
+    }
+  }
+  JUST(CheckLearningRateDataType(ctx));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const auto& scale_by_tensor = ctx->InputTensorDesc("scale_by_tensor", 0);
+    JUST(CheckScalarDataType(&scale_by_tensor, first_model.data_type()));
+  }
+  return Maybe<void>::Ok();
+}
+Maybe<void> GetMultiTensorUpdateSbp(user_op::SbpContext* ctx,
+                                    const std::vector<std::string>& state_arg_names) {
+  const int64_t model_num = ctx->user_op_conf().input_size("model");
+  ctx->NewBuilder().Broadcast(ctx->inputs()).Build();
+  int64_t min_num_axes = ctx->LogicalTensorDesc4InputArgNameAndIndex("model", 0).shape().NumAxes();
+  FOR_RANGE(int64_t, i, 1, model_num) {
+    min_num_axes = std::min(
+        min_num_axes, ctx->LogicalTensorDesc4InputArgNameAndIndex("model", i).shape().NumAxes());
+  }
+  FOR_RANGE(int64_t, axis, 0, min_num_axes) {
+    user_op::UserOpSbpSignatureBuilder builder = ctx->NewBuilder();
+    builder.Broadcast(ctx->inputs());
+    FOR_RANGE(int64_t, i, 0, model_num) {
+      builder.Split(user_op::OpArg("model", i), axis)
+          .Split(user_op::OpArg("model_diff", i), axis);
+      for (const std::string& arg_name : state_arg_names) {
+        builder.Split(user_op::OpArg(arg_name, i), axis);
+      }
+    }
+    builder.Build();
+  }
+  return Maybe<void>::Ok();
+}
+Maybe<void> MultiTensorUpdateInputArgModifyFn(
+    const user_op::GetInputArgModifier& GetInputArgModifierFn,
+    const user_op::UserOpConfWrapper& conf, const std::vector<std::string>& state_arg_names) {
+  FOR_RANGE(int32_t, i, 0, conf.input_size("model")) {
+    JUST(SetInputArgModifierMutable(GetInputArgModifierFn, "model", i));
+    for (const std::string& arg_name : state_arg_names) {
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, arg_name, i));
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+const std::vector<std::string>& MomentumStateArgNames() {
+  static const std::vector<std::string> arg_names{"momentum"};
+  return arg_names;
+}
+const std::vector<std::string>& AdamStateArgNames() {
+  static const std::vector<std::string> arg_names{"m", "v", "max_v"};
+  return arg_names;
+}
+
 REGISTER_NO_GRAD_USER_OP("sgd_update")
     .Input("model")
     .Input("model_diff")
@@ -782,6 +870,96 @@ REGISTER_NO_GRAD_USER_OP("lars_update")
     .SetInputArgModifyFn(LarsUpdateInputArgModifyFn)
     .SetDataTypeInferFn(InferLarsUpdateDataType);
 
+REGISTER_NO_GRAD_USER_OP("multi_tensor_sgd_update")
+    .InputWithMinimum("model", 1)
+    .InputWithMinimum("model_diff", 1)
+    .OptionalInput("learning_rate")
+    .OptionalInput("scale_by_tensor")
+    .OptionalInput("skip_if")
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<double>("scale", 1.0)
+    .Attr<float>("l1", 0.0)
+    .Attr<float>("l2", 0.0)
+    .Attr<float>("weight_decay", 0.0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateTensorDesc(ctx, {});
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      return GetMultiTensorUpdateSbp(ctx, {});
+    })
+    .SetInputArgModifyFn([](const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                            const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+      return MultiTensorUpdateInputArgModifyFn(GetInputArgModifierFn, conf, {});
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateDataType(ctx, {});
+    });
+
+REGISTER_NO_GRAD_USER_OP("multi_tensor_momentum_update")
+    .InputWithMinimum("model", 1)
+    .InputWithMinimum("model_diff", 1)
+    .InputWithMinimum("momentum", 1)
+    .OptionalInput("learning_rate")
+    .OptionalInput("scale_by_tensor")
+    .OptionalInput("skip_if")
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<double>("scale", 1.0)
+    .Attr<float>("l1", 0.0)
+    .Attr<float>("l2", 0.0)
+    .Attr<float>("beta", 0.9)
+    .Attr<float>("weight_decay", 0.0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateTensorDesc(ctx, MomentumStateArgNames());
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      return GetMultiTensorUpdateSbp(ctx, MomentumStateArgNames());
+    })
+    .SetInputArgModifyFn([](const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                            const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+      return MultiTensorUpdateInputArgModifyFn(GetInputArgModifierFn, conf,
+                                               MomentumStateArgNames());
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateDataType(ctx, MomentumStateArgNames());
+    });
+
+REGISTER_NO_GRAD_USER_OP("multi_tensor_adam_update")
+    .InputWithMinimum("model", 1)
+    .InputWithMinimum("model_diff", 1)
+    .OptionalInput("learning_rate")
+    .OptionalInput("scale_by_tensor")
+    .OptionalInput("skip_if")
+    .OptionalInput("bias_correction1")
+    .OptionalInput("bias_correction2")
+    .InputWithMinimum("m", 1)
+    .InputWithMinimum("v", 1)
+    .InputWithMinimum("max_v", 1)
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<float>("bias_correction1_val", 1.0)
+    .Attr<float>("bias_correction2_val", 1.0)
+    .Attr<double>("scale", 1.0)
+    .Attr<float>("l1", 0.0)
+    .Attr<float>("l2", 0.0)
+    .Attr<float>("beta1", 0.9)
+    .Attr<float>("beta2", 0.999)
+    .Attr<float>("epsilon", 1e-8)
+    .Attr<float>("weight_decay", 0.0)
+    .Attr<bool>("amsgrad", false)
+    .Attr<bool>("do_bias_correction", true)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateTensorDesc(ctx, AdamStateArgNames());
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      return GetMultiTensorUpdateSbp(ctx, AdamStateArgNames());
+    })
+    .SetInputArgModifyFn([](const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                            const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+      return MultiTensorUpdateInputArgModifyFn(GetInputArgModifierFn, conf, AdamStateArgNames());
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferMultiTensorUpdateDataType(ctx, AdamStateArgNames());
+    });
+
 }  // namespace
 
 }  // namespace oneflow
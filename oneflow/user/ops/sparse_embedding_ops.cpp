@@ -0,0 +1,210 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/job/initializer_conf.pb.h"
+#include "oneflow/user/kernels/sparse_embedding_table.h"
+
+namespace oneflow {
+
+namespace {
+
+// The model of these ops is a placeholder variable, it only orders them with the other users of
+// the model. The embedding and its optimizer states live in the sparse embedding table.
+Maybe<void> CheckSparseEmbeddingAttrs(user_op::InferContext* ctx) {
+  CHECK_OR_RETURN(!ctx->Attr<std::string>("table_name").empty());
+  CHECK_GT_OR_RETURN(ctx->Attr<int64_t>("embedding_size"), 0);
+  CHECK_GE_OR_RETURN(ctx->Attr<int64_t>("num_states"), 0);
+  InitializerConf initializer_conf;
+  CHECK_OR_RETURN(
+      TxtString2PbMessage(ctx->Attr<std::string>("initializer_conf"), &initializer_conf));
+  CHECK_OR_RETURN(IsSparseEmbeddingInitializerSupported(initializer_conf))
+      << "sparse embeddings only support constant, random uniform and random normal initializers";
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckOptionalScalarInput(user_op::InferContext* ctx, const std::string& arg_name) {
+  if (ctx->has_input(arg_name, 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputTensorDesc(arg_name, 0).shape(), Shape({1}));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckOptionalScalarInputDataType(user_op::InferContext* ctx,
+                                             const std::string& arg_name, DataType data_type) {
+  if (ctx->has_input(arg_name, 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputTensorDesc(arg_name, 0).data_type(), data_type);
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferSparseEmbeddingUpdateTensorDesc(user_op::InferContext* ctx,
+                                                 int64_t num_states) {
+  JUST(CheckSparseEmbeddingAttrs(ctx));
+  CHECK_EQ_OR_RETURN(ctx->Attr<int64_t>("num_states"), num_states);
+  const Shape& indices_shape = ctx->InputTensorDesc("model_diff_indices", 0).shape();
+  const Shape& values_shape = ctx->InputTensorDesc("model_diff_values", 0).shape();
+  CHECK_EQ_OR_RETURN(values_shape.NumAxes(), indices_shape.NumAxes() + 1);
+  FOR_RANGE(int64_t, i, 0, indices_shape.NumAxes()) {
+    CHECK_EQ_OR_RETURN(values_shape.At(i), indices_shape.At(i));
+  }
+  CHECK_EQ_OR_RETURN(values_shape.At(indices_shape.NumAxes()),
+                     ctx->Attr<int64_t>("embedding_size"));
+  JUST(CheckOptionalScalarInput(ctx, "learning_rate"));
+  JUST(CheckOptionalScalarInput(ctx, "skip_if"));
+  JUST(CheckOptionalScalarInput(ctx, "bias_correction1"));
+  JUST(CheckOptionalScalarInput(ctx, "bias_correction2"));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferSparseEmbeddingUpdateDataType(user_op::InferContext* ctx) {
+  CHECK_OR_RETURN(IsIndexDataType(ctx->InputDType("model_diff_indices", 0)));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("model_diff_values", 0), ctx->InputDType("model", 0));
+  JUST(CheckOptionalScalarInputDataType(ctx, "learning_rate", DataType::kFloat));
+  JUST(CheckOptionalScalarInputDataType(ctx, "skip_if", DataType::kInt64));
+  JUST(CheckOptionalScalarInputDataType(ctx, "bias_correction1", DataType::kFloat));
+  JUST(CheckOptionalScalarInputDataType(ctx, "bias_correction2", DataType::kFloat));
+  return Maybe<void>::Ok();
+}
+
+// Every rank updates its replica of the table with all the diffs, like a broadcast model.
+Maybe<void> GetSparseEmbeddingUpdateSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder().Broadcast(ctx->inputs()).Build();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SparseEmbeddingUpdateInputArgModifyFn(
+    const user_op::GetInputArgModifier& GetInputArgModifierFn,
+    const user_op::UserOpConfWrapper& conf) {
+  user_op::InputArgModifier* model_modifier = GetInputArgModifierFn("model", 0);
+  CHECK_NOTNULL_OR_RETURN(model_modifier);
+  model_modifier->set_is_mutable(true);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_NO_GRAD_USER_OP("sparse_embedding_lookup")
+    .Input("ids")
+    .Input("model")
+    .Output("out")
+    .Attr<std::string>("table_name")
+    .Attr<int64_t>("embedding_size")
+    .Attr<int64_t>("num_states", 0)
+    .Attr<std::string>("initializer_conf")
+    .Attr<int64_t>("seed", 0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      JUST(CheckSparseEmbeddingAttrs(ctx));
+      const user_op::TensorDesc& ids = ctx->InputTensorDesc("ids", 0);
+      CHECK_GT_OR_RETURN(ids.shape().NumAxes(), 0);
+      DimVector dim_vec = ids.shape().dim_vec();
+      dim_vec.push_back(ctx->Attr<int64_t>("embedding_size"));
+      user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+      *out->mut_shape() = Shape(dim_vec);
+      out->set_is_dynamic(ids.is_dynamic());
+      return Maybe<void>::Ok();
+    })
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      const int64_t ids_num_axes =
+          ctx->LogicalTensorDesc4InputArgNameAndIndex("ids", 0).shape().NumAxes();
+      FOR_RANGE(int64_t, i, 0, ids_num_axes) {
+        ctx->NewBuilder()
+            .Split(user_op::OpArg("ids", 0), i)
+            .Broadcast(user_op::OpArg("model", 0))
+            .Split(user_op::OpArg("out", 0), i)
+            .Build();
+      }
+      ctx->NewBuilder().Broadcast(ctx->inputs()).Broadcast(ctx->outputs()).Build();
+      return Maybe<void>::Ok();
+    })
+    .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      CHECK_OR_RETURN(IsIndexDataType(ctx->InputDType("ids", 0)));
+      *ctx->OutputDType("out", 0) = ctx->InputDType("model", 0);
+      return Maybe<void>::Ok();
+    });
+
+REGISTER_NO_GRAD_USER_OP("sparse_embedding_sgd_update")
+    .Input("model")
+    .Input("model_diff_indices")
+    .Input("model_diff_values")
+    .OptionalInput("learning_rate")
+    .OptionalInput("skip_if")
+    .Attr<std::string>("table_name")
+    .Attr<int64_t>("embedding_size")
+    .Attr<int64_t>("num_states", 0)
+    .Attr<std::string>("initializer_conf")
+    .Attr<int64_t>("seed", 0)
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<float>("weight_decay", 0.0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferSparseEmbeddingUpdateTensorDesc(ctx, 0);
+    })
+    .SetGetSbpFn(GetSparseEmbeddingUpdateSbp)
+    .SetInputArgModifyFn(SparseEmbeddingUpdateInputArgModifyFn)
+    .SetDataTypeInferFn(InferSparseEmbeddingUpdateDataType);
+
+REGISTER_NO_GRAD_USER_OP("sparse_embedding_momentum_update")
+    .Input("model")
+    .Input("model_diff_indices")
+    .Input("model_diff_values")
+    .OptionalInput("learning_rate")
+    .OptionalInput("skip_if")
+    .Attr<std::string>("table_name")
+    .Attr<int64_t>("embedding_size")
+    .Attr<int64_t>("num_states", 1)
+    .Attr<std::string>("initializer_conf")
+    .Attr<int64_t>("seed", 0)
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<float>("beta", 0.9)
+    .Attr<float>("weight_decay", 0.0)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      return InferSparseEmbeddingUpdateTensorDesc(ctx, 1);
+    })
+    .SetGetSbpFn(GetSparseEmbeddingUpdateSbp)
+    .SetInputArgModifyFn(SparseEmbeddingUpdateInputArgModifyFn)
+    .SetDataTypeInferFn(InferSparseEmbeddingUpdateDataType);
+
+REGISTER_NO_GRAD_USER_OP("sparse_embedding_adam_update")
+    .Input("model")
+    .Input("model_diff_indices")
+    .Input("model_diff_values")
+    .OptionalInput("learning_rate")
+    .OptionalInput("skip_if")
+    .OptionalInput("bias_correction1")
+    .OptionalInput("bias_correction2")
+    .Attr<std::string>("table_name")
+    .Attr<int64_t>("embedding_size")
+    .Attr<int64_t>("num_states", 2)
+    .Attr<std::string>("initializer_conf")
+    .Attr<int64_t>("seed", 0)
+    .Attr<float>("learning_rate_val", 0.0)
+    .Attr<float>("bias_correction1_val", 1.0)
+    .Attr<float>("bias_correction2_val", 1.0)
+    .Attr<float>("beta1", 0.9)
+    .Attr<float>("beta2", 0.999)
+    .Attr<float>("epsilon", 1e-8)
+    .Attr<float>("weight_decay", 0.0)
+    .Attr<bool>("amsgrad", false)
+    .Attr<bool>("do_bias_correction", true)
+    .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      // m and v, and max_v with amsgrad.
+      return InferSparseEmbeddingUpdateTensorDesc(ctx, ctx->Attr<bool>("amsgrad") ? 3 : 2);
+    })
+    .SetGetSbpFn(GetSparseEmbeddingUpdateSbp)
+    .SetInputArgModifyFn(SparseEmbeddingUpdateInputArgModifyFn)
+    .SetDataTypeInferFn(InferSparseEmbeddingUpdateDataType);
+
+}  // namespace oneflow
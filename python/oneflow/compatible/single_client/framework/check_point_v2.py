@@ -291,6 +291,9 @@ def _SaveVarDict(
                 f.write(slice.tobytes())
         with open(os.path.join(var_dir, META_INFO_FILENAME), "w") as f:
             f.write(text_format.MessageToString(meta_info))
+        # A variable kept in a sparse embedding table is a placeholder, the rows
+        # live in the table.
+        oneflow._oneflow_internal.SaveSparseEmbeddingTables(name, var_dir)
     with open(os.path.join(path, "snapshot_done"), "w"):
         pass
 
@@ -502,6 +505,10 @@ def LoadVariables(value_dict: Dict[str, ValueContainer], ignore_mismatch: bool =
             var_blob = interface_op_read_and_write.GetEagerInterfaceBlob(name)
             scope_symbol_id = _GetScopeSymbolIdFromEagerBlob(var_blob)
             FeedValueToVariable(var_blob, value, scope_symbol_id)
+            if isinstance(value, FileBackendVariableBlob):
+                oneflow._oneflow_internal.LoadSparseEmbeddingTables(
+                    name, value.var_dir_
+                )
         elif not ignore_mismatch:
             raise RuntimeError('"{}" is not a variable name'.format(name))
     oneflow._oneflow_internal.eager.single_client.Sync()
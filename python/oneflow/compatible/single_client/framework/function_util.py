@@ -351,10 +351,24 @@ def policy_time_line(func_desc):
     return "use_time_line_algo"
 
 
+@oneflow_function_config("static_mem_alloc_policy_white_list.policy_lifetime_packing")
+def policy_lifetime_packing(func_desc):
+    """A static memory allocation policy called: lifetime_packing
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_lifetime_packing_algo"
+
+
 @oneflow_function_config("static_mem_alloc_algo_white_list.show")
 def show_static_mem_alloc_algo_white_list(func_desc):
     """Show configuration of  static memory allocation policy,
-          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo"
+          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo",
+          "use_lifetime_packing_algo"
 
     Args:
         func_desc ([type]): [description]
@@ -366,6 +380,7 @@ def show_static_mem_alloc_algo_white_list(func_desc):
         "use_mem_size_first_algo",
         "use_mutual_exclusion_first_algo",
         "use_time_line_algo",
+        "use_lifetime_packing_algo",
     ]
 
 
@@ -796,6 +811,11 @@ def set_model_update_conf(func_desc, value):
 def set_indexed_slices_optimizer_conf(func_desc, value):
     """Set indexed slices configuration of optimizer
 
+    With "lazy_sparse_rows": True, the rows of CPU embeddings and of their optimizer
+    states are created the first time their ids are seen. flow.checkpoint.save and
+    flow.load_variables save and load these rows, and other jobs can not read the
+    embeddings.
+
     Args:
         func_desc ([type]): [description]
         value ([type]): [description]
@@ -0,0 +1,207 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import tempfile
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from test_util import GenArgList
+
+import oneflow.compatible.single_client.unittest
+from oneflow.compatible import single_client as flow
+from oneflow.compatible.single_client import typing as oft
+
+vocab_size = 100000
+embedding_size = 16
+batch_size = 64
+
+
+optimizer_state_nums = {"sgd": 0, "momentum": 1, "adam": 2}
+
+
+def make_optimizer(optimizer_type):
+    lr_scheduler = flow.optimizer.PiecewiseConstantScheduler([], [0.1])
+    if optimizer_type == "sgd":
+        return flow.optimizer.SGD(lr_scheduler, momentum=0)
+    elif optimizer_type == "momentum":
+        return flow.optimizer.SGD(lr_scheduler, momentum=0.9)
+    elif optimizer_type == "adam":
+        return flow.optimizer.Adam(lr_scheduler)
+    raise NotImplementedError(optimizer_type)
+
+
+def get_embedding(initializer):
+    return flow.get_variable(
+        "embedding",
+        shape=(vocab_size, embedding_size),
+        dtype=flow.float,
+        initializer=initializer,
+        trainable=True,
+    )
+
+
+def make_func_config(lazy_sparse_rows):
+    func_config = flow.FunctionConfig()
+    func_config.default_data_type(flow.float)
+    func_config.indexed_slices_optimizer_conf(
+        dict(
+            include_op_names=dict(op_name=["embedding"]),
+            lazy_sparse_rows=lazy_sparse_rows,
+        )
+    )
+    return func_config
+
+
+def make_embedding_job(optimizer_type, initializer, lazy_sparse_rows):
+    @flow.global_function(
+        type="train", function_config=make_func_config(lazy_sparse_rows)
+    )
+    def EmbeddingJob(
+        ids: oft.Numpy.Placeholder((batch_size,), dtype=flow.int32),
+        targets: oft.Numpy.Placeholder((batch_size, embedding_size)),
+    ):
+        with flow.scope.placement("cpu", "0:0"):
+            out = flow.gather(params=get_embedding(initializer), indices=ids)
+            loss = flow.math.reduce_sum(flow.math.square(out - targets))
+            make_optimizer(optimizer_type).minimize(loss)
+        return out
+
+    return EmbeddingJob
+
+
+def make_predict_job(initializer):
+    @flow.global_function(function_config=make_func_config(True))
+    def PredictJob(ids: oft.Numpy.Placeholder((batch_size,), dtype=flow.int32)):
+        with flow.scope.placement("cpu", "0:0"):
+            return flow.gather(params=get_embedding(initializer), indices=ids)
+
+    return PredictJob
+
+
+def train_embedding(optimizer_type, initializer, lazy_sparse_rows, ids, targets):
+    flow.clear_default_session()
+    job = make_embedding_job(optimizer_type, initializer, lazy_sparse_rows)
+    return [job(ids[i], targets[i]).get().numpy() for i in range(len(ids))]
+
+
+def random_ids_and_targets(train_iters):
+    ids = np.random.randint(0, 1000, size=(train_iters, batch_size)).astype(np.int32)
+    targets = np.random.uniform(
+        -1, 1, size=(train_iters, batch_size, embedding_size)
+    ).astype(np.float32)
+    return (ids, targets)
+
+
+def check_sparse_rows(test_case, optimizer_type, ids):
+    """Checks that the embedding of the session is kept in a sparse embedding table
+    with a row for each distinct id."""
+    test_case.assertEqual(tuple(flow.get_all_variables()["embedding"].shape), (1,))
+    with tempfile.TemporaryDirectory() as save_dir:
+        flow.checkpoint.save(save_dir)
+        rows_path = os.path.join(save_dir, "embedding", "sparse_rows_0")
+        row_size = (1 + optimizer_state_nums[optimizer_type]) * embedding_size * 4
+        # The row size and the row num, then the id and the row of each row.
+        row_num = (os.path.getsize(rows_path) - 16) // (8 + row_size)
+    test_case.assertEqual(row_num, len(np.unique(ids)))
+    test_case.assertLess(row_num, vocab_size)
+
+
+def compare_lazy_sparse_rows_with_dense(test_case, optimizer_type):
+    (ids, targets) = random_ids_and_targets(5)
+    initializer = flow.constant_initializer(0.5)
+    dense = train_embedding(optimizer_type, initializer, False, ids, targets)
+    lazy = train_embedding(optimizer_type, initializer, True, ids, targets)
+    check_sparse_rows(test_case, optimizer_type, ids)
+    for (dense_out, lazy_out) in zip(dense, lazy):
+        test_case.assertTrue(np.allclose(dense_out, lazy_out, rtol=1e-5, atol=1e-5))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestSparseEmbedding(flow.unittest.TestCase):
+    def test_lazy_sparse_rows(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["optimizer_type"] = ["sgd", "momentum", "adam"]
+        for arg in GenArgList(arg_dict):
+            compare_lazy_sparse_rows_with_dense(test_case, *arg)
+
+    def test_lazy_sparse_rows_init(test_case):
+        ids = np.random.randint(0, vocab_size, size=(2, batch_size)).astype(np.int32)
+        ids[1] = ids[0]
+        targets = np.zeros((2, batch_size, embedding_size), dtype=np.float32)
+        initializer = flow.random_normal_initializer(stddev=1.0)
+        (first, second) = train_embedding("sgd", initializer, True, ids, targets)
+        # Rows are created once, whichever position their ids come first in.
+        for i in range(batch_size):
+            j = list(ids[0]).index(ids[0][i])
+            test_case.assertTrue(np.array_equal(first[i], first[j]))
+        test_case.assertGreater(len(np.unique(first[:, 0])), 1)
+        # The diffs of an id seen n times sum to 2 * n * row with zero targets.
+        counts = {i: list(ids[0]).count(i) for i in ids[0]}
+        for i in range(batch_size):
+            scale = 1 - 2 * 0.1 * counts[ids[0][i]]
+            test_case.assertTrue(
+                np.allclose(second[i], first[i] * scale, rtol=1e-4, atol=1e-5)
+            )
+
+    def test_lazy_sparse_rows_checkpoint(test_case):
+        (ids, targets) = random_ids_and_targets(6)
+        # Rows first seen after the load are initialized alike in both sessions.
+        initializer = flow.constant_initializer(0.5)
+        expected = train_embedding("adam", initializer, True, ids, targets)
+        with tempfile.TemporaryDirectory() as save_dir:
+            flow.clear_default_session()
+            job = make_embedding_job("adam", initializer, True)
+            for i in range(3):
+                job(ids[i], targets[i]).get()
+            flow.checkpoint.save(save_dir)
+            flow.clear_default_session()
+            job = make_embedding_job("adam", initializer, True)
+            flow.load_variables(flow.checkpoint.get(save_dir))
+            results = [job(ids[i], targets[i]).get().numpy() for i in range(3, 6)]
+            check_sparse_rows(test_case, "adam", ids)
+        for (result, expected_result) in zip(results, expected[3:]):
+            test_case.assertTrue(
+                np.allclose(result, expected_result, rtol=1e-5, atol=1e-5)
+            )
+
+    def test_other_job_can_not_read_sparse_rows(test_case):
+        initializer = flow.constant_initializer(0.5)
+        (ids, targets) = random_ids_and_targets(1)
+        flow.clear_default_session()
+        job = make_embedding_job("sgd", initializer, True)
+        make_predict_job(initializer)
+        with test_case.assertRaises(Exception):
+            job(ids[0], targets[0]).get()
+
+    def test_variable_read_by_other_job_stays_dense(test_case):
+        initializer = flow.constant_initializer(0.5)
+        (ids, targets) = random_ids_and_targets(4)
+        # The last output is the embedding of the first ids after three updates.
+        ids[3] = ids[0]
+        expected = train_embedding("sgd", initializer, False, ids, targets)
+        flow.clear_default_session()
+        predict_job = make_predict_job(initializer)
+        job = make_embedding_job("sgd", initializer, True)
+        for i in range(3):
+            result = job(ids[i], targets[i]).get().numpy()
+            test_case.assertTrue(np.allclose(result, expected[i], rtol=1e-5, atol=1e-5))
+        result = predict_job(ids[0]).get().numpy()
+        test_case.assertTrue(np.allclose(result, expected[3], rtol=1e-5, atol=1e-5))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -250,10 +250,24 @@ def policy_time_line(func_desc):
     return "use_time_line_algo"
 
 
+@oneflow_function_config("static_mem_alloc_policy_white_list.policy_lifetime_packing")
+def policy_lifetime_packing(func_desc):
+    """A static memory allocation policy called: lifetime_packing
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_lifetime_packing_algo"
+
+
 @oneflow_function_config("static_mem_alloc_algo_white_list.show")
 def show_static_mem_alloc_algo_white_list(func_desc):
     """Show configuration of  static memory allocation policy,
-          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo"
+          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo",
+          "use_lifetime_packing_algo"
 
     Args:
         func_desc ([type]): [description]
@@ -265,6 +279,7 @@ def show_static_mem_alloc_algo_white_list(func_desc):
         "use_mem_size_first_algo",
         "use_mutual_exclusion_first_algo",
         "use_time_line_algo",
+        "use_lifetime_packing_algo",
     ]
 
 
@@ -695,6 +710,10 @@ def set_model_update_conf(func_desc, value):
 def set_indexed_slices_optimizer_conf(func_desc, value):
     """Set indexed slices configuration of optimizer
 
+    With "lazy_sparse_rows": True, the rows of CPU embeddings and of their optimizer
+    states are created the first time their ids are seen. Only single-client jobs
+    apply it.
+
     Args:
         func_desc ([type]): [description]
         value ([type]): [description]
@@ -728,6 +747,18 @@ def set_enable_gradients_stats_aggregation(func_desc, value=True):
     func_desc.job_config_proto.set_enable_gradients_stats_aggregation(value)
 
 
+@oneflow_function_config("enable_multi_tensor_model_update")
+def set_enable_multi_tensor_model_update(func_desc, value=True):
+    """Whether update the models sharing an optimizer configuration with one multi tensor
+            update op. Only CPU sgd, momentum and adam updates are grouped for now.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_enable_multi_tensor_model_update(value)
+
+
 @oneflow_function_config("train.loss_scale_factor")
 def set_loss_scale_factor(func_desc, value):
     """Set scale factor for loss
@@ -30,3 +30,73 @@ def ProfilerStart():
 
 def ProfilerStop():
     oneflow._oneflow_internal.profiler.ProfilerStop()
+
+
+def StartHostTrace():
+    oneflow._oneflow_internal.profiler.StartHostTrace()
+
+
+def StopHostTrace():
+    oneflow._oneflow_internal.profiler.StopHostTrace()
+
+
+def DumpHostTrace(path):
+    oneflow._oneflow_internal.profiler.DumpHostTrace(path)
+
+
+def EnableOpStats(enabled=True):
+    oneflow._oneflow_internal.profiler.EnableOpStats(enabled)
+
+
+def ResetOpStats():
+    oneflow._oneflow_internal.profiler.ResetOpStats()
+
+
+def OpStats(group_by="op_type"):
+    """Per op type or per op name call count, host wall time and bytes, sorted by total time.
+
+    Times are in nanoseconds. It can be called while the job is running.
+    """
+    assert group_by in ("op_type", "op_name"), group_by
+    stats = oneflow._oneflow_internal.profiler.GetOpStats(group_by == "op_type")
+    for stat in stats:
+        stat["mean_ns"] = stat["total_ns"] / stat["count"]
+    return stats
+
+
+def FormatOpStats(group_by="op_type", limit=None):
+    stats = OpStats(group_by)
+    if limit is not None:
+        stats = stats[:limit]
+    header = (
+        "name",
+        "count",
+        "total(ms)",
+        "mean(us)",
+        "p50(us)",
+        "p99(us)",
+        "in(MB)",
+        "out(MB)",
+    )
+    rows = [
+        (
+            stat["name"],
+            str(stat["count"]),
+            "%.3f" % (stat["total_ns"] / 1e6),
+            "%.3f" % (stat["mean_ns"] / 1e3),
+            "%.3f" % (stat["p50_ns"] / 1e3),
+            "%.3f" % (stat["p99_ns"] / 1e3),
+            "%.3f" % (stat["input_bytes"] / 1e6),
+            "%.3f" % (stat["output_bytes"] / 1e6),
+        )
+        for stat in stats
+    ]
+    widths = [max(len(row[i]) for row in [header] + rows) for i in range(len(header))]
+    lines = [
+        "  ".join(
+            cell.ljust(widths[i]) if i == 0 else cell.rjust(widths[i])
+            for (i, cell) in enumerate(row)
+        )
+        for row in [header] + rows
+    ]
+    return "\n".join(lines)
@@ -72,6 +72,14 @@ class GraphConfig(object):
         """
         self.proto.set_enable_fuse_model_update_ops(mode)
 
+    def allow_multi_tensor_model_update(self, mode: bool = True):
+        """If true, update the parameters sharing an optimizer configuration with one multi tensor update op, only on CPU for now.
+
+        Args:
+            mode (bool, optional): [description]. Default is True.
+        """
+        self.proto.set_enable_multi_tensor_model_update(mode)
+
     def allow_fuse_add_to_output(self, mode: bool = True):
         """If true, try to fuse a binary element-wise add to one of the predecessors to improve performance.
 
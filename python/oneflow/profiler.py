@@ -13,7 +13,14 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+from oneflow.framework.profiler import DumpHostTrace as dump_host_trace
+from oneflow.framework.profiler import EnableOpStats as enable_op_stats
+from oneflow.framework.profiler import FormatOpStats as format_op_stats
+from oneflow.framework.profiler import OpStats as op_stats
 from oneflow.framework.profiler import ProfilerStart as profiler_start
 from oneflow.framework.profiler import ProfilerStop as profiler_stop
 from oneflow.framework.profiler import RangePop as range_pop
 from oneflow.framework.profiler import RangePush as range_push
+from oneflow.framework.profiler import ResetOpStats as reset_op_stats
+from oneflow.framework.profiler import StartHostTrace as start_host_trace
+from oneflow.framework.profiler import StopHostTrace as stop_host_trace
@@ -0,0 +1,138 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+
+import oneflow as flow
+
+
+def train_with_graph(init_values, grad_seq, make_optimizer, multi_tensor):
+    class CustomModule(flow.nn.Module):
+        def __init__(self):
+            super().__init__()
+            self.params = flow.nn.ParameterList(
+                [flow.nn.Parameter(flow.tensor(value)) for value in init_values]
+            )
+
+        def forward(self, masks):
+            loss = None
+            for (param, mask) in zip(self.params, masks):
+                param_loss = flow.sum(param * mask)
+                loss = param_loss if loss is None else loss + param_loss
+            return loss
+
+    module = CustomModule()
+    module.train()
+    optimizer = make_optimizer(module.parameters())
+
+    class CustomGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.m = module
+            self.add_optimizer(optimizer)
+            self.config.allow_multi_tensor_model_update(multi_tensor)
+
+        def build(self, *masks):
+            loss = self.m(masks)
+            loss.backward()
+            return loss
+
+    graph = CustomGraph()
+    for grads in grad_seq:
+        graph(*[flow.tensor(grad) for grad in grads])
+    op_type_names = [op.user_conf.op_type_name for op in graph._full_graph_proto.net.op]
+    return ([param.numpy() for param in module.params], op_type_names)
+
+
+def compare_multi_tensor_update(
+    test_case,
+    make_optimizer,
+    update_op_type_name,
+    multi_tensor_update_op_num=1,
+    update_op_num=0,
+):
+    # The largest model is split into several chunks.
+    shapes = [(10,), (3, 4), (1,), (256, 300), (7, 5, 3)]
+    init_values = [np.random.uniform(size=shape).astype(np.float32) for shape in shapes]
+    grad_seq = [
+        [np.random.uniform(size=shape).astype(np.float32) for shape in shapes]
+        for _ in range(5)
+    ]
+    (expected, op_type_names) = train_with_graph(
+        init_values, grad_seq, make_optimizer, False
+    )
+    test_case.assertEqual(op_type_names.count(update_op_type_name), len(shapes))
+    (results, op_type_names) = train_with_graph(
+        init_values, grad_seq, make_optimizer, True
+    )
+    # The update ops left are the ones the pass must not group.
+    test_case.assertEqual(
+        op_type_names.count("multi_tensor_" + update_op_type_name),
+        multi_tensor_update_op_num,
+    )
+    test_case.assertEqual(op_type_names.count(update_op_type_name), update_op_num)
+    for (result, expected_result) in zip(results, expected):
+        test_case.assertTrue(np.allclose(result, expected_result, rtol=1e-5, atol=1e-5))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphMultiTensorModelUpdate(flow.unittest.TestCase):
+    def test_sgd(test_case):
+        compare_multi_tensor_update(
+            test_case,
+            lambda params: flow.optim.SGD(params, lr=0.1, weight_decay=0.01),
+            "sgd_update",
+        )
+
+    def test_momentum(test_case):
+        compare_multi_tensor_update(
+            test_case,
+            lambda params: flow.optim.SGD(params, lr=0.1, momentum=0.9),
+            "momentum_update",
+        )
+
+    def test_adam(test_case):
+        compare_multi_tensor_update(
+            test_case,
+            lambda params: flow.optim.Adam(params, lr=0.01, weight_decay=0.01),
+            "adam_update",
+        )
+
+    def test_different_attrs_not_grouped(test_case):
+        def make_optimizer(params):
+            params = list(params)
+            # The weight decay becomes the l2 attr of the update ops, so only the
+            # models of a param group are grouped, and the last one is left alone.
+            return flow.optim.SGD(
+                [
+                    {"params": params[:2], "weight_decay": 0.01},
+                    {"params": params[2:4], "weight_decay": 0.02},
+                    {"params": params[4:], "weight_decay": 0.03},
+                ],
+                lr=0.1,
+            )
+
+        compare_multi_tensor_update(
+            test_case,
+            make_optimizer,
+            "sgd_update",
+            multi_tensor_update_op_num=2,
+            update_op_num=1,
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -185,6 +185,28 @@ class TestSoftmax(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    def test_softmax_long_rows(test_case):
+        # Rows longer than the cache resident size take the online max and sum path on cpu.
+        arr = np.random.randn(3, 40000).astype(np.float32) * 10
+        arr[1, 30000] = 100
+        x = flow.tensor(arr, device="cpu", requires_grad=True)
+        for log in [False, True]:
+            y = flow.nn.LogSoftmax(dim=1)(x) if log else flow.nn.Softmax(dim=1)(x)
+            shifted = arr - arr.max(axis=1, keepdims=True)
+            exp = np.exp(shifted)
+            np_prob = exp / exp.sum(axis=1, keepdims=True)
+            np_log_prob = shifted - np.log(exp.sum(axis=1, keepdims=True))
+            np_out = np_log_prob if log else np_prob
+            test_case.assertTrue(np.allclose(y.numpy(), np_out, 1e-04, 1e-06))
+            dy = np.random.randn(3, 40000).astype(np.float32)
+            (y * flow.tensor(dy)).sum().backward()
+            if log:
+                np_grad = dy - np_prob * dy.sum(axis=1, keepdims=True)
+            else:
+                np_grad = (dy - (dy * np_prob).sum(axis=1, keepdims=True)) * np_prob
+            test_case.assertTrue(np.allclose(x.grad.numpy(), np_grad, 1e-03, 1e-05))
+            x.grad = None
+
 
 @flow.unittest.skip_unless_1n1d()
 class TestHardsigmoidModule(flow.unittest.TestCase):
@@ -0,0 +1,120 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import time
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+from test_util import GenArgList
+
+
+def _cpu_all_reduce(x, placement):
+    y = x.to_consistent(placement=placement, sbp=flow.sbp.partial_sum)
+    return y.to_consistent(placement=placement, sbp=flow.sbp.broadcast)
+
+
+def _placement(ranks, process_num_per_node):
+    node_id2device_ids = OrderedDict()
+    for rank in ranks:
+        node_id = rank // process_num_per_node
+        node_id2device_ids.setdefault(node_id, []).append(rank % process_num_per_node)
+    return flow.placement("cpu", dict(node_id2device_ids))
+
+
+def _test_cpu_all_reduce(test_case, ranks, elem_cnt, process_num_per_node):
+    placement = _placement(ranks, process_num_per_node)
+    np_arr = np.arange(elem_cnt, dtype=np.float32) % 97
+    rank = flow.env.get_rank()
+    x = flow.tensor(np_arr * (rank + 1), dtype=flow.float32)
+    y = _cpu_all_reduce(x, placement)
+    if rank in ranks:
+        scale = sum(r + 1 for r in ranks)
+        test_case.assertTrue(np.allclose(y.to_local().numpy(), np_arr * scale))
+
+
+def _test_cpu_all_reduce_with_and_without_shm(test_case, arg_dict):
+    old_enable_shm = os.getenv("ONEFLOW_CCL_CPU_ENABLE_SHM")
+    try:
+        # without shm, the ranks of a node also take the flat ring or halving/doubling
+        for enable_shm in ["1", "0"]:
+            os.environ["ONEFLOW_CCL_CPU_ENABLE_SHM"] = enable_shm
+            for arg in GenArgList(arg_dict):
+                _test_cpu_all_reduce(test_case, *arg)
+    finally:
+        if old_enable_shm is None:
+            del os.environ["ONEFLOW_CCL_CPU_ENABLE_SHM"]
+        else:
+            os.environ["ONEFLOW_CCL_CPU_ENABLE_SHM"] = old_enable_shm
+
+
+def _benchmark_cpu_all_reduce(device_list):
+    placement = flow.placement("cpu", {0: device_list})
+    world_size = len(device_list)
+    warmup_iters, iters = 5, 20
+    for byte_size in [2 ** i for i in range(10, 29, 2)]:
+        x = flow.ones(byte_size // 4, dtype=flow.float32)
+        for _ in range(warmup_iters):
+            _cpu_all_reduce(x, placement).to_local().numpy()
+        start = time.perf_counter()
+        for _ in range(iters):
+            _cpu_all_reduce(x, placement).to_local().numpy()
+        elapsed = (time.perf_counter() - start) / iters
+        alg_bw = byte_size / elapsed / 1e9
+        bus_bw = alg_bw * 2 * (world_size - 1) / world_size
+        if flow.env.get_rank() == 0:
+            print(
+                "all_reduce %10d bytes: %9.1f us, algbw %6.2f GB/s, busbw %6.2f GB/s"
+                % (byte_size, elapsed * 1e6, alg_bw, bus_bw)
+            )
+
+
+@flow.unittest.skip_unless_1n4d()
+class TestCpuAllReduce(flow.unittest.TestCase):
+    def test_cpu_all_reduce(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["ranks"] = [[0, 1], [1, 2, 3], [0, 1, 2, 3]]
+        # small sizes take recursive halving/doubling, large ones the chunked ring
+        arg_dict["elem_cnt"] = [1, 3, 1000, 1 << 20, (1 << 20) + 7]
+        arg_dict["process_num_per_node"] = [4]
+        _test_cpu_all_reduce_with_and_without_shm(test_case, arg_dict)
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_CPU_ALL_REDUCE_BENCHMARK"), "only run on demand"
+    )
+    def test_cpu_all_reduce_benchmark(test_case):
+        # python3 -m oneflow.distributed.launch --nproc_per_node 4 test_cpu_all_reduce.py
+        _benchmark_cpu_all_reduce([0, 1, 2, 3])
+
+
+@flow.unittest.skip_unless_2n2d()
+class TestCpuAllReduce2Nodes(flow.unittest.TestCase):
+    def test_cpu_all_reduce_uneven_nodes(test_case):
+        arg_dict = OrderedDict()
+        # with uneven ranks per node, the leader alone on its node must still go
+        # through the same shared memory slot pieces as the other leader
+        arg_dict["ranks"] = [[0, 1, 2], [1, 2, 3], [0, 2], [0, 1, 2, 3]]
+        # more than one 4MiB slot of floats
+        arg_dict["elem_cnt"] = [1, 1000, (1 << 20) + 7, (1 << 21) + 3]
+        arg_dict["process_num_per_node"] = [2]
+        _test_cpu_all_reduce_with_and_without_shm(test_case, arg_dict)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,126 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import subprocess
+import sys
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+
+_PRELUDE = """
+import numpy as np
+import oneflow as flow
+
+def _random(*shape):
+    return np.random.uniform(-1, 1, shape).astype(np.float32)
+
+flow.profiler.reset_op_stats()
+flow.profiler.enable_op_stats(True)
+"""
+
+_CHECK_FUSED = """
+stats = flow.profiler.op_stats(group_by="op_type")
+fused = [stat for stat in stats if stat["op_type"] == "eager_fused_elementwise"]
+assert len(fused) == 1 and fused[0]["count"] > 0, stats
+"""
+
+_CHAIN = """
+(x, a, b) = (_random(4, 1000), _random(4, 1000), _random(4, 1000))
+y = flow.tensor(x)
+for _ in range(40):
+    y = flow.relu(y * flow.tensor(a) + flow.tensor(b)) - 0.5
+    x = np.maximum(x * a + b, 0) - 0.5
+assert np.allclose(y.numpy(), x, atol=1e-5)
+"""
+
+_ESCAPED_INTERMEDIATE = """
+(x, a) = (_random(3, 5), _random(3, 5))
+(of_x, of_a) = (flow.tensor(x), flow.tensor(a))
+of_mul = of_x * of_a
+of_div = (of_mul + 2) / of_a
+of_out = flow.add(of_div, of_mul, of_x)
+assert np.allclose(of_mul.numpy(), x * a, atol=1e-5)
+assert np.allclose(of_out.numpy(), (x * a + 2) / a + x * a + x, atol=1e-5)
+"""
+
+_INPLACE_AFTER_BUFFERED_READ = """
+(x, a) = (_random(8), _random(8))
+(of_x, of_a) = (flow.tensor(x), flow.tensor(a))
+of_y = of_x * 3
+of_x.add_(of_a)
+assert np.allclose(of_y.numpy(), x * 3, atol=1e-5)
+assert np.allclose(of_x.numpy(), x + a, atol=1e-5)
+"""
+
+# Broadcasting and other dtypes run unfused between buffered ops.
+_NOT_FUSIBLE = """
+(x, b) = (_random(2, 3), _random(3))
+of_x = flow.tensor(x) + 1
+of_y = flow.tensor(x, dtype=flow.float64) * 2
+of_z = of_x + flow.tensor(b)
+assert np.allclose(of_z.numpy(), x + 1 + b, atol=1e-5)
+assert np.allclose(of_y.numpy(), x * 2, atol=1e-5)
+"""
+
+# The backward ops read the buffered results of the forward ones.
+_REQUIRES_GRAD = """
+(x, a, b) = (_random(4, 7), _random(4, 7), _random(4, 7))
+of_x = flow.tensor(x, requires_grad=True)
+of_a = flow.tensor(a, requires_grad=True)
+of_y = flow.relu(of_x * of_a + flow.tensor(b)) * 2 - of_x
+of_y.sum().backward()
+mask = (x * a + b > 0).astype(np.float32)
+assert np.allclose(of_y.numpy(), np.maximum(x * a + b, 0) * 2 - x, atol=1e-5)
+assert np.allclose(of_x.grad.numpy(), 2 * mask * a - 1, atol=1e-5)
+assert np.allclose(of_a.grad.numpy(), 2 * mask * x, atol=1e-5)
+"""
+
+
+def _run_with_fusion(test_case, code):
+    # The fusion flag is read once, so the code runs in a new process.
+    env = dict(os.environ)
+    env["ONEFLOW_EAGER_ELEMENTWISE_FUSION"] = "1"
+    result = subprocess.run(
+        [sys.executable, "-c", _PRELUDE + code + _CHECK_FUSED],
+        env=env,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+    )
+    test_case.assertEqual(result.returncode, 0, result.stderr)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerElementwiseFusion(flow.unittest.TestCase):
+    def test_chain(test_case):
+        _run_with_fusion(test_case, _CHAIN)
+
+    def test_escaped_intermediate(test_case):
+        _run_with_fusion(test_case, _ESCAPED_INTERMEDIATE)
+
+    def test_inplace_after_buffered_read(test_case):
+        _run_with_fusion(test_case, _INPLACE_AFTER_BUFFERED_READ)
+
+    def test_not_fusible(test_case):
+        _run_with_fusion(test_case, _NOT_FUSIBLE)
+
+    def test_requires_grad(test_case):
+        _run_with_fusion(test_case, _REQUIRES_GRAD)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,114 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _infer_cache_counts():
+    one = flow._oneflow_internal.one
+    return (
+        one.GetLocalTensorInferCacheHitCount(),
+        one.GetLocalTensorInferCacheMissCount(),
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerInferCache(flow.unittest.TestCase):
+    def test_same_shapes_hit(test_case):
+        x = flow.tensor(np.random.randn(3, 4).astype(np.float32))
+        flow.matmul(x, x.T)
+        (hits, misses) = _infer_cache_counts()
+        for _ in range(10):
+            y = flow.matmul(x, x.T)
+        (new_hits, new_misses) = _infer_cache_counts()
+        test_case.assertGreaterEqual(new_hits - hits, 10)
+        test_case.assertEqual(new_misses, misses)
+        test_case.assertTrue(np.allclose(y.numpy(), np.matmul(x.numpy(), x.numpy().T)))
+
+    def test_new_shapes_infer(test_case):
+        # Shapes no other case uses, so that the first call of each misses.
+        for (shape, is_new) in [
+            ((7, 3), True),
+            ((4, 13), True),
+            ((7, 3), False),
+            ((17,), True),
+            ((4, 13), False),
+        ]:
+            x = np.random.randn(*shape).astype(np.float32)
+            of_x = flow.tensor(x)
+            (hits, misses) = _infer_cache_counts()
+            y = flow.sum(of_x, dim=0)
+            (new_hits, new_misses) = _infer_cache_counts()
+            if is_new:
+                test_case.assertGreaterEqual(new_misses - misses, 1)
+            else:
+                test_case.assertEqual(new_misses, misses)
+                test_case.assertGreaterEqual(new_hits - hits, 1)
+            test_case.assertEqual(y.shape, flow.Size(x.shape[1:]))
+            test_case.assertTrue(np.allclose(y.numpy(), np.sum(x, axis=0), atol=1e-5))
+
+    def test_attrs_are_part_of_key(test_case):
+        x = np.random.randn(2, 3, 4).astype(np.float32)
+        of_x = flow.tensor(x)
+        for dims in [(0, 2, 1), (2, 1, 0), (0, 2, 1)]:
+            y = of_x.permute(*dims)
+            test_case.assertTrue(np.array_equal(y.numpy(), np.transpose(x, dims)))
+
+    def test_repeated_small_op_hits(test_case):
+        x = flow.ones(4)
+        flow.relu(x)
+        (hits, misses) = _infer_cache_counts()
+        op_num = 100
+        for _ in range(op_num):
+            x = flow.relu(x)
+        (new_hits, new_misses) = _infer_cache_counts()
+        test_case.assertGreaterEqual(new_hits - hits, op_num)
+        test_case.assertEqual(new_misses, misses)
+        test_case.assertTrue(np.array_equal(x.numpy(), np.ones(4, np.float32)))
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_device_infer_op(test_case):
+        # copy infers its device from its attrs rather than from its input.
+        x = np.random.randn(5, 11).astype(np.float32)
+        of_x = flow.tensor(x)
+        (hits, misses) = _infer_cache_counts()
+        y = of_x.to("cuda")
+        (new_hits, new_misses) = _infer_cache_counts()
+        test_case.assertGreaterEqual(new_misses - misses, 1)
+        test_case.assertEqual(y.device, flow.device("cuda", 0))
+        # Same input and attrs, the cached device is right.
+        (hits, misses) = (new_hits, new_misses)
+        y = of_x.to("cuda")
+        (new_hits, new_misses) = _infer_cache_counts()
+        test_case.assertGreaterEqual(new_hits - hits, 1)
+        test_case.assertEqual(new_misses, misses)
+        test_case.assertEqual(y.device, flow.device("cuda", 0))
+        # Back to cpu, the other device attr misses.
+        (hits, misses) = (new_hits, new_misses)
+        z = y.to("cpu")
+        (new_hits, new_misses) = _infer_cache_counts()
+        test_case.assertGreaterEqual(new_misses - misses, 1)
+        test_case.assertEqual(z.device, flow.device("cpu"))
+        test_case.assertTrue(np.array_equal(z.numpy(), x))
+
+
+if __name__ == "__main__":
+    unittest.main()
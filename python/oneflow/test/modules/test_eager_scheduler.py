@@ -0,0 +1,128 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import subprocess
+import sys
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+
+# Single threaded kernels, so that the worker thread takes one core at most.
+_SINGLE_THREAD_ENV = {
+    "OMP_NUM_THREADS": "1",
+    "MKL_NUM_THREADS": "1",
+    "OPENBLAS_NUM_THREADS": "1",
+}
+
+_SMALL_OPS_CODE = """
+import numpy as np
+import oneflow as flow
+
+x = flow.zeros(1)
+for _ in range(2000):
+    x = x + 1
+assert np.array_equal(x.numpy(), np.array([2000], np.float32))
+"""
+
+# Prints the eager instructions/sec of a chain of small CPU ops.
+_THROUGHPUT_CODE = """
+import time
+import numpy as np
+import oneflow as flow
+
+op_num = 20000
+x = flow.zeros(1)
+x.numpy()
+start = time.perf_counter()
+for _ in range(op_num):
+    x = x + 1
+result = x.numpy()
+elapsed = time.perf_counter() - start
+assert np.array_equal(result, np.array([op_num], np.float32))
+print(op_num / elapsed)
+"""
+
+# Prints the cores the process takes while the main thread sleeps and the worker
+# thread runs a chain of long matmuls.
+_LONG_OPS_CODE = """
+import time
+import numpy as np
+import oneflow as flow
+
+x = flow.ones(1024, 1024)
+x.numpy()
+y = x
+for _ in range(64):
+    y = flow.matmul(y, x) / 1024
+wall_start = time.perf_counter()
+cpu_start = time.process_time()
+time.sleep(1)
+cpu_time = time.process_time() - cpu_start
+wall_time = time.perf_counter() - wall_start
+assert np.allclose(y.numpy(), np.ones((1024, 1024)))
+print(cpu_time / wall_time)
+"""
+
+
+def _run_with_scheduler_env(test_case, code, spin_us, max_wait_us):
+    # The VM reads the scheduler env once, so the code runs in a new process.
+    env = dict(os.environ)
+    env.update(_SINGLE_THREAD_ENV)
+    env["ONEFLOW_VM_SCHEDULER_SPIN_US"] = str(spin_us)
+    env["ONEFLOW_VM_SCHEDULER_MAX_WAIT_US"] = str(max_wait_us)
+    result = subprocess.run(
+        [sys.executable, "-c", code],
+        env=env,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+    )
+    test_case.assertEqual(result.returncode, 0, result.stderr)
+    return result.stdout
+
+
+def _benchmark_scheduler(test_case, spin_us, max_wait_us):
+    env = (spin_us, max_wait_us)
+    ops_per_second = float(
+        _run_with_scheduler_env(test_case, _THROUGHPUT_CODE, *env).split()[-1]
+    )
+    cores = float(_run_with_scheduler_env(test_case, _LONG_OPS_CODE, *env).split()[-1])
+    print(
+        "eager scheduler spin_us=%-4d max_wait_us=%-4d: %10.0f instructions/sec, "
+        "%.2f cores while waiting for a long op"
+        % (spin_us, max_wait_us, ops_per_second, cores)
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerScheduler(flow.unittest.TestCase):
+    def test_small_ops(test_case):
+        _run_with_scheduler_env(test_case, _SMALL_OPS_CODE, -1, 200)
+        # Waits right away, it relies on the notifications of Receive and the worker.
+        _run_with_scheduler_env(test_case, _SMALL_OPS_CODE, 0, 1000 * 1000)
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_EAGER_SCHEDULER_BENCHMARK"), "only run on demand"
+    )
+    def test_eager_scheduler_benchmark(test_case):
+        # The busy scheduler takes a core of its own while a long op runs.
+        for (spin_us, max_wait_us) in [(-1, 200), (0, 200), (50, 200), (50, 1000)]:
+            _benchmark_scheduler(test_case, spin_us, max_wait_us)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import os
+import time
 import unittest
 from collections import OrderedDict
 
@@ -126,6 +128,40 @@ def _test_layernorm_backward(test_case, device):
     )
 
 
+def _reduce_layer_norm(x, weight, bias, begin_norm_axis, eps):
+    # the mean/var reductions nn.LayerNorm used on cpu before the fused kernels
+    reduce_axis = list(range(begin_norm_axis, len(x.shape)))
+    mean = x.mean(dim=reduce_axis, keepdim=True)
+    variance = x.var(dim=reduce_axis, unbiased=False, keepdim=True)
+    return (x - mean) * (variance + eps).rsqrt() * weight + bias
+
+
+def _benchmark_layernorm(shape, backward):
+    x = flow.tensor(np.random.randn(*shape).astype(np.float32), requires_grad=backward)
+    m = flow.nn.LayerNorm(shape[-1:])
+    impls = OrderedDict()
+    impls["layer_norm"] = m
+    impls["reduce"] = lambda x: _reduce_layer_norm(
+        x, m.weight, m.bias, len(shape) - 1, m.eps
+    )
+    warmup_iters, iters = 3, 10
+    for name, impl in impls.items():
+        for i in range(warmup_iters + iters):
+            if i == warmup_iters:
+                start = time.perf_counter()
+            y = impl(x)
+            if backward:
+                y.sum().backward()
+                x.grad.numpy()
+            else:
+                y.numpy()
+        elapsed = (time.perf_counter() - start) / iters
+        print(
+            "layer_norm %-16s backward=%d %-10s: %10.1f us"
+            % (shape, backward, name, elapsed * 1e6)
+        )
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestLayerNorm(flow.unittest.TestCase):
     def test_layernorm(test_case):
@@ -164,6 +200,16 @@ class TestLayerNorm(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_LAYER_NORM_BENCHMARK"), "only run on demand"
+    )
+    def test_layernorm_benchmark(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["shape"] = [(512, 768), (4096, 1024), (64, 128, 4096)]
+        arg_dict["backward"] = [False, True]
+        for arg in GenArgList(arg_dict):
+            _benchmark_layernorm(*arg)
+
 
 if __name__ == "__main__":
     unittest.main()
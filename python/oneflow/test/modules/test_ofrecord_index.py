@@ -0,0 +1,121 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import struct
+import tempfile
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.core.record import record_pb2 as record_pb
+from oneflow.utils.data.ofrecord_index import (
+    build_ofrecord_index,
+    load_ofrecord_index,
+)
+
+
+def _write_ofrecord_parts(data_dir, record_nums, indexed_part_ids):
+    """Returns the labels of the records, part by part."""
+    labels = []
+    for (i, record_num) in enumerate(record_nums):
+        part_path = os.path.join(data_dir, "part-%d" % i)
+        with open(part_path, "wb") as f:
+            for j in range(record_num):
+                record = record_pb.OFRecord()
+                record.feature["label"].int32_list.value.append(100 * i + j)
+                data = record.SerializeToString()
+                f.write(struct.pack("<q", len(data)))
+                f.write(data)
+                labels.append(100 * i + j)
+        if i in indexed_part_ids:
+            build_ofrecord_index(part_path)
+    return labels
+
+
+def _read_labels(data_dir, data_part_num, batch_num, env):
+    saved_env = {key: os.getenv(key) for key in env}
+    os.environ.update(env)
+    try:
+        reader = flow.nn.OFRecordReader(
+            data_dir, batch_size=2, data_part_num=data_part_num
+        )
+        decoder = flow.nn.OFRecordRawDecoder("label", shape=(), dtype=flow.int32)
+        labels = []
+        for _ in range(batch_num):
+            labels.extend(decoder(reader()).numpy().tolist())
+        return labels
+    finally:
+        for (key, value) in saved_env.items():
+            if value is None:
+                os.environ.pop(key)
+            else:
+                os.environ[key] = value
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordIndex(flow.unittest.TestCase):
+    def test_build_and_load(test_case):
+        records = [b"a" * n for n in (1, 17, 5, 300)]
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            part_path = os.path.join(tmp_dir, "part-0")
+            with open(part_path, "wb") as f:
+                for record in records:
+                    f.write(struct.pack("<q", len(record)))
+                    f.write(record)
+            test_case.assertEqual(build_ofrecord_index(part_path), len(records))
+            entries = load_ofrecord_index(part_path)
+            with open(part_path, "rb") as f:
+                data = f.read()
+            test_case.assertEqual(
+                [data[offset : offset + length] for (offset, length) in entries],
+                records,
+            )
+            with open(part_path, "ab") as f:
+                f.write(struct.pack("<q", 1) + b"b")
+            with test_case.assertRaises(AssertionError):
+                load_ofrecord_index(part_path)
+
+    def test_indexed_reader(test_case):
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            # Part 1 has no index and gets scanned.
+            labels = _write_ofrecord_parts(tmp_dir, [3, 4, 2], [0, 2])
+            expected = (labels * 3)[:16]
+            test_case.assertEqual(
+                _read_labels(tmp_dir, 3, 8, {"ONEFLOW_DATA_OFRECORD_INDEXED": "0"}),
+                expected,
+            )
+            test_case.assertEqual(
+                _read_labels(tmp_dir, 3, 8, {"ONEFLOW_DATA_OFRECORD_INDEXED": "1"}),
+                expected,
+            )
+
+    def test_indexed_reader_skip_sample_num(test_case):
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            labels = _write_ofrecord_parts(tmp_dir, [3, 4, 2], [0, 1, 2])
+            # Past the end of the first epoch.
+            skip_sample_num = 11
+            env = {
+                "ONEFLOW_DATA_OFRECORD_INDEXED": "1",
+                "ONEFLOW_DATA_OFRECORD_SKIP_SAMPLE_NUM": str(skip_sample_num),
+            }
+            test_case.assertEqual(
+                _read_labels(tmp_dir, 3, 4, env),
+                (labels * 3)[skip_sample_num : skip_sample_num + 8],
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,48 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestProfilerOpStats(flow.unittest.TestCase):
+    def test_eager_op_stats(test_case):
+        flow.profiler.reset_op_stats()
+        flow.profiler.enable_op_stats(True)
+        x = flow.randn(16, 32)
+        for _ in range(5):
+            y = flow.relu(x)
+        y.numpy()
+        stats = flow.profiler.op_stats(group_by="op_type")
+        flow.profiler.enable_op_stats(False)
+        relu_stats = [stat for stat in stats if stat["op_type"] == "relu"]
+        test_case.assertEqual(len(relu_stats), 1)
+        relu_stat = relu_stats[0]
+        test_case.assertEqual(relu_stat["count"], 5)
+        test_case.assertEqual(relu_stat["input_bytes"], 5 * 16 * 32 * 4)
+        test_case.assertEqual(relu_stat["output_bytes"], 5 * 16 * 32 * 4)
+        test_case.assertGreater(relu_stat["total_ns"], 0)
+        test_case.assertLessEqual(relu_stat["p50_ns"], relu_stat["p99_ns"])
+        test_case.assertIn("relu", flow.profiler.format_op_stats(group_by="op_type"))
+        flow.profiler.reset_op_stats()
+        test_case.assertEqual(flow.profiler.op_stats(), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,85 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import argparse
+import os
+import struct
+
+_MAGIC = b"OFRINDEX"
+
+
+def ofrecord_index_path(part_path):
+    return part_path + ".index"
+
+
+def build_ofrecord_index(part_path):
+    """Writes the record offset index of an OFRecord part file next to it.
+
+    With ONEFLOW_DATA_OFRECORD_INDEXED=1, the OFRecordReader reads records through
+    these indexes. All ranks then draw disjoint samples from one shuffle of the
+    whole dataset and resume from ONEFLOW_DATA_OFRECORD_SKIP_SAMPLE_NUM without
+    scanning the part files.
+    Returns the record num.
+    """
+    part_size = os.path.getsize(part_path)
+    entries = []
+    with open(part_path, "rb") as f:
+        offset = 0
+        while offset < part_size:
+            header = f.read(8)
+            assert len(header) == 8, "truncated record at %d of %s" % (
+                offset,
+                part_path,
+            )
+            (length,) = struct.unpack("<q", header)
+            assert length > 0, "invalid record at %d of %s" % (offset, part_path)
+            offset += 8
+            assert offset + length <= part_size, "truncated record in %s" % part_path
+            entries.append((offset, length))
+            offset += length
+            f.seek(offset)
+    index_path = ofrecord_index_path(part_path)
+    tmp_path = index_path + ".tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(_MAGIC)
+        f.write(struct.pack("<qq", part_size, len(entries)))
+        for entry in entries:
+            f.write(struct.pack("<qq", *entry))
+    os.replace(tmp_path, index_path)
+    return len(entries)
+
+
+def load_ofrecord_index(part_path):
+    """Returns the (offset, length) of each record body in an indexed part file."""
+    with open(ofrecord_index_path(part_path), "rb") as f:
+        assert f.read(len(_MAGIC)) == _MAGIC
+        (part_size, record_num) = struct.unpack("<qq", f.read(16))
+        assert part_size == os.path.getsize(part_path), "stale index of " + part_path
+        return [struct.unpack("<qq", f.read(16)) for _ in range(record_num)]
+
+
+def _main():
+    parser = argparse.ArgumentParser(
+        description="Build the record offset indexes of OFRecord part files"
+    )
+    parser.add_argument("part_paths", nargs="+")
+    args = parser.parse_args()
+    for part_path in args.part_paths:
+        record_num = build_ofrecord_index(part_path)
+        print("%s: %d records" % (ofrecord_index_path(part_path), record_num))
+
+
+if __name__ == "__main__":
+    _main()